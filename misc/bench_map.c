@@ -0,0 +1,156 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/lib/objects/objects.h"
+
+// Measures the time taken by map insertions and lookups
+// (both hits and misses) with int and string keys, for
+// maps of increasing size.
+//
+//   make bench_map && ./bench_map
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static Object *makeKey(int i, Heap *heap, Error *error)
+{
+    if (i & 1) {
+        char buffer[32];
+        int n = snprintf(buffer, sizeof(buffer), "key_%d", i);
+        return Object_FromString(buffer, n, heap, error);
+    }
+    return Object_FromInt(i, heap, error);
+}
+
+int main(void)
+{
+    Error error;
+    Error_Init(&error);
+
+    Heap *heap = Heap_New(1 << 30);
+    if (heap == NULL) {
+        fprintf(stderr, "Error: Failed to create the heap\n");
+        return -1;
+    }
+
+    int sizes[] = {4, 8, 64, 1024, 65536};
+    int total_lookups = 1 << 22;
+
+    for (size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+
+        int n = sizes[s];
+
+        // Keys [0, n) are inserted and keys [n, 2n) 
+        // are used to measure misses. Lookups use equal 
+        // but distinct objects, like the ones produced
+        // when running a script.
+        Object **keys  = malloc(n * sizeof(Object*));
+        Object **probe = malloc(2 * n * sizeof(Object*));
+        for (int i = 0; i < n; i++)
+            keys[i] = makeKey(i, heap, &error);
+        for (int i = 0; i < 2 * n; i++)
+            probe[i] = makeKey(i, heap, &error);
+
+        double t0 = now();
+        Object *map = Object_NewMap(-1, heap, &error);
+        for (int i = 0; i < n; i++)
+            Object_Insert(map, keys[i], keys[i], heap, &error);
+        double t1 = now();
+
+        int rounds = total_lookups / n;
+        long long found = 0;
+        for (int r = 0; r < rounds; r++)
+            for (int i = 0; i < n; i++)
+                found += (Object_Select(map, probe[i], heap, &error) != NULL);
+        double t2 = now();
+
+        long long missed = 0;
+        for (int r = 0; r < rounds; r++)
+            for (int i = n; i < 2 * n; i++)
+                missed += (Object_Select(map, probe[i], heap, &error) == NULL);
+        double t3 = now();
+
+        if (error.occurred) {
+            Error_Print(&error, ErrorType_INTERNAL, stderr);
+            return -1;
+        }
+
+        // Building many small maps measures the cost of
+        // allocating them, which dominates for records.
+        int builds = n <= 8 ? 1 << 16 : 0;
+        for (int b = 0; b < builds; b++) {
+            Object *small = Object_NewMap(-1, heap, &error);
+            for (int i = 0; i < n; i++)
+                Object_Insert(small, keys[i], keys[i], heap, &error);
+        }
+        double t4 = now();
+
+        if (error.occurred) {
+            Error_Print(&error, ErrorType_INTERNAL, stderr);
+            return -1;
+        }
+
+        double lookups = (double) rounds * n;
+        printf("size=%-6d insert=%6.1f ns  hit=%6.1f ns  miss=%6.1f ns", n,
+               (t1 - t0) * 1e9 / n, (t2 - t1) * 1e9 / lookups, (t3 - t2) * 1e9 / lookups);
+        if (builds > 0)
+            printf("  build=%6.1f ns", (t4 - t3) * 1e9 / builds);
+        printf("  (%lld found, %lld missed)\n", found, missed);
+        free(keys);
+        free(probe);
+    }
+
+    // Maps with dense int keys, like arrays, counters
+    // and histograms. Updates select and reinsert a key.
+    int dense_sizes[] = {1024, 65536};
+
+    for (size_t s = 0; s < sizeof(dense_sizes)/sizeof(dense_sizes[0]); s++) {
+
+        int n = dense_sizes[s];
+
+        Object **probe = malloc(n * sizeof(Object*));
+        for (int i = 0; i < n; i++)
+            probe[i] = Object_FromInt(i, heap, &error);
+
+        double t0 = now();
+        Object *map = Object_NewMap(-1, heap, &error);
+        for (int i = 0; i < n; i++)
+            Object_Insert(map, Object_FromInt(i, heap, &error), probe[i], heap, &error);
+        double t1 = now();
+
+        int rounds = total_lookups / n;
+        long long found = 0;
+        for (int r = 0; r < rounds; r++)
+            for (int i = 0; i < n; i++)
+                found += (Object_Select(map, probe[i], heap, &error) != NULL);
+        double t2 = now();
+
+        // Updates allocate, so they're fewer.
+        int updates = 1 << 18;
+        for (int u = 0; u < updates; u++) {
+            Object *key = probe[(u * 7919) % n];
+            Object *val = Object_Select(map, key, heap, &error);
+            val = Object_FromInt(Object_GetInt(val) + 1, heap, &error);
+            Object_Insert(map, key, val, heap, &error);
+        }
+        double t3 = now();
+
+        if (error.occurred) {
+            Error_Print(&error, ErrorType_INTERNAL, stderr);
+            return -1;
+        }
+
+        double lookups = (double) rounds * n;
+        printf("dense=%-5d insert=%6.1f ns  hit=%6.1f ns  update=%6.1f ns  (%lld found)\n", n,
+               (t1 - t0) * 1e9 / n, (t2 - t1) * 1e9 / lookups, (t3 - t2) * 1e9 / updates, found);
+        free(probe);
+    }
+
+    Heap_Free(heap);
+    Error_Free(&error);
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/lib/utils/bpalloc.h"
+#include "../src/lib/compiler/parse.h"
+#include "../src/lib/compiler/compile.h"
+
+// Measures the throughput of the parser, and of the 
+// whole compiler, on a large generated source, like the
+// ones produced by code generators.
+//
+//   make bench_parse && ./bench_parse [megabytes]
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Appends one function with a bit of everything: 
+// comments, strings, maps, lists, operators and the
+// control flow statements.
+static int generateFunction(char *dst, size_t max, int i)
+{
+    return snprintf(dst, max,
+        "# Rule number %d, generated.\n"
+        "fun rule_%d(record: Map, limit: int = %d) {\n"
+        "    tags = [\"alpha\", 'beta', \"gamma_%d\", none, true, false];\n"
+        "    info = {name: \"rule_%d\", weight: %d.5, \"key with spaces\": [1, 2, 3]};\n"
+        "    total = 0;\n"
+        "    for tag in tags: {\n"
+        "        if tag != none and count(tags) >= 3 or not false:\n"
+        "            total = total + (limit * %d - 7) %% 13 / 2;\n"
+        "        else\n"
+        "            total = total - 1;\n"
+        "    }\n"
+        "    while total > 100: total = total / 2;\n"
+        "    do total = total + 1; while total < 10;\n"
+        "    ok = record.value <= total;\n"
+        "    return ok, info.name, tags[%d %% 3];\n"
+        "}\n\n",
+        i, i, i % 97, i, i, i, i % 11, i);
+}
+
+int main(int argc, char **argv)
+{
+    size_t target = (argc > 1 ? atoi(argv[1]) : 8) << 20;
+
+    char  *body = malloc(target + 4096);
+    size_t size = 0;
+    for (int i = 0; size < target; i++)
+        size += generateFunction(body + size, target + 4096 - size, i);
+
+    Error error;
+    Error_Init(&error);
+
+    Source *src = Source_FromString("<generated>", body, size, &error);
+    if (src == NULL) {
+        Error_Print(&error, ErrorType_INTERNAL, stderr);
+        return -1;
+    }
+
+    double mb = size / (1024.0 * 1024.0);
+    double best_parse = 1e9;
+    double best_compile = 1e9;
+
+    for (int round = 0; round < 5; round++) {
+
+        int error_offset;
+
+        double t0 = now();
+        BPAlloc *alloc = BPAlloc_Init(-1);
+        AST *ast = parse(src, alloc, &error, &error_offset);
+        double t1 = now();
+        BPAlloc_Free(alloc);
+
+        if (ast == NULL) {
+            Error_Print(&error, ErrorType_INTERNAL, stderr);
+            return -1;
+        }
+
+        double t2 = now();
+        Executable *exe = compile(src, &error, &error_offset);
+        double t3 = now();
+
+        if (exe == NULL) {
+            Error_Print(&error, ErrorType_INTERNAL, stderr);
+            return -1;
+        }
+        Executable_Free(exe);
+
+        if (t1 - t0 < best_parse)   best_parse   = t1 - t0;
+        if (t3 - t2 < best_compile) best_compile = t3 - t2;
+    }
+
+    printf("source=%.1f MB  parse=%.1f MB/s  compile=%.1f MB/s\n", 
+           mb, mb / best_parse, mb / best_compile);
+
+    Source_Free(src);
+    free(body);
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/lib/utils/vecops.h"
+
+// Compares the scalar vector kernels with the ones
+// chosen for this processor, over arrays that fit in
+// the L1 cache and over arrays of 1M items, where the
+// memory bandwidth is what limits them.
+//
+//   make bench_vec && ./bench_vec
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#define N (1 << 20)
+#define TOTAL (1 << 28) // Items processed by each measurement
+
+int main(void)
+{
+    double *x = malloc(N * sizeof(double));
+    double *y = malloc(N * sizeof(double));
+    long long int *a = malloc(N * sizeof(long long int));
+    if (x == NULL || y == NULL || a == NULL) {
+        fprintf(stderr, "Error: No memory\n");
+        return -1;
+    }
+
+    for (int i = 0; i < N; i++) {
+        x[i] = i * 0.5;
+        y[i] = 1.0 / (i + 1);
+        a[i] = i;
+    }
+
+    const VecOps *impls[] = { VecOps_GetScalar(), VecOps_Get() };
+    int sizes[] = { 1024, N };
+
+    for (int k = 0; k < 4; k++) {
+
+        int n = sizes[k / 2];
+        int rounds = TOTAL / n;
+
+        const VecOps *ops = impls[k % 2];
+        volatile double sink = 0;
+
+        double t0 = now();
+        for (int r = 0; r < rounds; r++)
+            sink += ops->sum_f64(x, n);
+        double t1 = now();
+        for (int r = 0; r < rounds; r++)
+            sink += ops->sum_i64(a, n);
+        double t2 = now();
+        for (int r = 0; r < rounds; r++)
+            sink += ops->dot_f64(x, y, n);
+        double t3 = now();
+        for (int r = 0; r < rounds; r++) {
+            double mn, mx;
+            ops->minmax_f64(x, n, &mn, &mx);
+            sink += mn + mx;
+        }
+        double t4 = now();
+        for (int r = 0; r < rounds; r++)
+            ops->axpy_f64(1e-9, x, y, n);
+        double t5 = now();
+        (void) sink;
+
+        double scale = 1e9 / TOTAL; // ns per item
+        printf("n=%-8d %-6s  sum_f64 %.3f ns  sum_i64 %.3f ns  dot_f64 %.3f ns  minmax_f64 %.3f ns  axpy_f64 %.3f ns\n",
+               n, ops->name, (t1 - t0) * scale, (t2 - t1) * scale, (t3 - t2) * scale, (t4 - t3) * scale, (t5 - t4) * scale);
+    }
+
+    free(x);
+    free(y);
+    free(a);
+    return 0;
+}
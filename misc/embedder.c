@@ -35,7 +35,9 @@ int main(int argc, char **argv)
         return -1;
     }
     
-    fprintf(out_stream, "const unsigned char %s[] = {\n\t", variable);
+    // The data is aligned so that binary formats can be
+    // used in place.
+    fprintf(out_stream, "_Alignas(16) const unsigned char %s[] = {\n\t", variable);
 
     size_t w = 0;
     bool done = false;
@@ -59,6 +61,7 @@ int main(int argc, char **argv)
     }
     
     fprintf(out_stream, "\n\t0\n};\n");
+    fprintf(out_stream, "const unsigned long %s_size = %zu;\n", variable, w);
 
     fclose(in_stream);
     fclose(out_stream);
@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include "../src/lib/utils/hash.h"
+#include "../src/lib/utils/error.h"
+#include "../src/lib/utils/source.h"
+#include "../src/lib/compiler/compile.h"
+
+// Compiles a noja file to the binary executable format 
+// read by Executable_Load, tagged with the hash of the
+// source. It's used at build time to precompile the 
+// prelude, so it only links the compiler.
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <input> <output>\n", argv[0]);
+        return -1;
+    }
+
+    const char *input  = argv[1];
+    const char *output = argv[2];
+
+    Error error;
+    Error_Init(&error);
+
+    Source *source = Source_FromFile(input, &error);
+    if (source == NULL) {
+        Error_Print(&error, ErrorType_UNSPECIFIED, stderr);
+        Error_Free(&error);
+        return -1;
+    }
+
+    int error_offset;
+    Executable *exe = compile(source, &error, &error_offset);
+    if (exe == NULL) {
+        Error_Print(&error, ErrorType_SYNTAX, stderr);
+        Error_Free(&error);
+        Source_Free(source);
+        return -1;
+    }
+
+    uint64_t hash = hashbytes64(Source_GetBody(source), Source_GetSize(source));
+    if (!Executable_Save(exe, output, hash, &error)) {
+        Error_Print(&error, ErrorType_UNSPECIFIED, stderr);
+        Error_Free(&error);
+        Executable_Free(exe);
+        Source_Free(source);
+        return -1;
+    }
+
+    Executable_Free(exe);
+    Source_Free(source);
+    return 0;
+}
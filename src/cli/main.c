@@ -34,6 +34,7 @@
 #include <signal.h>
 #include <stdbool.h>
 #include "../lib/run.h"
+#include "../lib/image.h"
 #include "../lib/runtime.h"
 #include "../lib/diagram.h"
 #include "../lib/executable.h"
@@ -61,6 +62,9 @@ static void help(FILE *stream, const char *name)
 		"  -p, --profile       Profile the execution of the source (can't be used with -d)\n"
 		"  -o, --output <file> Specify the output file of -p or --diagram-ast\n"
 		"  -H, --heap <size>   Specify the heap size of the runtime\n"
+		"  -c, --cache <dir>   Store compiled scripts in a folder and reuse them\n"
+		"  --image <file>      Start from a runtime image instead of the builtins\n"
+		"  --save-image <file> Store an image of the runtime after running the script\n"
 		"  --diagram-ast       Generate a GraphViz view of the AST\n"
 		"\n");
 }
@@ -90,6 +94,9 @@ int main(int argc, char **argv)
 	const char *output = NULL;
 	const char *input  = NULL;
 	size_t heap = 1024 * 1024;
+	const char *cache = NULL;
+	const char *image = NULL;
+	const char *save_image = NULL;
 
 	for (int i = 1; i < argc; i++) {
 
@@ -140,6 +147,27 @@ int main(int argc, char **argv)
 				return -1;
 			}
 			
+		} else if (!strcmp(argv[i], "-c") || !strcmp(argv[i], "--cache")) {
+
+			if (i+1 == argc || argv[i+1][0] == '-') {
+				fprintf(stderr, "Missing folder path after %s option\n", argv[i]);
+				usage(stderr, argv[0]);
+				return -1;
+			}
+			cache = argv[++i];
+
+		} else if (!strcmp(argv[i], "--image") || !strcmp(argv[i], "--save-image")) {
+
+			if (i+1 == argc || argv[i+1][0] == '-') {
+				fprintf(stderr, "Missing file path after %s option\n", argv[i]);
+				usage(stderr, argv[0]);
+				return -1;
+			}
+			if (!strcmp(argv[i], "--image"))
+				image = argv[++i];
+			else
+				save_image = argv[++i];
+
 		} else {
 			input = argv[i];
 			break;
@@ -214,20 +242,35 @@ int main(int argc, char **argv)
 			RuntimeConfig config = Runtime_GetDefaultConfigs();
 			config.time = profile;
 			config.heap = heap;
+			config.cache = cache;
 
-			runtime = Runtime_New(config);
-			if (runtime == NULL) {
-				fprintf(stderr, "Error: Failed to initialize runtime\n");
-				code = -1;
-				break;
+			Error error;
+		   Error_Init(&error);
+
+			if (image != NULL) {
+				RuntimeImage *loaded = RuntimeImage_Load(image, &error);
+				if (loaded != NULL) {
+					runtime = Runtime_NewFromImage(loaded, config, &error);
+					RuntimeImage_Free(loaded);
+				}
+				if (runtime == NULL) {
+					Error_Print(&error, ErrorType_INTERNAL, stderr);
+					Error_Free(&error);
+					code = -1;
+					break;
+				}
+			} else {
+				runtime = Runtime_New(config);
+				if (runtime == NULL) {
+					fprintf(stderr, "Error: Failed to initialize runtime\n");
+					code = -1;
+					break;
+				}
 			}
 			signal(SIGINT,  signalHandler);
 		   signal(SIGTERM, signalHandler);
-
-			Error error;
-		   Error_Init(&error);
 		   
-		   if (!Runtime_plugDefaultBuiltins(runtime, &error)) {
+		   if (image == NULL && !Runtime_plugDefaultBuiltins(runtime, &error)) {
 		   	Error_Print(&error, ErrorType_RUNTIME, stderr);
 		   	Error_Free(&error);
 		   	Runtime_PrintStackTrace(runtime, stderr);
@@ -258,6 +301,20 @@ int main(int argc, char **argv)
 		    	break;
 			}
 			
+			if (save_image != NULL) {
+				RuntimeImage *saved = RuntimeImage_FromRuntime(runtime, &error);
+				if (saved == NULL || !RuntimeImage_Save(saved, save_image, &error)) {
+					Error_Print(&error, ErrorType_INTERNAL, stderr);
+					Error_Free(&error);
+					if (saved != NULL)
+						RuntimeImage_Free(saved);
+					Runtime_Free(runtime);
+					code = -1;
+					break;
+				}
+				RuntimeImage_Free(saved);
+			}
+
 			code = 0;
 			if (output == NULL)
 				Runtime_SerializeProfilingResultsToStream(runtime, stdout);
@@ -0,0 +1,252 @@
+#include <string.h>
+#include "utils.h"
+#include "array.h"
+#include "../utils/defs.h"
+
+static bool isArray(Object *obj)
+{
+	return Object_IsIntArray(obj) || Object_IsFloatArray(obj);
+}
+
+// Builds an array of the given kind from
+//   - an int, which is the number of zeros to fill it with;
+//   - a List of numbers;
+//   - a Buffer, whose bytes are the raw elements in the
+//     machine's byte order;
+//   - another array, whose elements are converted.
+static Object *makeArray(Object *source, bool floats, Heap *heap, Error *error)
+{
+	Object *array;
+
+	if (Object_IsInt(source)) {
+
+		long long int length = Object_GetInt(source);
+		if (length < 0) {
+			Error_Report(error, ErrorType_RUNTIME, "Negative array length");
+			return NULL;
+		}
+		array = floats
+			? Object_NewFloatArray(length, heap, error)
+			: Object_NewIntArray(length, heap, error);
+
+	} else if (Object_IsList(source)) {
+
+		int count;
+		Object_GetListItems(source, &count);
+
+		array = floats
+			? Object_NewFloatArray(count, heap, error)
+			: Object_NewIntArray(count, heap, error);
+		if (array == NULL)
+			return NULL;
+
+		// Allocating the array didn't move the
+		// list, but the pointer to its items
+		// is only taken now to be safe.
+		Object **items = Object_GetListItems(source, NULL);
+		for (int i = 0; i < count; i++) {
+			Object *item = items[i];
+			if (floats) {
+				double *dst = Object_GetFloatArray(array, NULL);
+				if (Object_IsFloat(item))
+					dst[i] = Object_GetFloat(item);
+				else if (Object_IsInt(item))
+					dst[i] = Object_GetInt(item);
+				else {
+					Error_Report(error, ErrorType_RUNTIME, "Item %d is not a number", i);
+					return NULL;
+				}
+			} else {
+				long long int *dst = Object_GetIntArray(array, NULL);
+				if (!Object_IsInt(item)) {
+					Error_Report(error, ErrorType_RUNTIME, "Item %d is not an int", i);
+					return NULL;
+				}
+				dst[i] = Object_GetInt(item);
+			}
+		}
+
+	} else if (Object_IsBuffer(source)) {
+
+		size_t size;
+		Object_GetBuffer(source, &size);
+
+		if (size % 8 != 0) {
+			Error_Report(error, ErrorType_RUNTIME, "Buffer size %d is not a multiple of 8", (int) size);
+			return NULL;
+		}
+
+		array = floats
+			? Object_NewFloatArray(size / 8, heap, error)
+			: Object_NewIntArray(size / 8, heap, error);
+		if (array == NULL)
+			return NULL;
+
+		void *dst = floats
+			? (void*) Object_GetFloatArray(array, NULL)
+			: (void*) Object_GetIntArray(array, NULL);
+		if (size > 0)
+			memcpy(dst, Object_GetBuffer(source, NULL), size);
+
+	} else if (isArray(source)) {
+
+		int count = Object_Count(source, error);
+		array = floats
+			? Object_NewFloatArray(count, heap, error)
+			: Object_NewIntArray(count, heap, error);
+		if (array == NULL)
+			return NULL;
+
+		for (int i = 0; i < count; i++) {
+			if (floats) {
+				double *dst = Object_GetFloatArray(array, NULL);
+				if (Object_IsFloatArray(source))
+					dst[i] = Object_GetFloatArray(source, NULL)[i];
+				else
+					dst[i] = Object_GetIntArray(source, NULL)[i];
+			} else {
+				long long int *dst = Object_GetIntArray(array, NULL);
+				if (Object_IsFloatArray(source))
+					dst[i] = Object_GetFloatArray(source, NULL)[i];
+				else
+					dst[i] = Object_GetIntArray(source, NULL)[i];
+			}
+		}
+
+	} else {
+		Error_Report(error, ErrorType_RUNTIME, "Can't make an array from a %s", Object_GetName(source));
+		return NULL;
+	}
+
+	return array;
+}
+
+static int bin_ints(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: length, list, buffer or array
+	UNUSED(argc);
+
+	Object *array = makeArray(argv[0], false, Runtime_GetHeap(runtime), error);
+	if (array == NULL)
+		return -1;
+
+	return returnValues2(error, runtime, rets, "o", array);
+}
+
+static int bin_floats(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: length, list, buffer or array
+	UNUSED(argc);
+
+	Object *array = makeArray(argv[0], true, Runtime_GetHeap(runtime), error);
+	if (array == NULL)
+		return -1;
+
+	return returnValues2(error, runtime, rets, "o", array);
+}
+
+static int bin_slice(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: array
+	// 1: start
+	// 2: end or none
+	//
+	// Unlike list.slice, the returned array shares
+	// the elements with the original one (like
+	// buffer.sliceUp does), so writes through one
+	// are seen by the other. Indices are handled
+	// like list.slice does.
+	if (!isArray(argv[0])) {
+		Error_Report(error, ErrorType_RUNTIME, "Argument 0 is not an array");
+		return -1;
+	}
+
+	ParsedArgument pargs[3];
+	if (!parseArgs(error, argv+1, argc-1, pargs+1, "i?i"))
+		return -1;
+
+	int64_t count = Object_Count(argv[0], error);
+	int64_t start = pargs[1].as_int;
+	int64_t end   = pargs[2].defined ? pargs[2].as_int : count;
+
+	if (start < 0) start += count;
+	if (end   < 0) end   += count;
+
+	if (start < 0) start = 0;
+	if (start > count) start = count;
+	if (end > count) end = count;
+	if (end < start) end = start;
+
+	Object *slice = Object_SliceArray(argv[0], start, end - start, Runtime_GetHeap(runtime), error);
+	if (slice == NULL)
+		return -1;
+
+	return returnValues2(error, runtime, rets, "o", slice);
+}
+
+static int bin_toBuffer(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: array
+	//
+	// Returns a buffer with a copy of the raw
+	// elements in the machine's byte order.
+	UNUSED(argc);
+
+	if (!isArray(argv[0])) {
+		Error_Report(error, ErrorType_RUNTIME, "Argument 0 is not an array");
+		return -1;
+	}
+
+	size_t length;
+	void *src = Object_IsFloatArray(argv[0])
+		? (void*) Object_GetFloatArray(argv[0], &length)
+		: (void*) Object_GetIntArray(argv[0], &length);
+
+	Object *buffer = Object_NewBuffer(length * 8, Runtime_GetHeap(runtime), error);
+	if (buffer == NULL)
+		return -1;
+
+	if (length > 0)
+		memcpy(Object_GetBuffer(buffer, NULL), src, length * 8);
+
+	return returnValues2(error, runtime, rets, "o", buffer);
+}
+
+static int bin_toList(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: array
+	UNUSED(argc);
+
+	if (!isArray(argv[0])) {
+		Error_Report(error, ErrorType_RUNTIME, "Argument 0 is not an array");
+		return -1;
+	}
+
+	Heap *heap = Runtime_GetHeap(runtime);
+
+	int count = Object_Count(argv[0], error);
+	Object *list = Object_NewList(count, heap, error);
+	if (list == NULL)
+		return -1;
+
+	for (int i = 0; i < count; i++) {
+		Object *item = Object_IsFloatArray(argv[0])
+			? Object_FromFloat(Object_GetFloatArray(argv[0], NULL)[i], heap, error)
+			: Object_FromInt(Object_GetIntArray(argv[0], NULL)[i], heap, error);
+		if (item == NULL)
+			return -1;
+		if (!Object_InsertIntoList(list, i, item, heap, error))
+			return -1;
+	}
+
+	return returnValues2(error, runtime, rets, "o", list);
+}
+
+StaticMapSlot bins_array[] = {
+	{ "ints",     SM_FUNCT, .as_funct = bin_ints,     .argc = 1 },
+	{ "floats",   SM_FUNCT, .as_funct = bin_floats,   .argc = 1 },
+	{ "slice",    SM_FUNCT, .as_funct = bin_slice,    .argc = 3 },
+	{ "toBuffer", SM_FUNCT, .as_funct = bin_toBuffer, .argc = 1 },
+	{ "toList",   SM_FUNCT, .as_funct = bin_toList,   .argc = 1 },
+	{ NULL, SM_END, {}, {} },
+};
@@ -0,0 +1,2 @@
+#include "../runtime.h"
+extern StaticMapSlot bins_array[];
\ No newline at end of file
@@ -40,6 +40,10 @@
 #include "string.h"
 #include "buffer.h"
 #include "random.h"
+#include "regex.h"
+#include "list.h"
+#include "array.h"
+#include "vec.h"
 #include "../defs.h"
 #include "../utils/defs.h"
 #include "../objects/objects.h"
@@ -133,7 +137,52 @@ static int bin_import(Runtime *runtime,
 		return -1;
 
 	const char *path = pargs[0].as_string.data;
-	return runFileRelativeToScript(runtime, path, rets, error);
+	return importFileRelativeToScript(runtime, path, false, rets, error);
+}
+
+static int bin_reload(Runtime *runtime, 
+					  Object **argv, 
+					  unsigned int argc, 
+					  Object *rets[static MAX_RETS], 
+					  Error *error)
+{
+	UNUSED(argc);
+	ASSERT(argc == 1);
+	
+	ParsedArgument pargs[1];
+	if (!parseArgs(error, argv, argc, pargs, "s"))
+		return -1;
+
+	const char *path = pargs[0].as_string.data;
+	return importFileRelativeToScript(runtime, path, true, rets, error);
+}
+
+// Calls a function inside a region of the heap, so 
+// that what it allocated is released when it returns,
+// except for what it returns.
+static int bin_region(Runtime *runtime, 
+					  Object **argv, 
+					  unsigned int argc, 
+					  Object *rets[static MAX_RETS], 
+					  Error *error)
+{
+	UNUSED(argc);
+	ASSERT(argc == 1);
+
+	HeapRegion region;
+	Runtime_OpenRegion(runtime, &region);
+
+	int retc = Object_Call(argv[0], NULL, 0, rets, Runtime_GetHeap(runtime), error);
+	if (retc < 0) {
+		// The frames of the failed call may still
+		// refer to the objects of the region.
+		region.escaped = true;
+		Runtime_CloseRegion(runtime, &region, NULL, 0);
+		return -1;
+	}
+
+	Runtime_CloseRegion(runtime, &region, rets, retc);
+	return retc;
 }
 
 static int bin_type(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
@@ -280,6 +329,35 @@ static int bin_istypeof(Runtime *runtime, Object **argv, unsigned int argc, Obje
 	return 1;
 }
 
+static int bin_range(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// range(end), range(start, end) or range(start, end, step)
+	//
+	// The end is excluded and the step defaults to 1.
+	ParsedArgument pargs[3];
+	if (!parseArgs(error, argv, argc, pargs, "i?i?i"))
+		return -1;
+
+	int64_t start = 0;
+	int64_t end   = pargs[0].as_int;
+	int64_t step  = 1;
+
+	if (pargs[1].defined) {
+		start = pargs[0].as_int;
+		end   = pargs[1].as_int;
+	}
+
+	if (pargs[2].defined)
+		step = pargs[2].as_int;
+
+	Object *range = Object_NewRange(start, end, step, Runtime_GetHeap(runtime), error);
+	if (range == NULL)
+		return -1;
+
+	rets[0] = range;
+	return 1;
+}
+
 static int bin_keysof(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
 {
 	UNUSED(argc);
@@ -294,6 +372,60 @@ static int bin_keysof(Runtime *runtime, Object **argv, unsigned int argc, Object
 	return 1;
 }
 
+static int bin_valuesof(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	UNUSED(argc);
+	ASSERT(argc == 1);
+	Heap   *heap = Runtime_GetHeap(runtime);
+	Object *vals = Object_NewMapView(argv[0], MAPVIEW_VALUES, heap, error);
+	if (vals == NULL)
+		return -1;
+	rets[0] = vals;
+	return 1;
+}
+
+static int bin_itemsof(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	UNUSED(argc);
+	ASSERT(argc == 1);
+	Heap   *heap  = Runtime_GetHeap(runtime);
+	Object *items = Object_NewMapView(argv[0], MAPVIEW_ITEMS, heap, error);
+	if (items == NULL)
+		return -1;
+	rets[0] = items;
+	return 1;
+}
+
+static int bin_copy(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	UNUSED(argc);
+	ASSERT(argc == 1);
+	Heap   *heap = Runtime_GetHeap(runtime);
+	Object *copy = Object_Copy(argv[0], heap, error);
+	if (copy == NULL)
+		return -1;
+	rets[0] = copy;
+	return 1;
+}
+
+static int bin_delete(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	UNUSED(argc);
+	ASSERT(argc == 2);
+	Heap   *heap = Runtime_GetHeap(runtime);
+	Object *val  = Object_Delete(argv[0], argv[1], heap, error);
+	if (val == NULL) {
+		if (error->occurred)
+			return -1;
+		// The key wasn't there.
+		val = Object_NewNone(heap, error);
+		if (val == NULL)
+			return -1;
+	}
+	rets[0] = val;
+	return 1;
+}
+
 void bins_basic_init(StaticMapSlot slots[])
 {
 	slots[0].as_type = Object_GetTypeType();
@@ -309,7 +441,11 @@ void bins_basic_init(StaticMapSlot slots[])
 	slots[10].as_type = Object_GetDirType();
 	slots[11].as_type = Object_GetNullableType();
 	slots[12].as_type = Object_GetSumType();
-	slots[13].as_object = Object_NewAny();
+	slots[13].as_type = Object_GetIntArrayType();
+	slots[14].as_type = Object_GetFloatArrayType();
+	slots[15].as_type = Object_GetRangeType();
+	slots[16].as_type = Object_GetMapViewType();
+	slots[17].as_object = Object_NewAny();
 }
 
 StaticMapSlot bins_basic[] = {
@@ -326,6 +462,10 @@ StaticMapSlot bins_basic[] = {
 	{ TYPENAME_DIRECTORY, SM_TYPE, .as_type = NULL /* Until bins_basic_init is called */ },
 	{ TYPENAME_NULLABLE,  SM_TYPE, .as_type = NULL },
 	{ TYPENAME_SUM,       SM_TYPE, .as_type = NULL },
+	{ TYPENAME_INTARRAY,   SM_TYPE, .as_type = NULL },
+	{ TYPENAME_FLOATARRAY, SM_TYPE, .as_type = NULL },
+	{ TYPENAME_RANGE,      SM_TYPE, .as_type = NULL },
+	{ TYPENAME_MAPVIEW,    SM_TYPE, .as_type = NULL },
 	{ "any",    SM_OBJECT, .as_object = NULL },
 	
 	{ "net",    SM_SMAP, .as_smap = bins_net,    },
@@ -334,8 +474,14 @@ StaticMapSlot bins_basic[] = {
 	{ "buffer", SM_SMAP, .as_smap = bins_buffer, },
 	{ "string", SM_SMAP, .as_smap = bins_string, },
 	{ "random", SM_SMAP, .as_smap = bins_random, },
+	{ "regex",  SM_SMAP, .as_smap = bins_regex,  },
+	{ "list",   SM_SMAP, .as_smap = bins_list,   },
+	{ "array",  SM_SMAP, .as_smap = bins_array,  },
+	{ "vec",    SM_SMAP, .as_smap = bins_vec,    },
 	
 	{ "import", SM_FUNCT, .as_funct = bin_import, .argc = 1, },
+	{ "reload", SM_FUNCT, .as_funct = bin_reload, .argc = 1, },
+	{ "region", SM_FUNCT, .as_funct = bin_region, .argc = 1, },
 	{ "type",   SM_FUNCT, .as_funct = bin_type, .argc = 1 },
 	{ "print",  SM_FUNCT, .as_funct = bin_print, .argc = -1 },
 	{ "input",  SM_FUNCT, .as_funct = bin_input, .argc = 0 },
@@ -345,6 +491,11 @@ StaticMapSlot bins_basic[] = {
 	{ "istypeof", SM_FUNCT, .as_funct = bin_istypeof, .argc = 2, },
 	{ "typename", SM_FUNCT, .as_funct = bin_typename, .argc = 1, },
 	{ "keysof", SM_FUNCT, .as_funct = bin_keysof, .argc = 1, },
+	{ "valuesof", SM_FUNCT, .as_funct = bin_valuesof, .argc = 1, },
+	{ "itemsof",  SM_FUNCT, .as_funct = bin_itemsof,  .argc = 1, },
+	{ "range",  SM_FUNCT, .as_funct = bin_range,  .argc = 3, },
+	{ "delete", SM_FUNCT, .as_funct = bin_delete, .argc = 2, },
+	{ "copy",   SM_FUNCT, .as_funct = bin_copy,   .argc = 1, },
 	{ "getCurrentWorkingDirectory", SM_FUNCT, .as_funct = bin_getCurrentWorkingDirectory, .argc = 0 },
 	{ "getCurrentScriptDirectory",  SM_FUNCT, .as_funct = bin_getCurrentScriptDirectory,  .argc = 0 },
 	{ "getCurrentScriptLocation",   SM_FUNCT, .as_funct = bin_getCurrentScriptLocation,   .argc = 0 },
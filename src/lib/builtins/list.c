@@ -0,0 +1,414 @@
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+#include "list.h"
+#include "../utils/defs.h"
+
+// Turns a possibly negative index into a position
+// counted from the start of a list of [count] items.
+// Negative indices count from the end of the list.
+static int64_t normalizeIndex(int64_t idx, int count)
+{
+	if (idx < 0)
+		idx += count;
+	return idx;
+}
+
+static int bin_push(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: list
+	// 1: item
+	ParsedArgument pargs[2];
+	if (!parseArgs(error, argv, argc, pargs, "lo"))
+		return -1;
+
+	int count;
+	Object_GetListItems(argv[0], &count);
+
+	if (!Object_InsertIntoList(argv[0], count, argv[1], Runtime_GetHeap(runtime), error))
+		return -1;
+
+	return returnValues2(error, runtime, rets, "n");
+}
+
+static int bin_pop(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: list
+	//
+	// Removes the last item and returns it.
+	ParsedArgument pargs[1];
+	if (!parseArgs(error, argv, argc, pargs, "l"))
+		return -1;
+
+	int count;
+	Object_GetListItems(argv[0], &count);
+
+	if (count == 0) {
+		Error_Report(error, ErrorType_RUNTIME, "Can't pop from an empty list");
+		return -1;
+	}
+
+	Object *item = Object_RemoveFromList(argv[0], count-1, Runtime_GetHeap(runtime), error);
+	if (item == NULL)
+		return -1;
+
+	return returnValues2(error, runtime, rets, "o", item);
+}
+
+static int bin_insert(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: list
+	// 1: index
+	// 2: item
+	//
+	// Inserts the item before the one at the index,
+	// shifting the following ones forward.
+	ParsedArgument pargs[3];
+	if (!parseArgs(error, argv, argc, pargs, "lio"))
+		return -1;
+
+	int count;
+	Object_GetListItems(argv[0], &count);
+
+	int64_t idx = normalizeIndex(pargs[1].as_int, count);
+	if (idx < 0 || idx > count) {
+		Error_Report(error, ErrorType_RUNTIME, "Index %lld is out of range", (long long) pargs[1].as_int);
+		return -1;
+	}
+
+	if (!Object_InsertIntoList(argv[0], idx, argv[2], Runtime_GetHeap(runtime), error))
+		return -1;
+
+	return returnValues2(error, runtime, rets, "n");
+}
+
+static int bin_remove(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: list
+	// 1: index
+	//
+	// Removes the item at the index and returns it.
+	ParsedArgument pargs[2];
+	if (!parseArgs(error, argv, argc, pargs, "li"))
+		return -1;
+
+	int count;
+	Object_GetListItems(argv[0], &count);
+
+	int64_t idx = normalizeIndex(pargs[1].as_int, count);
+	if (idx < 0 || idx >= count) {
+		Error_Report(error, ErrorType_RUNTIME, "Index %lld is out of range", (long long) pargs[1].as_int);
+		return -1;
+	}
+
+	Object *item = Object_RemoveFromList(argv[0], idx, Runtime_GetHeap(runtime), error);
+	if (item == NULL)
+		return -1;
+
+	return returnValues2(error, runtime, rets, "o", item);
+}
+
+static int bin_extend(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: list
+	// 1: list of items to append
+	ParsedArgument pargs[2];
+	if (!parseArgs(error, argv, argc, pargs, "ll"))
+		return -1;
+
+	int count;
+	Object **items = Object_GetListItems(argv[1], &count);
+
+	if (!Object_ExtendList(argv[0], items, count, Runtime_GetHeap(runtime), error))
+		return -1;
+
+	return returnValues2(error, runtime, rets, "n");
+}
+
+static int bin_slice(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: list
+	// 1: start
+	// 2: end or none
+	//
+	// Returns a new list with the items from start
+	// up to end (excluded), or up to the end of the
+	// list if it's none. Indices out of the list are
+	// clamped to it.
+	ParsedArgument pargs[3];
+	if (!parseArgs(error, argv, argc, pargs, "li?i"))
+		return -1;
+
+	int count;
+	Object **items = Object_GetListItems(argv[0], &count);
+
+	int64_t start = normalizeIndex(pargs[1].as_int, count);
+	int64_t end   = pargs[2].defined ? normalizeIndex(pargs[2].as_int, count) : count;
+
+	if (start < 0) start = 0;
+	if (end > count) end = count;
+	if (end < start) end = start;
+
+	Object *slice = Object_NewList2(end - start, items + start, Runtime_GetHeap(runtime), error);
+	if (slice == NULL)
+		return -1;
+
+	return returnValues2(error, runtime, rets, "o", slice);
+}
+
+static int bin_reverse(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: list
+	//
+	// Reverses the list in place.
+	ParsedArgument pargs[1];
+	if (!parseArgs(error, argv, argc, pargs, "l"))
+		return -1;
+
+	int count;
+	Object **items = Object_GetMutableListItems(argv[0], &count, Runtime_GetHeap(runtime), error);
+	if (items == NULL)
+		return -1;
+
+	for (int i = 0, j = count-1; i < j; i++, j--) {
+		Object *temp = items[i];
+		items[i] = items[j];
+		items[j] = temp;
+	}
+
+	return returnValues2(error, runtime, rets, "n");
+}
+
+// The sort works on a permutation of the positions of
+// the items instead of the items themselves. When the
+// comparator is a noja function, calling it may trigger
+// a collection that moves the items, so they can't be
+// held by native code. The list is only referenced by
+// the native frame's arguments, which the collector
+// keeps up to date, and the items are read from it at
+// each comparison.
+typedef int (*LessFunc)(void *ctx, int a, int b, Error *error);
+
+// Runs shorter than this are sorted by insertion.
+#define SORT_RUN 16
+
+static bool insertionSort(int *perm, int lo, int hi, LessFunc less, void *ctx, Error *error)
+{
+	for (int i = lo+1; i < hi; i++) {
+		int x = perm[i];
+		int j = i;
+		while (j > lo) {
+			int res = less(ctx, x, perm[j-1], error);
+			if (res < 0)
+				return false;
+			if (res == 0)
+				break;
+			perm[j] = perm[j-1];
+			j--;
+		}
+		perm[j] = x;
+	}
+	return true;
+}
+
+static bool merge(int *src, int *dst, int lo, int mid, int hi, LessFunc less, void *ctx, Error *error)
+{
+	int i = lo, j = mid, k = lo;
+	while (i < mid && j < hi) {
+
+		// The right item is only taken first
+		// when it's strictly less than the left
+		// one, which makes the sort stable.
+		int res = less(ctx, src[j], src[i], error);
+		if (res < 0)
+			return false;
+
+		if (res)
+			dst[k++] = src[j++];
+		else
+			dst[k++] = src[i++];
+	}
+	while (i < mid) dst[k++] = src[i++];
+	while (j < hi)  dst[k++] = src[j++];
+	return true;
+}
+
+// Stable bottom-up merge sort of [perm]. The [temp]
+// buffer must have the same size.
+static bool mergeSort(int *perm, int *temp, int count, LessFunc less, void *ctx, Error *error)
+{
+	for (int lo = 0; lo < count; lo += SORT_RUN) {
+		int hi = MIN(lo + SORT_RUN, count);
+		if (!insertionSort(perm, lo, hi, less, ctx, error))
+			return false;
+	}
+
+	int *src = perm;
+	int *dst = temp;
+	for (int width = SORT_RUN; width < count; width *= 2) {
+		for (int lo = 0; lo < count; lo += 2 * width) {
+			int mid = MIN(lo + width, count);
+			int hi  = MIN(lo + 2 * width, count);
+			if (!merge(src, dst, lo, mid, hi, less, ctx, error))
+				return false;
+		}
+		int *swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	if (src != perm)
+		memcpy(perm, src, sizeof(int) * count);
+	return true;
+}
+
+static int compareNatively(Object *a, Object *b, Error *error)
+{
+	if (Object_IsInt(a) && Object_IsInt(b)) {
+		long long int x = Object_GetInt(a);
+		long long int y = Object_GetInt(b);
+		return (x > y) - (x < y);
+	}
+
+	if ((Object_IsInt(a) || Object_IsFloat(a)) && (Object_IsInt(b) || Object_IsFloat(b))) {
+		double x = Object_IsInt(a) ? (double) Object_GetInt(a) : Object_GetFloat(a);
+		double y = Object_IsInt(b) ? (double) Object_GetInt(b) : Object_GetFloat(b);
+		return (x > y) - (x < y);
+	}
+
+	if (Object_IsString(a) && Object_IsString(b)) {
+		size_t len_a, len_b;
+		const char *str_a = Object_GetString(a, &len_a);
+		const char *str_b = Object_GetString(b, &len_b);
+		int res = memcmp(str_a, str_b, MIN(len_a, len_b));
+		if (res == 0)
+			res = (len_a > len_b) - (len_a < len_b);
+		return res;
+	}
+
+	Error_Report(error, ErrorType_RUNTIME, "Can't compare %s and %s without a comparator",
+				 Object_GetName(a), Object_GetName(b));
+	return 0;
+}
+
+static int lessNatively(void *ctx, int a, int b, Error *error)
+{
+	Object **items = ctx;
+	int res = compareNatively(items[a], items[b], error);
+	if (error->occurred)
+		return -1;
+	return res < 0;
+}
+
+typedef struct {
+	Runtime *runtime;
+	Object **argv; // The list and the comparator
+	int count;
+} SortContext;
+
+static int lessWithComparator(void *ctx, int a, int b, Error *error)
+{
+	SortContext *sort = ctx;
+
+	int count;
+	Object **items = Object_GetListItems(sort->argv[0], &count);
+	if (count != sort->count) {
+		Error_Report(error, ErrorType_RUNTIME, "List was modified while being sorted");
+		return -1;
+	}
+
+	Object *args[2] = { items[a], items[b] };
+	Object *rets[MAX_RETS];
+	int retc = Object_Call(sort->argv[1], args, 2, rets, Runtime_GetHeap(sort->runtime), error);
+	if (retc < 0)
+		return -1;
+
+	// NOTE: Every object reference other than the
+	//       ones in [sort->argv] and [rets] may have
+	//       been invalidated from here.
+
+	if (retc == 0 || !Object_IsBool(rets[0])) {
+		Error_Report(error, ErrorType_RUNTIME, "Comparator was expected to return a bool");
+		return -1;
+	}
+	return Object_GetBool(rets[0]);
+}
+
+static int bin_sort(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: list
+	// 1: comparator or none
+	//
+	// Sorts the list in place. The sort is stable. If a
+	// comparator is provided, it's called with two items
+	// and returns true if the first must come before the
+	// second. Otherwise numbers and strings are sorted
+	// in ascending order.
+	ParsedArgument pargs[2];
+	if (!parseArgs(error, argv, argc, pargs, "l?o"))
+		return -1;
+
+	bool has_comparator = !Object_IsNone(argv[1]);
+
+	int count;
+	Object_GetListItems(argv[0], &count);
+
+	int *perm = malloc(2 * sizeof(int) * count);
+	if (perm == NULL && count > 0) {
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		return -1;
+	}
+
+	for (int i = 0; i < count; i++)
+		perm[i] = i;
+
+	bool ok;
+	if (has_comparator) {
+		SortContext ctx = { runtime, argv, count };
+		ok = mergeSort(perm, perm + count, count, lessWithComparator, &ctx, error);
+	} else {
+		Object **items = Object_GetListItems(argv[0], NULL);
+		ok = mergeSort(perm, perm + count, count, lessNatively, items, error);
+	}
+
+	if (!ok) {
+		free(perm);
+		return -1;
+	}
+
+	// Move the items to their sorted positions. From
+	// here no collection can happen, so the items can
+	// be held in a native buffer.
+	Object **items = Object_GetMutableListItems(argv[0], NULL, Runtime_GetHeap(runtime), error);
+	if (items == NULL) {
+		free(perm);
+		return -1;
+	}
+
+	Object **sorted = malloc(sizeof(Object*) * count);
+	if (sorted == NULL && count > 0) {
+		free(perm);
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		return -1;
+	}
+
+	for (int i = 0; i < count; i++)
+		sorted[i] = items[perm[i]];
+	memcpy(items, sorted, sizeof(Object*) * count);
+
+	free(sorted);
+	free(perm);
+	return returnValues2(error, runtime, rets, "n");
+}
+
+StaticMapSlot bins_list[] = {
+	{ "push",    SM_FUNCT, .as_funct = bin_push,    .argc = 2 },
+	{ "pop",     SM_FUNCT, .as_funct = bin_pop,     .argc = 1 },
+	{ "insert",  SM_FUNCT, .as_funct = bin_insert,  .argc = 3 },
+	{ "remove",  SM_FUNCT, .as_funct = bin_remove,  .argc = 2 },
+	{ "extend",  SM_FUNCT, .as_funct = bin_extend,  .argc = 2 },
+	{ "slice",   SM_FUNCT, .as_funct = bin_slice,   .argc = 3 },
+	{ "reverse", SM_FUNCT, .as_funct = bin_reverse, .argc = 1 },
+	{ "sort",    SM_FUNCT, .as_funct = bin_sort,    .argc = 2 },
+	{ NULL, SM_END, {}, {} },
+};
\ No newline at end of file
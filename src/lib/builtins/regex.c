@@ -0,0 +1,308 @@
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+#include "regex.h"
+#include "../utils/defs.h"
+#include "../utils/regex.h"
+#include "../defs.h"
+
+// Patterns provided as strings are compiled through
+// the regex cache of the runtime, so that using the
+// same pattern string in a loop doesn't recompile it
+// at each iteration. The returned regex is owned by
+// the cache, so the caller needs to copy it if it's
+// stored anywhere.
+static Regex *compileCached(Runtime *runtime, const char *pattern, size_t length, Error *error)
+{
+	RegexCache *cache = Runtime_GetRegexCache(runtime, error);
+	if (cache == NULL)
+		return NULL;
+
+	return RegexCache_Compile(cache, pattern, length, error);
+}
+
+// Gets the regex from an argument that may be either
+// a pattern string or a compiled Regex object.
+static Regex *getRegexArg(Runtime *runtime, Object *arg, int index, Error *error)
+{
+	if (Object_IsRegex(arg))
+		return Object_GetRegex(arg);
+
+	if (Object_IsString(arg)) {
+		size_t length;
+		const char *pattern = Object_GetString(arg, &length);
+		return compileCached(runtime, pattern, length, error);
+	}
+
+	Error_Report(error, ErrorType_RUNTIME, "Argument %d was expected to be a " TYPENAME_STRING " or a " TYPENAME_REGEX ", but a %s was provided", index+1, Object_GetName(arg));
+	return NULL;
+}
+
+// Gets the bytes of an argument that may be 
+// either a string or a buffer.
+static const char *getSubjectArg(Object *arg, int index, size_t *length, Error *error)
+{
+	if (Object_IsString(arg))
+		return Object_GetString(arg, length);
+
+	if (Object_IsBuffer(arg))
+		return Object_GetBuffer(arg, length);
+
+	Error_Report(error, ErrorType_RUNTIME, "Argument %d was expected to be a " TYPENAME_STRING " or a " TYPENAME_BUFFER ", but a %s was provided", index+1, Object_GetName(arg));
+	return NULL;
+}
+
+// Returns the portion of the subject between the
+// offsets [begin] and [end]. Strings produce strings
+// while buffers produce slices of the same buffer.
+static Object *sliceSubject(Object *subject, long long int begin, long long int end, Heap *heap, Error *error)
+{
+	if (Object_IsBuffer(subject))
+		return Object_SliceBuffer(subject, begin, end - begin, heap, error);
+
+	const char *str = Object_GetString(subject, NULL);
+	return Object_FromString(str + begin, end - begin, heap, error);
+}
+
+static bool getStartArg(ParsedArgument *parg, size_t length, size_t *start, Error *error)
+{
+	*start = 0;
+	if (parg->defined) {
+		if (parg->as_int < 0 || (size_t) parg->as_int > length) {
+			Error_Report(error, ErrorType_RUNTIME, "Starting offset is out of bounds");
+			return false;
+		}
+		*start = parg->as_int;
+	}
+	return true;
+}
+
+static int bin_compile(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	ParsedArgument pargs[1];
+	if (!parseArgs(error, argv, argc, pargs, "s"))
+		return -1;
+
+	Regex *regex = compileCached(runtime, pargs[0].as_string.data, pargs[0].as_string.size, error);
+	if (regex == NULL)
+		return -1;
+
+	Object *obj = Object_FromRegex(regex, Runtime_GetHeap(runtime), error);
+	if (obj == NULL)
+		return -1;
+
+	rets[0] = obj;
+	return 1;
+}
+
+static int bin_match(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: pattern or regex
+	// 1: string or buffer
+	//
+	// Returns true if the whole subject
+	// matches the pattern.
+
+	UNUSED(argc);
+	ASSERT(argc == 2);
+
+	Regex *regex = getRegexArg(runtime, argv[0], 0, error);
+	if (regex == NULL)
+		return -1;
+
+	size_t length;
+	const char *str = getSubjectArg(argv[1], 1, &length, error);
+	if (str == NULL)
+		return -1;
+
+	long long int caps[2 * Regex_GroupCount(regex)];
+	int res = Regex_Exec(regex, str, length, 0, RegexMode_FULL, caps, error);
+	if (res < 0)
+		return -1;
+
+	return returnValues2(error, runtime, rets, "b", res);
+}
+
+static int bin_search(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: pattern or regex
+	// 1: string or buffer
+	// 2: starting offset or none
+	//
+	// Returns the offsets where the first match
+	// begins and ends, or none if there's no match.
+
+	ParsedArgument pargs[3];
+	if (!parseArgs(error, argv, argc, pargs, "oo?i"))
+		return -1;
+
+	Regex *regex = getRegexArg(runtime, argv[0], 0, error);
+	if (regex == NULL)
+		return -1;
+
+	size_t length;
+	const char *str = getSubjectArg(argv[1], 1, &length, error);
+	if (str == NULL)
+		return -1;
+
+	size_t start;
+	if (!getStartArg(&pargs[2], length, &start, error))
+		return -1;
+
+	long long int caps[2 * Regex_GroupCount(regex)];
+	int res = Regex_Exec(regex, str, length, start, RegexMode_SEARCH, caps, error);
+	if (res < 0)
+		return -1;
+
+	if (res == 0)
+		return returnValues2(error, runtime, rets, "n");
+	return returnValues2(error, runtime, rets, "ii", (int) caps[0], (int) caps[1]);
+}
+
+static int bin_captures(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: pattern or regex
+	// 1: string or buffer
+	// 2: starting offset or none
+	//
+	// Returns a list with the text of the first match 
+	// followed by the text of each group, or none if 
+	// there's no match. Groups that didn't participate
+	// in the match are none.
+
+	ParsedArgument pargs[3];
+	if (!parseArgs(error, argv, argc, pargs, "oo?i"))
+		return -1;
+
+	Regex *regex = getRegexArg(runtime, argv[0], 0, error);
+	if (regex == NULL)
+		return -1;
+
+	size_t length;
+	const char *str = getSubjectArg(argv[1], 1, &length, error);
+	if (str == NULL)
+		return -1;
+
+	size_t start;
+	if (!getStartArg(&pargs[2], length, &start, error))
+		return -1;
+
+	int groups = Regex_GroupCount(regex);
+	long long int caps[2 * groups];
+	int res = Regex_Exec(regex, str, length, start, RegexMode_SEARCH, caps, error);
+	if (res < 0)
+		return -1;
+
+	Heap *heap = Runtime_GetHeap(runtime);
+	
+	if (res == 0)
+		return returnValues(error, heap, rets, "n");
+
+	Object *items[groups];
+	for (int i = 0; i < groups; i++) {
+		long long int begin = caps[2*i];
+		long long int end   = caps[2*i+1];
+		if (begin < 0 || end < 0)
+			items[i] = Object_NewNone(heap, error);
+		else
+			items[i] = sliceSubject(argv[1], begin, end, heap, error);
+		if (items[i] == NULL)
+			return -1;
+	}
+
+	Object *list = Object_NewList2(groups, items, heap, error);
+	if (list == NULL)
+		return -1;
+
+	rets[0] = list;
+	return 1;
+}
+
+static int bin_findAll(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: pattern or regex
+	// 1: string or buffer
+	//
+	// Returns the list of all non-overlapping matches.
+
+	UNUSED(argc);
+	ASSERT(argc == 2);
+
+	Regex *regex = getRegexArg(runtime, argv[0], 0, error);
+	if (regex == NULL)
+		return -1;
+
+	size_t length;
+	const char *str = getSubjectArg(argv[1], 1, &length, error);
+	if (str == NULL)
+		return -1;
+
+	Heap *heap = Runtime_GetHeap(runtime);
+
+	Object  *starting[32];
+	Object **items = starting;
+	int count = 0;
+	int capacity = sizeof(starting) / sizeof(starting[0]);
+
+	long long int caps[2 * Regex_GroupCount(regex)];
+	size_t offset = 0;
+	while (offset <= length) {
+
+		int res = Regex_Exec(regex, str, length, offset, RegexMode_SEARCH, caps, error);
+		if (res < 0)
+			goto fail;
+		if (res == 0)
+			break;
+
+		if (count == capacity) {
+			capacity *= 2;
+			Object **temp;
+			if (items == starting) {
+				temp = malloc(capacity * sizeof(Object*));
+				if (temp != NULL)
+					memcpy(temp, items, count * sizeof(Object*));
+			} else
+				temp = realloc(items, capacity * sizeof(Object*));
+			if (temp == NULL) {
+				Error_Report(error, ErrorType_INTERNAL, "No memory");
+				goto fail;
+			}
+			items = temp;
+		}
+
+		Object *item = sliceSubject(argv[1], caps[0], caps[1], heap, error);
+		if (item == NULL)
+			goto fail;
+		items[count++] = item;
+
+		// Empty matches would be found again at the
+		// same offset, so the search moves forward.
+		if (caps[1] == caps[0])
+			offset = caps[1] + 1;
+		else
+			offset = caps[1];
+	}
+
+	Object *list = Object_NewList2(count, items, heap, error);
+	if (items != starting)
+		free(items);
+	if (list == NULL)
+		return -1;
+
+	rets[0] = list;
+	return 1;
+
+fail:
+	if (items != starting)
+		free(items);
+	return -1;
+}
+
+StaticMapSlot bins_regex[] = {
+	{ "compile",  SM_FUNCT, .as_funct = bin_compile,  .argc = 1 },
+	{ "match",    SM_FUNCT, .as_funct = bin_match,    .argc = 2 },
+	{ "search",   SM_FUNCT, .as_funct = bin_search,   .argc = 3 },
+	{ "captures", SM_FUNCT, .as_funct = bin_captures, .argc = 3 },
+	{ "findAll",  SM_FUNCT, .as_funct = bin_findAll,  .argc = 2 },
+	{ NULL, SM_END, {}, {} },
+};
@@ -1,7 +1,10 @@
+#define _GNU_SOURCE // For [memmem] and [memrchr]
 #include <ctype.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
 #include "utils.h"
 #include "string.h"
 #include "../utils/defs.h"
@@ -265,6 +268,847 @@ static int bin_toInt(Runtime *runtime, Object **argv, unsigned int argc, Object
     return returnValues2(error, runtime, rets, "i", result);
 }
 
+// NOTE: All offsets used by the following functions are byte 
+//       offsets, like the ones expected by [slice].
+
+// Returns the offset of the first occurrence of [needle] in
+// [hay], or -1 if there's none. Single byte needles go through
+// [memchr] while longer ones through [memmem]. Both are 
+// vectorized by the libc so they're way faster than a byte 
+// by byte comparison.
+static long long int findBytes(const char *hay, size_t haylen, const char *needle, size_t needlelen)
+{
+    const char *p;
+    if (needlelen == 1)
+        p = memchr(hay, needle[0], haylen);
+    else
+        p = memmem(hay, haylen, needle, needlelen);
+    
+    if (p == NULL)
+        return -1;
+    return p - hay;
+}
+
+// Like [findBytes] but returns the last occurrence.
+static long long int rfindBytes(const char *hay, size_t haylen, const char *needle, size_t needlelen)
+{
+    if (needlelen > haylen)
+        return -1;
+
+    if (needlelen == 0)
+        return haylen;
+
+    // Any match must start in [0, limit).
+    size_t limit = haylen - needlelen + 1;
+    while (limit > 0) {
+
+        const char *p = memrchr(hay, needle[0], limit);
+        if (p == NULL)
+            return -1;
+        
+        size_t offset = p - hay;
+        if (!memcmp(p, needle, needlelen))
+            return offset;
+        
+        limit = offset;
+    }
+    return -1;
+}
+
+// Returns the number of non-overlapping occurrences 
+// of [needle] in [hay]. The needle can't be empty.
+static size_t countBytes(const char *hay, size_t haylen, const char *needle, size_t needlelen)
+{
+    ASSERT(needlelen > 0);
+
+    size_t count = 0;
+    size_t offset = 0;
+    while (offset < haylen) {
+        long long int k = findBytes(hay + offset, haylen - offset, needle, needlelen);
+        if (k < 0)
+            break;
+        count++;
+        offset += k + needlelen;
+    }
+    return count;
+}
+
+static int bin_find(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+    // 0: string
+    // 1: substring to be found
+    // 2: starting offset or none
+
+    ParsedArgument pargs[3];
+    if (!parseArgs(error, argv, argc, pargs, "ss?i"))
+        return -1;
+
+    const char *hay = pargs[0].as_string.data;
+    size_t   haylen = pargs[0].as_string.size;
+    const char *needle = pargs[1].as_string.data;
+    size_t   needlelen = pargs[1].as_string.size;
+
+    size_t start = 0;
+    if (pargs[2].defined) {
+        if (pargs[2].as_int < 0 || (size_t) pargs[2].as_int > haylen) {
+            Error_Report(error, ErrorType_RUNTIME, "starting offset is out of bounds");
+            return -1;
+        }
+        start = pargs[2].as_int;
+    }
+
+    long long int k;
+    if (needlelen == 0)
+        k = 0;
+    else
+        k = findBytes(hay + start, haylen - start, needle, needlelen);
+
+    Object *result;
+    if (k < 0)
+        result = Object_NewNone(Runtime_GetHeap(runtime), error);
+    else
+        result = Object_FromInt(start + k, Runtime_GetHeap(runtime), error);
+    
+    if (result == NULL)
+        return -1;
+    rets[0] = result;
+    return 1;
+}
+
+static int bin_rfind(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+    // 0: string
+    // 1: substring to be found
+
+    ParsedArgument pargs[2];
+    if (!parseArgs(error, argv, argc, pargs, "ss"))
+        return -1;
+
+    long long int k = rfindBytes(pargs[0].as_string.data, pargs[0].as_string.size,
+                                 pargs[1].as_string.data, pargs[1].as_string.size);
+
+    Object *result;
+    if (k < 0)
+        result = Object_NewNone(Runtime_GetHeap(runtime), error);
+    else
+        result = Object_FromInt(k, Runtime_GetHeap(runtime), error);
+    
+    if (result == NULL)
+        return -1;
+    rets[0] = result;
+    return 1;
+}
+
+static int bin_count(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+    // 0: string
+    // 1: substring to be counted
+
+    ParsedArgument pargs[2];
+    if (!parseArgs(error, argv, argc, pargs, "ss"))
+        return -1;
+
+    if (pargs[1].as_string.size == 0) {
+        Error_Report(error, ErrorType_RUNTIME, "Argument #%d is an empty string", 2);
+        return -1;
+    }
+
+    size_t n = countBytes(pargs[0].as_string.data, pargs[0].as_string.size,
+                          pargs[1].as_string.data, pargs[1].as_string.size);
+
+    Object *result = Object_FromInt(n, Runtime_GetHeap(runtime), error);
+    if (result == NULL)
+        return -1;
+    rets[0] = result;
+    return 1;
+}
+
+static int bin_startsWith(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+    // 0: string
+    // 1: prefix
+
+    ParsedArgument pargs[2];
+    if (!parseArgs(error, argv, argc, pargs, "ss"))
+        return -1;
+
+    const char *str = pargs[0].as_string.data;
+    size_t   len = pargs[0].as_string.size;
+    const char *pre = pargs[1].as_string.data;
+    size_t   prelen = pargs[1].as_string.size;
+
+    bool yes = prelen <= len && !memcmp(str, pre, prelen);
+    return returnValues2(error, runtime, rets, "b", yes);
+}
+
+static int bin_endsWith(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+    // 0: string
+    // 1: suffix
+
+    ParsedArgument pargs[2];
+    if (!parseArgs(error, argv, argc, pargs, "ss"))
+        return -1;
+
+    const char *str = pargs[0].as_string.data;
+    size_t   len = pargs[0].as_string.size;
+    const char *suf = pargs[1].as_string.data;
+    size_t   suflen = pargs[1].as_string.size;
+
+    bool yes = suflen <= len && !memcmp(str + len - suflen, suf, suflen);
+    return returnValues2(error, runtime, rets, "b", yes);
+}
+
+static int bin_split(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+    // 0: string
+    // 1: separator
+    // 2: maximum number of splits or none
+
+    ParsedArgument pargs[3];
+    if (!parseArgs(error, argv, argc, pargs, "ss?i"))
+        return -1;
+
+    const char *str = pargs[0].as_string.data;
+    size_t   len = pargs[0].as_string.size;
+    const char *sep = pargs[1].as_string.data;
+    size_t   seplen = pargs[1].as_string.size;
+
+    if (seplen == 0) {
+        Error_Report(error, ErrorType_RUNTIME, "Argument #%d is an empty string", 2);
+        return -1;
+    }
+
+    // Count the parts first, so that the list is
+    // allocated once with the right size.
+    size_t max_splits = countBytes(str, len, sep, seplen);
+    if (pargs[2].defined && pargs[2].as_int >= 0 && (size_t) pargs[2].as_int < max_splits)
+        max_splits = pargs[2].as_int;
+    size_t num_parts = max_splits + 1;
+
+    Object **parts = malloc(sizeof(Object*) * num_parts);
+    if (parts == NULL) {
+        Error_Report(error, ErrorType_INTERNAL, "No memory");
+        return -1;
+    }
+
+    Heap *heap = Runtime_GetHeap(runtime);
+
+    size_t offset = 0;
+    for (size_t i = 0; i < num_parts; i++) {
+
+        size_t length;
+        if (i+1 == num_parts)
+            length = len - offset;
+        else {
+            long long int k = findBytes(str + offset, len - offset, sep, seplen);
+            ASSERT(k >= 0);
+            length = k;
+        }
+        
+        parts[i] = Object_FromString(str + offset, length, heap, error);
+        if (parts[i] == NULL) {
+            free(parts);
+            return -1;
+        }
+        offset += length + seplen;
+    }
+
+    Object *list = Object_NewList2(num_parts, parts, heap, error);
+    free(parts);
+
+    if (list == NULL)
+        return -1;
+    rets[0] = list;
+    return 1;
+}
+
+static int bin_join(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+    // 0: list of strings
+    // 1: separator or none
+
+    ParsedArgument pargs[2];
+    if (!parseArgs(error, argv, argc, pargs, "l?s"))
+        return -1;
+
+    const char *sep = "";
+    size_t   seplen = 0;
+    if (pargs[1].defined) {
+        sep = pargs[1].as_string.data;
+        seplen = pargs[1].as_string.size;
+    }
+
+    int count;
+    Object **items = Object_GetListItems(argv[0], &count);
+
+    size_t total = 0;
+    for (int i = 0; i < count; i++) {
+        if (!Object_IsString(items[i])) {
+            Error_Report(error, ErrorType_RUNTIME, "Item %d of the list is not a string", i);
+            return -1;
+        }
+        size_t length;
+        Object_GetString(items[i], &length);
+        total += length;
+    }
+    if (count > 0)
+        total += seplen * (count - 1);
+
+    char starting[128];
+    char *buffer = starting;
+
+    if (total > sizeof(starting)-1) {
+        buffer = malloc(total+1);
+        if (buffer == NULL) {
+            Error_Report(error, ErrorType_INTERNAL, "No memory");
+            return -1;
+        }
+    }
+
+    size_t written = 0;
+    for (int i = 0; i < count; i++) {
+        
+        if (i > 0) {
+            memcpy(buffer + written, sep, seplen);
+            written += seplen;
+        }
+
+        size_t length;
+        const char *s = Object_GetString(items[i], &length);
+        memcpy(buffer + written, s, length);
+        written += length;
+    }
+    ASSERT(written == total);
+    buffer[total] = '\0';
+
+    Object *result = Object_FromString(buffer, total, Runtime_GetHeap(runtime), error);
+    
+    if (buffer != starting)
+        free(buffer);
+
+    if (result == NULL)
+        return -1;
+    rets[0] = result;
+    return 1;
+}
+
+static int bin_replace(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+    // 0: string
+    // 1: substring to be replaced
+    // 2: replacement
+    // 3: maximum number of replacements or none
+
+    ParsedArgument pargs[4];
+    if (!parseArgs(error, argv, argc, pargs, "sss?i"))
+        return -1;
+
+    const char *str = pargs[0].as_string.data;
+    size_t   len = pargs[0].as_string.size;
+    const char *old = pargs[1].as_string.data;
+    size_t   oldlen = pargs[1].as_string.size;
+    const char *new = pargs[2].as_string.data;
+    size_t   newlen = pargs[2].as_string.size;
+
+    if (oldlen == 0) {
+        Error_Report(error, ErrorType_RUNTIME, "Argument #%d is an empty string", 2);
+        return -1;
+    }
+
+    size_t num = countBytes(str, len, old, oldlen);
+    if (pargs[3].defined && pargs[3].as_int >= 0 && (size_t) pargs[3].as_int < num)
+        num = pargs[3].as_int;
+
+    if (num == 0) {
+        // Strings are immutable, so 
+        // the input can be returned.
+        rets[0] = argv[0];
+        return 1;
+    }
+
+    size_t total = len - num * oldlen + num * newlen;
+
+    char starting[128];
+    char *buffer = starting;
+
+    if (total > sizeof(starting)-1) {
+        buffer = malloc(total+1);
+        if (buffer == NULL) {
+            Error_Report(error, ErrorType_INTERNAL, "No memory");
+            return -1;
+        }
+    }
+
+    size_t copied = 0;
+    size_t written = 0;
+    for (size_t i = 0; i < num; i++) {
+        long long int k = findBytes(str + copied, len - copied, old, oldlen);
+        if (k < 0) {
+            UNREACHABLE;
+            break;
+        }
+        memcpy(buffer + written, str + copied, k);
+        written += k;
+        memcpy(buffer + written, new, newlen);
+        written += newlen;
+        copied += k + oldlen;
+    }
+    memcpy(buffer + written, str + copied, len - copied);
+    written += len - copied;
+    ASSERT(written == total);
+    buffer[total] = '\0';
+
+    Object *result = Object_FromString(buffer, total, Runtime_GetHeap(runtime), error);
+
+    if (buffer != starting)
+        free(buffer);
+
+    if (result == NULL)
+        return -1;
+    rets[0] = result;
+    return 1;
+}
+
+// Growable output buffer used by [format], [fromInt] and
+// [fromFloat]. It starts out on the stack and only moves 
+// to the heap when the output doesn't fit.
+typedef struct {
+    char  *data;
+    size_t size;
+    size_t capacity;
+    bool   nomem;
+    char   starting[256];
+} StringBuilder;
+
+static void sbInit(StringBuilder *sb)
+{
+    sb->data = sb->starting;
+    sb->size = 0;
+    sb->capacity = sizeof(sb->starting);
+    sb->nomem = false;
+}
+
+static void sbFree(StringBuilder *sb)
+{
+    if (sb->data != sb->starting)
+        free(sb->data);
+}
+
+// Makes sure that [extra] more bytes can be 
+// written. Returns false if out of memory.
+static bool sbReserve(StringBuilder *sb, size_t extra)
+{
+    if (sb->nomem)
+        return false;
+
+    if (sb->size + extra <= sb->capacity)
+        return true;
+
+    size_t capacity = 2 * sb->capacity;
+    while (capacity < sb->size + extra)
+        capacity *= 2;
+
+    char *data;
+    if (sb->data == sb->starting) {
+        data = malloc(capacity);
+        if (data != NULL)
+            memcpy(data, sb->data, sb->size);
+    } else
+        data = realloc(sb->data, capacity);
+
+    if (data == NULL) {
+        sb->nomem = true;
+        return false;
+    }
+    sb->data = data;
+    sb->capacity = capacity;
+    return true;
+}
+
+static void sbAppend(StringBuilder *sb, const char *str, size_t len)
+{
+    if (sbReserve(sb, len)) {
+        memcpy(sb->data + sb->size, str, len);
+        sb->size += len;
+    }
+}
+
+static void sbAppendString(StringBuilder *sb, const char *str)
+{
+    sbAppend(sb, str, strlen(str));
+}
+
+// Appends the output of a [snprintf] call with the
+// given format. The single argument may be an integer
+// or a float, as specified by [is_float].
+static void sbAppendNumber(StringBuilder *sb, const char *fmt, bool is_float, long long int ival, double fval)
+{
+    char tmp[64];
+    int n;
+    if (is_float)
+        n = snprintf(tmp, sizeof(tmp), fmt, fval);
+    else
+        n = snprintf(tmp, sizeof(tmp), fmt, ival);
+    
+    if (n < 0)
+        return;
+
+    if ((size_t) n < sizeof(tmp)) {
+        sbAppend(sb, tmp, n);
+        return;
+    }
+
+    // Doesn't fit in the temporary buffer (it may
+    // happen when a big width is specified or with
+    // very big floats), so write it in place.
+    if (!sbReserve(sb, n+1))
+        return;
+    if (is_float)
+        snprintf(sb->data + sb->size, n+1, fmt, fval);
+    else
+        snprintf(sb->data + sb->size, n+1, fmt, ival);
+    sb->size += n;
+}
+
+// Nested collections deeper than this are printed 
+// as "..." to avoid looping on cyclic references.
+#define MAX_FORMAT_DEPTH 32
+
+// Appends the textual representation of [obj], which
+// is the same one produced by [print].
+static void sbAppendObject(StringBuilder *sb, Object *obj, Heap *heap, Error *error, int depth)
+{
+    if (depth > MAX_FORMAT_DEPTH) {
+        sbAppendString(sb, "...");
+        return;
+    }
+
+    if (Object_IsString(obj)) {
+        size_t len;
+        const char *str = Object_GetString(obj, &len);
+        sbAppend(sb, str, len);
+        return;
+    }
+
+    if (Object_IsInt(obj)) {
+        sbAppendNumber(sb, "%lld", false, Object_GetInt(obj), 0);
+        return;
+    }
+
+    if (Object_IsFloat(obj)) {
+        sbAppendNumber(sb, "%2.2f", true, 0, Object_GetFloat(obj));
+        return;
+    }
+
+    if (Object_IsNone(obj)) {
+        sbAppendString(sb, "none");
+        return;
+    }
+
+    if (Object_IsBool(obj)) {
+        sbAppendString(sb, Object_GetBool(obj) ? "true" : "false");
+        return;
+    }
+
+    if (Object_IsList(obj)) {
+        int count;
+        Object **items = Object_GetListItems(obj, &count);
+        sbAppendString(sb, "[");
+        for (int i = 0; i < count; i++) {
+            if (i > 0)
+                sbAppendString(sb, ", ");
+            sbAppendObject(sb, items[i], heap, error, depth+1);
+        }
+        sbAppendString(sb, "]");
+        return;
+    }
+
+    if (Object_IsMap(obj)) {
+
+        // The map can't change while it's being
+        // converted, so its items can be walked
+        // directly.
+        Object *key, *val;
+        sbAppendString(sb, "{");
+        for (int pos = 0, i = 0; Object_NextMapItem(obj, &pos, &key, &val); i++) {
+            if (i > 0)
+                sbAppendString(sb, ", ");
+            sbAppendObject(sb, key, heap, error, depth+1);
+            sbAppendString(sb, ": ");
+            sbAppendObject(sb, val, heap, error, depth+1);
+        }
+        sbAppendString(sb, "}");
+        return;
+    }
+
+    // Any other object is less common, so it's
+    // fine to go through its [print] method.
+    char  *text = NULL;
+    size_t len = 0;
+    FILE *fp = open_memstream(&text, &len);
+    if (fp == NULL) {
+        sb->nomem = true;
+        return;
+    }
+    Object_Print(obj, fp);
+    fclose(fp);
+    sbAppend(sb, text, len);
+    free(text);
+}
+
+// Pads the output starting at offset [start] with spaces 
+// until it's at least [width] bytes long. If [left] is true
+// the padding goes after the text, else before it.
+static void sbPad(StringBuilder *sb, size_t start, size_t width, bool left)
+{
+    size_t len = sb->size - start;
+    if (len >= width)
+        return;
+
+    size_t pad = width - len;
+    if (!sbReserve(sb, pad))
+        return;
+
+    char *text = sb->data + start;
+    if (!left)
+        memmove(text + pad, text, len);
+    memset(left ? text + len : text, ' ', pad);
+    sb->size += pad;
+}
+
+static Object *sbToString(StringBuilder *sb, Heap *heap, Error *error)
+{
+    if (sb->nomem) {
+        Error_Report(error, ErrorType_INTERNAL, "No memory");
+        return NULL;
+    }
+    return Object_FromString(sb->data, sb->size, heap, error);
+}
+
+static int bin_format(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+    // 0: format string
+    // 1..: values
+    //
+    // The format string is a subset of printf's:
+    //
+    //   %[flags][width][.precision]specifier
+    //
+    // where the flags are '-' (align left), '0' (pad numbers
+    // with zeros) and '+' (always write the sign of numbers),
+    // and the specifiers are:
+    //
+    //   d, i  an int
+    //   x, X  an int in hexadecimal
+    //   f     an int or float with [precision] decimals (6 by default)
+    //   e, g  like f but in scientific or shortest notation
+    //   s     any value, as it would be printed. The precision 
+    //         is the maximum number of bytes of output.
+    //   %     a literal '%'
+    //
+    // Widths are in bytes.
+
+    if (argc == 0 || !Object_IsString(argv[0])) {
+        Error_Report(error, ErrorType_RUNTIME, "Argument #%d is not a string", 1);
+        return -1;
+    }
+
+    size_t fmtlen;
+    const char *fmt = Object_GetString(argv[0], &fmtlen);
+
+    Heap *heap = Runtime_GetHeap(runtime);
+
+    StringBuilder sb;
+    sbInit(&sb);
+
+    unsigned int next = 1; // Index of the next value to be formatted
+    size_t i = 0;
+    while (i < fmtlen) {
+
+        // Copy everything up to the next specifier.
+        const char *p = memchr(fmt + i, '%', fmtlen - i);
+        size_t plain = (p == NULL) ? fmtlen - i : (size_t) (p - fmt) - i;
+        sbAppend(&sb, fmt + i, plain);
+        i += plain;
+        if (i == fmtlen)
+            break;
+
+        i++; // Skip the '%'.
+
+        bool left = false;
+        bool zero = false;
+        bool sign = false;
+        while (i < fmtlen && (fmt[i] == '-' || fmt[i] == '0' || fmt[i] == '+')) {
+            if (fmt[i] == '-') left = true;
+            if (fmt[i] == '0') zero = true;
+            if (fmt[i] == '+') sign = true;
+            i++;
+        }
+
+        size_t width = 0;
+        while (i < fmtlen && fmt[i] >= '0' && fmt[i] <= '9' && width < 1000000)
+            width = width * 10 + fmt[i++] - '0';
+        
+        long long int precision = -1;
+        if (i < fmtlen && fmt[i] == '.') {
+            i++;
+            precision = 0;
+            while (i < fmtlen && fmt[i] >= '0' && fmt[i] <= '9' && precision < 1000000)
+                precision = precision * 10 + fmt[i++] - '0';
+        }
+
+        if (i == fmtlen) {
+            Error_Report(error, ErrorType_RUNTIME, "Format string ends with an incomplete specifier");
+            sbFree(&sb);
+            return -1;
+        }
+        
+        char spec = fmt[i++];
+        if (spec == '%') {
+            sbAppendString(&sb, "%");
+            continue;
+        }
+
+        if (next == argc) {
+            Error_Report(error, ErrorType_RUNTIME, "Not enough values for the format string");
+            sbFree(&sb);
+            return -1;
+        }
+        Object *arg = argv[next++];
+
+        switch (spec) {
+            
+            case 'd':
+            case 'i':
+            case 'x':
+            case 'X':
+            case 'f':
+            case 'e':
+            case 'g':
+            {
+                bool is_float = (spec == 'f' || spec == 'e' || spec == 'g');
+
+                if (!Object_IsInt(arg) && !(is_float && Object_IsFloat(arg))) {
+                    Error_Report(error, ErrorType_RUNTIME, "Argument #%d is a %s but %%%c expects %s", 
+                                 next, Object_GetName(arg), spec, is_float ? "a numeric" : "an int");
+                    sbFree(&sb);
+                    return -1;
+                }
+
+                // Build the C format for the specifier.
+                char cfmt[32];
+                int n = 0;
+                cfmt[n++] = '%';
+                if (left) cfmt[n++] = '-';
+                if (zero) cfmt[n++] = '0';
+                if (sign) cfmt[n++] = '+';
+                n += snprintf(cfmt + n, sizeof(cfmt) - n, "%zu", width);
+                if (is_float) {
+                    if (precision >= 0)
+                        n += snprintf(cfmt + n, sizeof(cfmt) - n, ".%lld", precision);
+                    cfmt[n++] = spec;
+                } else {
+                    cfmt[n++] = 'l';
+                    cfmt[n++] = 'l';
+                    cfmt[n++] = (spec == 'i') ? 'd' : spec;
+                }
+                cfmt[n] = '\0';
+
+                if (is_float)
+                    sbAppendNumber(&sb, cfmt, true, 0, Object_IsInt(arg) ? Object_GetInt(arg) : Object_GetFloat(arg));
+                else
+                    sbAppendNumber(&sb, cfmt, false, Object_GetInt(arg), 0);
+                break;
+            }
+
+            case 's':
+            {
+                size_t start = sb.size;
+                sbAppendObject(&sb, arg, heap, error, 0);
+                if (error->occurred) {
+                    sbFree(&sb);
+                    return -1;
+                }
+                if (precision >= 0 && sb.size - start > (size_t) precision)
+                    sb.size = start + precision;
+                sbPad(&sb, start, width, left);
+                break;
+            }
+
+            default:
+            Error_Report(error, ErrorType_RUNTIME, "Invalid format specifier %%%c", spec);
+            sbFree(&sb);
+            return -1;
+        }
+    }
+
+    if (next < argc) {
+        Error_Report(error, ErrorType_RUNTIME, "Format string expects %d values, but %d were provided", next-1, argc-1);
+        sbFree(&sb);
+        return -1;
+    }
+
+    Object *result = sbToString(&sb, heap, error);
+    sbFree(&sb);
+
+    if (result == NULL)
+        return -1;
+    rets[0] = result;
+    return 1;
+}
+
+static int bin_fromInt(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+    // 0: int
+
+    ParsedArgument pargs[1];
+    if (!parseArgs(error, argv, argc, pargs, "i"))
+        return -1;
+
+    char buffer[32];
+    int n = snprintf(buffer, sizeof(buffer), "%lld", (long long int) pargs[0].as_int);
+
+    Object *result = Object_FromString(buffer, n, Runtime_GetHeap(runtime), error);
+    if (result == NULL)
+        return -1;
+    rets[0] = result;
+    return 1;
+}
+
+static int bin_fromFloat(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+    // 0: float
+    // 1: number of decimals or none (2 by default)
+
+    ParsedArgument pargs[2];
+    if (!parseArgs(error, argv, argc, pargs, "f?i"))
+        return -1;
+
+    int decimals = 2;
+    if (pargs[1].defined) {
+        if (pargs[1].as_int < 0 || pargs[1].as_int > 100) {
+            Error_Report(error, ErrorType_RUNTIME, "Number of decimals is out of range");
+            return -1;
+        }
+        decimals = pargs[1].as_int;
+    }
+
+    StringBuilder sb;
+    sbInit(&sb);
+    char cfmt[16];
+    snprintf(cfmt, sizeof(cfmt), "%%.%df", decimals);
+    sbAppendNumber(&sb, cfmt, true, 0, pargs[0].as_float);
+    
+    Object *result = sbToString(&sb, Runtime_GetHeap(runtime), error);
+    sbFree(&sb);
+
+    if (result == NULL)
+        return -1;
+    rets[0] = result;
+    return 1;
+}
+
 StaticMapSlot bins_string[] = {
     { "ord",  SM_FUNCT, .as_funct = bin_ord, .argc = 1 },
     { "chr",  SM_FUNCT, .as_funct = bin_chr, .argc = 1 },
@@ -272,4 +1116,16 @@ StaticMapSlot bins_string[] = {
     { "trim", SM_FUNCT, .as_funct = bin_trim, .argc = 1 },
     { "slice", SM_FUNCT, .as_funct = bin_slice, .argc = 3 },
     { "toInt", SM_FUNCT, .as_funct = bin_toInt, .argc = 1 },
+    { "find",  SM_FUNCT, .as_funct = bin_find,  .argc = 3 },
+    { "rfind", SM_FUNCT, .as_funct = bin_rfind, .argc = 2 },
+    { "count", SM_FUNCT, .as_funct = bin_count, .argc = 2 },
+    { "split", SM_FUNCT, .as_funct = bin_split, .argc = 3 },
+    { "join",  SM_FUNCT, .as_funct = bin_join,  .argc = 2 },
+    { "replace",    SM_FUNCT, .as_funct = bin_replace,    .argc = 4 },
+    { "startsWith", SM_FUNCT, .as_funct = bin_startsWith, .argc = 2 },
+    { "endsWith",   SM_FUNCT, .as_funct = bin_endsWith,   .argc = 2 },
+    { "format",     SM_FUNCT, .as_funct = bin_format,     .argc = -1 },
+    { "fromInt",    SM_FUNCT, .as_funct = bin_fromInt,    .argc = 1 },
+    { "fromFloat",  SM_FUNCT, .as_funct = bin_fromFloat,  .argc = 2 },
+    { NULL, SM_END, {}, {} },
 };
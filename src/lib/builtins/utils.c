@@ -14,6 +14,7 @@ int returnValuesVA(Error *error, Heap *heap, Object *rets[static MAX_RETS], cons
 		switch (fmt[i]) {
 			case 'o': ret = va_arg(va, Object*); break;
 			case 'n': ret = Object_NewNone(heap, error); break;
+			case 'b': ret = Object_FromBool (va_arg(va, int),    heap, error); break;
 			case 'i': ret = Object_FromInt  (va_arg(va, int),    heap, error); break;
 			case 'f': ret = Object_FromFloat(va_arg(va, double), heap, error); break;
 			case 's': ret = Object_FromString(va_arg(va, char*), -1, heap, error); break;
@@ -0,0 +1,630 @@
+#include <string.h>
+#include "utils.h"
+#include "vec.h"
+#include "../defs.h"
+#include "../utils/defs.h"
+#include "../utils/vecops.h"
+
+// Vector functions take IntArrays, FloatArrays or
+// Buffers. Since a buffer is just bytes, the kind of
+// its items must be specified using the last argument
+// of the function as one of "int32", "int64", "float32"
+// or "float64".
+//
+// Items that are stored as 32 bit values are converted
+// in chunks of CHUNK items to 64 bit ones before being
+// handed to the kernels.
+
+#define CHUNK 512
+
+typedef enum {
+	KIND_I32,
+	KIND_I64,
+	KIND_F32,
+	KIND_F64,
+} Kind;
+
+typedef struct {
+	Kind kind;
+	void  *data;
+	size_t count;
+} VecArg;
+
+static bool isIntKind(Kind kind)
+{
+	return kind == KIND_I32 || kind == KIND_I64;
+}
+
+static bool parseKind(Object *obj, Kind *kind, Error *error)
+{
+	static const struct {
+		const char *name;
+		Kind kind;
+	} kinds[] = {
+		{ "int32",   KIND_I32 },
+		{ "int64",   KIND_I64 },
+		{ "float32", KIND_F32 },
+		{ "float64", KIND_F64 },
+	};
+
+	if (!Object_IsString(obj)) {
+		Error_Report(error, ErrorType_RUNTIME, "Buffer operands need the kind of their items, but it's a %s", Object_GetName(obj));
+		return false;
+	}
+
+	size_t len;
+	const char *str = Object_GetString(obj, &len);
+	for (size_t i = 0; i < sizeof(kinds)/sizeof(kinds[0]); i++)
+		if (strlen(kinds[i].name) == len && !strncmp(kinds[i].name, str, len)) {
+			*kind = kinds[i].kind;
+			return true;
+		}
+
+	Error_Report(error, ErrorType_RUNTIME, "Unknown item kind \"%.*s\"", (int) len, str);
+	return false;
+}
+
+// Makes an operand out of argv[idx]. The [kind] object is
+// the last argument of the function and is only used by
+// buffers.
+static bool getOperand(Object **argv, int idx, Object *kind, VecArg *op, Error *error)
+{
+	Object *obj = argv[idx];
+
+	if (Object_IsIntArray(obj)) {
+		op->kind = KIND_I64;
+		op->data = Object_GetIntArray(obj, &op->count);
+		return true;
+	}
+
+	if (Object_IsFloatArray(obj)) {
+		op->kind = KIND_F64;
+		op->data = Object_GetFloatArray(obj, &op->count);
+		return true;
+	}
+
+	if (Object_IsBuffer(obj)) {
+
+		if (!parseKind(kind, &op->kind, error))
+			return false;
+
+		size_t size;
+		op->data = Object_GetBuffer(obj, &size);
+
+		size_t itemsize = (op->kind == KIND_I32 || op->kind == KIND_F32) ? 4 : 8;
+		if (size % itemsize != 0) {
+			Error_Report(error, ErrorType_RUNTIME, "Buffer size %d is not a multiple of %d", (int) size, (int) itemsize);
+			return false;
+		}
+		op->count = size / itemsize;
+		return true;
+	}
+
+	Error_Report(error, ErrorType_RUNTIME, "Argument %d is not an " TYPENAME_INTARRAY ", " TYPENAME_FLOATARRAY " or " TYPENAME_BUFFER, idx);
+	return false;
+}
+
+// Returns how many items starting from [start] are
+// returned by a single call to getInts or getFloats.
+static size_t chunkSize(VecArg *op, size_t start, bool floats)
+{
+	size_t left = op->count - start;
+	bool native = floats ? op->kind == KIND_F64 : op->kind == KIND_I64;
+	if (native || left < CHUNK)
+		return left;
+	return CHUNK;
+}
+
+static const long long int *getInts(VecArg *op, size_t start, size_t n, long long int scratch[static CHUNK])
+{
+	ASSERT(isIntKind(op->kind));
+
+	if (op->kind == KIND_I64)
+		return (long long int*) op->data + start;
+
+	const int32_t *src = (int32_t*) op->data + start;
+	for (size_t i = 0; i < n; i++)
+		scratch[i] = src[i];
+	return scratch;
+}
+
+static const double *getFloats(VecArg *op, size_t start, size_t n, double scratch[static CHUNK])
+{
+	switch (op->kind) {
+		case KIND_F64: return (double*) op->data + start;
+		case KIND_F32: for (size_t i = 0; i < n; i++) scratch[i] = ((float*)         op->data)[start + i]; break;
+		case KIND_I32: for (size_t i = 0; i < n; i++) scratch[i] = ((int32_t*)       op->data)[start + i]; break;
+		case KIND_I64: for (size_t i = 0; i < n; i++) scratch[i] = ((long long int*) op->data)[start + i]; break;
+	}
+	return scratch;
+}
+
+// Like chunkSize, but for two operands that are
+// read in lockstep.
+static size_t chunkSize2(VecArg *x, VecArg *y, size_t start, bool floats)
+{
+	size_t a = chunkSize(x, start, floats);
+	size_t b = chunkSize(y, start, floats);
+	return a < b ? a : b;
+}
+
+static bool checkSameCount(VecArg *x, VecArg *y, Error *error)
+{
+	if (x->count != y->count) {
+		Error_Report(error, ErrorType_RUNTIME, "Operands have different item counts (%d and %d)", (int) x->count, (int) y->count);
+		return false;
+	}
+	return true;
+}
+
+static bool checkNotEmpty(VecArg *x, Error *error)
+{
+	if (x->count == 0) {
+		Error_Report(error, ErrorType_RUNTIME, "VecArg has no items");
+		return false;
+	}
+	return true;
+}
+
+static int bin_sum(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: vector
+	// 1: kind
+	UNUSED(argc);
+
+	VecArg x;
+	if (!getOperand(argv, 0, argv[1], &x, error))
+		return -1;
+
+	const VecOps *ops = VecOps_Get();
+
+	if (isIntKind(x.kind)) {
+		long long int scratch[CHUNK];
+		unsigned long long int sum = 0;
+		for (size_t i = 0, n; i < x.count; i += n) {
+			n = chunkSize(&x, i, false);
+			sum += (unsigned long long int) ops->sum_i64(getInts(&x, i, n, scratch), n);
+		}
+		Object *res = Object_FromInt((long long int) sum, Runtime_GetHeap(runtime), error);
+		if (res == NULL)
+			return -1;
+		return returnValues2(error, runtime, rets, "o", res);
+	}
+
+	double scratch[CHUNK];
+	double sum = 0;
+	for (size_t i = 0, n; i < x.count; i += n) {
+		n = chunkSize(&x, i, true);
+		sum += ops->sum_f64(getFloats(&x, i, n, scratch), n);
+	}
+	return returnValues2(error, runtime, rets, "f", sum);
+}
+
+static int bin_mean(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: vector
+	// 1: kind
+	//
+	// The mean is always a float, and is computed
+	// using floats even for int items, so it can't
+	// overflow.
+	UNUSED(argc);
+
+	VecArg x;
+	if (!getOperand(argv, 0, argv[1], &x, error))
+		return -1;
+
+	if (!checkNotEmpty(&x, error))
+		return -1;
+
+	const VecOps *ops = VecOps_Get();
+
+	double scratch[CHUNK];
+	double sum = 0;
+	for (size_t i = 0, n; i < x.count; i += n) {
+		n = chunkSize(&x, i, true);
+		sum += ops->sum_f64(getFloats(&x, i, n, scratch), n);
+	}
+	return returnValues2(error, runtime, rets, "f", sum / x.count);
+}
+
+static int minOrMax(Runtime *runtime, Object **argv, Object *rets[static MAX_RETS], Error *error, bool max)
+{
+	VecArg x;
+	if (!getOperand(argv, 0, argv[1], &x, error))
+		return -1;
+
+	if (!checkNotEmpty(&x, error))
+		return -1;
+
+	const VecOps *ops = VecOps_Get();
+
+	if (isIntKind(x.kind)) {
+		long long int scratch[CHUNK];
+		long long int res = 0;
+		for (size_t i = 0, n; i < x.count; i += n) {
+			n = chunkSize(&x, i, false);
+			long long int lo, hi;
+			ops->minmax_i64(getInts(&x, i, n, scratch), n, &lo, &hi);
+			long long int m = max ? hi : lo;
+			if (i == 0 || (max ? m > res : m < res))
+				res = m;
+		}
+		Object *obj = Object_FromInt(res, Runtime_GetHeap(runtime), error);
+		if (obj == NULL)
+			return -1;
+		return returnValues2(error, runtime, rets, "o", obj);
+	}
+
+	double scratch[CHUNK];
+	double res = 0;
+	for (size_t i = 0, n; i < x.count; i += n) {
+		n = chunkSize(&x, i, true);
+		double lo, hi;
+		ops->minmax_f64(getFloats(&x, i, n, scratch), n, &lo, &hi);
+		double m = max ? hi : lo;
+		if (i == 0 || (max ? m > res : m < res))
+			res = m;
+	}
+	return returnValues2(error, runtime, rets, "f", res);
+}
+
+static int bin_min(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: vector
+	// 1: kind
+	UNUSED(argc);
+	return minOrMax(runtime, argv, rets, error, false);
+}
+
+static int bin_max(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: vector
+	// 1: kind
+	UNUSED(argc);
+	return minOrMax(runtime, argv, rets, error, true);
+}
+
+static int bin_dot(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: vector
+	// 1: vector
+	// 2: kind
+	//
+	// The result is an int when both vectors hold
+	// ints, else it's a float.
+	UNUSED(argc);
+
+	VecArg x, y;
+	if (!getOperand(argv, 0, argv[2], &x, error) ||
+		!getOperand(argv, 1, argv[2], &y, error))
+		return -1;
+
+	if (!checkSameCount(&x, &y, error))
+		return -1;
+
+	const VecOps *ops = VecOps_Get();
+
+	if (isIntKind(x.kind) && isIntKind(y.kind)) {
+		long long int scratch_x[CHUNK];
+		long long int scratch_y[CHUNK];
+		unsigned long long int dot = 0;
+		for (size_t i = 0, n; i < x.count; i += n) {
+			n = chunkSize2(&x, &y, i, false);
+			dot += (unsigned long long int) ops->dot_i64(getInts(&x, i, n, scratch_x), getInts(&y, i, n, scratch_y), n);
+		}
+		Object *res = Object_FromInt((long long int) dot, Runtime_GetHeap(runtime), error);
+		if (res == NULL)
+			return -1;
+		return returnValues2(error, runtime, rets, "o", res);
+	}
+
+	double scratch_x[CHUNK];
+	double scratch_y[CHUNK];
+	double dot = 0;
+	for (size_t i = 0, n; i < x.count; i += n) {
+		n = chunkSize2(&x, &y, i, true);
+		dot += ops->dot_f64(getFloats(&x, i, n, scratch_x), getFloats(&y, i, n, scratch_y), n);
+	}
+	return returnValues2(error, runtime, rets, "f", dot);
+}
+
+static int addOrMul(Runtime *runtime, Object **argv, Object *rets[static MAX_RETS], Error *error, bool mul)
+{
+	VecArg x, y;
+	if (!getOperand(argv, 0, argv[2], &x, error) ||
+		!getOperand(argv, 1, argv[2], &y, error))
+		return -1;
+
+	if (!checkSameCount(&x, &y, error))
+		return -1;
+
+	const VecOps *ops = VecOps_Get();
+	Heap *heap = Runtime_GetHeap(runtime);
+
+	Object *res;
+	if (isIntKind(x.kind) && isIntKind(y.kind)) {
+
+		res = Object_NewIntArray(x.count, heap, error);
+		if (res == NULL)
+			return -1;
+		long long int *z = Object_GetIntArray(res, NULL);
+
+		long long int scratch_x[CHUNK];
+		long long int scratch_y[CHUNK];
+		for (size_t i = 0, n; i < x.count; i += n) {
+			n = chunkSize2(&x, &y, i, false);
+			const long long int *a = getInts(&x, i, n, scratch_x);
+			const long long int *b = getInts(&y, i, n, scratch_y);
+			(mul ? ops->mul_i64 : ops->add_i64)(a, b, z + i, n);
+		}
+
+	} else {
+
+		res = Object_NewFloatArray(x.count, heap, error);
+		if (res == NULL)
+			return -1;
+		double *z = Object_GetFloatArray(res, NULL);
+
+		double scratch_x[CHUNK];
+		double scratch_y[CHUNK];
+		for (size_t i = 0, n; i < x.count; i += n) {
+			n = chunkSize2(&x, &y, i, true);
+			const double *a = getFloats(&x, i, n, scratch_x);
+			const double *b = getFloats(&y, i, n, scratch_y);
+			(mul ? ops->mul_f64 : ops->add_f64)(a, b, z + i, n);
+		}
+	}
+
+	return returnValues2(error, runtime, rets, "o", res);
+}
+
+static int bin_add(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: vector
+	// 1: vector
+	// 2: kind
+	//
+	// Returns a new IntArray when both vectors hold
+	// ints, else a new FloatArray.
+	UNUSED(argc);
+	return addOrMul(runtime, argv, rets, error, false);
+}
+
+static int bin_mul(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: vector
+	// 1: vector
+	// 2: kind
+	UNUSED(argc);
+	return addOrMul(runtime, argv, rets, error, true);
+}
+
+static int bin_axpy(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: scalar a
+	// 1: vector x
+	// 2: array y
+	// 3: kind
+	//
+	// Computes y = a * x + y in place. The result
+	// is stored in y, so it must be an array. If it's
+	// an IntArray, both a and x must be ints.
+	UNUSED(argc);
+
+	VecArg x;
+	if (!getOperand(argv, 1, argv[3], &x, error))
+		return -1;
+
+	Object *a = argv[0];
+	Object *y = argv[2];
+
+	size_t count;
+	const VecOps *ops = VecOps_Get();
+
+	if (Object_IsIntArray(y)) {
+
+		if (!Object_IsInt(a) || !isIntKind(x.kind)) {
+			Error_Report(error, ErrorType_RUNTIME, "Can't store float results into an " TYPENAME_INTARRAY);
+			return -1;
+		}
+
+		long long int *z = Object_GetIntArray(y, &count);
+		if (count != x.count) {
+			Error_Report(error, ErrorType_RUNTIME, "Operands have different item counts (%d and %d)", (int) x.count, (int) count);
+			return -1;
+		}
+
+		long long int scratch[CHUNK];
+		for (size_t i = 0, n; i < x.count; i += n) {
+			n = chunkSize(&x, i, false);
+			ops->axpy_i64(Object_GetInt(a), getInts(&x, i, n, scratch), z + i, n);
+		}
+
+	} else if (Object_IsFloatArray(y)) {
+
+		double k;
+		if (Object_IsInt(a))
+			k = Object_GetInt(a);
+		else if (Object_IsFloat(a))
+			k = Object_GetFloat(a);
+		else {
+			Error_Report(error, ErrorType_RUNTIME, "Argument 0 is not a number");
+			return -1;
+		}
+
+		double *z = Object_GetFloatArray(y, &count);
+		if (count != x.count) {
+			Error_Report(error, ErrorType_RUNTIME, "Operands have different item counts (%d and %d)", (int) x.count, (int) count);
+			return -1;
+		}
+
+		double scratch[CHUNK];
+		for (size_t i = 0, n; i < x.count; i += n) {
+			n = chunkSize(&x, i, true);
+			ops->axpy_f64(k, getFloats(&x, i, n, scratch), z + i, n);
+		}
+
+	} else {
+		Error_Report(error, ErrorType_RUNTIME, "Argument 2 is not an " TYPENAME_INTARRAY " or " TYPENAME_FLOATARRAY);
+		return -1;
+	}
+
+	return returnValues2(error, runtime, rets, "n");
+}
+
+static int bin_prefixSum(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: vector
+	// 1: kind
+	//
+	// Returns a new array where each item is the sum
+	// of the ones up to the same position of the vector.
+	// Each item depends on the previous one, so this is
+	// a plain loop.
+	UNUSED(argc);
+
+	VecArg x;
+	if (!getOperand(argv, 0, argv[1], &x, error))
+		return -1;
+
+	Heap *heap = Runtime_GetHeap(runtime);
+
+	Object *res;
+	if (isIntKind(x.kind)) {
+
+		res = Object_NewIntArray(x.count, heap, error);
+		if (res == NULL)
+			return -1;
+		long long int *z = Object_GetIntArray(res, NULL);
+
+		long long int scratch[CHUNK];
+		unsigned long long int sum = 0;
+		for (size_t i = 0, n; i < x.count; i += n) {
+			n = chunkSize(&x, i, false);
+			const long long int *a = getInts(&x, i, n, scratch);
+			for (size_t j = 0; j < n; j++) {
+				sum += (unsigned long long int) a[j];
+				z[i + j] = (long long int) sum;
+			}
+		}
+
+	} else {
+
+		res = Object_NewFloatArray(x.count, heap, error);
+		if (res == NULL)
+			return -1;
+		double *z = Object_GetFloatArray(res, NULL);
+
+		double scratch[CHUNK];
+		double sum = 0;
+		for (size_t i = 0, n; i < x.count; i += n) {
+			n = chunkSize(&x, i, true);
+			const double *a = getFloats(&x, i, n, scratch);
+			for (size_t j = 0; j < n; j++) {
+				sum += a[j];
+				z[i + j] = sum;
+			}
+		}
+	}
+
+	return returnValues2(error, runtime, rets, "o", res);
+}
+
+static int bin_histogram(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// 0: vector
+	// 1: number of bins
+	// 2: low
+	// 3: high
+	// 4: kind
+	//
+	// Returns an IntArray with the number of items
+	// that fall in each of the equally sized bins
+	// that split [low, high]. Items out of the range
+	// (and NaNs) aren't counted.
+	UNUSED(argc);
+
+	VecArg x;
+	if (!getOperand(argv, 0, argv[4], &x, error))
+		return -1;
+
+	ParsedArgument pargs[4];
+	if (!parseArgs(error, argv+1, 1, pargs+1, "i"))
+		return -1;
+
+	double bounds[2];
+	for (int i = 0; i < 2; i++) {
+		Object *obj = argv[2 + i];
+		if (Object_IsInt(obj))
+			bounds[i] = Object_GetInt(obj);
+		else if (Object_IsFloat(obj))
+			bounds[i] = Object_GetFloat(obj);
+		else {
+			Error_Report(error, ErrorType_RUNTIME, "Argument %d is not a number", 2 + i);
+			return -1;
+		}
+	}
+
+	int64_t bins = pargs[1].as_int;
+	double  low  = bounds[0];
+	double  high = bounds[1];
+
+	if (bins < 1) {
+		Error_Report(error, ErrorType_RUNTIME, "The number of bins must be positive");
+		return -1;
+	}
+
+	if (!(low < high)) {
+		Error_Report(error, ErrorType_RUNTIME, "The low bound must be less than the high bound");
+		return -1;
+	}
+
+	Object *res = Object_NewIntArray(bins, Runtime_GetHeap(runtime), error);
+	if (res == NULL)
+		return -1;
+	long long int *counts = Object_GetIntArray(res, NULL);
+
+	double scale = bins / (high - low);
+
+	double scratch[CHUNK];
+	for (size_t i = 0, n; i < x.count; i += n) {
+		n = chunkSize(&x, i, true);
+		const double *a = getFloats(&x, i, n, scratch);
+		for (size_t j = 0; j < n; j++) {
+			double v = a[j];
+			if (!(v >= low && v <= high))
+				continue;
+			int64_t bin = (v - low) * scale;
+			if (bin >= bins) // v == high
+				bin = bins-1;
+			counts[bin]++;
+		}
+	}
+
+	return returnValues2(error, runtime, rets, "o", res);
+}
+
+static int bin_backend(Runtime *runtime, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Error *error)
+{
+	// Returns the name of the instruction set
+	// used by the kernels.
+	UNUSED(argv);
+	UNUSED(argc);
+	return returnValues2(error, runtime, rets, "s", VecOps_Get()->name);
+}
+
+StaticMapSlot bins_vec[] = {
+	{ "sum",       SM_FUNCT, .as_funct = bin_sum,       .argc = 2 },
+	{ "mean",      SM_FUNCT, .as_funct = bin_mean,      .argc = 2 },
+	{ "min",       SM_FUNCT, .as_funct = bin_min,       .argc = 2 },
+	{ "max",       SM_FUNCT, .as_funct = bin_max,       .argc = 2 },
+	{ "dot",       SM_FUNCT, .as_funct = bin_dot,       .argc = 3 },
+	{ "add",       SM_FUNCT, .as_funct = bin_add,       .argc = 3 },
+	{ "mul",       SM_FUNCT, .as_funct = bin_mul,       .argc = 3 },
+	{ "axpy",      SM_FUNCT, .as_funct = bin_axpy,      .argc = 4 },
+	{ "prefixSum", SM_FUNCT, .as_funct = bin_prefixSum, .argc = 2 },
+	{ "histogram", SM_FUNCT, .as_funct = bin_histogram, .argc = 5 },
+	{ "backend",   SM_FUNCT, .as_funct = bin_backend,   .argc = 0 },
+	{ NULL, SM_END, {}, {} },
+};
@@ -0,0 +1,2 @@
+#include "../runtime.h"
+extern StaticMapSlot bins_vec[];
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "codecache.h"
+#include "utils/hash.h"
+
+// The code cache holds the executables of the last
+// compiled sources, so that embedders running the same
+// strings over and over don't compile them every time.
+// It can be shared by multiple runtimes, by setting it
+// in their configuration, but not by multiple threads.
+//
+// Sources are identified by their name, absolute path
+// and body. The hash of the body is computed by the
+// caller, since it's also needed by the cache folder,
+// and is only used to find the candidates, which are
+// then compared with the source the executable holds.
+// When the cache is full, the least recently used 
+// executable is dropped.
+
+typedef struct Entry Entry;
+struct Entry {
+	uint64_t key;
+	Executable *exe;
+	Entry *next; // Next in the bucket
+	Entry *newer, *older;
+};
+
+struct xCodeCache {
+	int capacity, count;
+	size_t hits, misses;
+	Entry *newest, *oldest;
+	unsigned int mask;
+	Entry *buckets[];
+};
+
+CodeCache *CodeCache_New(int capacity)
+{
+	if (capacity < 1)
+		capacity = 1;
+
+	unsigned int buckets = 8;
+	while (buckets < 2 * (unsigned int) capacity)
+		buckets *= 2;
+
+	CodeCache *cache = calloc(1, sizeof(CodeCache) + buckets * sizeof(Entry*));
+	if (cache == NULL)
+		return NULL;
+
+	cache->capacity = capacity;
+	cache->mask = buckets - 1;
+	return cache;
+}
+
+void CodeCache_Free(CodeCache *cache)
+{
+	Entry *entry = cache->newest;
+	while (entry != NULL) {
+		Entry *older = entry->older;
+		Executable_Free(entry->exe);
+		free(entry);
+		entry = older;
+	}
+	free(cache);
+}
+
+static uint64_t makeKey(Source *source, uint64_t hash)
+{
+	const char *name = Source_GetName(source);
+	if (name == NULL)
+		return hash;
+	return hash ^ (hashbytes64(name, strlen(name)) * 0x9E3779B97F4A7C15ULL);
+}
+
+static bool sameString(const char *a, const char *b)
+{
+	if (a == NULL || b == NULL)
+		return a == b;
+	return !strcmp(a, b);
+}
+
+static bool sameSource(Source *a, Source *b)
+{
+	if (a == b)
+		return true;
+	return a != NULL && b != NULL
+	    && Source_GetSize(a) == Source_GetSize(b)
+	    && sameString(Source_GetName(a), Source_GetName(b))
+	    && sameString(Source_GetAbsolutePath(a), Source_GetAbsolutePath(b))
+	    && !memcmp(Source_GetBody(a), Source_GetBody(b), Source_GetSize(a));
+}
+
+static void unlink_(CodeCache *cache, Entry *entry)
+{
+	if (entry->newer) entry->newer->older = entry->older; else cache->newest = entry->older;
+	if (entry->older) entry->older->newer = entry->newer; else cache->oldest = entry->newer;
+}
+
+static void linkAsNewest(CodeCache *cache, Entry *entry)
+{
+	entry->newer = NULL;
+	entry->older = cache->newest;
+	if (cache->newest) cache->newest->newer = entry; else cache->oldest = entry;
+	cache->newest = entry;
+}
+
+static Entry **findEntry(CodeCache *cache, Source *source, uint64_t key)
+{
+	Entry **link = &cache->buckets[key & cache->mask];
+	while (*link != NULL) {
+		Entry *entry = *link;
+		if (entry->key == key && sameSource(Executable_GetSource(entry->exe), source))
+			break;
+		link = &entry->next;
+	}
+	return link;
+}
+
+// Returns a copy of the executable of [source], or NULL
+// if it's not in the cache. The [hash] is the one of the
+// source's body, as returned by [hashbytes64].
+Executable *CodeCache_Lookup(CodeCache *cache, Source *source, uint64_t hash)
+{
+	Entry *entry = *findEntry(cache, source, makeKey(source, hash));
+	if (entry == NULL) {
+		cache->misses++;
+		return NULL;
+	}
+	cache->hits++;
+
+	if (cache->newest != entry) {
+		unlink_(cache, entry);
+		linkAsNewest(cache, entry);
+	}
+	return Executable_Copy(entry->exe);
+}
+
+static void dropOldest(CodeCache *cache)
+{
+	Entry *entry = cache->oldest;
+	Entry **link = &cache->buckets[entry->key & cache->mask];
+	while (*link != entry)
+		link = &(*link)->next;
+	*link = entry->next;
+	unlink_(cache, entry);
+	Executable_Free(entry->exe);
+	free(entry);
+	cache->count--;
+}
+
+// Stores a copy of [exe] as the executable of [source].
+// Since the cache only makes things faster, failing to
+// store it isn't an error.
+void CodeCache_Insert(CodeCache *cache, Source *source, uint64_t hash, Executable *exe)
+{
+	uint64_t key = makeKey(source, hash);
+	if (*findEntry(cache, source, key) != NULL)
+		return;
+
+	if (!sameSource(Executable_GetSource(exe), source))
+		return; // The source couldn't be compared to the next ones.
+
+	Entry *entry = malloc(sizeof(Entry));
+	if (entry == NULL)
+		return;
+
+	if (cache->count == cache->capacity)
+		dropOldest(cache);
+
+	Entry **bucket = &cache->buckets[key & cache->mask];
+	entry->key = key;
+	entry->exe = Executable_Copy(exe);
+	entry->next = *bucket;
+	*bucket = entry;
+	linkAsNewest(cache, entry);
+	cache->count++;
+}
+
+void CodeCache_GetStats(CodeCache *cache, CodeCacheStats *stats)
+{
+	stats->hits = cache->hits;
+	stats->misses = cache->misses;
+	stats->count = cache->count;
+	stats->capacity = cache->capacity;
+}
@@ -0,0 +1,21 @@
+#ifndef CODECACHE_H
+#define CODECACHE_H
+#include <stddef.h>
+#include <stdint.h>
+#include "executable.h"
+
+typedef struct xCodeCache CodeCache;
+
+typedef struct {
+	size_t hits;
+	size_t misses;
+	int    count;
+	int    capacity;
+} CodeCacheStats;
+
+CodeCache  *CodeCache_New(int capacity);
+void        CodeCache_Free(CodeCache *cache);
+Executable *CodeCache_Lookup(CodeCache *cache, Source *source, uint64_t hash);
+void        CodeCache_Insert(CodeCache *cache, Source *source, uint64_t hash, Executable *exe);
+void        CodeCache_GetStats(CodeCache *cache, CodeCacheStats *stats);
+#endif
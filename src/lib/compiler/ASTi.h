@@ -43,6 +43,7 @@ typedef enum {
 	NODE_WHILE,
 	NODE_BREAK,
 	NODE_DOWHILE,
+	NODE_FOR,
 } NodeKind;
 
 typedef enum {
@@ -184,6 +185,14 @@ typedef struct {
 	Node *condition;
 } DoWhileNode;
 
+typedef struct {
+	Node  base;
+	char *key; // NULL when only the value is bound.
+	char *val;
+	Node *set;
+	Node *body;
+} ForNode;
+
 typedef struct {
 	Node  base;
 	Node *head;
@@ -46,6 +46,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include "../utils/defs.h"
 #include "codegenctx.h"
 #include "compile.h"
@@ -130,6 +131,22 @@ static void emitInstr_JUMPIFANDPOP_2(CodegenContext *ctx,
 	CodegenContext_EmitInstr(ctx, OPCODE_JUMPIFANDPOP, opv, 1, off, len);
 }
 
+static void emitInstr_ITER_INIT(CodegenContext *ctx, int off, int len)
+{
+	CodegenContext_EmitInstr(ctx, OPCODE_ITER_INIT, NULL, 0, off, len);
+}
+
+static void emitInstr_ITER_NEXT(CodegenContext *ctx, 
+	                            Label *op0, long long int op1,
+	                            int off, int len)
+{
+	Operand opv[2] = {
+		{ .type = OPTP_PROMISE, .as_promise = Label_ToPromise(op0) },
+		{ .type = OPTP_INT, .as_int = op1 },
+	};
+	CodegenContext_EmitInstr(ctx, OPCODE_ITER_NEXT, opv, 2, off, len);
+}
+
 static void emitInstr_EQL(CodegenContext *ctx, int off, int len)
 {
 	CodegenContext_EmitInstr(ctx, OPCODE_EQL, NULL, 0, off, len);
@@ -194,9 +211,233 @@ static Opcode exprkind_to_opcode(ExprKind kind)
 	return -1;
 }
 
+static bool emitInstrForInlinedCall(CodegenContext *ctx, CallExprNode *call, 
+	                                Label *label_break, int returns);
+
+/* Static types
+ *
+ *   A parameter annotated with the builtin "int" or "float"
+ *   type that the function never assigns holds a value of
+ *   that type for the whole call, since the annotation was
+ *   checked on entry. The same goes for the parameters of
+ *   the inlined functions, which are never assigned. The
+ *   types of these parameters, of the numeric literals and
+ *   of the arithmetic on them are known at compile time and
+ *   are used to:
+ *
+ *     - Check the annotations with CHECKINT and CHECKFLT,
+ *       which don't load the type by name like CHECKTYPE;
+ *
+ *     - Skip the checks of the inlined calls whose arguments
+ *       are known to have the right type;
+ *
+ *     - Emit the versions of the arithmetic and relational
+ *       instructions specialized for ints or floats.
+ */
+
+// Parameters after this index are never typed.
+#define MAX_TYPED_ARGS 32
+
+struct FunctionScope {
+	FuncExprNode *func;
+	StaticType argtypes[MAX_TYPED_ARGS]; // By argument index.
+};
+
+// Returns the index of the argument with the given name,
+// or -1. When more parameters have the same name, the
+// first one is bound last by the function, so it wins.
+static int getParameterIndex(FuncExprNode *func, const char *name)
+{
+	int found = -1;
+	int argidx = func->argc-1;
+	for(Node *arg = func->argv; arg != NULL; arg = arg->next, argidx -= 1)
+		if(!strcmp(((ArgumentNode*) arg)->name, name))
+			found = argidx;
+	return found;
+}
+
+// Returns the type granted by the annotation of
+// the argument with index [argidx] of [func].
+static StaticType getAnnotatedType(CodegenContext *ctx, FuncExprNode *func, int argidx)
+{
+	InlineTable *inlines = CodegenContext_GetInlineTable(ctx);
+	if(inlines == NULL || argidx < 0)
+		return STATICTYPE_UNKNOWN;
+
+	Node *arg = func->argv;
+	for(int i = func->argc-1; i > argidx; i -= 1)
+		arg = arg->next;
+	return InlineTable_GetAnnotatedType(inlines, ((ArgumentNode*) arg)->type);
+}
+
+static void initFunctionScope(CodegenContext *ctx, FunctionScope *scope, FuncExprNode *func)
+{
+	scope->func = func;
+
+	int argidx = func->argc-1;
+	for(Node *arg = func->argv; arg != NULL; arg = arg->next, argidx -= 1)
+	{
+		if(argidx >= MAX_TYPED_ARGS)
+			continue;
+
+		const char *name = ((ArgumentNode*) arg)->name;
+		StaticType type = getAnnotatedType(ctx, func, argidx);
+		if(type != STATICTYPE_UNKNOWN && !InlineTable_IsConstantParameter(func, name))
+			type = STATICTYPE_UNKNOWN;
+		scope->argtypes[argidx] = type;
+	}
+}
+
+// Returns the type of the value of [node] if it's known.
+// The [inlined] function is the one whose body [node] is
+// part of when it's inlined, or NULL.
+static StaticType getStaticType(CodegenContext *ctx, FuncExprNode *inlined, Node *node)
+{
+	if(node->kind != NODE_EXPR)
+		return STATICTYPE_UNKNOWN;
+
+	ExprNode *expr = (ExprNode*) node;
+	switch(expr->kind)
+	{
+		case EXPR_INT:
+		return STATICTYPE_INT;
+
+		case EXPR_FLOAT:
+		return STATICTYPE_FLOAT;
+
+		case EXPR_IDENT:
+		{
+			const char *name = ((IdentExprNode*) expr)->val;
+			if(inlined != NULL)
+				return getAnnotatedType(ctx, inlined, getParameterIndex(inlined, name));
+
+			FunctionScope *scope = CodegenContext_GetFunctionScope(ctx);
+			if(scope == NULL)
+				return STATICTYPE_UNKNOWN;
+
+			int argidx = getParameterIndex(scope->func, name);
+			if(argidx < 0 || argidx >= MAX_TYPED_ARGS)
+				return STATICTYPE_UNKNOWN;
+			return scope->argtypes[argidx];
+		}
+
+		case EXPR_POS:
+		case EXPR_NEG:
+		return getStaticType(ctx, inlined, ((OperExprNode*) expr)->head);
+
+		case EXPR_ADD: case EXPR_SUB:
+		case EXPR_MUL: case EXPR_DIV:
+		case EXPR_MOD:
+		{
+			Node *lop = ((OperExprNode*) expr)->head;
+			StaticType ltype = getStaticType(ctx, inlined, lop);
+			StaticType rtype = getStaticType(ctx, inlined, lop->next);
+			if(ltype == STATICTYPE_INT && rtype == STATICTYPE_INT)
+				return STATICTYPE_INT;
+			// Operations mixing ints and floats
+			// give floats, except for the modulo
+			// which only accepts ints.
+			if(ltype == STATICTYPE_UNKNOWN || rtype == STATICTYPE_UNKNOWN || expr->kind == EXPR_MOD)
+				return STATICTYPE_UNKNOWN;
+			return STATICTYPE_FLOAT;
+		}
+
+		default:
+		return STATICTYPE_UNKNOWN;
+	}
+	UNREACHABLE;
+	return STATICTYPE_UNKNOWN;
+}
+
+// Returns true if [node] is made only of numeric
+// literals and arithmetic operators.
+static bool isConstantExpr(Node *node)
+{
+	if(node->kind != NODE_EXPR)
+		return false;
+
+	ExprNode *expr = (ExprNode*) node;
+	switch(expr->kind)
+	{
+		case EXPR_INT:
+		case EXPR_FLOAT:
+		return true;
+
+		case EXPR_POS: case EXPR_NEG:
+		case EXPR_ADD: case EXPR_SUB:
+		case EXPR_MUL: case EXPR_DIV:
+		case EXPR_MOD:
+		for(Node *operand = ((OperExprNode*) expr)->head; operand; operand = operand->next)
+			if(!isConstantExpr(operand))
+				return false;
+		return true;
+
+		default:
+		return false;
+	}
+	UNREACHABLE;
+	return false;
+}
+
+// Returns the instruction of the operator [expr], 
+// specialized if its operands are known to be both
+// ints or both floats. Operations on constants are
+// left as they are.
+static Opcode getOperatorOpcode(CodegenContext *ctx, FuncExprNode *inlined, ExprNode *expr)
+{
+	Opcode opcode = exprkind_to_opcode(expr->kind);
+	switch(opcode)
+	{
+		case OPCODE_ADD: case OPCODE_SUB: case OPCODE_MUL:
+		case OPCODE_LSS: case OPCODE_GRT: case OPCODE_LEQ: case OPCODE_GEQ:
+		break;
+
+		default:
+		return opcode;
+	}
+
+	Node *lop = ((OperExprNode*) expr)->head;
+	if(isConstantExpr(lop) && isConstantExpr(lop->next))
+		return opcode;
+
+	StaticType type = getStaticType(ctx, inlined, lop);
+	if(type == STATICTYPE_UNKNOWN || type != getStaticType(ctx, inlined, lop->next))
+		return opcode;
+
+	bool is_int = (type == STATICTYPE_INT);
+	switch(opcode)
+	{
+		case OPCODE_ADD: return is_int ? OPCODE_ADDINT : OPCODE_ADDFLT;
+		case OPCODE_SUB: return is_int ? OPCODE_SUBINT : OPCODE_SUBFLT;
+		case OPCODE_MUL: return is_int ? OPCODE_MULINT : OPCODE_MULFLT;
+		case OPCODE_LSS: return is_int ? OPCODE_LSSINT : OPCODE_LSSFLT;
+		case OPCODE_GRT: return is_int ? OPCODE_GRTINT : OPCODE_GRTFLT;
+		case OPCODE_LEQ: return is_int ? OPCODE_LEQINT : OPCODE_LEQFLT;
+		case OPCODE_GEQ: return is_int ? OPCODE_GEQINT : OPCODE_GEQFLT;
+		default: UNREACHABLE; break;
+	}
+	return opcode;
+}
+
+// Emits CHECKINT or CHECKFLT for an annotation 
+// with a known type.
+static void emitInstr_CHECKNUM(CodegenContext *ctx, StaticType type, int arg_index, const char *arg_name, int off, int len)
+{
+	assert(type != STATICTYPE_UNKNOWN);
+	Operand opv[2] = {
+		{ .type = OPTP_INT, .as_int = arg_index },
+		{ .type = OPTP_STRING, .as_string = arg_name },
+	};
+	Opcode opcode = (type == STATICTYPE_INT) ? OPCODE_CHECKINT : OPCODE_CHECKFLT;
+	CodegenContext_EmitInstr(ctx, opcode, opv, 2, off, len);
+}
+
 static void emitInstrForFuncCallNode(CodegenContext *ctx, CallExprNode *expr, 
 	                                 Label *label_break, int returns)
 {
+	if(emitInstrForInlinedCall(ctx, expr, label_break, returns))
+		return;
+
 	Node *arg = expr->argv;
 	while(arg)
 	{
@@ -247,17 +488,25 @@ static void emitInstrForArgumentNode(CodegenContext *ctx, ArgumentNode *arg, int
 	}
 
 	if (arg->type != NULL) {
-		emitInstrForNode(ctx, arg->type, NULL);
-		emitInstr_CHECKTYPE(ctx, argidx, arg->name, arg->type->offset, arg->type->length);
+		StaticType type = InlineTable_GetAnnotatedType(CodegenContext_GetInlineTable(ctx), arg->type);
+		if (type == STATICTYPE_UNKNOWN) {
+			emitInstrForNode(ctx, arg->type, NULL);
+			emitInstr_CHECKTYPE(ctx, argidx, arg->name, arg->type->offset, arg->type->length);
+		} else
+			emitInstr_CHECKNUM(ctx, type, argidx, arg->name, arg->type->offset, arg->type->length);
 	}
 
 	emitInstr_ASS(ctx, arg->name, arg->base.offset, arg->base.length);
 	emitInstr_POP1(ctx, arg->base.offset, arg->base.length);
 }
 
-static void emitInstrForFuncExprNode(CodegenContext *ctx, FuncExprNode *func, const char *name)
+// The [label_func] is set to the start of the function's
+// code. If it's NULL, a temporary label is used.
+static void emitInstrForFuncExprNode(CodegenContext *ctx, FuncExprNode *func, const char *name, Label *label_func)
 {
-	Label *label_func = Label_New(ctx);
+	bool own_label_func = (label_func == NULL);
+	if(own_label_func)
+		label_func = Label_New(ctx);
 	Label *label_jump = Label_New(ctx);
 
 	// Push function.
@@ -274,6 +523,11 @@ static void emitInstrForFuncExprNode(CodegenContext *ctx, FuncExprNode *func, co
 
 	// Compile the function body.
 	{
+		// The types of the parameters are only known
+		// once they're all bound.
+		FunctionScope *outer = CodegenContext_GetFunctionScope(ctx);
+		CodegenContext_SetFunctionScope(ctx, NULL);
+
 		// Assign the arguments.
 		ArgumentNode *arg = (ArgumentNode*) func->argv;
 		int argidx = func->argc-1;
@@ -284,7 +538,12 @@ static void emitInstrForFuncExprNode(CodegenContext *ctx, FuncExprNode *func, co
 			argidx -= 1;
 		}
 
+		FunctionScope scope;
+		initFunctionScope(ctx, &scope, func);
+		CodegenContext_SetFunctionScope(ctx, &scope);
+
 		emitInstrForNode(ctx, func->body, NULL);
+		CodegenContext_SetFunctionScope(ctx, outer);
 
 		if(func->body->kind == NODE_EXPR)
 			emitInstr_POP1(ctx, func->body->offset + func->body->length, 0);
@@ -297,13 +556,28 @@ static void emitInstrForFuncExprNode(CodegenContext *ctx, FuncExprNode *func, co
 	// This is the first index after the function code.
 	Label_SetHere(label_jump, ctx);
 
-	Label_Free(label_func);
+	if(own_label_func)
+		Label_Free(label_func);
 	Label_Free(label_jump);
 }
 
+static Label *getCandidateLabel(CodegenContext *ctx, InlineCandidate *candidate)
+{
+	if(candidate->label == NULL)
+		candidate->label = Label_New(ctx);
+	return candidate->label;
+}
+
 static void emitInstrForFuncDeclNode(CodegenContext *ctx, FuncDeclNode *func)
 {
-	emitInstrForFuncExprNode(ctx, func->expr, func->name->val);
+	// If the function may be inlined, its position
+	// is needed by the guards of the inlined calls.
+	Label *label_func = NULL;
+	InlineCandidate *candidate = InlineTable_GetCandidate(CodegenContext_GetInlineTable(ctx), func->name->val);
+	if(candidate != NULL && candidate->decl == func)
+		label_func = getCandidateLabel(ctx, candidate);
+
+	emitInstrForFuncExprNode(ctx, func->expr, func->name->val, label_func);
 	emitInstr_ASS(ctx, func->name->val, func->base.offset, func->base.length); // Assign variable
 	emitInstr_POP1(ctx, func->base.offset, func->base.length); // Pop function object
 }
@@ -410,7 +684,7 @@ static void emitInstrForExprNode(CodegenContext *ctx, ExprNode *expr,
 			OperExprNode *oper = (OperExprNode*) expr;
 			for(Node *operand = oper->head; operand; operand = operand->next)
 				emitInstrForNode(ctx, operand, label_break);
-			CodegenContext_EmitInstr(ctx, exprkind_to_opcode(expr->kind), NULL, 0, expr->base.offset, expr->base.length);
+			CodegenContext_EmitInstr(ctx, getOperatorOpcode(ctx, NULL, expr), NULL, 0, expr->base.offset, expr->base.length);
 			return;
 		}
 
@@ -575,7 +849,7 @@ static void emitInstrForExprNode(CodegenContext *ctx, ExprNode *expr,
 		return;
 
 		case EXPR_FUNC:
-		emitInstrForFuncExprNode(ctx, (FuncExprNode*) expr, "???");
+		emitInstrForFuncExprNode(ctx, (FuncExprNode*) expr, "???", NULL);
 		return;
 
 		case EXPR_SELECT:
@@ -671,6 +945,406 @@ static void emitInstrForDoWhileLoopNode(CodegenContext *ctx, DoWhileNode *loop,
 	Label_Free(label_end);
 }
 
+static void emitInstrForForLoopNode(CodegenContext *ctx, ForNode *loop, Label *label_break)
+{
+	/*
+	 *   <set>
+	 *   ITER_INIT
+	 * start:
+	 *   ITER_NEXT end, 2
+	 *   ASS <val>
+	 *   POP 1
+	 *   ASS <key>
+	 *   POP 1
+	 *   <body>
+	 *   JUMP start
+	 * end:
+	 *   POP 1
+	 *
+	 * The iterator stays on the stack for the whole
+	 * loop, so breaking out of it jumps to the final
+	 * POP too. When no key is bound, ITER_NEXT only
+	 * pushes the value and its second operand is 1.
+	 */
+
+	Label *label_start = Label_New(ctx);
+	Label *label_end = Label_New(ctx);
+	emitInstrForNode(ctx, loop->set, label_break);
+	emitInstr_ITER_INIT(ctx, loop->set->offset, loop->set->length);
+	Label_SetHere(label_start, ctx);
+	emitInstr_ITER_NEXT(ctx, label_end, loop->key == NULL ? 1 : 2, loop->base.offset, loop->base.length);
+	emitInstr_ASS(ctx, loop->val, loop->base.offset, loop->base.length);
+	emitInstr_POP1(ctx, loop->base.offset, loop->base.length);
+	if(loop->key != NULL)
+	{
+		emitInstr_ASS(ctx, loop->key, loop->base.offset, loop->base.length);
+		emitInstr_POP1(ctx, loop->base.offset, loop->base.length);
+	}
+	emitInstrForNode(ctx, loop->body, label_end);
+	if(loop->body->kind == NODE_EXPR)
+		emitInstr_POP1(ctx, loop->body->offset, 0);
+	emitInstr_JUMP(ctx, label_start, loop->base.offset, loop->base.length);
+	Label_SetHere(label_end, ctx);
+	emitInstr_POP1(ctx, loop->base.offset, loop->base.length);
+	Label_Free(label_start);
+	Label_Free(label_end);
+}
+
+/* Inlining
+ *
+ *   Calls to the functions found by the inliner (see inliner.c)
+ *   are expanded in place. The arguments are left on the stack
+ *   where the call would have taken them and the body refers to
+ *   them with PUSHSTK, so no frame and no locals map are created.
+ *
+ *   Since the variable holding the function may be changed at
+ *   any time, the inlined code is guarded by a CHECKFUN which
+ *   falls back to a normal call when the called object isn't
+ *   the function created by the declaration:
+ *
+ *     <args>
+ *     PUSHVAR <name>
+ *     CHECKFUN func, slow
+ *     <type checks>
+ *     <body>
+ *   end:
+ *     POPUNDER <argc>
+ *     JUMP done
+ *   slow:
+ *     CALL <argc>, 1
+ *   done:
+ *
+ *   Every return of the body pushes its value and jumps to
+ *   "end", while falling off the body's end pushes none.
+ *
+ *   The type checks and the body are marked as inlined into
+ *   the call, so that stack traces of errors they raise still
+ *   show the call site, like the frame of a call would.
+ */
+
+typedef struct {
+	FuncExprNode *func;
+	Label *label_end;
+	Node  *last_return; // Return at the end of the body, or NULL.
+	int depth; // Values on the stack above the arguments.
+} InlineScope;
+
+static void emitInstr_PUSHSTK(CodegenContext *ctx, long long int op0, int off, int len)
+{
+	Operand opv[1] = {
+		{ .type = OPTP_INT, .as_int = op0 }
+	};
+	CodegenContext_EmitInstr(ctx, OPCODE_PUSHSTK, opv, 1, off, len);
+}
+
+static void emitInstrForInlinedExpr(CodegenContext *ctx, InlineScope *scope, Node *node)
+{
+	assert(node->kind == NODE_EXPR);
+
+	ExprNode *expr = (ExprNode*) node;
+	int depth = scope->depth;
+
+	switch(expr->kind)
+	{
+		case EXPR_IDENT:
+		{
+			// The first argument is on top of
+			// the others.
+			int argidx = getParameterIndex(scope->func, ((IdentExprNode*) expr)->val);
+			if(argidx < 0)
+				emitInstrForExprNode(ctx, expr, NULL);
+			else
+				emitInstr_PUSHSTK(ctx, argidx + depth, expr->base.offset, expr->base.length);
+			break;
+		}
+
+		case EXPR_INT:   case EXPR_FLOAT:
+		case EXPR_NONE:  case EXPR_TRUE:
+		case EXPR_FALSE: case EXPR_STRING:
+		emitInstrForExprNode(ctx, expr, NULL);
+		break;
+
+		case EXPR_NULLABLETYPE:
+		case EXPR_SUMTYPE:
+		case EXPR_NOT: case EXPR_MOD:
+		case EXPR_POS: case EXPR_NEG:
+		case EXPR_ADD: case EXPR_SUB:
+		case EXPR_MUL: case EXPR_DIV:
+		case EXPR_EQL: case EXPR_NQL:
+		case EXPR_LSS: case EXPR_LEQ:
+		case EXPR_GRT: case EXPR_GEQ:
+		{
+			OperExprNode *oper = (OperExprNode*) expr;
+			for(Node *operand = oper->head; operand; operand = operand->next)
+				emitInstrForInlinedExpr(ctx, scope, operand);
+			CodegenContext_EmitInstr(ctx, getOperatorOpcode(ctx, scope->func, expr), NULL, 0, expr->base.offset, expr->base.length);
+			break;
+		}
+
+		case EXPR_AND:
+		case EXPR_OR:
+		{
+			// Same as the non-inlined version.
+			OperExprNode *oper = (OperExprNode*) expr;
+			bool is_and = (expr->kind == EXPR_AND);
+			Label *label_end   = Label_New(ctx);
+			Label *label_short = Label_New(ctx);
+			for(Node *operand = oper->head; operand; operand = operand->next) {
+				emitInstrForInlinedExpr(ctx, scope, operand);
+				if(is_and)
+					emitInstr_JUMPIFNOTANDPOP(ctx, label_short, expr->base.offset, expr->base.length);
+				else
+					emitInstr_JUMPIFANDPOP_2(ctx, label_short, expr->base.offset, expr->base.length);
+				scope->depth = depth;
+			}
+			if(is_and)
+				emitInstr_PUSHTRU(ctx, expr->base.offset, expr->base.length);
+			else
+				emitInstr_PUSHFLS(ctx, expr->base.offset, expr->base.length);
+			emitInstr_JUMP(ctx, label_end, expr->base.offset, expr->base.length);
+			Label_SetHere(label_short, ctx);
+			if(is_and)
+				emitInstr_PUSHFLS(ctx, expr->base.offset, expr->base.length);
+			else
+				emitInstr_PUSHTRU(ctx, expr->base.offset, expr->base.length);
+			Label_SetHere(label_end, ctx);
+			Label_Free(label_short);
+			Label_Free(label_end);
+			break;
+		}
+
+		case EXPR_SELECT:
+		{
+			IndexSelectionExprNode *sel = (IndexSelectionExprNode*) expr;
+			emitInstrForInlinedExpr(ctx, scope, sel->set);
+			emitInstrForInlinedExpr(ctx, scope, sel->idx);
+			CodegenContext_EmitInstr(ctx, OPCODE_SELECT, NULL, 0, expr->base.offset, expr->base.length);
+			break;
+		}
+
+		case EXPR_LIST:
+		{
+			ListExprNode *l = (ListExprNode*) expr;
+
+			Operand op = { .type = OPTP_INT, .as_int = l->itemc };
+			CodegenContext_EmitInstr(ctx, OPCODE_PUSHLST, &op, 1, expr->base.offset, expr->base.length);
+			scope->depth = depth + 1;
+
+			int i = 0;
+			for(Node *item = l->items; item; item = item->next, i += 1)
+			{
+				op = (Operand) { .type = OPTP_INT, .as_int = i };
+				CodegenContext_EmitInstr(ctx, OPCODE_PUSHINT, &op, 1, item->offset, item->length);
+				scope->depth += 1;
+				emitInstrForInlinedExpr(ctx, scope, item);
+				CodegenContext_EmitInstr(ctx, OPCODE_INSERT, NULL, 0, item->offset, item->length);
+				scope->depth = depth + 1;
+			}
+			break;
+		}
+
+		case EXPR_MAP:
+		{
+			MapExprNode *m = (MapExprNode*) expr;
+
+			Operand op = { .type = OPTP_INT, .as_int = m->itemc };
+			CodegenContext_EmitInstr(ctx, OPCODE_PUSHMAP, &op, 1, expr->base.offset, expr->base.length);
+			scope->depth = depth + 1;
+
+			for(Node *key = m->keys, *item = m->items; item; key = key->next, item = item->next)
+			{
+				emitInstrForInlinedExpr(ctx, scope, key);
+				emitInstrForInlinedExpr(ctx, scope, item);
+				CodegenContext_EmitInstr(ctx, OPCODE_INSERT, NULL, 0, item->offset, item->length);
+				scope->depth = depth + 1;
+			}
+			break;
+		}
+
+		case EXPR_CALL:
+		{
+			CallExprNode *call = (CallExprNode*) expr;
+			for(Node *arg = call->argv; arg; arg = arg->next)
+				emitInstrForInlinedExpr(ctx, scope, arg);
+			emitInstrForInlinedExpr(ctx, scope, call->func);
+
+			Operand ops[2];
+			ops[0] = (Operand) { .type = OPTP_INT, .as_int = call->argc };
+			ops[1] = (Operand) { .type = OPTP_INT, .as_int = 1 };
+			CodegenContext_EmitInstr(ctx, OPCODE_CALL, ops, 2, expr->base.offset, expr->base.length);
+			break;
+		}
+
+		default:
+		// The inliner doesn't accept anything else.
+		UNREACHABLE;
+		break;
+	}
+
+	scope->depth = depth + 1;
+}
+
+static void emitInstrForInlinedStmt(CodegenContext *ctx, InlineScope *scope, Node *node)
+{
+	switch(node->kind)
+	{
+		case NODE_EXPR:
+		emitInstrForInlinedExpr(ctx, scope, node);
+		emitInstr_POP1(ctx, node->offset, 0);
+		scope->depth -= 1;
+		return;
+
+		case NODE_RETURN:
+		{
+			ReturnNode *ret = (ReturnNode*) node;
+			emitInstrForInlinedExpr(ctx, scope, ret->val);
+			if(node != scope->last_return)
+				emitInstr_JUMP(ctx, scope->label_end, ret->base.offset, ret->base.length);
+			scope->depth -= 1;
+			return;
+		}
+
+		case NODE_IFELSE:
+		{
+			IfElseNode *ifelse = (IfElseNode*) node;
+			Label *label_else = Label_New(ctx);
+			emitInstrForInlinedExpr(ctx, scope, ifelse->condition);
+			emitInstr_JUMPIFNOTANDPOP(ctx, label_else, ifelse->condition->offset, ifelse->condition->length);
+			scope->depth -= 1;
+			emitInstrForInlinedStmt(ctx, scope, ifelse->true_branch);
+			if(ifelse->false_branch)
+			{
+				Label *label_done = Label_New(ctx);
+				emitInstr_JUMP(ctx, label_done, ifelse->base.offset, ifelse->base.length);
+				Label_SetHere(label_else, ctx);
+				emitInstrForInlinedStmt(ctx, scope, ifelse->false_branch);
+				Label_SetHere(label_done, ctx);
+				Label_Free(label_done);
+			}
+			else
+				Label_SetHere(label_else, ctx);
+			Label_Free(label_else);
+			return;
+		}
+
+		case NODE_COMP:
+		for(Node *stmt = ((CompoundNode*) node)->head; stmt; stmt = stmt->next)
+			emitInstrForInlinedStmt(ctx, scope, stmt);
+		return;
+
+		default:
+		// The inliner doesn't accept anything else.
+		UNREACHABLE;
+		return;
+	}
+}
+
+// Returns false if the call can't be inlined,
+// in which case nothing is emitted.
+static bool emitInstrForInlinedCall(CodegenContext *ctx, CallExprNode *call, 
+	                                Label *label_break, int returns)
+{
+	InlineTable *inlines = CodegenContext_GetInlineTable(ctx);
+	if(inlines == NULL || returns != 1 || ((ExprNode*) call->func)->kind != EXPR_IDENT)
+		return false;
+
+	InlineCandidate *candidate = InlineTable_GetCandidate(inlines, ((IdentExprNode*) call->func)->val);
+	if(candidate == NULL || candidate->decl->expr->argc != call->argc)
+		return false;
+
+	FuncExprNode *func = candidate->decl->expr;
+	int off = call->base.base.offset;
+	int len = call->base.base.length;
+
+	for(Node *arg = call->argv; arg; arg = arg->next)
+		emitInstrForNode(ctx, arg, label_break);
+	emitInstrForNode(ctx, call->func, label_break);
+
+	Label *label_slow = Label_New(ctx);
+	Label *label_done = Label_New(ctx);
+	Label *label_end  = Label_New(ctx);
+	{
+		Operand ops[2] = {
+			{ .type = OPTP_PROMISE, .as_promise = Label_ToPromise(getCandidateLabel(ctx, candidate)) },
+			{ .type = OPTP_PROMISE, .as_promise = Label_ToPromise(label_slow) },
+		};
+		CodegenContext_EmitInstr(ctx, OPCODE_CHECKFUN, ops, 2, off, len);
+	}
+	CodegenContext_SetCaller(ctx, off);
+
+	// If the body ends with a return, there's
+	// no need to jump to the end from it.
+	Node *last = func->body;
+	while(last != NULL && last->kind == NODE_COMP)
+	{
+		Node *stmt = ((CompoundNode*) last)->head;
+		while(stmt != NULL && stmt->next != NULL)
+			stmt = stmt->next;
+		last = stmt;
+	}
+
+	InlineScope scope = {
+		.func = func,
+		.label_end = label_end,
+		.last_return = (last != NULL && last->kind == NODE_RETURN) ? last : NULL,
+		.depth = 0,
+	};
+
+	// Check the types in the same order as the 
+	// function would, except for the arguments
+	// that are known to have the right type.
+	int argidx = func->argc-1;
+	Node *value = call->argv;
+	for(Node *arg = func->argv; arg != NULL; arg = arg->next, value = value->next, argidx -= 1)
+	{
+		ArgumentNode *arg2 = (ArgumentNode*) arg;
+		if(arg2->type != NULL)
+		{
+			StaticType type = InlineTable_GetAnnotatedType(inlines, arg2->type);
+			if(type != STATICTYPE_UNKNOWN && type == getStaticType(ctx, NULL, value))
+				continue;
+
+			emitInstr_PUSHSTK(ctx, argidx, arg2->type->offset, arg2->type->length);
+			if(type == STATICTYPE_UNKNOWN) {
+				scope.depth += 1;
+				emitInstrForInlinedExpr(ctx, &scope, arg2->type);
+				emitInstr_CHECKTYPE(ctx, argidx, arg2->name, arg2->type->offset, arg2->type->length);
+				scope.depth = 0;
+			} else
+				emitInstr_CHECKNUM(ctx, type, argidx, arg2->name, arg2->type->offset, arg2->type->length);
+			emitInstr_POP1(ctx, arg2->base.offset, arg2->base.length);
+		}
+	}
+
+	emitInstrForInlinedStmt(ctx, &scope, func->body);
+	if(scope.last_return == NULL)
+		CodegenContext_EmitInstr(ctx, OPCODE_PUSHNNE, NULL, 0, func->body->offset + func->body->length, 0);
+	CodegenContext_SetCaller(ctx, -1);
+	Label_SetHere(label_end, ctx);
+
+	if(call->argc > 0)
+	{
+		Operand op = { .type = OPTP_INT, .as_int = call->argc };
+		CodegenContext_EmitInstr(ctx, OPCODE_POPUNDER, &op, 1, off, len);
+	}
+	emitInstr_JUMP(ctx, label_done, off, len);
+	
+	Label_SetHere(label_slow, ctx);
+	{
+		Operand ops[2] = {
+			{ .type = OPTP_INT, .as_int = call->argc },
+			{ .type = OPTP_INT, .as_int = 1 },
+		};
+		CodegenContext_EmitInstr(ctx, OPCODE_CALL, ops, 2, off, len);
+	}
+	Label_SetHere(label_done, ctx);
+
+	Label_Free(label_slow);
+	Label_Free(label_done);
+	Label_Free(label_end);
+	return true;
+}
+
 static void emitInstrForNode(CodegenContext *ctx, Node *node, Label *label_break)
 {
 	assert(node != NULL);
@@ -699,6 +1373,10 @@ static void emitInstrForNode(CodegenContext *ctx, Node *node, Label *label_break
 		emitInstrForDoWhileLoopNode(ctx, (DoWhileNode*) node, label_break);
 		return;
 
+		case NODE_FOR:
+		emitInstrForForLoopNode(ctx, (ForNode*) node, label_break);
+		return;
+
 		case NODE_COMP:
 		{
 			CompoundNode *comp = (CompoundNode*) node;
@@ -775,8 +1453,17 @@ Executable *codegen(AST *ast, BPAlloc *alloc, Error *error, int *error_offset)
 		return NULL;
 	}
 
+	InlineTable *inlines = InlineTable_New(ast->root, error);
+	if(inlines == NULL) {
+		*error_offset = 0;
+		CodegenContext_Free(ctx);
+		return NULL;
+	}
+	CodegenContext_SetInlineTable(ctx, inlines);
+
 	if(setjmp(env)) {
 		assert(error->occurred == true);
+		InlineTable_Free(inlines);
 		CodegenContext_Free(ctx);
 		return NULL;
 	}
@@ -788,5 +1475,7 @@ Executable *codegen(AST *ast, BPAlloc *alloc, Error *error, int *error_offset)
 	emitInstr_EXIT(ctx, Source_GetSize(ast->src), 0);
 	assert(error->occurred == false);
 
-	return CodegenContext_MakeExecutableAndFree(ctx, ast->src);
+	Executable *exe = CodegenContext_MakeExecutableAndFree(ctx, ast->src);
+	InlineTable_Free(inlines);
+	return exe;
 }
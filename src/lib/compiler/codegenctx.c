@@ -10,6 +10,8 @@ struct CodegenContext {
     bool env_set;
     jmp_buf *env;
     int *error_offset;
+    InlineTable *inlines;
+    FunctionScope *function;
 };
 
 Label *Label_New(CodegenContext *ctx)
@@ -108,9 +110,36 @@ CodegenContext *CodegenContext_New(Error *error, BPAlloc *alloc)
     ctx->builder = builder;
     ctx->env_set = false;
     ctx->own_alloc = own_alloc;
+    ctx->inlines = NULL;
+    ctx->function = NULL;
     return ctx;
 }
 
+void CodegenContext_SetInlineTable(CodegenContext *ctx, InlineTable *inlines)
+{
+    ctx->inlines = inlines;
+}
+
+void CodegenContext_SetCaller(CodegenContext *ctx, int off)
+{
+    ExeBuilder_SetCaller(ctx->builder, off);
+}
+
+InlineTable *CodegenContext_GetInlineTable(CodegenContext *ctx)
+{
+    return ctx->inlines;
+}
+
+void CodegenContext_SetFunctionScope(CodegenContext *ctx, FunctionScope *function)
+{
+    ctx->function = function;
+}
+
+FunctionScope *CodegenContext_GetFunctionScope(CodegenContext *ctx)
+{
+    return ctx->function;
+}
+
 int CodegenContext_InstrCount(CodegenContext *ctx)
 {
     return ExeBuilder_InstrCount(ctx->builder);
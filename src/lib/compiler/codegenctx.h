@@ -2,8 +2,10 @@
 #define CODEGENCTX_H
 #include <setjmp.h>
 #include "../executable.h"
+#include "inliner.h"
 
 typedef struct CodegenContext CodegenContext;
+typedef struct FunctionScope FunctionScope;
 CodegenContext *CodegenContext_New(Error *error, BPAlloc *alloc);
 void            CodegenContext_EmitInstr(CodegenContext *ctx, Opcode opcode, Operand *opv, int opc, int off, int len);
 void            CodegenContext_SetJumpDest(CodegenContext *ctx, jmp_buf *env);
@@ -12,6 +14,11 @@ Executable     *CodegenContext_MakeExecutableAndFree(CodegenContext *ctx, Source
 void            CodegenContext_ReportErrorAndJump_(CodegenContext *ctx, const char *file, const char *func, int line, int error_offset, ErrorType type, const char *format, ...);
 #define         CodegenContext_ReportErrorAndJump(ctx, error_offset, typ, fmt, ...) CodegenContext_ReportErrorAndJump_(ctx, __FILE__, __func__, __LINE__, error_offset, typ, fmt, ## __VA_ARGS__) 
 int             CodegenContext_InstrCount(CodegenContext *ctx);
+void            CodegenContext_SetCaller(CodegenContext *ctx, int off);
+void            CodegenContext_SetInlineTable(CodegenContext *ctx, InlineTable *inlines);
+InlineTable    *CodegenContext_GetInlineTable(CodegenContext *ctx);
+void            CodegenContext_SetFunctionScope(CodegenContext *ctx, FunctionScope *function);
+FunctionScope  *CodegenContext_GetFunctionScope(CodegenContext *ctx);
 
 typedef struct Label Label;
 Label   *Label_New(CodegenContext *ctx);
@@ -476,6 +476,18 @@ static void nodeToGraphViz(GraphViz *ctx, Node *node, int *count, char *name)
 		}
 		return;
 
+		case NODE_FOR:
+		{
+			ForNode *loop = (ForNode*) node;
+			if(loop->key == NULL)
+				GraphViz_AppendHead(ctx, "\t%s [label=\"for %s\"];\n", name, loop->val);
+			else
+				GraphViz_AppendHead(ctx, "\t%s [label=\"for %s, %s\"];\n", name, loop->key, loop->val);
+			childToGraphViz(ctx, loop->set, count, name);
+			childToGraphViz(ctx, loop->body, count, name);
+		}
+		return;
+
 		case NODE_COMP:
 		{
 			CompoundNode *comp = (CompoundNode*) node;
@@ -0,0 +1,657 @@
+
+/* +--------------------------------------------------------------------------+
+** |                          _   _       _                                   |
+** |                         | \ | |     (_)                                  |
+** |                         |  \| | ___  _  __ _                             |
+** |                         | . ` |/ _ \| |/ _` |                            |
+** |                         | |\  | (_) | | (_| |                            |
+** |                         |_| \_|\___/| |\__,_|                            |
+** |                                    _/ |                                  |
+** |                                   |__/                                   |
+** +--------------------------------------------------------------------------+
+** | Copyright (c) 2022 Francesco Cozzuto <francesco.cozzuto@gmail.com>       |
+** +--------------------------------------------------------------------------+
+** | This file is part of The Noja Interpreter.                               |
+** |                                                                          |
+** | The Noja Interpreter is free software: you can redistribute it and/or    |
+** | modify it under the terms of the GNU General Public License as published |
+** | by the Free Software Foundation, either version 3 of the License, or (at |
+** | your option) any later version.                                          |
+** |                                                                          |
+** | The Noja Interpreter is distributed in the hope that it will be useful,  |
+** | but WITHOUT ANY WARRANTY; without even the implied warranty of           |
+** | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General |
+** | Public License for more details.                                         |
+** |                                                                          |
+** | You should have received a copy of the GNU General Public License along  |
+** | with The Noja Interpreter. If not, see <http://www.gnu.org/licenses/>.   |
+** +--------------------------------------------------------------------------+
+** |                         WHAT IS THIS FILE?                               |
+** |                                                                          |
+** | This file finds the functions whose calls can be expanded in place by    |
+** | the code generator. A function is a candidate when it's declared once    |
+** | with a "fun name(...)" statement and its body is small and made only of  |
+** | returns, if-else statements and expressions that don't bind variables    |
+** | or create functions.                                                     |
+** |                                                                          |
+** | Since the inlined body runs in the caller's frame, the names it uses     |
+** | other than the parameters must resolve to the same object from both      |
+** | places. That's granted by only allowing names that aren't bound          |
+** | anywhere in the source (by assignments, parameters, loops or function    |
+** | declarations), which therefore can only refer to builtins.               |
+** |                                                                          |
+** | The callee's binding isn't required to be constant: the code generator   |
+** | guards each inlined call by checking that the called object is the       |
+** | function created by the declaration, and falls back to a normal call     |
+** | otherwise.                                                               |
+** |                                                                          |
+** | The same binding information tells the code generator which type         |
+** | annotations refer to the builtin numeric types, so that the parameters   |
+** | that have them and are never assigned can be treated as values of a      |
+** | known type.                                                              |
+** +--------------------------------------------------------------------------+
+*/
+
+#include <string.h>
+#include <assert.h>
+#include "../utils/defs.h"
+#include "../utils/bpalloc.h"
+#include "../defs.h"
+#include "inliner.h"
+
+// Maximum number of AST nodes in the body and
+// type annotations of an inlined function.
+#define MAX_INLINE_NODES 32
+
+// Maximum number of parameters of an inlined function.
+#define MAX_INLINE_ARGS 8
+
+#define BUCKETS 256
+
+typedef struct Entry Entry;
+struct Entry {
+	Entry *next;
+	const char *name;
+	bool  bound; // Bound by something other than a function declaration.
+	int   decls;
+	InlineCandidate candidate; // Only valid when [inlinable] is true.
+	bool  inlinable;
+};
+
+struct InlineTable {
+	BPAlloc *alloc;
+	Entry   *buckets[BUCKETS];
+};
+
+static unsigned int hashName(const char *name)
+{
+	unsigned int h = 5381;
+	for(int i = 0; name[i] != '\0'; i += 1)
+		h = h * 33 + (unsigned char) name[i];
+	return h;
+}
+
+static Entry *lookup(InlineTable *table, const char *name)
+{
+	Entry *entry = table->buckets[hashName(name) % BUCKETS];
+	while(entry != NULL && strcmp(entry->name, name))
+		entry = entry->next;
+	return entry;
+}
+
+static Entry *lookupOrInsert(InlineTable *table, const char *name, Error *error)
+{
+	Entry *entry = lookup(table, name);
+	if(entry != NULL)
+		return entry;
+
+	entry = BPAlloc_Malloc(table->alloc, sizeof(Entry));
+	if(entry == NULL) {
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		return NULL;
+	}
+	memset(entry, 0, sizeof(Entry));
+	entry->name = name;
+
+	Entry **bucket = &table->buckets[hashName(name) % BUCKETS];
+	entry->next = *bucket;
+	*bucket = entry;
+	return entry;
+}
+
+static bool bindName(InlineTable *table, const char *name, Error *error)
+{
+	Entry *entry = lookupOrInsert(table, name, error);
+	if(entry == NULL)
+		return false;
+	entry->bound = true;
+	return true;
+}
+
+// Binds the identifiers on the left side of an
+// assignment, which may be a tuple of them.
+static bool bindTuple(InlineTable *table, ExprNode *lop, Error *error)
+{
+	if(lop->kind == EXPR_IDENT)
+		return bindName(table, ((IdentExprNode*) lop)->val, error);
+
+	if(lop->kind == EXPR_PAIR)
+	{
+		Node *head = ((OperExprNode*) lop)->head;
+		return bindTuple(table, (ExprNode*) head, error)
+			&& bindTuple(table, (ExprNode*) head->next, error);
+	}
+	return true;
+}
+
+static bool collectBindingsInList(InlineTable *table, Node *list, Error *error);
+
+static bool collectBindings(InlineTable *table, Node *node, Error *error)
+{
+	if(node == NULL)
+		return true;
+
+	switch(node->kind)
+	{
+		case NODE_EXPR:
+		{
+			ExprNode *expr = (ExprNode*) node;
+			switch(expr->kind)
+			{
+				case EXPR_INT:   case EXPR_FLOAT:
+				case EXPR_NONE:  case EXPR_TRUE:
+				case EXPR_FALSE: case EXPR_STRING:
+				case EXPR_IDENT:
+				return true;
+
+				case EXPR_ASS:
+				{
+					if(!bindTuple(table, (ExprNode*) ((OperExprNode*) expr)->head, error))
+						return false;
+					return collectBindingsInList(table, ((OperExprNode*) expr)->head, error);
+				}
+
+				case EXPR_CALL:
+				{
+					CallExprNode *call = (CallExprNode*) expr;
+					return collectBindings(table, call->func, error)
+						&& collectBindingsInList(table, call->argv, error);
+				}
+
+				case EXPR_FUNC:
+				{
+					FuncExprNode *func = (FuncExprNode*) expr;
+					for(Node *arg = func->argv; arg != NULL; arg = arg->next)
+					{
+						ArgumentNode *arg2 = (ArgumentNode*) arg;
+						if(!bindName(table, arg2->name, error)
+						|| !collectBindings(table, arg2->type, error)
+						|| !collectBindings(table, arg2->value, error))
+							return false;
+					}
+					return collectBindings(table, func->body, error);
+				}
+
+				case EXPR_SELECT:
+				case EXPR_ARW:
+				{
+					IndexSelectionExprNode *sel = (IndexSelectionExprNode*) expr;
+					return collectBindings(table, sel->set, error)
+						&& collectBindings(table, sel->idx, error);
+				}
+
+				case EXPR_LIST:
+				return collectBindingsInList(table, ((ListExprNode*) expr)->items, error);
+
+				case EXPR_MAP:
+				{
+					MapExprNode *map = (MapExprNode*) expr;
+					return collectBindingsInList(table, map->keys, error)
+						&& collectBindingsInList(table, map->items, error);
+				}
+
+				default:
+				// Every other expression is an operator.
+				return collectBindingsInList(table, ((OperExprNode*) expr)->head, error);
+			}
+			UNREACHABLE;
+		}
+
+		case NODE_IFELSE:
+		{
+			IfElseNode *ifelse = (IfElseNode*) node;
+			return collectBindings(table, ifelse->condition, error)
+				&& collectBindings(table, ifelse->true_branch, error)
+				&& collectBindings(table, ifelse->false_branch, error);
+		}
+
+		case NODE_WHILE:
+		{
+			WhileNode *loop = (WhileNode*) node;
+			return collectBindings(table, loop->condition, error)
+				&& collectBindings(table, loop->body, error);
+		}
+
+		case NODE_DOWHILE:
+		{
+			DoWhileNode *loop = (DoWhileNode*) node;
+			return collectBindings(table, loop->body, error)
+				&& collectBindings(table, loop->condition, error);
+		}
+
+		case NODE_FOR:
+		{
+			ForNode *loop = (ForNode*) node;
+			if(loop->key != NULL && !bindName(table, loop->key, error))
+				return false;
+			return bindName(table, loop->val, error)
+				&& collectBindings(table, loop->set, error)
+				&& collectBindings(table, loop->body, error);
+		}
+
+		case NODE_COMP:
+		return collectBindingsInList(table, ((CompoundNode*) node)->head, error);
+
+		case NODE_RETURN:
+		return collectBindings(table, ((ReturnNode*) node)->val, error);
+
+		case NODE_FUNC:
+		{
+			FuncDeclNode *func = (FuncDeclNode*) node;
+			Entry *entry = lookupOrInsert(table, func->name->val, error);
+			if(entry == NULL)
+				return false;
+			entry->decls += 1;
+			entry->candidate.decl = func;
+			return collectBindings(table, (Node*) func->expr, error);
+		}
+
+		case NODE_BREAK:
+		return true;
+
+		default:
+		UNREACHABLE;
+	}
+	UNREACHABLE;
+	return false;
+}
+
+static bool collectBindingsInList(InlineTable *table, Node *list, Error *error)
+{
+	for(Node *node = list; node != NULL; node = node->next)
+		if(!collectBindings(table, node, error))
+			return false;
+	return true;
+}
+
+static bool isParameter(FuncExprNode *func, const char *name)
+{
+	for(Node *arg = func->argv; arg != NULL; arg = arg->next)
+		if(!strcmp(((ArgumentNode*) arg)->name, name))
+			return true;
+	return false;
+}
+
+// The expressions and statements accepted here must
+// be the ones the code generator knows how to inline.
+static bool isInlinableExpr(InlineTable *table, FuncExprNode *func, Node *node, int *budget)
+{
+	if(node->kind != NODE_EXPR || --*budget < 0)
+		return false;
+
+	ExprNode *expr = (ExprNode*) node;
+	switch(expr->kind)
+	{
+		case EXPR_INT:   case EXPR_FLOAT:
+		case EXPR_NONE:  case EXPR_TRUE:
+		case EXPR_FALSE: case EXPR_STRING:
+		return true;
+
+		case EXPR_IDENT:
+		{
+			const char *name = ((IdentExprNode*) expr)->val;
+			return isParameter(func, name) || lookup(table, name) == NULL;
+		}
+
+		case EXPR_NULLABLETYPE:
+		case EXPR_SUMTYPE:
+		case EXPR_NOT: case EXPR_MOD:
+		case EXPR_POS: case EXPR_NEG:
+		case EXPR_ADD: case EXPR_SUB:
+		case EXPR_MUL: case EXPR_DIV:
+		case EXPR_EQL: case EXPR_NQL:
+		case EXPR_LSS: case EXPR_LEQ:
+		case EXPR_GRT: case EXPR_GEQ:
+		case EXPR_AND: case EXPR_OR:
+		{
+			for(Node *operand = ((OperExprNode*) expr)->head; operand; operand = operand->next)
+				if(!isInlinableExpr(table, func, operand, budget))
+					return false;
+			return true;
+		}
+
+		case EXPR_SELECT:
+		{
+			IndexSelectionExprNode *sel = (IndexSelectionExprNode*) expr;
+			return isInlinableExpr(table, func, sel->set, budget)
+				&& isInlinableExpr(table, func, sel->idx, budget);
+		}
+
+		case EXPR_LIST:
+		{
+			for(Node *item = ((ListExprNode*) expr)->items; item; item = item->next)
+				if(!isInlinableExpr(table, func, item, budget))
+					return false;
+			return true;
+		}
+
+		case EXPR_MAP:
+		{
+			MapExprNode *map = (MapExprNode*) expr;
+			for(Node *key = map->keys, *item = map->items; item; key = key->next, item = item->next)
+				if(!isInlinableExpr(table, func, key, budget) || !isInlinableExpr(table, func, item, budget))
+					return false;
+			return true;
+		}
+
+		case EXPR_CALL:
+		{
+			// Calls are emitted as normal calls, so the
+			// inlining never recurses.
+			CallExprNode *call = (CallExprNode*) expr;
+			if(((ExprNode*) call->func)->kind == EXPR_ARW)
+				return false;
+			for(Node *arg = call->argv; arg; arg = arg->next)
+				if(!isInlinableExpr(table, func, arg, budget))
+					return false;
+			return isInlinableExpr(table, func, call->func, budget);
+		}
+
+		default:
+		// Assignments, functions, tuples and arrows.
+		return false;
+	}
+	UNREACHABLE;
+	return false;
+}
+
+static bool isInlinableStmt(InlineTable *table, FuncExprNode *func, Node *node, int *budget)
+{
+	switch(node->kind)
+	{
+		case NODE_EXPR:
+		return isInlinableExpr(table, func, node, budget);
+
+		case NODE_RETURN:
+		return isInlinableExpr(table, func, ((ReturnNode*) node)->val, budget);
+
+		case NODE_IFELSE:
+		{
+			IfElseNode *ifelse = (IfElseNode*) node;
+			return isInlinableExpr(table, func, ifelse->condition, budget)
+				&& isInlinableStmt(table, func, ifelse->true_branch, budget)
+				&& (ifelse->false_branch == NULL || isInlinableStmt(table, func, ifelse->false_branch, budget));
+		}
+
+		case NODE_COMP:
+		{
+			for(Node *stmt = ((CompoundNode*) node)->head; stmt; stmt = stmt->next)
+				if(!isInlinableStmt(table, func, stmt, budget))
+					return false;
+			return true;
+		}
+
+		default:
+		return false;
+	}
+	UNREACHABLE;
+	return false;
+}
+
+static bool isInlinableFunc(InlineTable *table, FuncExprNode *func)
+{
+	if(func->argc > MAX_INLINE_ARGS)
+		return false;
+
+	int budget = MAX_INLINE_NODES;
+	for(Node *arg = func->argv; arg != NULL; arg = arg->next)
+	{
+		ArgumentNode *arg2 = (ArgumentNode*) arg;
+
+		// Default values are evaluated in the
+		// function's scope when the argument is
+		// none, which isn't worth inlining.
+		if(arg2->value != NULL)
+			return false;
+
+		if(arg2->type != NULL && !isInlinableExpr(table, func, arg2->type, &budget))
+			return false;
+	}
+	return isInlinableStmt(table, func, func->body, &budget);
+}
+
+/* Symbol: InlineTable_New
+ *
+ *   Walks the tree to find the functions declared
+ *   in it that can be inlined. If an error occurres,
+ *   NULL is returned and the [error] is filled out.
+ */
+InlineTable *InlineTable_New(Node *root, Error *error)
+{
+	BPAlloc *alloc = BPAlloc_Init(-1);
+	if(alloc == NULL) {
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		return NULL;
+	}
+
+	InlineTable *table = BPAlloc_Malloc(alloc, sizeof(InlineTable));
+	if(table == NULL) {
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		BPAlloc_Free(alloc);
+		return NULL;
+	}
+	memset(table, 0, sizeof(InlineTable));
+	table->alloc = alloc;
+
+	if(!collectBindings(table, root, error)) {
+		BPAlloc_Free(alloc);
+		return NULL;
+	}
+
+	for(int i = 0; i < BUCKETS; i += 1)
+		for(Entry *entry = table->buckets[i]; entry != NULL; entry = entry->next)
+			if(entry->decls == 1 && !entry->bound)
+				entry->inlinable = isInlinableFunc(table, entry->candidate.decl->expr);
+	return table;
+}
+
+void InlineTable_Free(InlineTable *table)
+{
+	BPAlloc_Free(table->alloc);
+}
+
+InlineCandidate *InlineTable_GetCandidate(InlineTable *table, const char *name)
+{
+	Entry *entry = lookup(table, name);
+	if(entry == NULL || !entry->inlinable)
+		return NULL;
+	return &entry->candidate;
+}
+
+/* Symbol: InlineTable_GetAnnotatedType
+ *
+ *   Returns the type that an argument has once it passed
+ *   the check of the annotation [type], if that's the name
+ *   of a builtin numeric type. As for the names used by the
+ *   inlined bodies, the name must not be bound anywhere in
+ *   the source for it to refer to the builtin.
+ */
+StaticType InlineTable_GetAnnotatedType(InlineTable *table, Node *type)
+{
+	if(type == NULL || type->kind != NODE_EXPR || ((ExprNode*) type)->kind != EXPR_IDENT)
+		return STATICTYPE_UNKNOWN;
+
+	const char *name = ((IdentExprNode*) type)->val;
+	if(lookup(table, name) != NULL)
+		return STATICTYPE_UNKNOWN;
+
+	if(!strcmp(name, TYPENAME_INT))
+		return STATICTYPE_INT;
+	if(!strcmp(name, TYPENAME_FLOAT))
+		return STATICTYPE_FLOAT;
+	return STATICTYPE_UNKNOWN;
+}
+
+static bool bindsNameInList(Node *list, const char *name);
+
+static bool tupleBindsName(ExprNode *lop, const char *name)
+{
+	if(lop->kind == EXPR_IDENT)
+		return !strcmp(((IdentExprNode*) lop)->val, name);
+
+	if(lop->kind == EXPR_PAIR)
+	{
+		Node *head = ((OperExprNode*) lop)->head;
+		return tupleBindsName((ExprNode*) head, name)
+			|| tupleBindsName((ExprNode*) head->next, name);
+	}
+	return false;
+}
+
+// Returns true if running [node] may bind [name] in
+// the frame that runs it. Unlike [collectBindings],
+// this doesn't look into the functions created by it,
+// since they bind their variables in their own frame.
+static bool bindsName(Node *node, const char *name)
+{
+	if(node == NULL)
+		return false;
+
+	switch(node->kind)
+	{
+		case NODE_EXPR:
+		{
+			ExprNode *expr = (ExprNode*) node;
+			switch(expr->kind)
+			{
+				case EXPR_INT:   case EXPR_FLOAT:
+				case EXPR_NONE:  case EXPR_TRUE:
+				case EXPR_FALSE: case EXPR_STRING:
+				case EXPR_IDENT: case EXPR_FUNC:
+				return false;
+
+				case EXPR_ASS:
+				{
+					Node *head = ((OperExprNode*) expr)->head;
+					return tupleBindsName((ExprNode*) head, name)
+						|| bindsNameInList(head, name);
+				}
+
+				case EXPR_CALL:
+				{
+					CallExprNode *call = (CallExprNode*) expr;
+					return bindsName(call->func, name)
+						|| bindsNameInList(call->argv, name);
+				}
+
+				case EXPR_SELECT:
+				case EXPR_ARW:
+				{
+					IndexSelectionExprNode *sel = (IndexSelectionExprNode*) expr;
+					return bindsName(sel->set, name)
+						|| bindsName(sel->idx, name);
+				}
+
+				case EXPR_LIST:
+				return bindsNameInList(((ListExprNode*) expr)->items, name);
+
+				case EXPR_MAP:
+				{
+					MapExprNode *map = (MapExprNode*) expr;
+					return bindsNameInList(map->keys, name)
+						|| bindsNameInList(map->items, name);
+				}
+
+				default:
+				// Every other expression is an operator.
+				return bindsNameInList(((OperExprNode*) expr)->head, name);
+			}
+			UNREACHABLE;
+		}
+
+		case NODE_IFELSE:
+		{
+			IfElseNode *ifelse = (IfElseNode*) node;
+			return bindsName(ifelse->condition, name)
+				|| bindsName(ifelse->true_branch, name)
+				|| bindsName(ifelse->false_branch, name);
+		}
+
+		case NODE_WHILE:
+		{
+			WhileNode *loop = (WhileNode*) node;
+			return bindsName(loop->condition, name)
+				|| bindsName(loop->body, name);
+		}
+
+		case NODE_DOWHILE:
+		{
+			DoWhileNode *loop = (DoWhileNode*) node;
+			return bindsName(loop->body, name)
+				|| bindsName(loop->condition, name);
+		}
+
+		case NODE_FOR:
+		{
+			ForNode *loop = (ForNode*) node;
+			if(loop->key != NULL && !strcmp(loop->key, name))
+				return true;
+			return !strcmp(loop->val, name)
+				|| bindsName(loop->set, name)
+				|| bindsName(loop->body, name);
+		}
+
+		case NODE_COMP:
+		return bindsNameInList(((CompoundNode*) node)->head, name);
+
+		case NODE_RETURN:
+		return bindsName(((ReturnNode*) node)->val, name);
+
+		case NODE_FUNC:
+		return !strcmp(((FuncDeclNode*) node)->name->val, name);
+
+		case NODE_BREAK:
+		return false;
+
+		default:
+		UNREACHABLE;
+	}
+	UNREACHABLE;
+	return false;
+}
+
+static bool bindsNameInList(Node *list, const char *name)
+{
+	for(Node *node = list; node != NULL; node = node->next)
+		if(bindsName(node, name))
+			return true;
+	return false;
+}
+
+/* Symbol: InlineTable_IsConstantParameter
+ *
+ *   Returns true if the parameter [name] of [func] holds
+ *   the argument it was bound to for the whole call. That
+ *   is, if it's not assigned by the body or by the default
+ *   values of the parameters that are bound after it.
+ */
+bool InlineTable_IsConstantParameter(FuncExprNode *func, const char *name)
+{
+	for(Node *arg = func->argv; arg != NULL; arg = arg->next)
+	{
+		ArgumentNode *arg2 = (ArgumentNode*) arg;
+		if(bindsName(arg2->value, name) || bindsName(arg2->type, name))
+			return false;
+	}
+	return !bindsName(func->body, name);
+}
@@ -0,0 +1,27 @@
+#ifndef INLINER_H
+#define INLINER_H
+#include <stdbool.h>
+#include "../utils/error.h"
+#include "ASTi.h"
+
+typedef struct Label Label;
+
+typedef struct {
+	FuncDeclNode *decl;
+	Label        *label; // Position of the function's code. Set by the code generator.
+} InlineCandidate;
+
+// Types of values known at compile time.
+typedef enum {
+	STATICTYPE_UNKNOWN,
+	STATICTYPE_INT,
+	STATICTYPE_FLOAT,
+} StaticType;
+
+typedef struct InlineTable InlineTable;
+InlineTable     *InlineTable_New(Node *root, Error *error);
+void             InlineTable_Free(InlineTable *table);
+InlineCandidate *InlineTable_GetCandidate(InlineTable *table, const char *name);
+StaticType       InlineTable_GetAnnotatedType(InlineTable *table, Node *type);
+bool             InlineTable_IsConstantParameter(FuncExprNode *func, const char *name);
+#endif /* INLINER_H */
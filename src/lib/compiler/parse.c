@@ -47,8 +47,9 @@
 ** | if an error occurres.                                                    |
 ** |                                                                          |
 ** | The parsing routines don't operate directly on the source text, but on   |
-** | the tokenized version of it. Before parsing a linked list of tokens is   |
-** | produced through the `tokenize` function.                                |
+** | the tokenized version of it. Tokens are produced on demand by the `lex`  |
+** | function as the parser moves forward, and only the current one and the   |
+** | previous one are kept.                                                   |
 ** +--------------------------------------------------------------------------+
 */
 
@@ -57,7 +58,6 @@
 #include <string.h>
 #include <assert.h>
 #include <errno.h>
-#include <ctype.h>
 #include "../utils/defs.h"
 #include "parse.h"
 #include "ASTi.h"
@@ -113,6 +113,8 @@ typedef enum {
 	TKWWHILE,
 	TKWBREAK,
 	TKWDO,
+	TKWFOR,
+	TKWIN,
 
 	TEQL,
 	TNQL,
@@ -125,13 +127,17 @@ typedef enum {
 typedef struct Token Token;
 struct Token {
 	TokenKind kind;
-	Token *prev, *next;
 	int offset, length;
 };
 
 typedef struct {
 	const char *src;
+	int len, pos;
 	Token   *token;
+	Token    window[2]; // The current token and the previous one.
+	bool     lookback;  // The parser went back to the previous token.
+	bool     has_prev;
+	int      lex_error_offset; // Where the lexer failed, or -1.
 	BPAlloc *alloc;
 	Error   *error;
 	int *error_offset;
@@ -147,264 +153,199 @@ static Node *parse_postfix_expression(Context *ctx);
 static Node *parse_prefix_expression(Context *ctx);
 static Node *parse_while_statement(Context *ctx);
 static Node *parse_dowhile_statement(Context *ctx);
+static Node *parse_for_statement(Context *ctx);
 
-static inline _Bool isoper(char c)
+enum {
+	CC_SPACE = 1 << 0,
+	CC_ALPHA = 1 << 1, // Letters and '_'
+	CC_DIGIT = 1 << 2,
+	CC_OPER  = 1 << 3,
+};
+
+// Class of each character, so that the lexer doesn't
+// need to call the locale-dependant <ctype.h> functions.
+static const unsigned char charclass[256] = {
+	['\t'] = CC_SPACE, ['\n'] = CC_SPACE, ['\v'] = CC_SPACE,
+	['\f'] = CC_SPACE, ['\r'] = CC_SPACE, [' ']  = CC_SPACE,
+	['a' ... 'z'] = CC_ALPHA,
+	['A' ... 'Z'] = CC_ALPHA,
+	['_'] = CC_ALPHA,
+	['0' ... '9'] = CC_DIGIT,
+	['+'] = CC_OPER, ['-'] = CC_OPER, ['*'] = CC_OPER, ['/'] = CC_OPER,
+	['<'] = CC_OPER, ['>'] = CC_OPER, ['!'] = CC_OPER, ['='] = CC_OPER,
+	[','] = CC_OPER, ['|'] = CC_OPER, ['%'] = CC_OPER,
+};
+
+static inline bool isclass(char c, int class)
 {
-	return 	c == '+' || c == '-' || 
-			c == '*' || c == '/' || 
-			c == '<' || c == '>' ||
-			c == '!' || c == '=' ||
-			c == ',' || c == '|' ||
-			c == '%';
+	return charclass[(unsigned char) c] & class;
 }
 
-#warning "update doc arguments"
-/* Symbol: tokenize
- * 
- *   Build a list of tokens that represents the 
- *   provided source code.
- *
- *
- * Arguments:
- *
- *   src: The source code to be tokenized.
- *   alloc: The allocator that will contain all of the
- *          generated tokens.
- *   error: Error information structure that is filled out if
- *          an error occurres.
- *
- *   None of the arguments are optional.
- *
- *
- * Returns:
- *   A pointer to the first node of a linked list of tokens.
- *   If an error occurres, NULL is returned and the `error` 
- *   structure is filled out.
- *
- */
-static Token *tokenize(Source *src, BPAlloc *alloc, Error *error, int *error_offset)
+// Keywords grouped by length.
+static const struct {
+	TokenKind   kind;
+	const char *text;
+} kwords[][4] = {
+	[2] = { {TKWIF, "if"}, {TKWOR, "or"}, {TKWDO, "do"}, {TKWIN, "in"} },
+	[3] = { {TKWFUN, "fun"}, {TKWNOT, "not"}, {TKWAND, "and"}, {TKWFOR, "for"} },
+	[4] = { {TKWELSE, "else"}, {TKWNONE, "none"}, {TKWTRUE, "true"} },
+	[5] = { {TKWFALSE, "false"}, {TKWWHILE, "while"}, {TKWBREAK, "break"} },
+	[6] = { {TKWRETURN, "return"} },
+};
+
+static TokenKind identOrKeyword(const char *str, int len)
 {
-	const char *str = Source_GetBody(src);
-	int 		len = Source_GetSize(src);
-	assert(str != NULL);
-	assert(len >= 0);
-
-	Token *head = NULL, 
-		  *tail = NULL;
-	int i = 0;
-	while(1)
+	if(len >= (int) (sizeof(kwords)/sizeof(*kwords)))
+		return TIDENT;
+
+	for(int i = 0; i < 4 && kwords[len][i].text != NULL; i += 1)
+		if(!memcmp(kwords[len][i].text, str, len))
+			return kwords[len][i].kind;
+	return TIDENT;
+}
+
+// Returns the kind of a sequence of operator characters.
+// Single characters are tokens of the kind of their value,
+// while longer sequences that aren't known operators are
+// only made of their first character.
+static TokenKind operatorKind(const char *str, int *len)
+{
+	if(*len == 2)
 	{
-		// Skip whitespace and comments.
-		while(i < len && (isspace(str[i]) || str[i] == '#'))
+		switch(str[0] << 8 | str[1])
 		{
-			while(i < len && isspace(str[i]))
-				i += 1;
-
-			if(i < len && str[i] == '#')
-			{
-				i += 1;
-				while(i < len && str[i] != '\n')
-					i += 1;
-			}
+			case '=' << 8 | '=': return TEQL;
+			case '!' << 8 | '=': return TNQL;
+			case '<' << 8 | '=': return TLEQ;
+			case '>' << 8 | '=': return TGEQ;
+			case '-' << 8 | '>': return TARW;
 		}
+	}
+	*len = 1;
+	return str[0];
+}
 
-		if(i == len)
-			break; // No more tokens left.
+/* Symbol: lex
+ * 
+ *   Reads the token that follows the previous one 
+ *   into [tok]. When the source ends, the token is
+ *   of kind TDONE.
+ *
+ *   If the source isn't valid, the token is also of 
+ *   kind TDONE and the position of the error is stored
+ *   in the context. It's reported when the parsing
+ *   ends, replacing the errors caused by the source
+ *   ending early.
+ */
+static void lex(Context *ctx, Token *tok)
+{
+	const char *str = ctx->src;
+	int 		len = ctx->len;
+	int 		i   = ctx->pos;
 
-		Token *tok = BPAlloc_Malloc(alloc, sizeof(Token)); // Allocate a token.
-			
-		if(tok == NULL)
-		{
-			// Error: No memory.
-			*error_offset = i;
-			Error_Report(error, ErrorType_INTERNAL, "No memory");
-			return NULL;
-		}
+	// Skip whitespace and comments.
+	while(i < len && (isclass(str[i], CC_SPACE) || str[i] == '#'))
+	{
+		while(i < len && isclass(str[i], CC_SPACE))
+			i += 1;
 
-		if(isalpha(str[i]) || str[i] == '_')
+		if(i < len && str[i] == '#')
 		{
-			tok->kind = TIDENT;
-			tok->offset = i;
-					
-			while(i < len && (isalpha(str[i]) || isdigit(str[i]) || str[i] == '_'))
+			i += 1;
+			while(i < len && str[i] != '\n')
 				i += 1;
-
-			tok->length = i - tok->offset;
-
-			static const struct {
-				TokenKind    kind;
-				int          size;
-				const char  *text;
-			} kwords[] = {
-				{     TKWIF, 2, "if"     },
-				{    TKWFUN, 3, "fun"    },
-				{    TKWNOT, 3, "not"    },
-				{    TKWAND, 3, "and"    },
-				{     TKWOR, 2, "or"     },
-				{   TKWELSE, 4, "else"   },
-				{   TKWNONE, 4, "none"   },
-				{   TKWTRUE, 4, "true"   },
-				{  TKWFALSE, 5, "false"  },
-				{ TKWRETURN, 6, "return" },
-				{  TKWWHILE, 5, "while"  },
-				{  TKWBREAK, 5, "break"  },
-				{     TKWDO, 2, "do"     },
-			};
-
-			for(unsigned int i = 0; i < sizeof(kwords)/sizeof(*kwords); i += 1)
-				if(kwords[i].size == tok->length && !strncmp(kwords[i].text, str + tok->offset, tok->length))
-				{
-					tok->kind = kwords[i].kind;
-					break;
-				}
 		}
-		else if(isdigit(str[i]))
-		{
-			tok->kind = TINT;
-			tok->offset = i;
+	}
 
-			while(i < len && isdigit(str[i]))
-				i += 1;
+	tok->offset = i;
 
-			if(i+1 < len && str[i] == '.' && isdigit(str[i+1]))
-			{
-				i += 1; // Consume the dot.
+	if(i == len)
+	{
+		tok->kind = TDONE;
+		tok->length = 0;
+		return;
+	}
 
-				tok->kind = TFLOAT;
+	if(isclass(str[i], CC_ALPHA))
+	{
+		while(i < len && isclass(str[i], CC_ALPHA | CC_DIGIT))
+			i += 1;
 
-				while(i < len && isdigit(str[i]))
-					i += 1;
-			}
+		tok->length = i - tok->offset;
+		tok->kind = identOrKeyword(str + tok->offset, tok->length);
+	}
+	else if(isclass(str[i], CC_DIGIT))
+	{
+		tok->kind = TINT;
 
-			tok->length = i - tok->offset;
-		}
-		else if(str[i] == '\'' || str[i] == '"')
-		{
-			tok->kind = TSTRING;
-			tok->offset = i;
+		while(i < len && isclass(str[i], CC_DIGIT))
+			i += 1;
 
-			char f = str[i];
+		if(i+1 < len && str[i] == '.' && isclass(str[i+1], CC_DIGIT))
+		{
+			i += 1; // Consume the dot.
 
-			i += 1; // Skip the starting quote.
+			tok->kind = TFLOAT;
 
-			while(1)
-			{
-				while(i < len && str[i] != '\\' && str[i] != f)
-					i += 1;
+			while(i < len && isclass(str[i], CC_DIGIT))
+				i += 1;
+		}
 
-				if(str[i] == '\\')
-				{
-					i += 1; // Consume the \.
-					if(i < len && (str[i] == '\'' || str[i] == '"' || str[i] == '\\'))
-						i += 1;
-				}
-				else break;
-			}
+		tok->length = i - tok->offset;
+	}
+	else if(str[i] == '\'' || str[i] == '"')
+	{
+		tok->kind = TSTRING;
 
-			if(i == len)
-			{
-				*error_offset = i;
-				Error_Report(error, 0, "Source ended inside string literal");
-				return NULL;
-			}
+		char f = str[i];
 
-			i += 1; // Consume the ' or ".
+		i += 1; // Skip the starting quote.
 
-			tok->length = i - tok->offset;
-		}
-		else if(isoper(str[i]))
+		while(1)
 		{
-			tok->offset = i;
-					
-			while(i < len && isoper(str[i]))
+			while(i < len && str[i] != '\\' && str[i] != f)
 				i += 1;
 
-			tok->length = i - tok->offset;
-				
-			// Determine the token
-
-			static const struct {
-				TokenKind    kind;
-				int          size;
-				const char  *text;
-			} optable[] = {
-				{   TADD, 1, "+"  },
-				{   TSUB, 1, "-"  },
-				{   TMUL, 1, "*"  },
-				{   TDIV, 1, "/"  },
-				{   TEQL, 2, "==" },
-				{   TNQL, 2, "!=" },
-				{   TLSS, 1, "<"  },
-				{   TLEQ, 2, "<=" },
-				{   TGRT, 1, ">"  },
-				{   TGEQ, 2, ">=" },
-				{   TASS, 1, "="  },
-				{ TCOMMA, 1, ","  },
-				{   TSMT, 1, "|"  },
-				{   TMOD, 1, "%"  },
-				{   TARW, 2, "->" },
-			};
-
-			_Bool found = 0;
-			for(unsigned int i = 0; i < sizeof(optable)/sizeof(*optable); i += 1)
-				if(optable[i].size == tok->length && !strncmp(optable[i].text, str + tok->offset, tok->length))
-				{
-					found = 1;
-					tok->kind = optable[i].kind;
-					break;
-				}
-
-			if(found == 0)
+			if(i < len && str[i] == '\\')
 			{
-				// Not a known operator.
-				tok->kind = str[tok->offset];
-				tok->length = 1;
-				i = tok->offset + 1;
+				i += 1; // Consume the \.
+				if(i < len && (str[i] == '\'' || str[i] == '"' || str[i] == '\\'))
+					i += 1;
 			}
+			else break;
 		}
-		else	
+
+		if(i == len)
 		{
-			tok->kind = str[i];
-			tok->offset = i;
-			tok->length = 1;
-			i += 1;
+			ctx->lex_error_offset = i;
+			ctx->pos = len;
+			tok->kind = TDONE;
+			tok->offset = len;
+			tok->length = 0;
+			return;
 		}
 
-		// Append to the token list.
-		if(head)
-			tail->next = tok;
-		else
-			head = tok;
-		tok->prev = tail;
-		tok->next = NULL;
-		tail = tok;
-	}
+		i += 1; // Consume the ' or ".
 
+		tok->length = i - tok->offset;
+	}
+	else if(isclass(str[i], CC_OPER))
 	{
-		Token *tok = BPAlloc_Malloc(alloc, sizeof(Token)); // Allocate a token.
-			
-		if(tok == NULL)
-		{
-			// Error: No memory.
-			*error_offset = i;
-			Error_Report(error, ErrorType_INTERNAL, "No memory");
-			return NULL;
-		}
-
-		tok->kind = TDONE;
-		tok->offset = i;
-		tok->length = 0;
+		while(i < len && isclass(str[i], CC_OPER))
+			i += 1;
 
-		if(head)
-			tail->next = tok;
-		else
-			head = tok;
-		tok->prev = tail;
-		tok->next = NULL;
-		tail = tok;
+		tok->length = i - tok->offset;
+		tok->kind = operatorKind(str + tok->offset, &tok->length);
+		i = tok->offset + tok->length;
+	}
+	else	
+	{
+		tok->kind = str[i];
+		tok->length = 1;
+		i += 1;
 	}
 
-	return head;
+	ctx->pos = i;
 }
 
 /* Symbol: parse
@@ -453,19 +394,35 @@ AST *parse(Source *src, BPAlloc *alloc, Error *error, int *error_offset)
 		#warning "should an error be reported here?"
 		return NULL;
 
-	Token *tokens = tokenize(src, alloc, error, error_offset);
-
-	if(tokens == NULL)
-		return NULL;
-
 	Context ctx;
 	ctx.src   = Source_GetBody(src);
-	ctx.token = tokens;
+	ctx.len   = Source_GetSize(src);
+	ctx.pos   = 0;
+	ctx.token = &ctx.window[0];
+	ctx.lookback = false;
+	ctx.has_prev = false;
+	ctx.lex_error_offset = -1;
 	ctx.alloc = alloc;
 	ctx.error = error;
 	ctx.error_offset = error_offset;
+	lex(&ctx, ctx.token);
+
 	Node *root = parse_compound_statement(&ctx, TDONE);
 
+	if(ctx.lex_error_offset >= 0)
+	{
+		// The parser saw the source end where the lexer
+		// failed, which may have caused other errors.
+		if(error->occurred)
+		{
+			Error_Free(error);
+			Error_Init(error);
+		}
+		*error_offset = ctx.lex_error_offset;
+		Error_Report(error, 0, "Source ended inside string literal");
+		return NULL;
+	}
+
 	if(root == NULL)
 		return NULL;
 
@@ -491,6 +448,19 @@ static inline TokenKind current(Context *ctx)
 	return current_token(ctx)->kind;
 }
 
+// Moves to the next token, which is lexed unless the
+// parser went back to the previous one. The token that
+// was before the current one is overwritten.
+static inline void advance(Context *ctx)
+{
+	ctx->token = (ctx->token == &ctx->window[0]) ? &ctx->window[1] : &ctx->window[0];
+	if(ctx->lookback)
+		ctx->lookback = false;
+	else
+		lex(ctx, ctx->token);
+	ctx->has_prev = true;
+}
+
 #ifdef DEBUG
 static inline TokenKind next(Context *ctx, const char *file, int line)
 {
@@ -500,7 +470,7 @@ static inline TokenKind next(Context *ctx, const char *file, int line)
 
 	Token *prev = ctx->token;
 
-	ctx->token = ctx->token->next;
+	advance(ctx);
 
 	fprintf(token_dest, "NEXT [%.*s] -> [%.*s] from %s:%d\n", 
 		      prev->length, ctx->src +       prev->offset,
@@ -510,15 +480,6 @@ static inline TokenKind next(Context *ctx, const char *file, int line)
 	return current(ctx);
 }
 
-static inline TokenKind prev(Context *ctx)
-{
-	assert(ctx != NULL);
-	assert(ctx->token != NULL);
-	assert(ctx->token->prev != NULL);
-	ctx->token = ctx->token->prev;
-	return current(ctx);
-}
-
 #define next(ctx) next(ctx, __FILE__, __LINE__)
 
 static void Error_Report_(Error *error, const char *file, const char *func, int line, _Bool internal, const char *fmt, ...)
@@ -544,21 +505,24 @@ static inline TokenKind next(Context *ctx)
 	assert(ctx != NULL);
 	assert(ctx->token != NULL);
 	assert(ctx->token->kind != TDONE);
-	ctx->token = ctx->token->next;
+	advance(ctx);
 	return current(ctx);
 }
 
+#endif
+
+// Goes back to the previous token. It can only be done
+// once before moving forward again.
 static inline TokenKind prev(Context *ctx)
 {
 	assert(ctx != NULL);
-	assert(ctx->token != NULL);
-	assert(ctx->token->prev != NULL);
-	ctx->token = ctx->token->prev;
+	assert(ctx->has_prev);
+	ctx->token = (ctx->token == &ctx->window[0]) ? &ctx->window[1] : &ctx->window[0];
+	ctx->lookback = true;
+	ctx->has_prev = false;
 	return current(ctx);
 }
 
-#endif
-
 static inline _Bool done(Context *ctx)
 {
 	return current(ctx) == TDONE;
@@ -605,13 +569,13 @@ static Node *parse_statement(Context *ctx)
 
 		case TKWBREAK:
 		{
-			Token *token = current_token(ctx);
+			Token token = *current_token(ctx);
 
 			next(ctx); // Consume the "break".
 
 			if(current(ctx) != ';')
 			{
-				*ctx->error_offset = token->offset;
+				*ctx->error_offset = token.offset;
 				Error_Report(ctx->error, ErrorType_SYNTAX, "Got token \"%.*s\" where \";\" was expected", ctx->token->length, ctx->src + ctx->token->offset);
 				return NULL;
 			}
@@ -629,8 +593,8 @@ static Node *parse_statement(Context *ctx)
 
 			node->kind = NODE_BREAK;
 			node->next = NULL;
-			node->offset = token->offset;
-			node->length = token->length;
+			node->offset = token.offset;
+			node->length = token.length;
 			return node;
 		}
 
@@ -681,6 +645,9 @@ static Node *parse_statement(Context *ctx)
 
 		case TKWDO:
 		return parse_dowhile_statement(ctx);
+
+		case TKWFOR:
+		return parse_for_statement(ctx);
 	}
 
 	*ctx->error_offset = current_token(ctx)->offset;
@@ -1632,7 +1599,7 @@ static Node *parse_prefix_expression(Context *ctx)
 		case '?':
 		case TKWNOT:
 		{
-			Token *unary_operator = current_token(ctx);
+			Token unary_operator = *current_token(ctx);
 
 			next(ctx);
 
@@ -1648,12 +1615,12 @@ static Node *parse_prefix_expression(Context *ctx)
 
 				temp->base.base.kind = NODE_EXPR;
 				temp->base.base.next = NULL;
-				temp->base.base.offset = unary_operator->offset;
-				temp->base.base.length = operand->offset + operand->length - unary_operator->offset;
+				temp->base.base.offset = unary_operator.offset;
+				temp->base.base.length = operand->offset + operand->length - unary_operator.offset;
 				temp->head = operand;
 				temp->count = 1;
 
-				switch(unary_operator->kind)
+				switch(unary_operator.kind)
 				{
 					case '?': temp->base.kind = EXPR_NULLABLETYPE; break;
 					case '+': temp->base.kind = EXPR_POS; break;
@@ -1744,9 +1711,9 @@ static Node *parse_expression_2(Context *ctx, Node *left_expr, int min_prec, _Bo
 {
 	while(isbinop(ctx->token) && precedenceof(ctx->token) >= min_prec)
 	{
-		Token *op = ctx->token;
+		Token op = *ctx->token;
 
-		if((op->kind == ',' && allow_toplev_tuples == 0) || (op->kind == '=' && allow_assignments == 0))
+		if((op.kind == ',' && allow_toplev_tuples == 0) || (op.kind == '=' && allow_assignments == 0))
 			break;
 
 		next(ctx);
@@ -1756,9 +1723,9 @@ static Node *parse_expression_2(Context *ctx, Node *left_expr, int min_prec, _Bo
 		if(right_expr == NULL)
 			return NULL;
 
-		while(isbinop(ctx->token) && (precedenceof(ctx->token) > precedenceof(op) || (precedenceof(ctx->token) == precedenceof(op) && isrightassoc(ctx->token))))
+		while(isbinop(ctx->token) && (precedenceof(ctx->token) > precedenceof(&op) || (precedenceof(ctx->token) == precedenceof(&op) && isrightassoc(ctx->token))))
 		{
-			int new_prec = precedenceof(op) + (precedenceof(op) < precedenceof(ctx->token));
+			int new_prec = precedenceof(&op) + (precedenceof(&op) < precedenceof(ctx->token));
 			right_expr = parse_expression_2(ctx, right_expr, new_prec, allow_toplev_tuples, allow_assignments);
 			
 			if(right_expr == NULL)
@@ -1784,7 +1751,7 @@ static Node *parse_expression_2(Context *ctx, Node *left_expr, int min_prec, _Bo
 			temp->base.base.offset = left_expr->offset;
 			temp->base.base.length = right_expr->offset + right_expr->length - left_expr->offset;
 
-			switch(op->kind)
+			switch(op.kind)
 			{
 				case '+': temp->base.kind = EXPR_ADD; break;
 				case '-': temp->base.kind = EXPR_SUB; break;
@@ -1850,8 +1817,8 @@ static Node *parse_ifelse_statement(Context *ctx)
 		return NULL;
 	}
 
-	Token *if_token = current_token(ctx);
-	assert(if_token != NULL);
+	Token if_token = *current_token(ctx);
+	assert(if_token.kind == TKWIF);
 
 	next(ctx); // Consume the "if" keyword.
 
@@ -1906,8 +1873,8 @@ static Node *parse_ifelse_statement(Context *ctx)
 
 		ifelse->base.kind = NODE_IFELSE;
 		ifelse->base.next = NULL;
-		ifelse->base.offset = if_token->offset;
-		ifelse->base.length = ctx->token->offset + ctx->token->length - if_token->offset;
+		ifelse->base.offset = if_token.offset;
+		ifelse->base.length = ctx->token->offset + ctx->token->length - if_token.offset;
 		ifelse->condition = condition;
 		ifelse->true_branch = true_branch;
 		ifelse->false_branch = false_branch;
@@ -2217,8 +2184,8 @@ static Node *parse_while_statement(Context *ctx)
 		return NULL;
 	}
 
-	Token *while_token = current_token(ctx);
-	assert(while_token != NULL);
+	Token while_token = *current_token(ctx);
+	assert(while_token.kind == TKWWHILE);
 
 	next(ctx); // Consume the "while" keyword.
 
@@ -2261,8 +2228,8 @@ static Node *parse_while_statement(Context *ctx)
 
 		whl->base.kind = NODE_WHILE;
 		whl->base.next = NULL;
-		whl->base.offset = while_token->offset;
-		whl->base.length = ctx->token->offset + ctx->token->length - while_token->offset;
+		whl->base.offset = while_token.offset;
+		whl->base.length = ctx->token->offset + ctx->token->length - while_token.offset;
 		whl->condition = condition;
 		whl->body = body;
 	}
@@ -2288,8 +2255,8 @@ static Node *parse_dowhile_statement(Context *ctx)
 		return NULL;
 	}
 
-	Token *do_token = current_token(ctx);
-	assert(do_token != NULL);
+	Token do_token = *current_token(ctx);
+	assert(do_token.kind == TKWDO);
 
 	next(ctx); // Consume the "do" keyword.
 
@@ -2348,11 +2315,147 @@ static Node *parse_dowhile_statement(Context *ctx)
 
 		dowhl->base.kind = NODE_DOWHILE;
 		dowhl->base.next = NULL;
-		dowhl->base.offset = do_token->offset;
-		dowhl->base.length = ctx->token->offset + ctx->token->length - do_token->offset;
+		dowhl->base.offset = do_token.offset;
+		dowhl->base.length = ctx->token->offset + ctx->token->length - do_token.offset;
 		dowhl->condition = condition;
 		dowhl->body = body;
 	}
 
 	return (Node*) dowhl;
-}
\ No newline at end of file
+}
+
+static char *parse_for_variable(Context *ctx)
+{
+	if(done(ctx))
+	{
+		*ctx->error_offset = ctx->token->offset;
+		Error_Report(ctx->error, ErrorType_SYNTAX, "Source ended where a for loop variable name was expected");
+		return NULL;
+	}
+
+	if(current(ctx) != TIDENT)
+	{
+		*ctx->error_offset = ctx->token->offset;
+		Error_Report(ctx->error, ErrorType_SYNTAX, "Got unexpected token \"%.*s\" where a for loop variable name was expected", ctx->token->length, ctx->src + ctx->token->offset);
+		return NULL;
+	}
+
+	char *name = copy_token_text(ctx);
+
+	if(name == NULL)
+	{
+		*ctx->error_offset = ctx->token->offset;
+		Error_Report(ctx->error, ErrorType_INTERNAL, "No memory");
+		return NULL;
+	}
+
+	next(ctx); // Consume the identifier.
+	return name;
+}
+
+static Node *parse_for_statement(Context *ctx)
+{
+	assert(ctx != NULL);
+
+	if(done(ctx))
+	{
+		*ctx->error_offset = ctx->token->offset;
+		Error_Report(ctx->error, ErrorType_SYNTAX, "Source ended where a for statement was expected");
+		return NULL;
+	}
+
+	if(current(ctx) != TKWFOR)
+	{
+		*ctx->error_offset = ctx->token->offset;
+		Error_Report(ctx->error, ErrorType_SYNTAX, "Got unexpected token \"%.*s\" where a for statement was expected", ctx->token->length, ctx->src + ctx->token->offset);
+		return NULL;
+	}
+
+	Token for_token = *current_token(ctx);
+	assert(for_token.kind == TKWFOR);
+
+	next(ctx); // Consume the "for" keyword.
+
+	// Either "for val in .." or "for key, val in ..".
+	char *key = NULL;
+	char *val = parse_for_variable(ctx);
+
+	if(val == NULL)
+		return NULL;
+
+	if(current(ctx) == ',')
+	{
+		next(ctx); // Consume the ','.
+
+		key = val;
+		val = parse_for_variable(ctx);
+
+		if(val == NULL)
+			return NULL;
+	}
+
+	if(done(ctx))
+	{
+		*ctx->error_offset = ctx->token->offset;
+		Error_Report(ctx->error, ErrorType_SYNTAX, "Source ended right after the for loop variables, where the \"in\" keyword was expected");
+		return NULL;
+	}
+
+	if(current(ctx) != TKWIN)
+	{
+		*ctx->error_offset = ctx->token->offset;
+		Error_Report(ctx->error, ErrorType_SYNTAX, "Got unexpected token \"%.*s\" after the for loop variables, where the \"in\" keyword was expected", ctx->token->length, ctx->src + ctx->token->offset);
+		return NULL;
+	}
+
+	next(ctx); // Consume the "in" keyword.
+
+	Node *set = parse_expression(ctx, 1, 0);
+	
+	if(set == NULL) 
+		return NULL;
+
+	if(done(ctx))
+	{
+		*ctx->error_offset = ctx->token->offset;
+		Error_Report(ctx->error, ErrorType_SYNTAX, "Source ended right after a for loop collection, where a ':' was expected");
+		return NULL;
+	}
+
+	if(current(ctx) != ':')
+	{
+		*ctx->error_offset = ctx->token->offset;
+		Error_Report(ctx->error, ErrorType_SYNTAX, "Got unexpected token \"%.*s\" after a for loop collection, where a ':' was expected", ctx->token->length, ctx->src + ctx->token->offset);
+		return NULL;
+	}
+
+	next(ctx); // Skip the ':'.
+
+	Node *body = parse_statement(ctx);
+	
+	if(body == NULL) 
+		return NULL;
+
+	ForNode *fr;
+	{
+		fr = BPAlloc_Malloc(ctx->alloc, sizeof(ForNode));
+		
+		if(fr == NULL)
+		{
+			*ctx->error_offset = ctx->token->offset;
+			Error_Report(ctx->error, ErrorType_INTERNAL, "No memory");
+			return NULL;
+		}
+
+		fr->base.kind = NODE_FOR;
+		fr->base.next = NULL;
+		fr->base.offset = for_token.offset;
+		fr->base.length = ctx->token->offset + ctx->token->length - for_token.offset;
+		fr->key = key;
+		fr->val = val;
+		fr->set = set;
+		fr->body = body;
+	}
+
+	return (Node*) fr;
+}
@@ -10,9 +10,16 @@
 #define TYPENAME_LIST   "List"
 #define TYPENAME_STRING "String"
 #define TYPENAME_BUFFER "Buffer"
+#define TYPENAME_RANGE  "Range"
+#define TYPENAME_MAPVIEW "MapView"
+#define TYPENAME_ITERATOR "Iterator"
+
+#define TYPENAME_INTARRAY   "IntArray"
+#define TYPENAME_FLOATARRAY "FloatArray"
 
 #define TYPENAME_FILE      "File"
 #define TYPENAME_DIRECTORY "Directory"
+#define TYPENAME_REGEX     "Regex"
 
 #define TYPENAME_NULLABLE "NullableType"
 #define TYPENAME_SUM      "SumType"
@@ -31,7 +31,14 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
 #include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "executable.h"
 #include "utils/defs.h"
 #include "utils/bucketlist.h"
@@ -39,10 +46,14 @@
 #define MAX_OPS 3
 #define MAX_OPCODE_NAME_SIZE 127
 
+// The [caller] of an instruction is the source offset of
+// the call its code was inlined into, or -1 if it wasn't
+// inlined, so that stack traces can show the call.
 typedef struct {
 	Opcode 	opcode;
 	int 	offset;
 	int 	length;
+	int 	caller;
 	union {
 		long long int as_int;
 		double 		  as_float;
@@ -55,11 +66,14 @@ struct xExecutable {
 	char 		*head;
 	Instruction *body;
 	Source 		*src;
+	void 		*map;  // Mapping of the file the executable
+	size_t 		 mapl; // was loaded from, or NULL.
 };
 
 struct xExeBuilder {
 	BucketList *data, *code;
 	int promc;
+	int caller;
 };
 
 typedef struct {
@@ -69,8 +83,10 @@ typedef struct {
 	OperandType *optypes;
 } InstrInfo;
 
+// The table is indexed by opcode, since it's
+// looked up each time an instruction is fetched.
 #define INSTR(name, ...)  	 	 		 \
-	{							 		 \
+	[OPCODE_##name] = {			 		 \
 		OPCODE_##name, 			 		 \
 		#name,					 		 \
 		sizeof((OperandType[]) { __VA_ARGS__ }) / sizeof(OperandType), \
@@ -120,6 +136,27 @@ static const InstrInfo instr_table[] = {
 	INSTR(JUMPIFNOTANDPOP, OPTP_IDX)
 	INSTR(JUMPIFANDPOP, OPTP_IDX)
 	INSTR(JUMP, OPTP_IDX)
+	INSTR(ITER_INIT)
+	INSTR(ITER_NEXT, OPTP_IDX, OPTP_INT)
+	INSTR(CHECKFUN, OPTP_IDX, OPTP_IDX)
+	INSTR(PUSHSTK, OPTP_INT)
+	INSTR(POPUNDER, OPTP_INT)
+	INSTR(CHECKINT, OPTP_INT, OPTP_STRING)
+	INSTR(CHECKFLT, OPTP_INT, OPTP_STRING)
+	INSTR(ADDINT)
+	INSTR(SUBINT)
+	INSTR(MULINT)
+	INSTR(LSSINT)
+	INSTR(GRTINT)
+	INSTR(LEQINT)
+	INSTR(GEQINT)
+	INSTR(ADDFLT)
+	INSTR(SUBFLT)
+	INSTR(MULFLT)
+	INSTR(LSSFLT)
+	INSTR(GRTFLT)
+	INSTR(LEQFLT)
+	INSTR(GEQFLT)
 };
 
 static const size_t instr_count = sizeof(instr_table)/sizeof(instr_table[0]);
@@ -140,7 +177,7 @@ _Bool Executable_GetOpcodeBinaryFromName(const char *name, size_t len, Opcode *o
 	ASSERT(name[len] == '\0');
 
 	for(size_t i = 0; i < instr_count; i += 1) {
-		if(!strcmp(name, instr_table[i].name)) {
+		if(instr_table[i].name != NULL && !strcmp(name, instr_table[i].name)) {
 			if (opcode != NULL)
 				*opcode = instr_table[i].opcode;
 			return 1;
@@ -151,10 +188,9 @@ _Bool Executable_GetOpcodeBinaryFromName(const char *name, size_t len, Opcode *o
 
 static const InstrInfo *Executable_GetInstrByOpcode(Opcode opcode)
 {
-	for (size_t i = 0; i < instr_count; i++)
-		if (instr_table[i].opcode == opcode)
-			return instr_table + i;
-	return NULL;
+	if ((size_t) opcode >= instr_count || instr_table[opcode].name == NULL)
+		return NULL;
+	return instr_table + opcode;
 }
 
 const char *Executable_GetOpcodeName(Opcode opcode)
@@ -182,6 +218,8 @@ void Executable_Free(Executable *exe)
 	{
 		if(exe->src)
 			Source_Free(exe->src);
+		if(exe->map)
+			munmap(exe->map, exe->mapl);
 		free(exe);
 	}
 }
@@ -265,6 +303,19 @@ int Executable_GetInstrLength(Executable *exe, int index)
 		return -1;
 }
 
+// Returns the offset of the call the instruction was
+// inlined into, or -1 if it wasn't inlined.
+int Executable_GetInstrCaller(Executable *exe, int index)
+{
+	if(index < 0 || index >= exe->bodyl)
+		return -1;
+
+	if(exe->src)
+		return exe->body[index].caller;
+	else
+		return -1;
+}
+
 _Bool Executable_Fetch(Executable *exe, int index, Opcode *opcode, Operand *ops, int *opc)
 {
 	ASSERT(index >= 0);
@@ -426,6 +477,283 @@ _Bool Executable_Equiv(Executable *exe1, Executable *exe2, FILE *log, const char
 	return true;
 }
 
+// Executables can be stored in files, so that the
+// scripts they were compiled from don't need to be
+// compiled again. A file is made of this header, 
+// followed by the instruction array (which also holds
+// the source map) and by the string pool, in the same
+// layout they have in memory. This way a file can be
+// mapped and used as it is.
+//
+// The instructions are stored in the native layout, 
+// so the file is only valid for the build that wrote
+// it. The header records the format version, the size
+// of an instruction and the number of opcodes to catch
+// files written by other builds, and the hash of the
+// source to catch files that are out of date.
+
+#define EXECUTABLE_FILE_MAGIC "NOJX"
+#define EXECUTABLE_FILE_VERSION 2
+
+typedef struct {
+	char 	 magic[4];
+	uint32_t version;
+	uint32_t instr_size;
+	uint32_t opcode_count;
+	uint64_t hash;
+	uint32_t headl;
+	uint32_t bodyl;
+} ExecutableFileHeader;
+
+// The instructions follow the header, so it must keep 
+// them aligned.
+_Static_assert(sizeof(ExecutableFileHeader) % _Alignof(Instruction) == 0, 
+			   "The executable file header misaligns the instructions");
+
+// Writes the executable in the file format to a stream.
+// It doesn't report errors, which are detected with
+// ferror.
+_Bool Executable_Write(Executable *exe, FILE *fp, uint64_t hash)
+{
+	ExecutableFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, EXECUTABLE_FILE_MAGIC, sizeof(header.magic));
+	header.version = EXECUTABLE_FILE_VERSION;
+	header.instr_size = sizeof(Instruction);
+	header.opcode_count = instr_count;
+	header.hash  = hash;
+	header.headl = exe->headl;
+	header.bodyl = exe->bodyl;
+
+	return fwrite(&header, sizeof(header), 1, fp) == 1
+		&& fwrite(exe->body, sizeof(Instruction), exe->bodyl, fp) == (size_t) exe->bodyl
+		&& fwrite(exe->head, 1, exe->headl, fp) == (size_t) exe->headl;
+}
+
+// Returns the number of bytes [Executable_Write] writes.
+size_t Executable_GetWriteSize(Executable *exe)
+{
+	return sizeof(ExecutableFileHeader) + exe->bodyl * sizeof(Instruction) + exe->headl;
+}
+
+_Bool Executable_Save(Executable *exe, const char *file, uint64_t hash, Error *error)
+{
+	// The file is written under a temporary name and 
+	// then renamed, so that other processes loading it
+	// at the same time never see it partially written.
+	char temp[1024];
+	int k = snprintf(temp, sizeof(temp), "%s.%ld.tmp", file, (long) getpid());
+	if(k < 0 || (size_t) k >= sizeof(temp))
+	{
+		Error_Report(error, ErrorType_INTERNAL, "Internal buffer is too small");
+		return 0;
+	}
+
+	FILE *fp = fopen(temp, "wb");
+	if(fp == NULL)
+	{
+		Error_Report(error, ErrorType_INTERNAL, "Couldn't open \"%s\" (%s)", temp, strerror(errno));
+		return 0;
+	}
+
+	_Bool ok = Executable_Write(exe, fp, hash);
+	
+	if(fclose(fp))
+		ok = 0;
+
+	if(!ok || rename(temp, file))
+	{
+		Error_Report(error, ErrorType_INTERNAL, "Couldn't write \"%s\" (%s)", file, strerror(errno));
+		remove(temp);
+		return 0;
+	}
+	return 1;
+}
+
+// Checks that the instructions of an executable that
+// was read from a file can be run safely.
+static _Bool validateInstructions(Instruction *body, int bodyl, const char *head, int headl)
+{
+	if(headl > 0 && head[headl-1] != '\0')
+		return 0;
+
+	for(int i = 0; i < bodyl; i += 1)
+	{
+		const InstrInfo *info = Executable_GetInstrByOpcode(body[i].opcode);
+		if(info == NULL)
+			return 0;
+
+		for(int j = 0; j < info->opcount; j += 1)
+		{
+			long long int operand = body[i].operands[j].as_int;
+			switch(info->optypes[j])
+			{
+				case OPTP_STRING:
+				if(operand < 0 || operand >= headl)
+					return 0;
+				break;
+
+				case OPTP_IDX:
+				if(operand < 0 || operand > bodyl)
+					return 0;
+				break;
+
+				default:
+				break;
+			}
+		}
+	}
+	return 1;
+}
+
+// Creates an executable that refers to the instructions
+// and strings of an image of an executable file, after
+// checking that it's valid. The image must outlive the
+// executable and be aligned like an instruction.
+Executable *Executable_FromMemory(const void *data, size_t size, uint64_t hash, Error *error)
+{
+	ASSERT(((uintptr_t) data) % _Alignof(Instruction) == 0);
+
+	const ExecutableFileHeader *header = data;
+	
+	if(size < sizeof(ExecutableFileHeader)
+		|| memcmp(header->magic, EXECUTABLE_FILE_MAGIC, sizeof(header->magic)))
+	{
+		Error_Report(error, ErrorType_INTERNAL, "Not an executable");
+		return NULL;
+	}
+
+	if(header->version != EXECUTABLE_FILE_VERSION
+		|| header->instr_size != sizeof(Instruction)
+		|| header->opcode_count != instr_count)
+	{
+		Error_Report(error, ErrorType_INTERNAL, "Executable was written by a different version of noja");
+		return NULL;
+	}
+
+	if(header->hash != hash)
+	{
+		Error_Report(error, ErrorType_INTERNAL, "Executable is out of date");
+		return NULL;
+	}
+
+	Instruction *body = (Instruction*) (header + 1);
+	char 		*head = (char*) (body + header->bodyl);
+
+	if(header->bodyl > INT_MAX / sizeof(Instruction) || header->headl > INT_MAX
+		|| size != sizeof(ExecutableFileHeader) + header->bodyl * sizeof(Instruction) + header->headl
+		|| !validateInstructions(body, header->bodyl, head, header->headl))
+	{
+		Error_Report(error, ErrorType_INTERNAL, "Executable is corrupted");
+		return NULL;
+	}
+
+	Executable *exe = malloc(sizeof(Executable));
+	if(exe == NULL)
+	{
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		return NULL;
+	}
+
+	exe->refs  = 1;
+	exe->headl = header->headl;
+	exe->bodyl = header->bodyl;
+	exe->head  = head;
+	exe->body  = body;
+	exe->src   = NULL;
+	exe->map   = NULL;
+	exe->mapl  = 0;
+	return exe;
+}
+
+// Returns a copy of an executable that doesn't depend
+// on the memory of the original one, which may be an
+// image that needs to be released.
+Executable *Executable_Duplicate(Executable *exe, Error *error)
+{
+	size_t codel = exe->bodyl * sizeof(Instruction);
+
+	Executable *copy = malloc(sizeof(Executable) + codel + exe->headl);
+	if(copy == NULL)
+	{
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		return NULL;
+	}
+
+	copy->refs  = 1;
+	copy->headl = exe->headl;
+	copy->bodyl = exe->bodyl;
+	copy->body  = (Instruction*) (copy + 1);
+	copy->head  = (char*) (copy->body + copy->bodyl);
+	copy->src   = exe->src ? Source_Copy(exe->src) : NULL;
+	copy->map   = NULL;
+	copy->mapl  = 0;
+	memcpy(copy->body, exe->body, codel);
+	memcpy(copy->head, exe->head, exe->headl);
+	return copy;
+}
+
+// Returns the offset of a string in the pool of the
+// executable, or -1 if it's not one of its strings.
+int Executable_GetStringOffset(Executable *exe, const char *str)
+{
+	if(str < exe->head || str >= exe->head + exe->headl)
+		return -1;
+	return str - exe->head;
+}
+
+const char *Executable_GetStringAtOffset(Executable *exe, int offset)
+{
+	if(offset < 0 || offset >= exe->headl)
+		return NULL;
+	return exe->head + offset;
+}
+
+Executable *Executable_Load(const char *file, uint64_t hash, Error *error)
+{
+	int fd = open(file, O_RDONLY);
+	if(fd < 0)
+	{
+		Error_Report(error, ErrorType_INTERNAL, "Couldn't open \"%s\" (%s)", file, strerror(errno));
+		return NULL;
+	}
+
+	struct stat info;
+	if(fstat(fd, &info))
+	{
+		Error_Report(error, ErrorType_INTERNAL, "Call to fstat failed (%s, errno = %d)", strerror(errno), errno);
+		close(fd);
+		return NULL;
+	}
+
+	size_t size = info.st_size;
+	if(size < sizeof(ExecutableFileHeader))
+	{
+		Error_Report(error, ErrorType_INTERNAL, "\"%s\" isn't an executable", file);
+		close(fd);
+		return NULL;
+	}
+
+	void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED)
+	{
+		Error_Report(error, ErrorType_INTERNAL, "Call to mmap failed (%s, errno = %d)", strerror(errno), errno);
+		return NULL;
+	}
+
+	Executable *exe = Executable_FromMemory(map, size, hash, error);
+	if(exe == NULL)
+	{
+		munmap(map, size);
+		return NULL;
+	}
+
+	exe->map  = map;
+	exe->mapl = size;
+	return exe;
+}
+
 ExeBuilder *ExeBuilder_New(BPAlloc *alloc)
 {
 	ASSERT(alloc != NULL);
@@ -436,6 +764,7 @@ ExeBuilder *ExeBuilder_New(BPAlloc *alloc)
 		return NULL;
 
 	exeb->promc = 0;
+	exeb->caller = -1;
 	exeb->data = BucketList_New(alloc);
 	exeb->code = BucketList_New(alloc);
 
@@ -476,7 +805,8 @@ Executable *ExeBuilder_Finalize(ExeBuilder *exeb, Error *error)
 		exe->head = (char*) (exe->body + exe->bodyl);
 		exe->refs = 1;
 		exe->src = NULL;
-		
+		exe->map = NULL;
+		exe->mapl = 0;
 	}
 
 	BucketList_Copy(exeb->data, exe->head, -1);
@@ -552,6 +882,7 @@ _Bool ExeBuilder_Append(ExeBuilder *exeb, Error *error, Opcode opcode, Operand *
 		instr->opcode = opcode;
 		instr->offset = off;
 		instr->length = len;
+		instr->caller = exeb->caller;
 
 		for(int i = 0; i < opc; i += 1)
 		{
@@ -656,6 +987,14 @@ BPAlloc *ExeBuilder_GetAlloc(ExeBuilder *exeb)
 	return BucketList_GetAlloc(exeb->code);
 }
 
+// Sets the offset of the call that the instructions
+// appended from now on are inlined into. It's -1 for
+// instructions that aren't inlined.
+void ExeBuilder_SetCaller(ExeBuilder *exeb, int off)
+{
+	exeb->caller = off;
+}
+
 int ExeBuilder_InstrCount(ExeBuilder *exeb)
 {
 	int raw_size = BucketList_Size(exeb->code);
@@ -31,6 +31,7 @@
 #ifndef EXECUTABLE_H
 #define EXECUTABLE_H
 #include <stdio.h>
+#include <stdint.h>
 #include "utils/source.h"
 #include "utils/promise.h"
 
@@ -95,6 +96,27 @@ typedef enum {
 	OPCODE_JUMPIFNOTANDPOP,
 	OPCODE_JUMP,
 	OPCODE_CHECKTYPE,
+	OPCODE_ITER_INIT,
+	OPCODE_ITER_NEXT,
+	OPCODE_CHECKFUN,
+	OPCODE_PUSHSTK,
+	OPCODE_POPUNDER,
+	OPCODE_CHECKINT,
+	OPCODE_CHECKFLT,
+	OPCODE_ADDINT,
+	OPCODE_SUBINT,
+	OPCODE_MULINT,
+	OPCODE_LSSINT,
+	OPCODE_GRTINT,
+	OPCODE_LEQINT,
+	OPCODE_GEQINT,
+	OPCODE_ADDFLT,
+	OPCODE_SUBFLT,
+	OPCODE_MULFLT,
+	OPCODE_LSSFLT,
+	OPCODE_GRTFLT,
+	OPCODE_LEQFLT,
+	OPCODE_GEQFLT,
 } Opcode;
 
 typedef struct xExecutable Executable;
@@ -109,7 +131,16 @@ _Bool 		Executable_SetSource(Executable *exe, Source *src);
 Source 	   *Executable_GetSource(Executable *exe);
 int 		Executable_GetInstrOffset(Executable *exe, int index);
 int 		Executable_GetInstrLength(Executable *exe, int index);
+int 		Executable_GetInstrCaller(Executable *exe, int index);
 const char *Executable_GetOpcodeName(Opcode opcode);
+Executable *Executable_Load(const char *file, uint64_t hash, Error *error);
+Executable *Executable_FromMemory(const void *data, size_t size, uint64_t hash, Error *error);
+_Bool 		Executable_Save(Executable *exe, const char *file, uint64_t hash, Error *error);
+_Bool 		Executable_Write(Executable *exe, FILE *fp, uint64_t hash);
+size_t 		Executable_GetWriteSize(Executable *exe);
+Executable *Executable_Duplicate(Executable *exe, Error *error);
+int 		Executable_GetStringOffset(Executable *exe, const char *str);
+const char *Executable_GetStringAtOffset(Executable *exe, int offset);
 _Bool       Executable_GetOpcodeBinaryFromName(const char *name, size_t name_len, Opcode *opcode);
 
 ExeBuilder *ExeBuilder_New(BPAlloc *alloc);
@@ -117,5 +148,6 @@ _Bool 		ExeBuilder_Append(ExeBuilder *exeb, Error *error, Opcode opcode, Operand
 Executable *ExeBuilder_Finalize(ExeBuilder *exeb, Error *error);
 BPAlloc    *ExeBuilder_GetAlloc(ExeBuilder *exeb);
 int 		ExeBuilder_InstrCount(ExeBuilder *exeb);
+void 		ExeBuilder_SetCaller(ExeBuilder *exeb, int off);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,805 @@
+#include <stdio.h>
+#include <errno.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "image.h"
+#include "utils/defs.h"
+#include "builtins/basic.h"
+
+// A runtime image is a copy of the heap of a runtime that
+// finished its setup, from which new runtimes can be made
+// without running the setup code again. It holds what's
+// reachable from the builtins and the module map, which
+// are the only roots that outlive the scripts.
+//
+// Since the copy will be placed at a different address,
+// every pointer it holds is stored in a relative form
+// and fixed when a runtime is made from the image, by
+// walking the relocation list:
+//
+//   - Pointers to the heap are stored as offsets from
+//     its start.
+//
+//   - Pointers to the static memory of the program, like
+//     static objects, native functions and their tables,
+//     are stored as offsets from an anchor function. The
+//     program may be loaded at a different address in a
+//     different process, but all of its parts move by the
+//     same amount, so the offsets are still valid as long
+//     as it's the same build.
+//
+//   - Executables are stored in a list, and the pointers
+//     to them and their strings are stored as indices
+//     in it.
+//
+//   - Pointers to the runtime are replaced with the new
+//     runtime.
+//
+// Objects that hold resources other than these, like
+// files, can't be stored in an image.
+
+typedef enum {
+	RELOC_HEAP,
+	RELOC_STATIC,
+	RELOC_RUNTIME,
+	RELOC_EXECUTABLE,
+	RELOC_EXESTRING,
+} RelocKind;
+
+typedef struct {
+	uint32_t offset; // Of the pointer, from the start of the heap.
+	uint32_t kind;
+	uint64_t value;  // Relative form of the pointer.
+} Reloc;
+
+struct xRuntimeImage {
+	char     *heap;
+	uint32_t  heapl;
+	uint32_t  objcount;
+	int64_t   builtins; // Offsets of the roots, or -1
+	int64_t   modules;  // when they're NULL.
+	Reloc    *relocs;
+	int       relocc;
+	uint32_t *destructs; // Offsets of the objects with
+	int       destructc; // a destructor.
+	Executable **exes;
+	int          exec;
+};
+
+static char *getAnchor(void)
+{
+	return (char*) (uintptr_t) &getAnchor;
+}
+
+static bool append(void **array, int *count, int *capacity, size_t itemsize, const void *item)
+{
+	if (*count == *capacity) {
+		int new_capacity = (*capacity == 0) ? 32 : 2 * *capacity;
+		void *temp = realloc(*array, new_capacity * itemsize);
+		if (temp == NULL)
+			return false;
+		*array = temp;
+		*capacity = new_capacity;
+	}
+	memcpy((char*) *array + *count * itemsize, item, itemsize);
+	*count += 1;
+	return true;
+}
+
+void RuntimeImage_Free(RuntimeImage *image)
+{
+	for (int i = 0; i < image->exec; i++)
+		Executable_Free(image->exes[i]);
+	free(image->exes);
+	free(image->destructs);
+	free(image->relocs);
+	free(image->heap);
+	free(image);
+}
+
+static RuntimeImage *newImage(Error *error)
+{
+	RuntimeImage *image = malloc(sizeof(RuntimeImage));
+	if (image == NULL) {
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		return NULL;
+	}
+	memset(image, 0, sizeof(RuntimeImage));
+	image->builtins = -1;
+	image->modules  = -1;
+	return image;
+}
+
+typedef struct {
+	RuntimeImage *image;
+	char    *base;
+	uint32_t used;
+	uint8_t *visited; // One bit for each 8 bytes of the heap.
+	Object **queue;
+	int queue_count, queue_capacity;
+	int reloc_capacity, destruct_capacity, exe_capacity;
+	int last_exe;
+	Error *error;
+} Capture;
+
+static bool inHeap(Capture *capture, const void *ptr)
+{
+	return (const char*) ptr >= capture->base
+		&& (const char*) ptr <  capture->base + capture->used;
+}
+
+static void fail(Capture *capture, const char *message)
+{
+	if (!capture->error->occurred)
+		Error_Report(capture->error, ErrorType_INTERNAL, "%s", message);
+}
+
+static void addReloc(Capture *capture, void *referer, RelocKind kind, uint64_t value)
+{
+	if (!inHeap(capture, referer)) {
+		fail(capture, "Object refers to another through memory that isn't part of the heap");
+		return;
+	}
+
+	Reloc reloc = {
+		.offset = (char*) referer - capture->base,
+		.kind = kind,
+		.value = value,
+	};
+	RuntimeImage *image = capture->image;
+	if (!append((void**) &image->relocs, &image->relocc, &capture->reloc_capacity, sizeof(Reloc), &reloc))
+		fail(capture, "No memory");
+}
+
+static void enqueue(Capture *capture, Object *obj)
+{
+	uint32_t unit = ((char*) obj - capture->base) / 8;
+	if (capture->visited[unit / 8] & (1 << (unit % 8)))
+		return;
+	capture->visited[unit / 8] |= 1 << (unit % 8);
+
+	if (!append((void**) &capture->queue, &capture->queue_count, &capture->queue_capacity, sizeof(Object*), &obj))
+		fail(capture, "No memory");
+}
+
+static void captureReference(Object **referer, void *userp)
+{
+	Capture *capture = userp;
+	Object *obj = *referer;
+
+	if (obj == NULL)
+		return;
+
+	if (inHeap(capture, obj)) {
+		addReloc(capture, referer, RELOC_HEAP, (char*) obj - capture->base);
+		enqueue(capture, obj);
+	} else if (obj->flags & Object_STATIC)
+		addReloc(capture, referer, RELOC_STATIC, (char*) obj - getAnchor());
+	else
+		fail(capture, "Object refers to another that isn't part of the heap");
+}
+
+static void captureExtension(void **referer, unsigned int size, void *userp)
+{
+	UNUSED(size);
+
+	Capture *capture = userp;
+
+	if (*referer == NULL)
+		return;
+
+	if (inHeap(capture, *referer))
+		addReloc(capture, referer, RELOC_HEAP, (char*) *referer - capture->base);
+	else
+		fail(capture, "Object has an extension that isn't part of the heap");
+}
+
+static void captureExtern(void **referer, ExternKind kind, void *userp)
+{
+	Capture *capture = userp;
+	RuntimeImage *image = capture->image;
+
+	if (*referer == NULL)
+		return;
+
+	switch (kind) {
+
+		case EXTERN_STATIC:
+		addReloc(capture, referer, RELOC_STATIC, (char*) *referer - getAnchor());
+		break;
+
+		case EXTERN_RUNTIME:
+		addReloc(capture, referer, RELOC_RUNTIME, 0);
+		break;
+
+		case EXTERN_EXECUTABLE:
+		{
+			Executable *exe = *referer;
+
+			int i = 0;
+			while (i < image->exec && image->exes[i] != exe)
+				i++;
+
+			if (i == image->exec) {
+				Executable *copy = Executable_Copy(exe);
+				if (!append((void**) &image->exes, &image->exec, &capture->exe_capacity, sizeof(Executable*), &copy)) {
+					Executable_Free(copy);
+					fail(capture, "No memory");
+					return;
+				}
+			}
+
+			capture->last_exe = i;
+			addReloc(capture, referer, RELOC_EXECUTABLE, i);
+			break;
+		}
+
+		case EXTERN_EXESTRING:
+		{
+			int offset = -1;
+			if (capture->last_exe >= 0)
+				offset = Executable_GetStringOffset(image->exes[capture->last_exe], *referer);
+
+			if (offset < 0) {
+				fail(capture, "Object refers to a string that isn't part of an executable");
+				return;
+			}
+
+			addReloc(capture, referer, RELOC_EXESTRING, ((uint64_t) capture->last_exe << 32) | (uint32_t) offset);
+			break;
+		}
+	}
+}
+
+static void captureObject(Capture *capture, Object *obj)
+{
+	const TypeObject *type = Object_GetType(obj);
+
+	if (type->free != NULL) {
+
+		if (type->walkexterns == NULL) {
+			if (!capture->error->occurred)
+				Error_Report(capture->error, ErrorType_RUNTIME, "Objects of type %s can't be stored in an image", type->name);
+			return;
+		}
+
+		RuntimeImage *image = capture->image;
+		uint32_t offset = (char*) obj - capture->base;
+		if (!append((void**) &image->destructs, &image->destructc, &capture->destruct_capacity, sizeof(uint32_t), &offset)) {
+			fail(capture, "No memory");
+			return;
+		}
+	}
+
+	captureReference((Object**) &obj->type, capture);
+	Object_WalkExtensions(obj, captureExtension, capture);
+	Object_WalkReferences(obj, captureReference, capture);
+
+	capture->last_exe = -1;
+	Object_WalkExterns(obj, captureExtern, capture);
+}
+
+static int64_t captureRoot(Capture *capture, Object *root)
+{
+	if (root == NULL)
+		return -1;
+
+	if (!inHeap(capture, root)) {
+		fail(capture, "Root object isn't part of the heap");
+		return -1;
+	}
+
+	enqueue(capture, root);
+	return (char*) root - capture->base;
+}
+
+RuntimeImage *RuntimeImage_FromRuntime(Runtime *runtime, Error *error)
+{
+	if (Runtime_GetDepth(runtime) > 0) {
+		Error_Report(error, ErrorType_RUNTIME, "Images can't be made of runtimes that are running code");
+		return NULL;
+	}
+
+	if (Runtime_GetTimingTable(runtime) != NULL) {
+		Error_Report(error, ErrorType_RUNTIME, "Images can't be made of runtimes that are profiling");
+		return NULL;
+	}
+
+	// Make sure the module map exists before compacting
+	// the heap, so that its creation doesn't allocate
+	// outside of the compacted region.
+	if (Runtime_GetModules(runtime, error) == NULL)
+		return NULL;
+
+	// The collection leaves the heap with only the live
+	// objects, all of them inside of its main memory pool.
+	if (!Runtime_CollectGarbage(runtime, error))
+		return NULL;
+
+	RuntimeImage *image = newImage(error);
+	if (image == NULL)
+		return NULL;
+
+	Heap *heap = Runtime_GetHeap(runtime);
+
+	Capture capture = {
+		.image = image,
+		.base  = Heap_GetPointer(heap),
+		.used  = Heap_GetUsedSize(heap),
+		.last_exe = -1,
+		.error = error,
+	};
+
+	capture.visited = calloc(capture.used / 64 + 1, 1);
+	if (capture.visited == NULL) {
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		RuntimeImage_Free(image);
+		return NULL;
+	}
+
+	image->builtins = captureRoot(&capture, Runtime_GetBuiltins(runtime));
+	image->modules  = captureRoot(&capture, Runtime_GetModules(runtime, error));
+
+	while (capture.queue_count > 0 && !error->occurred) {
+		Object *obj = capture.queue[--capture.queue_count];
+		captureObject(&capture, obj);
+		image->objcount += 1;
+	}
+
+	free(capture.visited);
+	free(capture.queue);
+
+	if (error->occurred) {
+		RuntimeImage_Free(image);
+		return NULL;
+	}
+
+	image->heapl = capture.used;
+	image->heap = malloc(image->heapl);
+	if (image->heap == NULL && image->heapl > 0) {
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		RuntimeImage_Free(image);
+		return NULL;
+	}
+	memcpy(image->heap, capture.base, image->heapl);
+	return image;
+}
+
+// Loads the image in a runtime with an empty heap.
+static bool loadImage(Runtime *runtime, RuntimeImage *image, Error *error)
+{
+	Heap *heap = Runtime_GetHeap(runtime);
+	if (!Heap_LoadImage(heap, image->heap, image->heapl, image->objcount, error))
+		return false;
+
+	char *base = Heap_GetPointer(heap);
+	char *anchor = getAnchor();
+
+	for (int i = 0; i < image->relocc; i++) {
+
+		Reloc reloc = image->relocs[i];
+
+		void *ptr;
+		switch (reloc.kind) {
+			case RELOC_HEAP:       ptr = base + reloc.value; break;
+			case RELOC_STATIC:     ptr = anchor + (int64_t) reloc.value; break;
+			case RELOC_RUNTIME:    ptr = runtime; break;
+			case RELOC_EXECUTABLE: ptr = Executable_Copy(image->exes[reloc.value]); break;
+			case RELOC_EXESTRING:  ptr = (void*) Executable_GetStringAtOffset(image->exes[reloc.value >> 32], reloc.value & 0xFFFFFFFF); break;
+			default: UNREACHABLE; ptr = NULL; break;
+		}
+		memcpy(base + reloc.offset, &ptr, sizeof(void*));
+	}
+
+	for (int i = 0; i < image->destructc; i++)
+		if (!Heap_TrackDestructor(heap, (Object*) (base + image->destructs[i]), error))
+			return false;
+
+	if (image->builtins >= 0 && !Runtime_plugBuiltins(runtime, (Object*) (base + image->builtins), error))
+		return false;
+
+	if (image->modules >= 0)
+		Runtime_SetModules(runtime, (Object*) (base + image->modules));
+
+	return true;
+}
+
+Runtime *Runtime_NewFromImage(RuntimeImage *image, RuntimeConfig config, Error *error)
+{
+	if (config.time) {
+		Error_Report(error, ErrorType_INTERNAL, "Runtimes made from images can't profile");
+		return NULL;
+	}
+
+	Runtime *runtime = Runtime_New(config);
+	if (runtime == NULL) {
+		Error_Report(error, ErrorType_INTERNAL, "Failed to initialize runtime");
+		return NULL;
+	}
+
+	if (!loadImage(runtime, image, error)) {
+		Runtime_Free(runtime);
+		return NULL;
+	}
+	return runtime;
+}
+
+// Brings a runtime made from [image] back to the state
+// it had when it was made, dropping everything the scripts
+// it ran allocated. A heap watermark isn't enough for this
+// since scripts may have mutated objects of the image and
+// the collector moves them, so the heap is emptied and the
+// image loaded again. The cost is a copy of the image heap
+// plus its relocations, which doesn't depend on how much
+// the scripts allocated. If this fails the runtime is left
+// empty and should be freed.
+bool Runtime_ResetFromImage(Runtime *runtime, RuntimeImage *image, Error *error)
+{
+	Runtime_Reset(runtime);
+	return loadImage(runtime, image, error);
+}
+
+// The image file is made of this header followed by the
+// heap, the relocations, the offsets of the objects with
+// destructors and the executables. Each of these parts
+// is padded to 8 bytes. Each executable is stored as its
+// size, its bytes in the executable file format and its
+// source.
+
+#define IMAGE_FILE_MAGIC "NOJI"
+#define IMAGE_FILE_VERSION 1
+
+typedef struct {
+	char     magic[4];
+	uint32_t version;
+	int64_t  layout[2]; // Distance of some symbols from the anchor,
+	                    // to detect images of different builds.
+	int64_t  builtins;
+	int64_t  modules;
+	uint32_t heapl;
+	uint32_t objcount;
+	uint32_t relocc;
+	uint32_t destructc;
+	uint32_t exec;
+	uint32_t padding;
+} ImageFileHeader;
+
+typedef struct {
+	uint64_t size;
+	uint32_t is_file;
+	uint32_t has_source;
+	uint32_t namel;
+	uint32_t bodyl;
+} ImageExecutableHeader;
+
+static void getLayout(int64_t layout[2])
+{
+	layout[0] = (char*) (uintptr_t) &Runtime_New - getAnchor();
+	layout[1] = (char*) bins_basic - getAnchor();
+}
+
+// Writes the padding that goes after [size] bytes.
+static bool writePadding(size_t size, FILE *fp)
+{
+	static const char zeros[8];
+	size_t padding = (8 - size % 8) % 8;
+	return fwrite(zeros, 1, padding, fp) == padding;
+}
+
+static bool writePadded(const void *data, size_t size, FILE *fp)
+{
+	return fwrite(data, 1, size, fp) == size
+		&& writePadding(size, fp);
+}
+
+bool RuntimeImage_Save(RuntimeImage *image, const char *file, Error *error)
+{
+	FILE *fp = fopen(file, "wb");
+	if (fp == NULL) {
+		Error_Report(error, ErrorType_INTERNAL, "Couldn't open \"%s\" (%s)", file, strerror(errno));
+		return false;
+	}
+
+	ImageFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, IMAGE_FILE_MAGIC, sizeof(header.magic));
+	header.version   = IMAGE_FILE_VERSION;
+	header.builtins  = image->builtins;
+	header.modules   = image->modules;
+	header.heapl     = image->heapl;
+	header.objcount  = image->objcount;
+	header.relocc    = image->relocc;
+	header.destructc = image->destructc;
+	header.exec      = image->exec;
+	getLayout(header.layout);
+
+	bool ok = writePadded(&header, sizeof(header), fp)
+		   && writePadded(image->heap, image->heapl, fp)
+		   && writePadded(image->relocs, image->relocc * sizeof(Reloc), fp)
+		   && writePadded(image->destructs, image->destructc * sizeof(uint32_t), fp);
+
+	for (int i = 0; ok && i < image->exec; i++) {
+
+		Executable *exe = image->exes[i];
+		Source *src = Executable_GetSource(exe);
+
+		const char *name = src ? Source_GetName(src) : NULL;
+		const char *body = src ? Source_GetBody(src) : NULL;
+
+		ImageExecutableHeader exe_header = {
+			.size  = Executable_GetWriteSize(exe),
+			.is_file = src && Source_GetAbsolutePath(src) != NULL,
+			.has_source = src != NULL,
+			.namel = name ? strlen(name) : 0,
+			.bodyl = src ? Source_GetSize(src) : 0,
+		};
+
+		ok = writePadded(&exe_header, sizeof(exe_header), fp)
+		  && Executable_Write(exe, fp, 0)
+		  && writePadding(exe_header.size, fp)
+		  && writePadded(name, exe_header.namel, fp)
+		  && writePadded(body, exe_header.bodyl, fp);
+	}
+
+	if (fclose(fp))
+		ok = false;
+
+	if (!ok) {
+		Error_Report(error, ErrorType_INTERNAL, "Couldn't write \"%s\"", file);
+		remove(file);
+		return false;
+	}
+	return true;
+}
+
+typedef struct {
+	char  *data;
+	size_t size;
+	size_t cursor;
+} Reader;
+
+// Returns a pointer to the next [size] bytes of the
+// file, skipping the padding after them, or NULL if
+// the file is too short.
+static void *readPadded(Reader *reader, size_t size)
+{
+	size_t padded = size + (8 - size % 8) % 8;
+	if (padded < size || reader->size - reader->cursor < padded)
+		return NULL;
+
+	void *ptr = reader->data + reader->cursor;
+	reader->cursor += padded;
+	return ptr;
+}
+
+static bool readExecutables(RuntimeImage *image, Reader *reader, Error *error)
+{
+	image->exes = malloc(image->exec * sizeof(Executable*));
+	if (image->exes == NULL && image->exec > 0) {
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		return false;
+	}
+
+	int count = image->exec;
+	image->exec = 0;
+
+	for (int i = 0; i < count; i++) {
+
+		ImageExecutableHeader *header = readPadded(reader, sizeof(ImageExecutableHeader));
+		if (header == NULL) {
+			Error_Report(error, ErrorType_INTERNAL, "Image is corrupted");
+			return false;
+		}
+
+		void *data = readPadded(reader, header->size);
+		char *name = readPadded(reader, header->namel);
+		char *body = readPadded(reader, header->bodyl);
+		if (data == NULL || name == NULL || body == NULL) {
+			Error_Report(error, ErrorType_INTERNAL, "Image is corrupted");
+			return false;
+		}
+
+		// The executable refers to the file's memory,
+		// so it's duplicated to outlive it.
+		Executable *exe = Executable_FromMemory(data, header->size, 0, error);
+		if (exe == NULL)
+			return false;
+
+		Executable *copy = Executable_Duplicate(exe, error);
+		Executable_Free(exe);
+		if (copy == NULL)
+			return false;
+
+		image->exes[image->exec++] = copy;
+
+		if (header->has_source) {
+
+			char namebuf[1024];
+			if (header->namel >= sizeof(namebuf)) {
+				Error_Report(error, ErrorType_INTERNAL, "Image is corrupted");
+				return false;
+			}
+			memcpy(namebuf, name, header->namel);
+			namebuf[header->namel] = '\0';
+
+			Source *src;
+			if (header->is_file)
+				src = Source_FromFileContents(namebuf, body, header->bodyl, error);
+			else
+				src = Source_FromString(namebuf, body, header->bodyl, error);
+			if (src == NULL)
+				return false;
+
+			bool ok = Executable_SetSource(copy, src);
+			Source_Free(src);
+			if (!ok) {
+				Error_Report(error, ErrorType_INTERNAL, "No memory");
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static bool readFile(const char *file, Reader *reader, Error *error)
+{
+	FILE *fp = fopen(file, "rb");
+	if (fp == NULL) {
+		Error_Report(error, ErrorType_INTERNAL, "Couldn't open \"%s\" (%s)", file, strerror(errno));
+		return false;
+	}
+
+	long size;
+	if (fseek(fp, 0, SEEK_END) || (size = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET)) {
+		Error_Report(error, ErrorType_INTERNAL, "Couldn't read \"%s\" (%s)", file, strerror(errno));
+		fclose(fp);
+		return false;
+	}
+
+	reader->data = malloc(size);
+	reader->size = size;
+	reader->cursor = 0;
+	if (reader->data == NULL && size > 0) {
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		fclose(fp);
+		return false;
+	}
+
+	if (fread(reader->data, 1, size, fp) != (size_t) size) {
+		Error_Report(error, ErrorType_INTERNAL, "Couldn't read \"%s\"", file);
+		free(reader->data);
+		fclose(fp);
+		return false;
+	}
+
+	fclose(fp);
+	return true;
+}
+
+static bool validateRelocations(RuntimeImage *image)
+{
+	for (int i = 0; i < image->relocc; i++) {
+		Reloc reloc = image->relocs[i];
+
+		if (reloc.offset % 8 != 0 || reloc.offset + sizeof(void*) > image->heapl)
+			return false;
+
+		switch (reloc.kind) {
+			case RELOC_HEAP: if (reloc.value >= image->heapl) return false; break;
+			case RELOC_STATIC: break;
+			case RELOC_RUNTIME: break;
+			case RELOC_EXECUTABLE: if (reloc.value >= (uint64_t) image->exec) return false; break;
+			case RELOC_EXESTRING:
+			if ((reloc.value >> 32) >= (uint64_t) image->exec
+				|| Executable_GetStringAtOffset(image->exes[reloc.value >> 32], reloc.value & 0xFFFFFFFF) == NULL)
+				return false;
+			break;
+			default: return false;
+		}
+	}
+
+	for (int i = 0; i < image->destructc; i++)
+		if (image->destructs[i] % 8 != 0 || image->destructs[i] >= image->heapl)
+			return false;
+
+	return image->builtins >= -1 && image->builtins < image->heapl
+		&& image->modules  >= -1 && image->modules  < image->heapl;
+}
+
+// NOTE: Images are trusted, since they hold pointers
+//       to the program. They're checked for obvious
+//       corruption only.
+RuntimeImage *RuntimeImage_Load(const char *file, Error *error)
+{
+	Reader reader;
+	if (!readFile(file, &reader, error))
+		return NULL;
+
+	ImageFileHeader *header = readPadded(&reader, sizeof(ImageFileHeader));
+	if (header == NULL || memcmp(header->magic, IMAGE_FILE_MAGIC, sizeof(header->magic))) {
+		Error_Report(error, ErrorType_INTERNAL, "\"%s\" isn't a runtime image", file);
+		free(reader.data);
+		return NULL;
+	}
+
+	int64_t layout[2];
+	getLayout(layout);
+
+	if (header->version != IMAGE_FILE_VERSION || memcmp(header->layout, layout, sizeof(layout))) {
+		Error_Report(error, ErrorType_INTERNAL, "\"%s\" was made by a different build of noja", file);
+		free(reader.data);
+		return NULL;
+	}
+
+	if (header->relocc > INT_MAX / sizeof(Reloc) || header->destructc > INT_MAX || header->exec > INT_MAX) {
+		Error_Report(error, ErrorType_INTERNAL, "\"%s\" is corrupted", file);
+		free(reader.data);
+		return NULL;
+	}
+
+	RuntimeImage *image = newImage(error);
+	if (image == NULL) {
+		free(reader.data);
+		return NULL;
+	}
+
+	image->heapl     = header->heapl;
+	image->objcount  = header->objcount;
+	image->builtins  = header->builtins;
+	image->modules   = header->modules;
+	image->relocc    = header->relocc;
+	image->destructc = header->destructc;
+	image->exec      = header->exec;
+
+	void *heap      = readPadded(&reader, image->heapl);
+	void *relocs    = readPadded(&reader, image->relocc * sizeof(Reloc));
+	void *destructs = readPadded(&reader, image->destructc * sizeof(uint32_t));
+
+	image->heap      = malloc(image->heapl);
+	image->relocs    = malloc(image->relocc * sizeof(Reloc));
+	image->destructs = malloc(image->destructc * sizeof(uint32_t));
+
+	// The counts are zeroed until the arrays are filled,
+	// so that the image can be freed at any point.
+	int exec = image->exec;
+	image->exec = 0;
+
+	if (heap == NULL || relocs == NULL || destructs == NULL) {
+		Error_Report(error, ErrorType_INTERNAL, "\"%s\" is corrupted", file);
+		RuntimeImage_Free(image);
+		free(reader.data);
+		return NULL;
+	}
+
+	if ((image->heap == NULL && image->heapl > 0) || (image->relocs == NULL && image->relocc > 0) || (image->destructs == NULL && image->destructc > 0)) {
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		RuntimeImage_Free(image);
+		free(reader.data);
+		return NULL;
+	}
+
+	memcpy(image->heap, heap, image->heapl);
+	memcpy(image->relocs, relocs, image->relocc * sizeof(Reloc));
+	memcpy(image->destructs, destructs, image->destructc * sizeof(uint32_t));
+
+	image->exec = exec;
+	if (!readExecutables(image, &reader, error)) {
+		RuntimeImage_Free(image);
+		free(reader.data);
+		return NULL;
+	}
+	free(reader.data);
+
+	if (!validateRelocations(image)) {
+		Error_Report(error, ErrorType_INTERNAL, "\"%s\" is corrupted", file);
+		RuntimeImage_Free(image);
+		return NULL;
+	}
+
+	// The image refers to the builtin tables, which must be
+	// initialized like a runtime plugging them would do.
+	bins_basic_init(bins_basic);
+	return image;
+}
@@ -0,0 +1,13 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+#include "runtime.h"
+
+typedef struct xRuntimeImage RuntimeImage;
+
+RuntimeImage *RuntimeImage_FromRuntime(Runtime *runtime, Error *error);
+RuntimeImage *RuntimeImage_Load(const char *file, Error *error);
+bool          RuntimeImage_Save(RuntimeImage *image, const char *file, Error *error);
+void          RuntimeImage_Free(RuntimeImage *image);
+Runtime      *Runtime_NewFromImage(RuntimeImage *image, RuntimeConfig config, Error *error);
+bool          Runtime_ResetFromImage(Runtime *runtime, RuntimeImage *image, Error *error);
+#endif
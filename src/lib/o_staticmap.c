@@ -60,14 +60,17 @@ typedef struct {
 static Object *select_(Object *self, Object *key, Heap *heap, Error *err);
 static Object *copy(Object *self, Heap *heap, Error *err);
 static int hash(Object *self);
+static void walkexterns(Object *self, void (*callback)(void **referer, ExternKind kind, void *userp), void *userp);
 
 static TypeObject t_staticmap = {
 	.base = (Object) { .type = &t_type, .flags = Object_STATIC },
 	.name = "static map",
 	.size = sizeof (StaticMapObject),
+	.immutable = true,
 	.copy = copy,
 	.hash = hash,
 	.select = select_,
+	.walkexterns = walkexterns,
 #warning "Need to walk the references"
 };
 
@@ -84,6 +87,13 @@ static int hash(Object *self)
 	return 0;
 }
 
+static void walkexterns(Object *self, void (*callback)(void **referer, ExternKind kind, void *userp), void *userp)
+{
+	StaticMapObject *map = (StaticMapObject*) self;
+	callback((void**) &map->runt, EXTERN_RUNTIME, userp);
+	callback((void**) &map->slots, EXTERN_STATIC, userp);
+}
+
 Object *Object_NewStaticMap(StaticMapSlot slots[], void (*initfn)(StaticMapSlot[]), Runtime *runt, Error *error)
 {
 	Heap *heap = Runtime_GetHeap(runt);
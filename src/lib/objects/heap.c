@@ -106,6 +106,7 @@ struct xHeap {
 	OflowAlloc *oflow;
 	PendingDestruct *pend;
 	int pend_size, pend_used;
+	HeapRegion *region;
 
 	_Bool collecting;
 	_Bool collection_failed;
@@ -136,6 +137,7 @@ Heap *Heap_New(int size)
 	heap->pend_size = 0;
 	heap->pend_used = 0;
 	heap->oflow = 0;
+	heap->region = NULL;
 	heap->collecting = 0;
 
 	if(heap->body == NULL)
@@ -151,13 +153,10 @@ Heap *Heap_New(int size)
 	return heap;
 }
 
-void Heap_Free(Heap *heap)
+// Calls the destructors of all objects and frees
+// the overflow allocations.
+static void destroyAll(Heap *heap)
 {
-
-#if USING_VALGRIND
-	VALGRIND_DESTROY_MEMPOOL(heap);
-#endif
-
 	Error error;
 	Error_Init(&error);
 
@@ -173,6 +172,7 @@ void Heap_Free(Heap *heap)
 			// Continue the loop..
 		}
 	}
+	heap->pend_used = 0;
 
 	while(heap->oflow)
 	{
@@ -180,7 +180,34 @@ void Heap_Free(Heap *heap)
 		free(heap->oflow);
 		heap->oflow = prev;
 	}
+}
+
+// Frees all objects at once, leaving the heap empty.
+void Heap_Reset(Heap *heap)
+{
+	assert(!heap->collecting);
+
+	destroyAll(heap);
+
+#if USING_VALGRIND
+	VALGRIND_DESTROY_MEMPOOL(heap);
+	VALGRIND_CREATE_MEMPOOL(heap, 0, 0);
+#endif
+
+	heap->used  = 0;
+	heap->total = 0;
+	heap->objcount = 0;
+	heap->region = NULL;
+}
+
+void Heap_Free(Heap *heap)
+{
+
+#if USING_VALGRIND
+	VALGRIND_DESTROY_MEMPOOL(heap);
+#endif
 
+	destroyAll(heap);
 	free(heap->pend);
 	free(heap->body);
 	free(heap);
@@ -206,48 +233,54 @@ float Heap_GetUsagePercentage(Heap *heap)
 	return 100.0 * heap->total / heap->size;
 }
 
-void *Heap_Malloc(Heap *heap, TypeObject *type, Error *err)
+// Makes sure there's room for one more object in the
+// list of objects with destructors.
+static bool reservePendingDestruct(Heap *heap, Error *err)
 {
-	_Bool requires_destruct = type->free != NULL;
-
-	if(requires_destruct)
+	if(heap->pend == NULL)
 	{
-		// This type of object requires
-		// a destructor to be called.
+		int n = 8;
+
+		heap->pend = malloc(n * sizeof(PendingDestruct));
+			
 		if(heap->pend == NULL)
 		{
-			int n = 8;
-
-			heap->pend = malloc(n * sizeof(PendingDestruct));
-				
-			if(heap->pend == NULL)
-			{
-				Error_Report(err, ErrorType_INTERNAL, "No memory");
-				return NULL;
-			}
-
-			heap->pend_used = 0;
-			heap->pend_size = n;
+			Error_Report(err, ErrorType_INTERNAL, "No memory");
+			return false;
 		}
-		else if(heap->pend_size == heap->pend_used)
-		{
-			int factor = 2;
 
-			void *new_pend = realloc(heap->pend, factor * heap->pend_size * sizeof(PendingDestruct));
+		heap->pend_used = 0;
+		heap->pend_size = n;
+	}
+	else if(heap->pend_size == heap->pend_used)
+	{
+		int factor = 2;
 
-			if(new_pend == NULL)
-			{
-				Error_Report(err, ErrorType_INTERNAL, "No memory");
-				return NULL;
-			}
+		void *new_pend = realloc(heap->pend, factor * heap->pend_size * sizeof(PendingDestruct));
 
-			heap->pend = new_pend;
-			heap->pend_size *= factor;
+		if(new_pend == NULL)
+		{
+			Error_Report(err, ErrorType_INTERNAL, "No memory");
+			return false;
 		}
 
-		assert(heap->pend_size > heap->pend_used);
+		heap->pend = new_pend;
+		heap->pend_size *= factor;
 	}
 
+	assert(heap->pend_size > heap->pend_used);
+	return true;
+}
+
+void *Heap_Malloc(Heap *heap, TypeObject *type, Error *err)
+{
+	_Bool requires_destruct = type->free != NULL;
+
+	// This type of object requires
+	// a destructor to be called.
+	if(requires_destruct && !reservePendingDestruct(heap, err))
+		return NULL;
+
 	int size = type->size;
 
 	if(size < (int) sizeof(MovedObject))
@@ -277,6 +310,54 @@ void *Heap_Malloc(Heap *heap, TypeObject *type, Error *err)
 	return (Object*) addr;
 }
 
+unsigned int Heap_GetUsedSize(Heap *heap)
+{
+	return heap->used;
+}
+
+// Fills an empty heap with the memory of another one, 
+// which was stored in an image. The pointers held by
+// the objects need to be fixed by the caller, which
+// must also track the objects with destructors.
+bool Heap_LoadImage(Heap *heap, const void *data, unsigned int size, unsigned int objcount, Error *err)
+{
+	assert(heap->used == 0 && heap->oflow == NULL);
+
+	if(size > (unsigned int) heap->size)
+	{
+		Error_Report(err, ErrorType_INTERNAL, "Heap is too small for the image (%u bytes are needed)", size);
+		return false;
+	}
+
+	memcpy(heap->body, data, size);
+	heap->used  = size;
+	heap->total = size;
+	heap->objcount = objcount;
+
+#if USING_VALGRIND
+	VALGRIND_MEMPOOL_ALLOC(heap, heap->body, size);
+#endif
+
+	return true;
+}
+
+bool Heap_TrackDestructor(Heap *heap, Object *obj, Error *err)
+{
+	assert(obj->type->free != NULL);
+
+	if(!reservePendingDestruct(heap, err))
+		return false;
+
+	heap->pend[heap->pend_used++] = (PendingDestruct) { .object = obj, .destructor = obj->type->free };
+	return true;
+}
+
+static void markRegionsEscaped(Heap *heap)
+{
+	for(HeapRegion *region = heap->region; region != NULL; region = region->prev)
+		region->escaped = 1;
+}
+
 void *Heap_RawMalloc(Heap *heap, int size, Error *err)
 {
 	assert(err);
@@ -300,6 +381,11 @@ void *Heap_RawMalloc(Heap *heap, int size, Error *err)
 			return NULL;
 		}
 		
+		// Overflow allocations can't be told apart
+		// by their address, so regions can't track
+		// them.
+		markRegionsEscaped(heap);
+
 		OflowAlloc *oflow = malloc(sizeof(OflowAlloc) + size);
 		
 		if(oflow == 0)
@@ -332,6 +418,10 @@ _Bool Heap_StartCollection(Heap *heap, Error *error)
 {
 	assert(heap->collecting == 0);
 
+	// The objects of the open regions are going to be
+	// mixed with the older ones.
+	markRegionsEscaped(heap);
+
 	void *new_body = malloc(heap->size);
 
 	if(new_body == NULL)
@@ -527,4 +617,237 @@ void Heap_CollectReference(Object **referer, void *userp)
 		// Update the referer
 		*referer = new_location;
 	}
-}
\ No newline at end of file
+}
+/* Regions
+** =======
+** A region lets the caller release all of the objects
+** allocated since it was opened at once, which is what
+** happens to the objects allocated while handling a
+** request, without waiting for a collection to copy
+** the ones that are still alive.
+**
+** Since the allocator bumps a pointer, the objects of
+** a region are the ones after the position it had when
+** the region was opened. Closing the region moves that
+** position back, after moving the objects that are still
+** needed (the ones the caller passes to [Heap_CloseRegion]
+** and the ones they refer to) at its start. This works
+** only if no object older than the region refers to its
+** objects, which would be left dangling. Objects are
+** only changed through a few functions, which call 
+** [Heap_WriteBarrier] on them, so when an older object
+** changes while a region is open, the region is marked
+** as escaped and closing it releases nothing. The same
+** happens if a collection runs or memory is allocated
+** outside of the heap's body while the region is open.
+** In all of these cases the objects of the region simply
+** become normal objects, which are freed by collections.
+**
+** The caller must make sure that the objects of the
+** region aren't referenced by roots that aren't passed
+** to [Heap_CloseRegion], like the runtime's stack.
+**
+** Regions can be nested but must be closed in the reverse
+** order of opening.
+*/
+
+void Heap_OpenRegion(Heap *heap, HeapRegion *region)
+{
+	assert(!heap->collecting);
+	region->prev = heap->region;
+	region->used = heap->used;
+	region->total = heap->total;
+	region->objcount = heap->objcount;
+	region->pend_used = heap->pend_used;
+	region->escaped = 0;
+	heap->region = region;
+}
+
+bool Heap_IsInRegion(Heap *heap, HeapRegion *region, void *ptr)
+{
+	char *body = heap->body;
+	char *addr = ptr;
+	return addr >= body + region->used && addr < body + heap->used;
+}
+
+// Must be called before changing an object allocated
+// outside of a region to refer to something else.
+void Heap_WriteBarrier(Heap *heap, Object *obj)
+{
+	for(HeapRegion *region = heap->region; region != NULL; region = region->prev)
+	{
+		if(Heap_IsInRegion(heap, region, obj))
+			break; // Then it's also in the outer ones.
+		region->escaped = 1;
+	}
+}
+
+typedef struct {
+	Heap *heap;
+	HeapRegion *region;
+	char *temp;
+	int   temp_used;
+	int   start;
+	int   moved;
+} Promotion;
+
+// Reserves space for a moved object in the temporary
+// buffer and returns the address it will have when the
+// buffer is copied back to the heap.
+static void *promoteMalloc(Promotion *prom, int size, void **final)
+{
+	void *addr = prom->temp + prom->temp_used;
+	*final = (char*) prom->heap->body + prom->start + prom->temp_used;
+	prom->temp_used += (size + 7) & ~7;
+	return addr;
+}
+
+static void promoteExtension(void **referer, unsigned int size, void *userp)
+{
+	Promotion *prom = userp;
+	void *old_location = *referer;
+
+	if(old_location == NULL || !Heap_IsInRegion(prom->heap, prom->region, old_location))
+		return;
+
+	void *new_location;
+	void *copy = promoteMalloc(prom, size, &new_location);
+	memcpy(copy, old_location, size);
+	*referer = new_location;
+}
+
+// Works like [Heap_CollectReference], but only moves 
+// the objects of the region. The objects are copied in
+// a temporary buffer and their references are set to 
+// the address they will have when it's copied back.
+static void promoteReference(Object **referer, void *userp)
+{
+	Promotion *prom = userp;
+	Object *old_location = *referer;
+
+	if(old_location == NULL || !Heap_IsInRegion(prom->heap, prom->region, old_location))
+		return;
+
+	if(old_location->flags & Object_MOVED)
+	{
+		*referer = ((MovedObject*) old_location)->new_location;
+		return;
+	}
+
+	int size = old_location->type->size;
+
+	Object *new_location;
+	Object *copy = promoteMalloc(prom, size, (void**) &new_location);
+	memcpy(copy, old_location, size);
+
+	old_location->flags |= Object_MOVED;
+	assert((int) sizeof(MovedObject) <= size);
+	((MovedObject*) old_location)->new_location = new_location;
+	prom->moved += 1;
+
+	*referer = new_location;
+
+	if((Object*) copy->type != old_location)
+		promoteReference((Object**) &copy->type, prom);
+
+	// The references are walked before moving the
+	// extensions, since the copy refers to the old
+	// ones until then. The references stored in the 
+	// old extensions are updated in place and then
+	// copied with them.
+	Object_WalkReferences(copy, promoteReference, prom);
+	Object_WalkExtensions(copy, promoteExtension, prom);
+}
+
+// Closes the last region that was opened. The [objs]
+// are the objects that need to outlive the region and
+// are updated with their new location. Returns true if
+// the memory of the region was released.
+bool Heap_CloseRegion(Heap *heap, HeapRegion *region, Object **objs, int count)
+{
+	assert(heap->region == region);
+	assert(!heap->collecting);
+
+	heap->region = region->prev;
+
+	if(region->escaped)
+	{
+		// The objects of the region are now part of
+		// the enclosing one.
+		if(heap->region != NULL)
+			heap->region->escaped = 1;
+		return 0;
+	}
+
+	// All of the objects of the region are after
+	// [start], since allocations are aligned.
+	int start = (region->used + 7) & ~7;
+
+	Promotion prom = {
+		.heap = heap,
+		.region = region,
+		.temp = NULL,
+		.temp_used = 0,
+		.start = start,
+		.moved = 0,
+	};
+
+	if(count > 0 && heap->used > start)
+	{
+		// Each object takes at least its size rounded up
+		// to 8 in the heap, except for the last one, so
+		// the moved ones fit in the same space plus 8.
+		if(heap->size - heap->used < 8)
+			return 0;
+
+		prom.temp = malloc(heap->used - start + 8);
+		if(prom.temp == NULL)
+			return 0;
+
+		for(int i = 0; i < count; i += 1)
+			promoteReference(&objs[i], &prom);
+	}
+
+	// Destroy the objects of the region that weren't 
+	// moved and update the location of the others.
+	Error error;
+	Error_Init(&error);
+
+	int i = region->pend_used;
+	while(i < heap->pend_used)
+	{
+		Object *obj = heap->pend[i].object;
+
+		if(obj->flags & Object_MOVED)
+		{
+			heap->pend[i].object = ((MovedObject*) obj)->new_location;
+			i += 1;
+		}
+		else
+		{
+			heap->pend[i].destructor(obj, &error);
+			if(error.occurred)
+			{
+				// Like when freeing the heap, there's
+				// nothing we can do about it.
+				Error_Free(&error);
+				Error_Init(&error);
+			}
+			heap->pend[i] = heap->pend[heap->pend_used-1];
+			heap->pend_used -= 1;
+		}
+	}
+
+	if(prom.temp != NULL)
+	{
+		memcpy((char*) heap->body + start, prom.temp, prom.temp_used);
+		free(prom.temp);
+		heap->used = start + prom.temp_used;
+	}
+	else
+		heap->used = region->used;
+
+	heap->total = region->total + (heap->used - region->used);
+	heap->objcount = region->objcount + prom.moved;
+	return 1;
+}
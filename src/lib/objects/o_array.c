@@ -0,0 +1,434 @@
+
+/* +--------------------------------------------------------------------------+
+** |                          _   _       _                                   |
+** |                         | \ | |     (_)                                  |
+** |                         |  \| | ___  _  __ _                             |
+** |                         | . ` |/ _ \| |/ _` |                            |
+** |                         | |\  | (_) | | (_| |                            |
+** |                         |_| \_|\___/| |\__,_|                            |
+** |                                    _/ |                                  |
+** |                                   |__/                                   |
+** +--------------------------------------------------------------------------+
+** | Copyright (c) 2022 Francesco Cozzuto <francesco.cozzuto@gmail.com>       |
+** +--------------------------------------------------------------------------+
+** | This file is part of The Noja Interpreter.                               |
+** |                                                                          |
+** | The Noja Interpreter is free software: you can redistribute it and/or    |
+** | modify it under the terms of the GNU General Public License as published |
+** | by the Free Software Foundation, either version 3 of the License, or (at |
+** | your option) any later version.                                          |
+** |                                                                          |
+** | The Noja Interpreter is distributed in the hope that it will be useful,  |
+** | but WITHOUT ANY WARRANTY; without even the implied warranty of           |
+** | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General |
+** | Public License for more details.                                         |
+** |                                                                          |
+** | You should have received a copy of the GNU General Public License along  |
+** | with The Noja Interpreter. If not, see <http://www.gnu.org/licenses/>.   |
+** +--------------------------------------------------------------------------+ 
+*/
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "objects.h"
+#include "../defs.h"
+#include "../utils/defs.h"
+
+/* Arrays hold numbers of a single kind unboxed and
+** contiguously, so that a million samples take 8MB
+** instead of a list of pointers to a million objects.
+**
+** The storage is malloc'd outside of the heap (like
+** buffers do) so that the collector doesn't have to
+** move it around, and is reference counted so that
+** slices can share it with the array they come from.
+*/
+
+typedef union {
+	long long int as_int;
+	double        as_float;
+} Element;
+
+typedef struct {
+	size_t refs, capacity;
+	Element items[];
+} Payload;
+
+typedef struct {
+	Object base;
+	Payload *payload;
+	size_t offset, length;
+} ArrayObject;
+
+static Object *select_(Object *self, Object *key, Heap *heap, Error *error);
+static bool    insert(Object *self, Object *key, Object *val, Heap *heap, Error *error);
+static int     count(Object *self);
+static void    print(Object *self, FILE *fp);
+static bool    free_(Object *self, Error *error);
+static Object *copy(Object *self, Heap *heap, Error *error);
+static Object *keysof(Object *self, Heap *heap, Error *error);
+
+static TypeObject t_intarray = {
+	.base = (Object) { .type = &t_type, .flags = Object_STATIC },
+	.name = TYPENAME_INTARRAY,
+	.size = sizeof(ArrayObject),
+	.copy = copy,
+	.select = select_,
+	.insert = insert,
+	.count = count,
+	.print = print,
+	.free  = free_,
+	.keysof = keysof,
+};
+
+static TypeObject t_floatarray = {
+	.base = (Object) { .type = &t_type, .flags = Object_STATIC },
+	.name = TYPENAME_FLOATARRAY,
+	.size = sizeof(ArrayObject),
+	.copy = copy,
+	.select = select_,
+	.insert = insert,
+	.count = count,
+	.print = print,
+	.free  = free_,
+	.keysof = keysof,
+};
+
+TypeObject *Object_GetIntArrayType()
+{
+	return &t_intarray;
+}
+
+TypeObject *Object_GetFloatArrayType()
+{
+	return &t_floatarray;
+}
+
+bool Object_IsIntArray(Object *obj)
+{
+	return Object_GetType(obj) == &t_intarray;
+}
+
+bool Object_IsFloatArray(Object *obj)
+{
+	return Object_GetType(obj) == &t_floatarray;
+}
+
+static bool isArray(Object *obj)
+{
+	return Object_IsIntArray(obj) || Object_IsFloatArray(obj);
+}
+
+static Payload *newPayload(size_t capacity, Error *error)
+{
+	if(capacity > (SIZE_MAX - sizeof(Payload)) / sizeof(Element))
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Array is too big");
+		return NULL;
+	}
+
+	Payload *payload = malloc(sizeof(Payload) + capacity * sizeof(Element));
+	if(payload == NULL)
+	{
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		return NULL;
+	}
+	payload->refs = 1;
+	payload->capacity = capacity;
+	return payload;
+}
+
+static Object *newArray(TypeObject *type, size_t length, Heap *heap, Error *error)
+{
+	ArrayObject *obj = (ArrayObject*) Heap_Malloc(heap, type, error);
+	if(obj == NULL)
+		return NULL;
+
+	// The object is allocated first so that if
+	// the payload can't be, it's left as a valid
+	// empty array that can be freed normally.
+	obj->payload = NULL;
+	obj->offset = 0;
+	obj->length = 0;
+
+	Payload *payload = newPayload(length, error);
+	if(payload == NULL)
+		return NULL;
+	memset(payload->items, 0, length * sizeof(Element));
+
+	obj->payload = payload;
+	obj->length = length;
+	return (Object*) obj;
+}
+
+Object *Object_NewIntArray(size_t length, Heap *heap, Error *error)
+{
+	return newArray(&t_intarray, length, heap, error);
+}
+
+Object *Object_NewFloatArray(size_t length, Heap *heap, Error *error)
+{
+	return newArray(&t_floatarray, length, heap, error);
+}
+
+static Element *getElements(Object *obj, size_t *length)
+{
+	ArrayObject *array = (ArrayObject*) obj;
+	if(length) *length = array->length;
+	if(array->payload == NULL)
+		return NULL;
+	return array->payload->items + array->offset;
+}
+
+long long int *Object_GetIntArray(Object *obj, size_t *length)
+{
+	if(!Object_IsIntArray(obj))
+	{
+		Error_Panic("Not an " TYPENAME_INTARRAY);
+		return NULL;
+	}
+	// Element is a union so its items can
+	// be viewed as a plain array of its
+	// members.
+	return (long long int*) getElements(obj, length);
+}
+
+double *Object_GetFloatArray(Object *obj, size_t *length)
+{
+	if(!Object_IsFloatArray(obj))
+	{
+		Error_Panic("Not a " TYPENAME_FLOATARRAY);
+		return NULL;
+	}
+	return (double*) getElements(obj, length);
+}
+
+Object *Object_SliceArray(Object *obj, size_t offset, size_t length, Heap *heap, Error *error)
+{
+	if(!isArray(obj))
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Not an " TYPENAME_INTARRAY " or " TYPENAME_FLOATARRAY);
+		return NULL;
+	}
+
+	ArrayObject *array = (ArrayObject*) obj;
+
+	if(offset > array->length || length > array->length - offset)
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Slice out of range");
+		return NULL;
+	}
+
+	ArrayObject *slice = (ArrayObject*) Heap_Malloc(heap, obj->type, error);
+	if(slice == NULL)
+		return NULL;
+
+	if(array->payload != NULL)
+		array->payload->refs++;
+	slice->payload = array->payload;
+	slice->offset = array->offset + offset;
+	slice->length = length;
+	return (Object*) slice;
+}
+
+// Makes it possible to append one more element
+// to the array. If the payload is shared with a
+// slice, the array gets a copy of its own so that
+// the append doesn't overwrite the slice's view.
+static bool makeRoomForOneMore(ArrayObject *array, Error *error)
+{
+	Payload *payload = array->payload;
+
+	if(payload != NULL && payload->refs == 1 && array->offset + array->length < payload->capacity)
+		return true;
+
+	size_t capacity = array->length < 8 ? 8 : array->length * 2;
+
+	if(payload != NULL && payload->refs == 1)
+	{
+		capacity += array->offset;
+		if(capacity > (SIZE_MAX - sizeof(Payload)) / sizeof(Element))
+		{
+			Error_Report(error, ErrorType_RUNTIME, "Array is too big");
+			return false;
+		}
+		Payload *grown = realloc(payload, sizeof(Payload) + capacity * sizeof(Element));
+		if(grown == NULL)
+		{
+			Error_Report(error, ErrorType_INTERNAL, "No memory");
+			return false;
+		}
+		grown->capacity = capacity;
+		array->payload = grown;
+		return true;
+	}
+
+	Payload *detached = newPayload(capacity, error);
+	if(detached == NULL)
+		return false;
+
+	if(payload != NULL)
+	{
+		memcpy(detached->items, payload->items + array->offset, array->length * sizeof(Element));
+		payload->refs--;
+	}
+
+	array->payload = detached;
+	array->offset = 0;
+	return true;
+}
+
+static bool free_(Object *self, Error *error)
+{
+	UNUSED(error);
+
+	ArrayObject *array = (ArrayObject*) self;
+
+	Payload *payload = array->payload;
+	if(payload != NULL)
+	{
+		ASSERT(payload->refs > 0);
+		payload->refs--;
+		if(payload->refs == 0)
+			free(payload);
+	}
+	return 1;
+}
+
+static Object *copy(Object *self, Heap *heap, Error *error)
+{
+	size_t length;
+	Element *items = getElements(self, &length);
+
+	Object *copied = newArray((TypeObject*) self->type, length, heap, error);
+	if(copied == NULL)
+		return NULL;
+
+	if(length > 0)
+		memcpy(getElements(copied, NULL), items, length * sizeof(Element));
+	return copied;
+}
+
+static Object *select_(Object *self, Object *key, Heap *heap, Error *error)
+{
+	ASSERT(self != NULL);
+	ASSERT(key != NULL);
+	ASSERT(heap != NULL);
+	ASSERT(error != NULL);
+
+	if(!Object_IsInt(key))
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Non integer key");
+		return NULL;
+	}
+
+	long long int idx = Object_GetInt(key);
+
+	size_t length;
+	Element *items = getElements(self, &length);
+
+	if(idx < 0 || (size_t) idx >= length)
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Index out of range");
+		return NULL;
+	}
+
+	if(self->type == &t_intarray)
+		return Object_FromInt(items[idx].as_int, heap, error);
+	else
+		return Object_FromFloat(items[idx].as_float, heap, error);
+}
+
+static bool insert(Object *self, Object *key, Object *val, Heap *heap, Error *error)
+{
+	UNUSED(heap);
+	ASSERT(self != NULL);
+	ASSERT(key != NULL);
+	ASSERT(val != NULL);
+	ASSERT(error != NULL);
+
+	ArrayObject *array = (ArrayObject*) self;
+
+	if(!Object_IsInt(key))
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Non integer key");
+		return 0;
+	}
+
+	Element elem;
+	if(self->type == &t_intarray)
+	{
+		if(!Object_IsInt(val))
+		{
+			Error_Report(error, ErrorType_RUNTIME, "Non integer value");
+			return 0;
+		}
+		elem.as_int = Object_GetInt(val);
+	}
+	else
+	{
+		// Ints are widened to floats like the
+		// arithmetic operators do.
+		if(Object_IsInt(val))
+			elem.as_float = Object_GetInt(val);
+		else if(Object_IsFloat(val))
+			elem.as_float = Object_GetFloat(val);
+		else
+		{
+			Error_Report(error, ErrorType_RUNTIME, "Non numeric value");
+			return 0;
+		}
+	}
+
+	long long int idx = Object_GetInt(key);
+
+	// Inserting right after the last element
+	// appends, like it does for lists.
+	if(idx < 0 || (size_t) idx > array->length)
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Index out of range");
+		return 0;
+	}
+
+	if((size_t) idx == array->length)
+	{
+		if(!makeRoomForOneMore(array, error))
+			return 0;
+		array->length++;
+	}
+
+	getElements(self, NULL)[idx] = elem;
+	return 1;
+}
+
+static int count(Object *self)
+{
+	return ((ArrayObject*) self)->length;
+}
+
+static void print(Object *self, FILE *fp)
+{
+	size_t length;
+	Element *items = getElements(self, &length);
+
+	fprintf(fp, "[");
+	for(size_t i = 0; i < length; i += 1)
+	{
+		if(self->type == &t_intarray)
+			fprintf(fp, "%lld", items[i].as_int);
+		else
+			fprintf(fp, "%2.2f", items[i].as_float);
+
+		if(i+1 < length)
+			fprintf(fp, ", ");
+	}
+	fprintf(fp, "]");
+}
+
+static Object *keysof(Object *self, Heap *heap, Error *error)
+{
+	int length = count(self);
+	return Object_NewRange(0, length, 1, heap, error);
+}
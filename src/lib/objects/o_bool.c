@@ -42,6 +42,7 @@ static TypeObject t_bool = {
 	.base = (Object) { .type = &t_type, .flags = Object_STATIC },
 	.name = TYPENAME_BOOL,
 	.size = sizeof(Object),
+	.immutable = true,
 	.hash = hash,
 	.copy = copy,
 	.print = print,
@@ -298,5 +298,5 @@ keysof(Object *self,
 {
 	BufferObject *buffer = (BufferObject*) self;
 	int count = buffer->length;
-	return Object_NewListOfConsecutiveIntegers(0, count-1, heap, error);
+	return Object_NewRange(0, count, 1, heap, error);
 }
\ No newline at end of file
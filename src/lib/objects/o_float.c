@@ -48,6 +48,7 @@ static TypeObject t_float = {
 	.base = (Object) { .type = &t_type, .flags = Object_STATIC },
 	.name = TYPENAME_FLOAT,
 	.size = sizeof (FloatObject),
+	.immutable = true,
 	.hash = hash,
 	.copy = copy,
 	.print = print,
@@ -48,6 +48,7 @@ static TypeObject t_int = {
 	.base = (Object) { .type = &t_type, .flags = Object_STATIC },
 	.name = TYPENAME_INT,
 	.size = sizeof(IntObject),
+	.immutable = true,
 	.hash = hash,
 	.copy = copy,
 	.print = print,
@@ -0,0 +1,233 @@
+
+/* +--------------------------------------------------------------------------+
+** |                          _   _       _                                   |
+** |                         | \ | |     (_)                                  |
+** |                         |  \| | ___  _  __ _                             |
+** |                         | . ` |/ _ \| |/ _` |                            |
+** |                         | |\  | (_) | | (_| |                            |
+** |                         |_| \_|\___/| |\__,_|                            |
+** |                                    _/ |                                  |
+** |                                   |__/                                   |
+** +--------------------------------------------------------------------------+
+** | Copyright (c) 2022 Francesco Cozzuto <francesco.cozzuto@gmail.com>       |
+** +--------------------------------------------------------------------------+
+** | This file is part of The Noja Interpreter.                               |
+** |                                                                          |
+** | The Noja Interpreter is free software: you can redistribute it and/or    |
+** | modify it under the terms of the GNU General Public License as published |
+** | by the Free Software Foundation, either version 3 of the License, or (at |
+** | your option) any later version.                                          |
+** |                                                                          |
+** | The Noja Interpreter is distributed in the hope that it will be useful,  |
+** | but WITHOUT ANY WARRANTY; without even the implied warranty of           |
+** | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General |
+** | Public License for more details.                                         |
+** |                                                                          |
+** | You should have received a copy of the GNU General Public License along  |
+** | with The Noja Interpreter. If not, see <http://www.gnu.org/licenses/>.   |
+** +--------------------------------------------------------------------------+ 
+*/
+
+
+#include "objects.h"
+#include "../utils/defs.h"
+#include "../utils/utf8.h"
+#include "../defs.h"
+
+/* Iterators are the cursors used by for loops.
+**
+** Lists, maps, strings and buffers are iterated
+** natively, reading their items in place. Any other
+** collection is iterated by selecting the keys that
+** [keysof] returns for it, which are stored in [keys].
+**
+** The [index] is the position of the next item, which
+** is its key for everything but maps. For strings, the
+** byte offset of the next character is in [offset].
+**
+** Adding or removing keys of a map moves its items,
+** so when the iterated collection is a map or a view
+** of one, the [map] and its [version] are stored when
+** the iteration starts and the iterator fails if the
+** version changes. Values may still be overwritten.
+*/
+
+typedef struct {
+	Object base;
+	Object *set;
+	Object *keys;
+	Object *map;
+	unsigned int version;
+	int index;
+	int offset;
+} IteratorObject;
+
+static void walk(Object *self, void (*callback)(Object **referer, void *userp), void *userp);
+
+static TypeObject t_iterator = {
+	.base = (Object) { .type = &t_type, .flags = Object_STATIC },
+	.name = TYPENAME_ITERATOR,
+	.size = sizeof(IteratorObject),
+	.walk = walk,
+};
+
+static void walk(Object *self, void (*callback)(Object **referer, void *userp), void *userp)
+{
+	IteratorObject *iter = (IteratorObject*) self;
+
+	callback(&iter->set, userp);
+	if(iter->keys != NULL)
+		callback(&iter->keys, userp);
+	if(iter->map != NULL)
+		callback(&iter->map, userp);
+}
+
+static bool isNative(Object *set)
+{
+	return Object_IsList(set) 
+		|| Object_IsMap(set) 
+		|| Object_IsString(set) 
+		|| Object_IsBuffer(set);
+}
+
+Object *Object_NewIterator(Object *set, Heap *heap, Error *error)
+{
+	Object *keys = NULL;
+	if(!isNative(set))
+	{
+		if(set->type->keysof == NULL)
+		{
+			Error_Report(error, ErrorType_RUNTIME, "Can't iterate over a %s", Object_GetName(set));
+			return NULL;
+		}
+
+		keys = Object_KeysOf(set, heap, error);
+		if(keys == NULL)
+			return NULL;
+	}
+
+	IteratorObject *iter = (IteratorObject*) Heap_Malloc(heap, &t_iterator, error);
+	if(iter == NULL)
+		return NULL;
+
+	Object *map = NULL;
+	if(Object_IsMap(set))
+		map = set;
+	else if(Object_IsMapView(set))
+		map = Object_GetViewedMap(set);
+
+	iter->set = set;
+	iter->keys = keys;
+	iter->map = map;
+	iter->version = map ? Object_GetMapVersion(map) : 0;
+	iter->index = 0;
+	iter->offset = 0;
+	return (Object*) iter;
+}
+
+// Stores the next item into [val] and its key into [key]
+// (if it's not NULL) and moves the iterator forward. It
+// returns 1 if there was an item, 0 if there were no more
+// items and -1 if an error occurred.
+//
+// The items are read when the iterator reaches them, so
+// changes to the collection made while iterating over it
+// are seen. Maps are the exception: adding or removing
+// their keys while iterating over them is an error.
+int Object_NextFromIterator(Object *self, Object **key, Object **val, Heap *heap, Error *error)
+{
+	if(self->type != &t_iterator)
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Not an " TYPENAME_ITERATOR);
+		return -1;
+	}
+
+	IteratorObject *iter = (IteratorObject*) self;
+	Object *set = iter->set;
+
+	if(iter->map != NULL && Object_GetMapVersion(iter->map) != iter->version)
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Keys of the map changed while iterating over it");
+		return -1;
+	}
+
+	if(Object_IsMap(set))
+		return Object_NextMapItem(set, &iter->index, key, val) ? 1 : 0;
+
+	if(Object_IsList(set))
+	{
+		int count;
+		Object **items = Object_GetListItems(set, &count);
+
+		if(iter->index >= count)
+			return 0;
+
+		*val = items[iter->index];
+	}
+	else if(Object_IsString(set))
+	{
+		size_t size;
+		const char *body = Object_GetString(set, &size);
+
+		if((size_t) iter->offset >= size)
+			return 0;
+
+		int len = utf8_sequence_to_utf32_codepoint(body + iter->offset, size - iter->offset, NULL);
+		ASSERT(len > 0);
+
+		*val = Object_FromString(body + iter->offset, len, heap, error);
+		if(*val == NULL)
+			return -1;
+
+		iter->offset += len;
+	}
+	else if(Object_IsBuffer(set))
+	{
+		size_t size;
+		unsigned char *bytes = Object_GetBuffer(set, &size);
+
+		if((size_t) iter->index >= size)
+			return 0;
+
+		*val = Object_FromInt(bytes[iter->index], heap, error);
+		if(*val == NULL)
+			return -1;
+	}
+	else
+	{
+		ASSERT(iter->keys != NULL);
+
+		int count = Object_Count(iter->keys, error);
+		if(error->occurred)
+			return -1;
+
+		if(iter->index >= count)
+			return 0;
+
+		Object *idx = Object_FromInt(iter->index, heap, error);
+		if(idx == NULL)
+			return -1;
+
+		Object *k = Object_Select(iter->keys, idx, heap, error);
+		if(k == NULL)
+			return -1;
+
+		*val = Object_Select(set, k, heap, error);
+		if(*val == NULL)
+			return -1;
+
+		iter->index += 1;
+		if(key) *key = k;
+		return 1;
+	}
+
+	if(key)
+	{
+		*key = Object_FromInt(iter->index, heap, error);
+		if(*key == NULL)
+			return -1;
+	}
+
+	iter->index += 1;
+	return 1;
+}
@@ -33,11 +33,32 @@
 #include "../utils/defs.h"
 #include "../defs.h"
 
-typedef struct {
+// Copies of lists whose items are all shareable (see
+// [Object_IsShareable]) are copy-on-write. The items of
+// the copied list are moved to a hidden list, the 
+// [backing], which is never modified and is shared by
+// the original and the copy. A list with a backing has
+// no items of its own and forwards reads to it. On the
+// first write, it takes back the array of the backing,
+// or a copy of it if other lists still share it.
+//
+// The [sharers] of a backing are the lists that refer
+// to it. Lists that are collected don't decrement it,
+// so it may be higher than the real count, which only
+// causes a copy that could have been avoided.
+//
+// When an item that's not shareable is inserted, the
+// list is marked as [nested] and its copies are deep.
+
+typedef struct ListObject ListObject;
+struct ListObject {
 	Object base;
 	int capacity, count;
 	Object **vals;
-} ListObject;
+	ListObject *backing;
+	int sharers;
+	bool nested;
+};
 
 static Object *select_(Object *self, Object *key, Heap *heap, Error *err);
 static _Bool   insert(Object *self, Object *key, Object *val, Heap *heap, Error *err);
@@ -50,6 +71,8 @@ static int hash(Object *self);
 static bool istypeof(Object *self, Object *other, Heap *heap, Error *error);
 static Object* keysof(Object *self, Heap *heap, Error  *error);
 
+static _Bool unshare(ListObject *list, Heap *heap, Error *error);
+
 static TypeObject t_list = {
 	.base = (Object) { .type = &t_type, .flags = Object_STATIC },
 	.name = TYPENAME_LIST,
@@ -66,13 +89,19 @@ static TypeObject t_list = {
 	.walkexts = walkexts,
 };
 
+// Returns the list that holds the items of [list].
+static inline ListObject *resolve(ListObject *list)
+{
+	return list->backing ? list->backing : list;
+}
+
 static bool 
 istypeof(Object *self, 
          Object *other,
          Heap   *heap,
          Error  *error)
 {
-    ListObject *list = (ListObject*) self;
+    ListObject *list = resolve((ListObject*) self);
     if (!Object_IsList(other))
         return false;
 
@@ -99,9 +128,9 @@ keysof(Object *self,
 	   Heap   *heap, 
 	   Error  *error)
 {
-	ListObject *list = (ListObject*) self;
+	ListObject *list = resolve((ListObject*) self);
 	int count = list->count;
-	return Object_NewListOfConsecutiveIntegers(0, count-1, heap, error);
+	return Object_NewRange(0, count, 1, heap, error);
 }
 
 static int hash(Object *self)
@@ -109,7 +138,7 @@ static int hash(Object *self)
 	ASSERT(self != NULL);
 	ASSERT(self->type == &t_list);
 
-	ListObject *ls = (ListObject*) self;
+	ListObject *ls = resolve((ListObject*) self);
 
 	int h = 0;
 	// The hash is the sum of the nested
@@ -121,12 +150,98 @@ static int hash(Object *self)
 	return h;
 }
 
+static ListObject *newView(ListObject *backing, Heap *heap, Error *error)
+{
+	ListObject *view = (ListObject*) Heap_Malloc(heap, &t_list, error);
+	if(view == NULL)
+		return NULL;
+
+	view->count = 0;
+	view->capacity = 0;
+	view->vals = NULL;
+	view->backing = backing;
+	view->sharers = 0;
+	view->nested = 0;
+	backing->sharers += 1;
+	return view;
+}
+
+// Makes a list that shares the items of [ls], which
+// must not be nested. If [ls] has no backing yet, its
+// items are moved to a new one.
+static Object *share(ListObject *ls, Heap *heap, Error *error)
+{
+	ASSERT(!ls->nested);
+
+	if(ls->backing == NULL)
+	{
+		ListObject *backing = (ListObject*) Heap_Malloc(heap, &t_list, error);
+		if(backing == NULL)
+			return NULL;
+
+		backing->count = ls->count;
+		backing->capacity = ls->capacity;
+		backing->vals = ls->vals;
+		backing->backing = NULL;
+		backing->sharers = 1;
+		backing->nested = 0;
+
+		ls->count = 0;
+		ls->capacity = 0;
+		ls->vals = NULL;
+		ls->backing = backing;
+	}
+
+	return (Object*) newView(ls->backing, heap, error);
+}
+
+// Gives [list] its own array of items, if it has a
+// backing. Must be called before modifying the list.
+static _Bool unshare(ListObject *list, Heap *heap, Error *error)
+{
+	ListObject *backing = list->backing;
+
+	if(backing == NULL)
+		return 1;
+
+	ASSERT(backing->sharers > 0);
+
+	list->count = backing->count;
+
+	if(backing->sharers == 1)
+	{
+		// This is the last list that uses the 
+		// backing, so it can take its array.
+		list->vals = backing->vals;
+		list->capacity = backing->capacity;
+		backing->vals = NULL;
+		backing->capacity = 0;
+		backing->count = 0;
+	}
+	else
+	{
+		int capacity = backing->count < 8 ? 8 : backing->count;
+		Object **vals = Heap_RawMalloc(heap, sizeof(Object*) * capacity, error);
+		if(vals == NULL)
+			return 0;
+
+		memcpy(vals, backing->vals, sizeof(Object*) * backing->count);
+		list->vals = vals;
+		list->capacity = capacity;
+	}
+
+	list->backing = NULL;
+	backing->sharers -= 1;
+	return 1;
+}
+
 static Object *copy(Object *self, Heap *heap, Error *err)
 {
-	UNUSED(heap);
-	UNUSED(err);
+	ListObject *ls = (ListObject*) self;
+
+	if(!ls->nested)
+		return share(ls, heap, err);
 
-	ListObject *ls  = (ListObject*) self;
 	ListObject *ls2 = (ListObject*) Object_NewList(ls->count, heap, err);
 	if(ls2 == NULL) return NULL;
 
@@ -137,6 +252,7 @@ static Object *copy(Object *self, Heap *heap, Error *err)
 	}
 
 	ls2->count = ls->count;
+	ls2->nested = 1;
 
 	return (Object*) ls2;
 }
@@ -162,6 +278,9 @@ Object *Object_NewList(int capacity, Heap *heap, Error *error)
 
 		obj->count = 0;
 		obj->capacity = capacity;
+		obj->backing = NULL;
+		obj->sharers = 0;
+		obj->nested = 0;
 		obj->vals = Heap_RawMalloc(heap, sizeof(Object*) * capacity, error);
 
 		if(obj->vals == NULL)
@@ -183,13 +302,54 @@ Object *Object_NewList2(int num, Object **items, Heap *heap, Error *error)
 	memcpy(list->vals, items, num * sizeof(Object*));
 	list->count = num;
 
+	for(int i = 0; i < num && !list->nested; i += 1)
+		if(!Object_IsShareable(items[i]))
+			list->nested = 1;
+
 	return (Object*) list;
 }
 
+Object **Object_GetListItems(Object *obj, int *count)
+{
+	if(!Object_IsList(obj)) {
+		Error_Panic("%s expected a " TYPENAME_LIST
+			        " object, but an %s was provided", 
+			        __func__, Object_GetName(obj));
+		return NULL;
+	}
+
+	ListObject *list = resolve((ListObject*) obj);
+	if(count) *count = list->count;
+	return list->vals;
+}
+
+// Like [Object_GetListItems], but the items can be
+// modified in place. Returns NULL on failure.
+Object **Object_GetMutableListItems(Object *obj, int *count, Heap *heap, Error *error)
+{
+	if(!Object_IsList(obj)) {
+		Error_Panic("%s expected a " TYPENAME_LIST
+			        " object, but an %s was provided", 
+			        __func__, Object_GetName(obj));
+		return NULL;
+	}
+
+	ListObject *list = (ListObject*) obj;
+	Heap_WriteBarrier(heap, obj);
+	if(!unshare(list, heap, error))
+		return NULL;
+
+	if(count) *count = list->count;
+	return list->vals;
+}
+
 static void walk(Object *self, void (*callback)(Object **referer, void *userp), void *userp)
 {
 	ListObject *list = (ListObject*) self;
 
+	if(list->backing != NULL)
+		callback((Object**) &list->backing, userp);
+
 	for(int i = 0; i < list->count; i += 1)
 		callback(&list->vals[i], userp);
 }
@@ -198,7 +358,8 @@ static void walkexts(Object *self, void (*callback)(void **referer, unsigned int
 {
 	ListObject *list = (ListObject*) self;
 	
-	callback((void**) &list->vals, sizeof(Object) * list->capacity, userp);
+	if(list->vals != NULL)
+		callback((void**) &list->vals, sizeof(Object*) * list->capacity, userp);
 }
 
 static Object *select_(Object *self, Object *key, Heap *heap, Error *error)
@@ -218,7 +379,7 @@ static Object *select_(Object *self, Object *key, Heap *heap, Error *error)
 
 	int idx = Object_GetInt(key);
 
-	ListObject *list = (ListObject*) self;
+	ListObject *list = resolve((ListObject*) self);
 
 	if(idx < 0 || idx >= list->count)
 	{
@@ -229,6 +390,8 @@ static Object *select_(Object *self, Object *key, Heap *heap, Error *error)
 	return list->vals[idx];
 }
 
+static _Bool reserve(ListObject *list, int new_capacity, Heap *heap, Error *error);
+
 static unsigned int calc_new_capacity(unsigned int old_capacity)
 {
 	return old_capacity * 2;
@@ -240,6 +403,18 @@ static _Bool grow(ListObject *list, Heap *heap, Error *error)
 
 	int new_capacity = calc_new_capacity(list->capacity);
 
+	return reserve(list, new_capacity, heap, error);
+}
+
+// Makes sure the list can hold [capacity] items 
+// without reallocating its array.
+static _Bool reserve(ListObject *list, int new_capacity, Heap *heap, Error *error)
+{
+	ASSERT(list != NULL);
+
+	if(new_capacity <= list->capacity)
+		return 1;
+
 	Object **vals = Heap_RawMalloc(heap, sizeof(Object*) * new_capacity, error);
 
 	if(vals == NULL)
@@ -272,12 +447,18 @@ static _Bool insert(Object *self, Object *key, Object *val, Heap *heap, Error *e
 
 	int idx = Object_GetInt(key);
 
-	if(idx < 0 || idx > list->count)
+	if(idx < 0 || idx > resolve(list)->count)
 	{
 		Error_Report(error, ErrorType_RUNTIME, "Out of range index");
 		return NULL;
 	}
 
+	if(!unshare(list, heap, error))
+		return 0;
+
+	if(!list->nested && !Object_IsShareable(val))
+		list->nested = 1;
+
 	if(idx == list->count)
 	{
 		if(list->count == list->capacity)
@@ -295,16 +476,112 @@ static _Bool insert(Object *self, Object *key, Object *val, Heap *heap, Error *e
 	return 1;
 }
 
+static ListObject *castList(Object *obj, const char *func)
+{
+	if(!Object_IsList(obj)) {
+		Error_Panic("%s expected a " TYPENAME_LIST
+			        " object, but an %s was provided", 
+			        func, Object_GetName(obj));
+		return NULL;
+	}
+	return (ListObject*) obj;
+}
+
+bool Object_InsertIntoList(Object *obj, int idx, Object *item, Heap *heap, Error *error)
+{
+	ListObject *list = castList(obj, __func__);
+	Heap_WriteBarrier(heap, obj);
+
+	if(idx < 0 || idx > resolve(list)->count)
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Out of range index");
+		return 0;
+	}
+
+	if(!unshare(list, heap, error))
+		return 0;
+
+	if(!list->nested && !Object_IsShareable(item))
+		list->nested = 1;
+
+	if(list->count == list->capacity)
+		if(!grow(list, heap, error))
+			return 0;
+
+	// Shift the following items forward.
+	memmove(list->vals + idx + 1, list->vals + idx, sizeof(Object*) * (list->count - idx));
+	list->vals[idx] = item;
+	list->count += 1;
+	return 1;
+}
+
+Object *Object_RemoveFromList(Object *obj, int idx, Heap *heap, Error *error)
+{
+	ListObject *list = castList(obj, __func__);
+	Heap_WriteBarrier(heap, obj);
+
+	if(idx < 0 || idx >= resolve(list)->count)
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Out of range index");
+		return NULL;
+	}
+
+	if(!unshare(list, heap, error))
+		return NULL;
+
+	Object *item = list->vals[idx];
+
+	// Shift the following items back.
+	memmove(list->vals + idx, list->vals + idx + 1, sizeof(Object*) * (list->count - idx - 1));
+	list->count -= 1;
+	return item;
+}
+
+bool Object_ExtendList(Object *obj, Object **items, int num, Heap *heap, Error *error)
+{
+	ASSERT(num >= 0);
+
+	ListObject *list = castList(obj, __func__);
+	Heap_WriteBarrier(heap, obj);
+
+	// The [items] may be the ones of this same list.
+	// They stay valid since unsharing never modifies
+	// the array of the backing.
+	if(!unshare(list, heap, error))
+		return 0;
+
+	for(int i = 0; i < num && !list->nested; i += 1)
+		if(!Object_IsShareable(items[i]))
+			list->nested = 1;
+
+	if(list->count + num > list->capacity)
+	{
+		int new_capacity = list->capacity;
+		while(new_capacity < list->count + num)
+			new_capacity = calc_new_capacity(new_capacity);
+
+		// The [items] may be the ones of this same
+		// list. The old array isn't freed, so they're
+		// still valid after this.
+		if(!reserve(list, new_capacity, heap, error))
+			return 0;
+	}
+
+	memcpy(list->vals + list->count, items, sizeof(Object*) * num);
+	list->count += num;
+	return 1;
+}
+
 static int count(Object *self)
 {
-	ListObject *list = (ListObject*) self;
+	ListObject *list = resolve((ListObject*) self);
 
 	return list->count;
 }
 
 static void print(Object *self, FILE *fp)
 {
-	ListObject *list = (ListObject*) self;
+	ListObject *list = resolve((ListObject*) self);
 
 	fprintf(fp, "[");
 	for(int i = 0; i < list->count; i += 1)
@@ -315,33 +592,4 @@ static void print(Object *self, FILE *fp)
 			fprintf(fp, ", ");
 	}
 	fprintf(fp, "]");
-}
-
-Object *Object_NewListOfConsecutiveIntegers(int first, int last, Heap *heap, Error *error)
-{
-	int count = last - first + 1;
-	
-	Object *list = Object_NewList(count, heap, error);
-	if (list == NULL)
-		return NULL;
-
-	for (int i = 0; i < count; i++) {
-
-		Object *key = Object_FromInt(i, heap, error);
-		if (key == NULL)
-			return NULL;
-
-		Object *val;
-		if (first == 0)
-			val = key;
-		else {
-			val = Object_FromInt(first+i, heap, error);
-			if (val == NULL)
-				return NULL;
-		}
-
-		if (!Object_Insert(list, key, val, heap, error))
-			return NULL;
-	}
-	return list;
 }
\ No newline at end of file
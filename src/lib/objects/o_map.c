@@ -28,17 +28,134 @@
 ** +--------------------------------------------------------------------------+ 
 */
 
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "objects.h"
 #include "../utils/defs.h"
 #include "../defs.h"
 
-typedef struct {
+// Maps with up to SMALL_MAP_SIZE items are stored inline 
+// in the object, in the [small] arrays, and lookups are 
+// a linear scan of the keys which doesn't need hashing.
+// These are marked by a [mapper_size] of 0. Since most 
+// maps are small (function locals, records, iterators),
+// this saves the allocation of the hashed layout. When
+// a small map grows past SMALL_MAP_SIZE, it's promoted
+// to the hashed layout. In the small layout there are
+// no holes, so [used] always equals [count].
+//
+// In the hashed layout the items are stored in insertion 
+// order in the [keys] and [vals] arrays, which can hold
+// [capacity] items. The int keys in [0, index_size) are
+// mapped to their position in these arrays by [index],
+// (-1 meaning that the key isn't in the map) while all
+// other keys are mapped by the hash table [mapper]. This
+// is similar to the array part of Lua's tables, so that
+// maps used as arrays, counters or histograms don't need
+// to hash or compare their keys. The [index_size] is 
+// chosen when the arrays are rebuilt as the largest power
+// of two such that more than half of the keys below it 
+// are in the map, so sparse int keys are still hashed.
+//
+// The hash table is an open addressing table in the style
+// of Abseil's "Swiss tables". It has [mapper_size] slots.
+// Each slot has a position in [mapper] and a control byte.
+// The control byte is either CTRL_EMPTY, CTRL_DELETED or, 
+// if the slot refers to an item, 7 bits of the hash of its
+// key. The slots are grouped in groups of GROUP_WIDTH slots
+// and lookups probe whole groups at the time by comparing
+// all of their control bytes with the hash bits of the
+// key (using SSE2 when available), so [Object_Compare] 
+// is only called on slots that very likely hold the key.
+// The probing stops at the first group with an empty slot.
+// There are [mapper_used] slots that aren't empty.
+//
+// The control bytes are stored after the [mapper] ints,
+// in the same allocation. Tables smaller than a group
+// have a single group padded with CTRL_SENTINEL bytes,
+// which never match anything.
+//
+// When an item is deleted, its slot is marked as 
+// CTRL_DELETED (so that the probing sequences that go
+// through it aren't interrupted) and its key and value
+// are set to NULL. The first [used] positions of [keys]
+// and [vals] are occupied by either an item or a hole 
+// left by a deleted one, and [count] is the number of 
+// items. When there are too many holes, the arrays are
+// compacted.
+//
+// Copies of maps whose keys and values are all shareable
+// (see [Object_IsShareable]) are copy-on-write. Small maps
+// are copied by copying their inline arrays, while the 
+// items of a hashed map are moved to a hidden map, the
+// [backing], which is never modified and is shared by the
+// original and the copy. A map with a backing is an empty
+// small map that forwards reads to it. On the first write,
+// it takes back the arrays of the backing, or copies of 
+// them if other maps still share them. The copies of the
+// arrays are plain memory copies, so no key is hashed.
+//
+// The [sharers] of a backing are the maps that refer to
+// it. Maps that are collected don't decrement it, so it
+// may be higher than the real count, which only causes 
+// a copy that could have been avoided.
+//
+// When an item that's not shareable is inserted, the
+// map is marked as [nested] and its copies are deep.
+//
+// The [version] is incremented each time a key is added
+// or removed, which are the only operations that may move 
+// the items in the arrays. Cursors over the items (like the
+// ones of map views) use it to know when they're stale.
+
+#define SMALL_MAP_SIZE 8
+
+typedef struct MapObject MapObject;
+struct MapObject {
 	Object base;
-	int mapper_size, count;
-	int *mapper;
-	Object **keys;
-	Object **vals;
-} MapObject;
+	MapObject *backing;
+	int sharers;
+	bool nested;
+	unsigned int version;
+	// The fields from here on hold the items and 
+	// are moved to and from the backing.
+	int mapper_size, count, used;
+	union {
+		struct {
+			int *mapper;
+			int *index;
+			Object **keys;
+			Object **vals;
+			int capacity;
+			int index_size;
+			int mapper_used;
+		};
+		struct {
+			Object *keys[SMALL_MAP_SIZE];
+			Object *vals[SMALL_MAP_SIZE];
+		} small;
+	};
+};
+
+#define STORAGE_OFFSET offsetof(MapObject, mapper_size)
+#define STORAGE_SIZE (sizeof(MapObject) - STORAGE_OFFSET)
+
+#define GROUP_WIDTH 16
+
+#define CTRL_EMPTY    ((int8_t) -128)
+#define CTRL_DELETED  ((int8_t) -2)
+#define CTRL_SENTINEL ((int8_t) -1)
+
+// Int keys are only put in the index if
+// they're smaller than this.
+#define MAX_INDEX_BITS 30
+
+static int find_small(MapObject *map, Object *key, Error *error);
 
 static Object *select_(Object *self, Object *key, Heap *heap, Error *err);
 static _Bool   insert(Object *self, Object *key, Object *val, Heap *heap, Error *err);
@@ -50,6 +167,8 @@ static Object *copy(Object *self, Heap *heap, Error *err);
 static int hash(Object *self);
 static bool istypeof(Object *self, Object *other, Heap *heap, Error *error);
 static Object *keysof(Object *self, Heap *heap, Error *error);
+static Object *delete(Object *self, Object *key, Heap *heap, Error *err);
+static _Bool   unshare(MapObject *map, Heap *heap, Error *error);
 
 static TypeObject t_map = {
 	.base = (Object) { .type = &t_type, .flags = Object_STATIC },
@@ -59,6 +178,7 @@ static TypeObject t_map = {
 	.hash = hash,
 	.select = select_,
 	.insert = insert,
+	.delete = delete,
 	.count = count,
 	.print = print,
 	.keysof = keysof,
@@ -67,14 +187,36 @@ static TypeObject t_map = {
 	.walkexts = walkexts,
 };
 
+static inline _Bool is_small(MapObject *map)
+{
+	return map->mapper_size == 0;
+}
+
+// Returns the map that holds the items of [map].
+static inline MapObject *resolve(MapObject *map)
+{
+	return map->backing ? map->backing : map;
+}
+
+// The first [used] keys and values, for both layouts.
+static inline Object **get_keys(MapObject *map)
+{
+	return is_small(map) ? map->small.keys : map->keys;
+}
+
+static inline Object **get_vals(MapObject *map)
+{
+	return is_small(map) ? map->small.vals : map->vals;
+}
+
 static Object*
 keysof(Object *self, 
 	   Heap   *heap, 
 	   Error  *error)
 {
-	MapObject *map = (MapObject*) self;
-#warning "This shouldn't return items that contain none"
-	return Object_NewList2(map->count, map->keys, heap, error);
+	// The keys are read from the map 
+	// when the view is accessed.
+	return Object_NewMapView(self, MAPVIEW_KEYS, heap, error);
 }
 
 static bool 
@@ -83,16 +225,39 @@ istypeof(Object *self,
          Heap   *heap,
          Error  *error)
 {
-    MapObject *map = (MapObject*) self;
+    MapObject *map = resolve((MapObject*) self);
     if (!Object_IsMap(other))
         return false;
 
-    for (int i = 0; i < map->count; i++) {
+    // Records are usually built with their keys in the
+    // same order as the schema they're checked against,
+    // so each key is first looked for at its position
+    // in the schema. When the two maps have the same 
+    // shape, no lookup is needed.
+    MapObject *map2 = resolve((MapObject*) other);
+    Object **keys2 = get_keys(map2);
+    Object **vals2 = get_vals(map2);
+
+    Object **keys = get_keys(map);
+    Object **vals = get_vals(map);
+
+    for (int i = 0; i < map->used; i++) {
     	
-    	Object *key = map->keys[i];
-    	Object *val = map->vals[i];
+    	Object *key = keys[i];
+    	Object *val = vals[i];
+
+    	if (key == NULL)
+    		continue;
     	
-    	Object *val2 = Object_Select(other, key, heap, error);
+    	Object *val2;
+    	Object *key2 = (i < map2->used) ? keys2[i] : NULL;
+    	if (key2 != NULL && (key2 == key || (key2->type == key->type && Object_Compare(key, key2, error))))
+    		val2 = vals2[i];
+    	else {
+    		if (error->occurred)
+    			return false;
+    		val2 = select_(other, key, heap, error);
+    	}
     	if (val2 == NULL)
     		return false;
     	
@@ -104,22 +269,265 @@ istypeof(Object *self,
 
 static inline int calc_capacity(int mapper_size)
 {
-	return mapper_size * 2.0 / 3.0;
+	return mapper_size * 7 / 8;
+}
+
+static inline int calc_ctrl_size(int mapper_size)
+{
+	return mapper_size < GROUP_WIDTH ? GROUP_WIDTH : mapper_size;
+}
+
+static inline int calc_mapper_bytes(int mapper_size)
+{
+	return sizeof(int) * mapper_size + calc_ctrl_size(mapper_size);
+}
+
+static inline int8_t *get_ctrl(int *mapper, int mapper_size)
+{
+	return (int8_t*) (mapper + mapper_size);
+}
+
+// Spreads the bits of the object's hash, since they're
+// often not well distributed (integers hash to themselves).
+// The top 7 bits are stored in the control bytes while the
+// others choose the group where the probing starts.
+static inline uint64_t mix_hash(int hash)
+{
+	return (uint64_t) (uint32_t) hash * 0x9E3779B97F4A7C15ull;
+}
+
+static inline int8_t hash_fragment(uint64_t h)
+{
+	return (int8_t) (h >> 57);
+}
+
+// Returns a bit mask with a bit set for each control 
+// byte of the group that equals [byte].
+static inline unsigned int match_byte(const int8_t *group, int8_t byte)
+{
+#ifdef __SSE2__
+	__m128i ctrl = _mm_loadu_si128((const __m128i*) group);
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(byte)));
+#else
+	unsigned int mask = 0;
+	for(int i = 0; i < GROUP_WIDTH; i += 1)
+		if(group[i] == byte)
+			mask |= 1u << i;
+	return mask;
+#endif
+}
+
+// Iterates over the groups of a table in a triangular
+// sequence (g, g+1, g+3, g+6, ...) which visits all of 
+// them when their number is a power of two.
+typedef struct {
+	unsigned int mask;
+	unsigned int group;
+	unsigned int step;
+} ProbeSeq;
+
+static inline ProbeSeq probe_start(uint64_t h, int mapper_size)
+{
+	unsigned int num_groups = mapper_size < GROUP_WIDTH ? 1 : mapper_size / GROUP_WIDTH;
+	return (ProbeSeq) { 
+		.mask  = num_groups - 1, 
+		.group = (h >> 25) & (num_groups - 1),
+		.step  = 0,
+	};
+}
+
+static inline void probe_next(ProbeSeq *seq)
+{
+	seq->step += 1;
+	seq->group = (seq->group + seq->step) & seq->mask;
+}
+
+// Returns the slot of [key], or -1 if it's not in the 
+// map. If [free_slot] isn't NULL, the first slot of the
+// probing sequence that may hold a new item is stored 
+// in it, which is where the key should be inserted.
+static int find_slot(MapObject *map, Object *key, uint64_t h, int *free_slot, Error *error)
+{
+	int8_t *ctrl = get_ctrl(map->mapper, map->mapper_size);
+	int8_t  frag = hash_fragment(h);
+
+	if(free_slot)
+		*free_slot = -1;
+
+	ProbeSeq seq = probe_start(h, map->mapper_size);
+	while(1)
+	{
+		int base = seq.group * GROUP_WIDTH;
+		int8_t *group = ctrl + base;
+
+		unsigned int mask = match_byte(group, frag);
+		while(mask)
+		{
+			int slot = base + __builtin_ctz(mask);
+			int k = map->mapper[slot];
+			ASSERT(k >= 0 && k < map->used);
+
+			// Keys are often the very same object that
+			// was inserted, which is cheaper to check.
+			if(map->keys[k] == key || Object_Compare(key, map->keys[k], error))
+				// Found it!
+				return slot;
+
+			if(error->occurred)
+				// Key doesn't implement compare.
+				return -1;
+
+			mask &= mask - 1;
+		}
+
+		unsigned int empty = match_byte(group, CTRL_EMPTY);
+
+		if(free_slot && *free_slot < 0)
+		{
+			unsigned int avail = empty | match_byte(group, CTRL_DELETED);
+			if(avail)
+				*free_slot = base + __builtin_ctz(avail);
+		}
+
+		if(empty)
+			// This group was never full, so
+			// the key can't be further on.
+			return -1;
+
+		probe_next(&seq);
+	}
+
+	UNREACHABLE;
+	return -1;
+}
+
+static void init_view(MapObject *map, MapObject *backing)
+{
+	map->backing = backing;
+	map->sharers = 0;
+	map->nested = 0;
+	map->mapper_size = 0;
+	map->count = 0;
+	map->used = 0;
+	backing->sharers += 1;
+}
+
+// Makes a map that shares the items of [map], which
+// must not be nested.
+static Object *share(MapObject *map, Heap *heap, Error *error)
+{
+	ASSERT(!map->nested);
+
+	MapObject *copy = (MapObject*) Heap_Malloc(heap, &t_map, error);
+	if(copy == NULL)
+		return NULL;
+
+	if(map->backing == NULL && is_small(map))
+	{
+		// Small maps are cheap enough to copy.
+		copy->backing = NULL;
+		copy->sharers = 0;
+		copy->nested = 0;
+		copy->version = 0;
+		memcpy((char*) copy + STORAGE_OFFSET, (char*) map + STORAGE_OFFSET, STORAGE_SIZE);
+		return (Object*) copy;
+	}
+
+	if(map->backing == NULL)
+	{
+		// Move the items to a new backing.
+		MapObject *backing = (MapObject*) Heap_Malloc(heap, &t_map, error);
+		if(backing == NULL)
+			return NULL;
+
+		backing->backing = NULL;
+		backing->sharers = 0;
+		backing->nested = 0;
+		backing->version = 0;
+		memcpy((char*) backing + STORAGE_OFFSET, (char*) map + STORAGE_OFFSET, STORAGE_SIZE);
+		init_view(map, backing);
+	}
+
+	copy->version = 0;
+	init_view(copy, map->backing);
+	return (Object*) copy;
+}
+
+// Gives [map] its own arrays, if it has a backing.
+// Must be called before modifying the map.
+static _Bool unshare(MapObject *map, Heap *heap, Error *error)
+{
+	MapObject *backing = map->backing;
+
+	if(backing == NULL)
+		return 1;
+
+	ASSERT(backing->sharers > 0);
+	ASSERT(!is_small(backing));
+
+	if(backing->sharers == 1)
+	{
+		// This is the last map that uses the 
+		// backing, so it can take its arrays.
+		memcpy((char*) map + STORAGE_OFFSET, (char*) backing + STORAGE_OFFSET, STORAGE_SIZE);
+		backing->mapper_size = 0;
+		backing->count = 0;
+		backing->used  = 0;
+	}
+	else
+	{
+		int *mapper   = Heap_RawMalloc(heap, calc_mapper_bytes(backing->mapper_size), error);
+		Object **keys = Heap_RawMalloc(heap, sizeof(Object*) * backing->capacity, error);
+		Object **vals = Heap_RawMalloc(heap, sizeof(Object*) * backing->capacity, error);
+		int *index    = NULL;
+
+		if(mapper == NULL || keys == NULL || vals == NULL)
+			return 0;
+
+		if(backing->index_size > 0)
+		{
+			index = Heap_RawMalloc(heap, sizeof(int) * backing->index_size, error);
+			if(index == NULL)
+				return 0;
+			memcpy(index, backing->index, sizeof(int) * backing->index_size);
+		}
+
+		memcpy(mapper, backing->mapper, calc_mapper_bytes(backing->mapper_size));
+		memcpy(keys, backing->keys, sizeof(Object*) * backing->used);
+		memcpy(vals, backing->vals, sizeof(Object*) * backing->used);
+
+		memcpy((char*) map + STORAGE_OFFSET, (char*) backing + STORAGE_OFFSET, STORAGE_SIZE);
+		map->mapper = mapper;
+		map->index  = index;
+		map->keys   = keys;
+		map->vals   = vals;
+	}
+
+	map->backing = NULL;
+	backing->sharers -= 1;
+	return 1;
 }
 
 static Object *copy(Object *self, Heap *heap, Error *err)
 {
 	MapObject *m1 = (MapObject*) self;
+
+	if(!m1->nested)
+		return share(m1, heap, err);
+
 	Object *m2 = Object_NewMap(m1->count, heap, err);
 	if(m2 == NULL) return NULL;
 
-	for(int i = 0; i < m1->count; i += 1)
+	for(int i = 0; i < m1->used; i += 1)
 	{
 		Object *key, *key_cpy;
 		Object *val, *val_cpy;
 
-		key = m1->keys[i];
-		val = m1->vals[i];
+		key = get_keys(m1)[i];
+		val = get_vals(m1)[i];
+
+		if(key == NULL)
+			continue;
 
 		key_cpy = Object_Copy(key, heap, err);
 		if(key_cpy == NULL) return NULL;
@@ -136,14 +544,17 @@ static Object *copy(Object *self, Heap *heap, Error *err)
 
 static int hash(Object *self)
 {
-	MapObject *m = (MapObject*) self;
+	MapObject *m = resolve((MapObject*) self);
+	Object **keys = get_keys(m);
+	Object **vals = get_vals(m);
 
 	int h = 0;
 	// The hash of the map is the sum of the
 	// hashes of each key and each item.
-	for(int i = 0; i < m->count; i += 1)
-		h += Object_Hash(m->keys[i])
-		   + Object_Hash(m->vals[i]);
+	for(int i = 0; i < m->used; i += 1)
+		if(keys[i] != NULL)
+			h += Object_Hash(keys[i])
+			   + Object_Hash(vals[i]);
 	return h;
 }
 
@@ -152,20 +563,130 @@ TypeObject *Object_GetMapType()
 	return &t_map;
 }
 
+// Iterates over the items of the map in insertion order.
+// The [pos] cursor must start at 0 and is moved after the
+// returned item. Returns false when there are no more items.
+bool Object_NextMapItem(Object *self, int *pos, Object **key, Object **val)
+{
+	ASSERT(self->type == &t_map);
+
+	MapObject *map = resolve((MapObject*) self);
+	Object **keys = get_keys(map);
+	Object **vals = get_vals(map);
+
+	// Skip the holes left by deleted items.
+	int i = *pos;
+	while(i < map->used && keys[i] == NULL)
+		i += 1;
+
+	if(i >= map->used)
+	{
+		*pos = i;
+		return false;
+	}
+
+	if(key) *key = keys[i];
+	if(val) *val = vals[i];
+	*pos = i+1;
+	return true;
+}
+
+// Moves the cursor of [Object_NextMapItem] to the item 
+// with index [target] in insertion order. The cursor is
+// made of the position [pos] and the index [idx] of the
+// item from which [Object_NextMapItem] would continue.
+// The search starts from it if it's before the target, 
+// so a sequential scan is linear overall. The cursor is
+// only valid while the version of the map is the same.
+// Returns false if the target is out of range.
+bool Object_SeekMapItem(Object *self, int *pos, int *idx, int target)
+{
+	ASSERT(self->type == &t_map);
+
+	MapObject *map = resolve((MapObject*) self);
+
+	if(target < 0 || target >= map->count)
+		return false;
+
+	if(map->used == map->count)
+	{
+		// No holes, so positions and
+		// indices are the same.
+		*pos = target;
+		*idx = target;
+		return true;
+	}
+
+	if(*idx > target)
+	{
+		*pos = 0;
+		*idx = 0;
+	}
+
+	Object **keys = get_keys(map);
+	int i = *pos, j = *idx;
+	while(1)
+	{
+		while(keys[i] == NULL)
+			i += 1;
+
+		if(j == target)
+			break;
+
+		i += 1;
+		j += 1;
+	}
+
+	*pos = i;
+	*idx = j;
+	return true;
+}
+
+unsigned int Object_GetMapVersion(Object *self)
+{
+	ASSERT(self->type == &t_map);
+	return ((MapObject*) self)->version;
+}
+
+static inline void init_ctrl(int *mapper, int mapper_size)
+{
+	int8_t *ctrl = get_ctrl(mapper, mapper_size);
+	memset(ctrl, CTRL_EMPTY, mapper_size);
+	memset(ctrl + mapper_size, CTRL_SENTINEL, calc_ctrl_size(mapper_size) - mapper_size);
+}
+
 Object *Object_NewMap(int num, Heap *heap, Error *error)
 {
 	// Handle default args.
 	if(num < 0)
 		num = 0;
 
-	// Calculate initial mapper size.
+	if(num <= SMALL_MAP_SIZE)
+	{
+		MapObject *obj = (MapObject*) Heap_Malloc(heap, &t_map, error);
+		if(obj == NULL)
+			return NULL;
+
+		obj->backing = NULL;
+		obj->sharers = 0;
+		obj->nested = 0;
+		obj->version = 0;
+		obj->mapper_size = 0;
+		obj->count = 0;
+		obj->used = 0;
+		return (Object*) obj;
+	}
+
+	// Calculate initial sizes.
 	int mapper_size, capacity;
 	{
 		mapper_size = 8;
 		while(calc_capacity(mapper_size) < num)
 			mapper_size <<= 1;
 
-		capacity = calc_capacity(mapper_size);
+		capacity = 2 * SMALL_MAP_SIZE;
+		while(capacity < num)
+			capacity <<= 1;
 	}
 
 	// Make the thing.
@@ -174,9 +695,18 @@ Object *Object_NewMap(int num, Heap *heap, Error *error)
 		if(obj == 0)
 			return 0;
 
+		obj->backing = NULL;
+		obj->sharers = 0;
+		obj->nested = 0;
+		obj->version = 0;
 		obj->mapper_size = mapper_size;
 		obj->count = 0;
-		obj->mapper = Heap_RawMalloc(heap, sizeof(int) * mapper_size, error);
+		obj->used = 0;
+		obj->capacity = capacity;
+		obj->index_size = 0;
+		obj->mapper_used = 0;
+		obj->index  = NULL;
+		obj->mapper = Heap_RawMalloc(heap, calc_mapper_bytes(mapper_size), error);
 		obj->keys   = Heap_RawMalloc(heap, sizeof(Object*) * capacity, error);
 		obj->vals   = Heap_RawMalloc(heap, sizeof(Object*) * capacity, error);
 
@@ -184,21 +714,25 @@ Object *Object_NewMap(int num, Heap *heap, Error *error)
 			return NULL;
 	}
 
-	for(int i = 0; i < mapper_size; i += 1)
-		obj->mapper[i] = -1;
-
+	init_ctrl(obj->mapper, mapper_size);
 	return (Object*) obj;
 }
 
 static void walk(Object *self, void (*callback)(Object **referer, void *userp), void *userp)
 {
 	MapObject *map = (MapObject*) self;
+	Object **keys = get_keys(map);
+	Object **vals = get_vals(map);
 
-	for(int i = 0; i < map->count; i += 1)
-	{
-		callback(&map->keys[i], userp);
-		callback(&map->vals[i], userp);
-	}
+	if(map->backing != NULL)
+		callback((Object**) &map->backing, userp);
+
+	for(int i = 0; i < map->used; i += 1)
+		if(keys[i] != NULL)
+		{
+			callback(&keys[i], userp);
+			callback(&vals[i], userp);
+		}
 }
 
 static void walkexts(Object *self, void (*callback)(void **referer, unsigned int size, void *userp), void *userp)
@@ -207,11 +741,32 @@ static void walkexts(Object *self, void (*callback)(void **referer, unsigned int
 
 	MapObject *map = (MapObject*) self;
 
-	int capacity = calc_capacity(map->mapper_size);
-	
-	callback((void**) &map->mapper, sizeof(int) * map->mapper_size, userp);
-	callback((void**) &map->keys, sizeof(Object*) * capacity, userp);
-	callback((void**) &map->vals, sizeof(Object*) * capacity, userp);
+	if(is_small(map))
+		// Everything is stored inline.
+		return;
+
+	callback((void**) &map->mapper, calc_mapper_bytes(map->mapper_size), userp);
+	callback((void**) &map->keys, sizeof(Object*) * map->capacity, userp);
+	callback((void**) &map->vals, sizeof(Object*) * map->capacity, userp);
+
+	if(map->index_size > 0)
+		callback((void**) &map->index, sizeof(int) * map->index_size, userp);
+}
+
+// Returns true if [key] is an int that goes in the 
+// index of a map with an index of [index_size] ints,
+// and stores its value in [k].
+static inline _Bool is_index_key(Object *key, int index_size, int *k)
+{
+	if(index_size == 0 || !Object_IsInt(key))
+		return 0;
+
+	long long int n = Object_GetInt(key);
+	if(n < 0 || n >= index_size)
+		return 0;
+
+	*k = (int) n;
+	return 1;
 }
 
 static Object *select_(Object *self, Object *key, Heap *heap, Error *error)
@@ -223,110 +778,307 @@ static Object *select_(Object *self, Object *key, Heap *heap, Error *error)
 	ASSERT(heap != NULL);
 	ASSERT(error != NULL);
 
-	MapObject *map = (MapObject*) self;
+	MapObject *map = resolve((MapObject*) self);
 
-	unsigned int mask = map->mapper_size - 1;
-	unsigned int hash = Object_Hash(key);
-	unsigned int pert = hash;
+	if(is_small(map))
+	{
+		int i = find_small(map, key, error);
+		if(i < 0)
+			return NULL;
 
-	int i = hash & mask;
+		return map->small.vals[i];
+	}
 
-	while(1)
+	int k;
+	if(is_index_key(key, map->index_size, &k))
 	{
-		int k = map->mapper[i];
-
-		if(k == -1)
-		{
-			// Empty slot. 
-			// This key is not present.
+		int i = map->index[k];
+		if(i < 0)
 			return NULL;
-		}
-		else
-		{
-			// Found an item. 
-			// Is it the right one?
-					
-			ASSERT(k >= 0);
 
-			if(Object_Compare(key, map->keys[k], error))
-				// Found it!
-				return map->vals[k];
+		return map->vals[i];
+	}
 
-			if(error->occurred)
-				// Key doesn't implement compare.
-				return 0;
+	uint64_t h = mix_hash(Object_Hash(key));
+	int slot = find_slot(map, key, h, NULL, error);
+	if(slot < 0)
+		return NULL;
+
+	return map->vals[map->mapper[slot]];
+}
+
+// Puts a key that isn't in the table yet in the first
+// empty slot of its probing sequence.
+static void place_in_table(int *mapper, int mapper_size, uint64_t h, int pos)
+{
+	int8_t *ctrl = get_ctrl(mapper, mapper_size);
 
-			// Not the one we wanted.
+	ProbeSeq seq = probe_start(h, mapper_size);
+	while(1)
+	{
+		int base = seq.group * GROUP_WIDTH;
+		unsigned int empty = match_byte(ctrl + base, CTRL_EMPTY);
+		if(empty)
+		{
+			int slot = base + __builtin_ctz(empty);
+			ctrl[slot] = hash_fragment(h);
+			mapper[slot] = pos;
+			return;
 		}
+		probe_next(&seq);
+	}
+}
+
+// Adds the int key [key], if it's one, to the counters
+// of [calc_index_size]. The counter i counts the keys 
+// in [2^(i-1), 2^i), with the first one counting 0.
+static void count_index_key(int *nums, Object *key)
+{
+	if(!Object_IsInt(key))
+		return;
 
-		pert >>= 5;
-		i = (i * 5 + pert + 1) & mask;
+	long long int n = Object_GetInt(key);
+	if(n < 0 || n >= (1ll << MAX_INDEX_BITS))
+		return;
+
+	int i = 0;
+	while(n > 0)
+	{
+		n >>= 1;
+		i += 1;
 	}
+	nums[i] += 1;
+}
 
-	UNREACHABLE;
-	return NULL;
+// Returns the largest power of two such that more than 
+// half of the ints below it are keys, or 0 if there's
+// no such size.
+static int calc_index_size(int *nums)
+{
+	int below = 0;
+	int index_size = 0;
+	for(int i = 0; i <= MAX_INDEX_BITS; i += 1)
+	{
+		below += nums[i];
+		if(below > (1 << i) / 2)
+			index_size = 1 << i;
+	}
+	return index_size;
 }
 
-static _Bool grow(MapObject *map, Heap *heap, Error *error)
+// Moves the items to new arrays of [new_capacity] items,
+// removing the holes left by deleted items, and chooses
+// a new size for the index and the hash table. The new
+// capacity may also be smaller than the current one, as
+// long as all items fit. If the map is small, this moves
+// it to the hashed layout.
+//
+// If [pending] isn't NULL, it's a key that's going to be
+// inserted right after this, so it's considered when 
+// choosing the size of the index. This way the keys of
+// a map filled in order all end up in the index.
+static _Bool rehash(MapObject *map, int new_capacity, Object *pending, Heap *heap, Error *error)
 {
 	ASSERT(map != NULL);
+	ASSERT(new_capacity > map->count);
+
+	Object **old_keys = get_keys(map);
+	Object **old_vals = get_vals(map);
+
+	int nums[MAX_INDEX_BITS+1] = {0};
+	for(int i = 0; i < map->used; i += 1)
+		if(old_keys[i] != NULL)
+			count_index_key(nums, old_keys[i]);
+
+	if(pending != NULL)
+		count_index_key(nums, pending);
+
+	int index_size = calc_index_size(nums);
+
+	int indexed = 0;
+	for(int i = 0; index_size > 0 && i <= MAX_INDEX_BITS && (1 << i) / 2 < index_size; i += 1)
+		indexed += nums[i];
 
-	int new_mapper_size = map->mapper_size << 1;
-	int new_capacity = calc_capacity(new_mapper_size);
+	// The keys that don't go in the index go in the 
+	// table, which gets room for as many more.
+	int hashed = map->count + (pending != NULL) - indexed;
+	int new_mapper_size = 8;
+	while(calc_capacity(new_mapper_size) < 2 * hashed)
+		new_mapper_size <<= 1;
 
-	int *mapper   = Heap_RawMalloc(heap, sizeof(int) * new_mapper_size, error);
+	int *mapper   = Heap_RawMalloc(heap, calc_mapper_bytes(new_mapper_size), error);
 	Object **keys = Heap_RawMalloc(heap, sizeof(Object*) * new_capacity, error);
 	Object **vals = Heap_RawMalloc(heap, sizeof(Object*) * new_capacity, error);
+	int *index    = NULL;
 
 	if(mapper == NULL || keys == NULL || vals == NULL)
 		return 0;
 
-	for(int i = 0; i < map->count; i += 1)
+	if(index_size > 0)
 	{
-		keys[i] = map->keys[i];
-		vals[i] = map->vals[i];
+		index = Heap_RawMalloc(heap, sizeof(int) * index_size, error);
+		if(index == NULL)
+			return 0;
+
+		memset(index, -1, sizeof(int) * index_size);
 	}
 
-	for(int i = 0; i < new_mapper_size; i += 1)
-		mapper[i] = -1;
+	init_ctrl(mapper, new_mapper_size);
 
-	// Rehash everything.
-	for(int i = 0; i < map->count; i += 1)
+	// Copy the items in order, skipping holes, and 
+	// map them. Note that when the map was small, the 
+	// old arrays overlap with the fields of the hashed
+	// layout, so these are only set at the end.
+	int count = 0;
+	int mapper_used = 0;
+	for(int i = 0; i < map->used; i += 1)
 	{
-		// This won't trigger an error because the key
-		// surely has a hash method since we already
-		// hashed it once.
-		int hash = Object_Hash(keys[i]);
+		if(old_keys[i] == NULL)
+			continue;
 
-		int mask = new_mapper_size - 1;
-		int pert = hash;
-			
-		int j = hash & mask;
+		keys[count] = old_keys[i];
+		vals[count] = old_vals[i];
 
-		while(1)
+		int k;
+		if(is_index_key(keys[count], index_size, &k))
+			index[k] = count;
+		else
 		{
-			if(mapper[j] == -1)
-			{
-				// No collision.
-				// Insert here.
-				mapper[j] = i;
-				break;
-			}
-
-			// Collided. Find a new place.
-			pert >>= 5;
-			j = (j * 5 + pert + 1) & mask;
+			// This won't trigger an error because the key
+			// surely has a hash method since we already
+			// hashed it once.
+			uint64_t h = mix_hash(Object_Hash(keys[count]));
+			place_in_table(mapper, new_mapper_size, h, count);
+			mapper_used += 1;
 		}
+
+		count += 1;
 	}
+	ASSERT(count == map->count);
 
 	// Done.
 	map->mapper = mapper;
 	map->mapper_size = new_mapper_size;
+	map->mapper_used = mapper_used;
+	map->index = index;
+	map->index_size = index_size;
 	map->keys = keys;
 	map->vals = vals;
+	map->capacity = new_capacity;
+	map->used = count;
 	return 1;
 }
 
+// Makes room for the insertion of [pending].
+static _Bool grow(MapObject *map, Object *pending, Heap *heap, Error *error)
+{
+	if(is_small(map))
+		return rehash(map, 2 * SMALL_MAP_SIZE, pending, heap, error);
+
+	int new_capacity = map->capacity;
+
+	// If at least a third of the positions are holes
+	// it's enough to compact the arrays, else the
+	// size is doubled. When only the table is full,
+	// rebuilding it doubles its size.
+	if(map->used == map->capacity && 3 * (map->used - map->count) < map->used)
+		new_capacity <<= 1;
+
+	return rehash(map, new_capacity, pending, heap, error);
+}
+
+// Moves the items of a hashed map back inline. The 
+// caller makes sure that there are no holes.
+static void demote(MapObject *map)
+{
+	ASSERT(!is_small(map));
+	ASSERT(map->count <= SMALL_MAP_SIZE);
+	ASSERT(map->used == map->count);
+
+	// The extensions aren't freed explicitly. They
+	// are dropped by the next collection.
+	Object **keys = map->keys;
+	Object **vals = map->vals;
+
+	memcpy(map->small.keys, keys, sizeof(Object*) * map->count);
+	memcpy(map->small.vals, vals, sizeof(Object*) * map->count);
+	map->mapper_size = 0;
+}
+
+// Returns the position of [key] in the inline arrays
+// of a small map, or -1 if it's not in the map.
+static int find_small(MapObject *map, Object *key, Error *error)
+{
+	for(int i = 0; i < map->count; i += 1)
+	{
+		Object *other = map->small.keys[i];
+
+		if(other == key)
+			return i;
+
+		// Checking the type here avoids a call
+		// for most of the keys that don't match.
+		if(other->type == key->type && Object_Compare(key, other, error))
+			return i;
+
+		if(error->occurred)
+			// Key doesn't implement compare.
+			return -1;
+	}
+	return -1;
+}
+
+static _Bool insert_small(MapObject *map, Object *key, Object *val, Heap *heap, Error *error)
+{
+	int i = find_small(map, key, error);
+	if(i >= 0)
+	{
+		// Already inserted.
+		// Overwrite the value.
+		map->small.vals[i] = val;
+		return 1;
+	}
+
+	if(error->occurred)
+		return 0;
+
+	ASSERT(map->count < SMALL_MAP_SIZE);
+
+	Object *key_copy = Object_Copy(key, heap, error);
+
+	if(key_copy == NULL)
+		return 0;
+
+	map->small.keys[map->count] = key_copy;
+	map->small.vals[map->count] = val;
+	map->count += 1;
+	map->used  += 1;
+	map->version += 1;
+	return 1;
+}
+
+// Returns the position of [key] in [keys] and [vals]
+// of a hashed map or -1 if it's not in the map. If the
+// key goes in the table, its slot (or -1) is stored in 
+// [slot], and the slot where it can be inserted is 
+// stored in [free_slot] if that's not NULL.
+static int find_hashed(MapObject *map, Object *key, int *slot, int *free_slot, Error *error)
+{
+	int k;
+	if(is_index_key(key, map->index_size, &k))
+	{
+		*slot = -1;
+		return map->index[k];
+	}
+
+	uint64_t h = mix_hash(Object_Hash(key));
+	*slot = find_slot(map, key, h, free_slot, error);
+	if(*slot < 0)
+		return -1;
+
+	return map->mapper[*slot];
+}
+
 static _Bool insert(Object *self, Object *key, Object *val, Heap *heap, Error *error)
 {
 	ASSERT(error != NULL);
@@ -338,81 +1090,211 @@ static _Bool insert(Object *self, Object *key, Object *val, Heap *heap, Error *e
 
 	MapObject *map = (MapObject*) self;
 
-	if(map->count == calc_capacity(map->mapper_size))
-		if(!grow(map, heap, error))
-			return 0;
-
-	unsigned int mask = map->mapper_size - 1;
-	unsigned int hash = Object_Hash(key);
-	unsigned int pert = hash;
+	if(!unshare(map, heap, error))
+		return 0;
 
-	int i = hash & mask;
+	if(!map->nested && (!Object_IsShareable(val) || !Object_IsShareable(key)))
+		map->nested = 1;
 
-	while(1)
+	if(is_small(map))
 	{
-		int k = map->mapper[i];
+		if(map->count < SMALL_MAP_SIZE)
+			return insert_small(map, key, val, heap, error);
 
-		if(k == -1)
+		// The map is full. If the key is already
+		// there, only its value is overwritten.
+		int i = find_small(map, key, error);
+		if(i >= 0)
 		{
-			// Empty slot. We can insert it here.
-			Object *key_copy = Object_Copy(key, heap, error);
+			map->small.vals[i] = val;
+			return 1;
+		}
 
-			if(key_copy == NULL)
-				return NULL;
+		if(error->occurred)
+			return 0;
 
-			map->mapper[i] = map->count;
-			map->keys[map->count] = key_copy;
-			map->vals[map->count] = val;
-			map->count += 1;
+		if(!grow(map, key, heap, error))
+			return 0;
+	}
+	else
+	{
+		int slot;
+		int i = find_hashed(map, key, &slot, NULL, error);
+		if(i >= 0)
+		{
+			// Already inserted.
+			// Overwrite the value.
+			map->vals[i] = val;
 			return 1;
 		}
-		else
-		{
-			ASSERT(k >= 0);
 
-			if(Object_Compare(key, map->keys[k], error))
-			{
-				// Already inserted.
-				// Overwrite the value.
-				map->vals[k] = val;
-				return 1;
-			}
+		if(error->occurred)
+			// Key doesn't implement compare.
+			return 0;
 
-			if(error->occurred)
-				// Key doesn't implement compare.
+		int k;
+		_Bool indexed = is_index_key(key, map->index_size, &k);
+
+		if(map->used == map->capacity || (!indexed && map->mapper_used == calc_capacity(map->mapper_size)))
+			if(!grow(map, key, heap, error))
 				return 0;
+	}
+
+	Object *key_copy = Object_Copy(key, heap, error);
+
+	if(key_copy == NULL)
+		return 0;
 
-			// Collision.
+	int k;
+	if(is_index_key(key, map->index_size, &k))
+		map->index[k] = map->used;
+	else
+	{
+		// The table may have changed, so the
+		// free slot needs to be found now.
+		uint64_t h = mix_hash(Object_Hash(key));
+		int free_slot;
+		int slot = find_slot(map, key, h, &free_slot, error);
+		ASSERT(slot < 0 && free_slot >= 0);
+		UNUSED(slot);
+
+		int8_t *ctrl = get_ctrl(map->mapper, map->mapper_size);
+		if(ctrl[free_slot] == CTRL_EMPTY)
+			map->mapper_used += 1;
+		ctrl[free_slot] = hash_fragment(h);
+		map->mapper[free_slot] = map->used;
+	}
+
+	map->keys[map->used] = key_copy;
+	map->vals[map->used] = val;
+	map->used  += 1;
+	map->count += 1;
+	map->version += 1;
+	return 1;
+}
+
+static Object *delete(Object *self, Object *key, Heap *heap, Error *error)
+{
+	ASSERT(error != NULL);
+	ASSERT(key != NULL);
+	ASSERT(heap != NULL);
+	ASSERT(self != NULL);
+	ASSERT(self->type == &t_map);
+
+	MapObject *map = (MapObject*) self;
+
+	if(map->backing != NULL)
+	{
+		// Only unshare if there's something to delete.
+		if(select_(self, key, heap, error) == NULL)
+			return NULL;
+
+		if(!unshare(map, heap, error))
+			return NULL;
+	}
+
+	if(is_small(map))
+	{
+		int i = find_small(map, key, error);
+		if(i < 0)
+			return NULL;
+
+		Object *val = map->small.vals[i];
+
+		// Shift the following items back to
+		// keep the insertion order.
+		int following = map->count - i - 1;
+		memmove(map->small.keys + i, map->small.keys + i + 1, sizeof(Object*) * following);
+		memmove(map->small.vals + i, map->small.vals + i + 1, sizeof(Object*) * following);
+		map->count -= 1;
+		map->used  -= 1;
+		map->version += 1;
+		return val;
+	}
+
+	int slot;
+	int i = find_hashed(map, key, &slot, NULL, error);
+	if(i < 0)
+		// Not present (or the key doesn't
+		// implement compare).
+		return NULL;
+
+	Object *val = map->vals[i];
+
+	int k;
+	if(is_index_key(key, map->index_size, &k))
+		map->index[k] = -1;
+	else
+	{
+		// If the group of the slot has an empty slot, no
+		// probing sequence goes past it, so the slot can
+		// be marked as empty instead of deleted.
+		int8_t *ctrl  = get_ctrl(map->mapper, map->mapper_size);
+		int8_t *group = ctrl + (slot / GROUP_WIDTH) * GROUP_WIDTH;
+		if(match_byte(group, CTRL_EMPTY))
+		{
+			ctrl[slot] = CTRL_EMPTY;
+			map->mapper_used -= 1;
 		}
+		else
+			ctrl[slot] = CTRL_DELETED;
+	}
 
-		pert >>= 5;
-		i = (i * 5 + pert + 1) & mask;
+	map->keys[i] = NULL;
+	map->vals[i] = NULL;
+	map->count -= 1;
+	map->version += 1;
+
+	// When more than half of the positions are holes
+	// the arrays are compacted and, if there are few 
+	// items left, the map is shrunk. Since this only
+	// happens after used/2 deletions, the cost is
+	// amortized.
+	if(map->used > 8 && 2 * (map->used - map->count) > map->used)
+	{
+		int new_capacity = map->capacity;
+		while(new_capacity > 2 * SMALL_MAP_SIZE && new_capacity / 2 >= 2 * map->count)
+			new_capacity >>= 1;
+
+		if(!rehash(map, new_capacity, NULL, heap, error))
+			return NULL;
+
+		// Few items are left, so they can be
+		// moved back inline.
+		if(map->count <= SMALL_MAP_SIZE / 2)
+			demote(map);
 	}
 
-	UNREACHABLE;
-	return 0;
+	return val;
 }
 
 static int count(Object *self)
 {
-	MapObject *map = (MapObject*) self;
+	MapObject *map = resolve((MapObject*) self);
 
 	return map->count;
 }
 
 static void print(Object *self, FILE *fp)
 {
-	MapObject *map = (MapObject*) self;
+	MapObject *map = resolve((MapObject*) self);
+
+	Object **keys = get_keys(map);
+	Object **vals = get_vals(map);
 
 	fprintf(fp, "{");
-	for(int i = 0; i < map->count; i += 1)
+	for(int i = 0, printed = 0; i < map->used; i += 1)
 	{
-		Object_Print(map->keys[i], fp);
-		fprintf(fp, ": ");
-		Object_Print(map->vals[i], fp);
+		if(keys[i] == NULL)
+			continue;
 
-		if(i+1 < map->count)
+		if(printed > 0)
 			fprintf(fp, ", ");
+
+		Object_Print(keys[i], fp);
+		fprintf(fp, ": ");
+		Object_Print(vals[i], fp);
+		printed += 1;
 	}
 	fprintf(fp, "}");
 }
\ No newline at end of file
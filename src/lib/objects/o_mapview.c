@@ -0,0 +1,249 @@
+
+/* +--------------------------------------------------------------------------+
+** |                          _   _       _                                   |
+** |                         | \ | |     (_)                                  |
+** |                         |  \| | ___  _  __ _                             |
+** |                         | . ` |/ _ \| |/ _` |                            |
+** |                         | |\  | (_) | | (_| |                            |
+** |                         |_| \_|\___/| |\__,_|                            |
+** |                                    _/ |                                  |
+** |                                   |__/                                   |
+** +--------------------------------------------------------------------------+
+** | Copyright (c) 2022 Francesco Cozzuto <francesco.cozzuto@gmail.com>       |
+** +--------------------------------------------------------------------------+
+** | This file is part of The Noja Interpreter.                               |
+** |                                                                          |
+** | The Noja Interpreter is free software: you can redistribute it and/or    |
+** | modify it under the terms of the GNU General Public License as published |
+** | by the Free Software Foundation, either version 3 of the License, or (at |
+** | your option) any later version.                                          |
+** |                                                                          |
+** | The Noja Interpreter is distributed in the hope that it will be useful,  |
+** | but WITHOUT ANY WARRANTY; without even the implied warranty of           |
+** | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General |
+** | Public License for more details.                                         |
+** |                                                                          |
+** | You should have received a copy of the GNU General Public License along  |
+** | with The Noja Interpreter. If not, see <http://www.gnu.org/licenses/>.   |
+** +--------------------------------------------------------------------------+ 
+*/
+
+
+#include <limits.h>
+#include "objects.h"
+#include "../utils/defs.h"
+#include "../defs.h"
+
+/* A map view is a read-only sequence over the keys,
+** the values or the items (key-value pairs) of a map,
+** in insertion order. It doesn't copy anything: it
+** reads the map each time it's accessed, so it always
+** reflects its current state.
+**
+** Since the items are selected by index, the view 
+** keeps a cursor to the last selected item, so that
+** scanning it sequentially doesn't need to skip the 
+** holes left by deleted items from the start each
+** time. The cursor is discarded when the version of
+** the map changes, which happens when keys are added
+** or removed. Iterating over a view while the map
+** changes is an error, which is detected by the
+** iterator.
+*/
+
+typedef struct {
+	Object base;
+	Object *map;
+	MapViewKind kind;
+	unsigned int version;
+	int pos, idx;
+} MapViewObject;
+
+static Object *select_(Object *self, Object *key, Heap *heap, Error *error);
+static int     count(Object *self);
+static void    print(Object *self, FILE *fp);
+static Object *keysof(Object *self, Heap *heap, Error *error);
+static Object *copy(Object *self, Heap *heap, Error *error);
+static void    walk(Object *self, void (*callback)(Object **referer, void *userp), void *userp);
+
+static TypeObject t_mapview = {
+	.base = (Object) { .type = &t_type, .flags = Object_STATIC },
+	.name = TYPENAME_MAPVIEW,
+	.size = sizeof(MapViewObject),
+	.select = select_,
+	.count = count,
+	.print = print,
+	.keysof = keysof,
+	.copy = copy,
+	.walk = walk,
+};
+
+TypeObject *Object_GetMapViewType()
+{
+	return &t_mapview;
+}
+
+bool Object_IsMapView(Object *obj)
+{
+	return Object_GetType(obj) == &t_mapview;
+}
+
+Object *Object_NewMapView(Object *map, MapViewKind kind, Heap *heap, Error *error)
+{
+	if(!Object_IsMap(map))
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Can't make a view of a %s", Object_GetName(map));
+		return NULL;
+	}
+
+	MapViewObject *view = (MapViewObject*) Heap_Malloc(heap, &t_mapview, error);
+	if(view == NULL)
+		return NULL;
+
+	view->map  = map;
+	view->kind = kind;
+	view->version = Object_GetMapVersion(map);
+	view->pos = 0;
+	view->idx = 0;
+	return (Object*) view;
+}
+
+Object *Object_GetViewedMap(Object *self)
+{
+	ASSERT(self->type == &t_mapview);
+	return ((MapViewObject*) self)->map;
+}
+
+static Object *makeItem(MapViewKind kind, Object *key, Object *val, Heap *heap, Error *error)
+{
+	switch(kind)
+	{
+		case MAPVIEW_KEYS: return key;
+		case MAPVIEW_VALUES: return val;
+		case MAPVIEW_ITEMS:
+		{
+			Object *pair[2] = { key, val };
+			return Object_NewList2(2, pair, heap, error);
+		}
+	}
+	UNREACHABLE;
+	return NULL;
+}
+
+static Object *select_(Object *self, Object *key, Heap *heap, Error *error)
+{
+	ASSERT(self != NULL);
+	ASSERT(self->type == &t_mapview);
+	ASSERT(key != NULL);
+	ASSERT(heap != NULL);
+	ASSERT(error != NULL);
+
+	if(!Object_IsInt(key))
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Non integer key");
+		return NULL;
+	}
+
+	long long int idx = Object_GetInt(key);
+
+	MapViewObject *view = (MapViewObject*) self;
+
+	unsigned int version = Object_GetMapVersion(view->map);
+	if(view->version != version)
+	{
+		// The map changed since the cursor 
+		// was moved, so it may be stale.
+		view->version = version;
+		view->pos = 0;
+		view->idx = 0;
+	}
+
+	if(idx < 0 || idx > INT_MAX || !Object_SeekMapItem(view->map, &view->pos, &view->idx, idx))
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Out of range index");
+		return NULL;
+	}
+
+	Object *k, *v;
+	bool found = Object_NextMapItem(view->map, &view->pos, &k, &v);
+	ASSERT(found);
+	UNUSED(found);
+	view->idx += 1;
+
+	return makeItem(view->kind, k, v, heap, error);
+}
+
+static int count(Object *self)
+{
+	MapViewObject *view = (MapViewObject*) self;
+	return Object_GetType(view->map)->count(view->map);
+}
+
+static Object *keysof(Object *self, Heap *heap, Error *error)
+{
+	return Object_NewRange(0, count(self), 1, heap, error);
+}
+
+static Object *copy(Object *self, Heap *heap, Error *error)
+{
+	// The copy of a view is a snapshot of
+	// it, which is a list of copies of its
+	// items.
+	MapViewObject *view = (MapViewObject*) self;
+
+	Object *list = Object_NewList(count(self), heap, error);
+	if(list == NULL)
+		return NULL;
+
+	Object *k, *v;
+	for(int pos = 0; Object_NextMapItem(view->map, &pos, &k, &v); )
+	{
+		Object *item = makeItem(view->kind, k, v, heap, error);
+		if(item == NULL)
+			return NULL;
+
+		item = Object_Copy(item, heap, error);
+		if(item == NULL)
+			return NULL;
+
+		int n = Object_Count(list, error);
+		if(!Object_InsertIntoList(list, n, item, heap, error))
+			return NULL;
+	}
+	return list;
+}
+
+static void walk(Object *self, void (*callback)(Object **referer, void *userp), void *userp)
+{
+	MapViewObject *view = (MapViewObject*) self;
+	callback(&view->map, userp);
+}
+
+static void print(Object *self, FILE *fp)
+{
+	// Views are printed like the list
+	// of their items would be.
+	MapViewObject *view = (MapViewObject*) self;
+
+	Object *k, *v;
+	fprintf(fp, "[");
+	for(int pos = 0, printed = 0; Object_NextMapItem(view->map, &pos, &k, &v); printed += 1)
+	{
+		if(printed > 0)
+			fprintf(fp, ", ");
+
+		switch(view->kind)
+		{
+			case MAPVIEW_KEYS: Object_Print(k, fp); break;
+			case MAPVIEW_VALUES: Object_Print(v, fp); break;
+			case MAPVIEW_ITEMS:
+			fprintf(fp, "[");
+			Object_Print(k, fp);
+			fprintf(fp, ", ");
+			Object_Print(v, fp);
+			fprintf(fp, "]");
+			break;
+		}
+	}
+	fprintf(fp, "]");
+}
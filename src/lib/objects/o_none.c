@@ -42,6 +42,7 @@ static TypeObject t_none = {
 	.base = (Object) { .type = &t_type, .flags = Object_STATIC },
 	.name = TYPENAME_NONE,
 	.size = sizeof(Object),
+	.immutable = true,
 	.hash = hash,
 	.copy = copy,
 	.print = print,
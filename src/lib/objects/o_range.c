@@ -0,0 +1,241 @@
+
+/* +--------------------------------------------------------------------------+
+** |                          _   _       _                                   |
+** |                         | \ | |     (_)                                  |
+** |                         |  \| | ___  _  __ _                             |
+** |                         | . ` |/ _ \| |/ _` |                            |
+** |                         | |\  | (_) | | (_| |                            |
+** |                         |_| \_|\___/| |\__,_|                            |
+** |                                    _/ |                                  |
+** |                                   |__/                                   |
+** +--------------------------------------------------------------------------+
+** | Copyright (c) 2022 Francesco Cozzuto <francesco.cozzuto@gmail.com>       |
+** +--------------------------------------------------------------------------+
+** | This file is part of The Noja Interpreter.                               |
+** |                                                                          |
+** | The Noja Interpreter is free software: you can redistribute it and/or    |
+** | modify it under the terms of the GNU General Public License as published |
+** | by the Free Software Foundation, either version 3 of the License, or (at |
+** | your option) any later version.                                          |
+** |                                                                          |
+** | The Noja Interpreter is distributed in the hope that it will be useful,  |
+** | but WITHOUT ANY WARRANTY; without even the implied warranty of           |
+** | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General |
+** | Public License for more details.                                         |
+** |                                                                          |
+** | You should have received a copy of the GNU General Public License along  |
+** | with The Noja Interpreter. If not, see <http://www.gnu.org/licenses/>.   |
+** +--------------------------------------------------------------------------+ 
+*/
+
+
+#include <limits.h>
+#include "objects.h"
+#include "../utils/defs.h"
+#include "../utils/hash.h"
+#include "../defs.h"
+
+/* A range is the read-only sequence of ints
+** 
+**   start, start + step, start + 2*step, ...
+**
+** with [count] items. The items aren't stored,
+** they're computed when selected, so a range
+** takes the same memory regardless of its size.
+*/
+
+typedef struct {
+	Object base;
+	long long int start, step;
+	int count;
+} RangeObject;
+
+static Object *select_(Object *self, Object *key, Heap *heap, Error *error);
+static int     count(Object *self);
+static void    print(Object *self, FILE *fp);
+static Object *keysof(Object *self, Heap *heap, Error *error);
+static Object *copy(Object *self, Heap *heap, Error *error);
+static int     hash(Object *self);
+static bool    op_eql(Object *self, Object *other);
+
+static TypeObject t_range = {
+	.base = (Object) { .type = &t_type, .flags = Object_STATIC },
+	.name = TYPENAME_RANGE,
+	.size = sizeof(RangeObject),
+	.immutable = true,
+	.select = select_,
+	.count = count,
+	.print = print,
+	.keysof = keysof,
+	.copy = copy,
+	.hash = hash,
+	.op_eql = op_eql,
+};
+
+TypeObject *Object_GetRangeType()
+{
+	return &t_range;
+}
+
+bool Object_IsRange(Object *obj)
+{
+	return Object_GetType(obj) == &t_range;
+}
+
+Object *Object_NewRange(long long int start, long long int end, long long int step, Heap *heap, Error *error)
+{
+	if(step == 0)
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Range step can't be 0");
+		return NULL;
+	}
+
+	// The count is the number of steps needed to
+	// reach or pass the end. It's computed using
+	// unsigned values since the distance may not
+	// fit into a signed one.
+	unsigned long long int num = 0;
+	if(step > 0 && start < end)
+	{
+		unsigned long long int dist = (unsigned long long int) end - (unsigned long long int) start;
+		unsigned long long int size = step;
+		num = (dist - 1) / size + 1;
+	}
+	else if(step < 0 && start > end)
+	{
+		unsigned long long int dist = (unsigned long long int) start - (unsigned long long int) end;
+		unsigned long long int size = -(unsigned long long int) step;
+		num = (dist - 1) / size + 1;
+	}
+
+	if(num > INT_MAX)
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Range is too big");
+		return NULL;
+	}
+
+	RangeObject *range = (RangeObject*) Heap_Malloc(heap, &t_range, error);
+	if(range == NULL)
+		return NULL;
+
+	range->start = start;
+	range->step  = step;
+	range->count = num;
+	return (Object*) range;
+}
+
+void Object_GetRange(Object *obj, long long int *start, long long int *step, int *count)
+{
+	if(!Object_IsRange(obj))
+	{
+		Error_Panic("Not a " TYPENAME_RANGE);
+		return;
+	}
+
+	RangeObject *range = (RangeObject*) obj;
+	if(start) *start = range->start;
+	if(step)  *step  = range->step;
+	if(count) *count = range->count;
+}
+
+static long long int itemAt(RangeObject *range, int idx)
+{
+	// The item is between the start and the end,
+	// but the offset from the start may not fit
+	// into a signed value.
+	unsigned long long int offset = (unsigned long long int) idx * (unsigned long long int) range->step;
+	return (long long int) ((unsigned long long int) range->start + offset);
+}
+
+static Object *select_(Object *self, Object *key, Heap *heap, Error *error)
+{
+	ASSERT(self != NULL);
+	ASSERT(self->type == &t_range);
+	ASSERT(key != NULL);
+	ASSERT(heap != NULL);
+	ASSERT(error != NULL);
+
+	if(!Object_IsInt(key))
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Non integer key");
+		return NULL;
+	}
+
+	long long int idx = Object_GetInt(key);
+
+	RangeObject *range = (RangeObject*) self;
+
+	if(idx < 0 || idx >= range->count)
+	{
+		Error_Report(error, ErrorType_RUNTIME, "Out of range index");
+		return NULL;
+	}
+
+	return Object_FromInt(itemAt(range, idx), heap, error);
+}
+
+static int count(Object *self)
+{
+	return ((RangeObject*) self)->count;
+}
+
+static Object *keysof(Object *self, Heap *heap, Error *error)
+{
+	return Object_NewRange(0, count(self), 1, heap, error);
+}
+
+static Object *copy(Object *self, Heap *heap, Error *error)
+{
+	// Ranges can't be modified, so
+	// they can be shared.
+	UNUSED(heap);
+	UNUSED(error);
+	return self;
+}
+
+static int hash(Object *self)
+{
+	RangeObject *range = (RangeObject*) self;
+
+	// Must be consistent with op_eql.
+	long long int fields[3] = {
+		range->count > 0 ? range->start : 0,
+		range->count > 1 ? range->step  : 0,
+		range->count,
+	};
+	return hashbytes((unsigned char*) fields, sizeof(fields));
+}
+
+static bool op_eql(Object *self, Object *other)
+{
+	RangeObject *r1 = (RangeObject*) self;
+	RangeObject *r2 = (RangeObject*) other;
+
+	// Empty ranges are equal regardless of where
+	// they start, and so are ranges with a single
+	// item regardless of the step.
+	if(r1->count != r2->count)
+		return false;
+	if(r1->count == 0)
+		return true;
+	if(r1->start != r2->start)
+		return false;
+	return r1->count == 1 || r1->step == r2->step;
+}
+
+static void print(Object *self, FILE *fp)
+{
+	// Ranges are printed like the list
+	// of their items would be.
+	RangeObject *range = (RangeObject*) self;
+
+	fprintf(fp, "[");
+	for(int i = 0; i < range->count; i += 1)
+	{
+		fprintf(fp, "%lld", itemAt(range, i));
+
+		if(i+1 < range->count)
+			fprintf(fp, ", ");
+	}
+	fprintf(fp, "]");
+}
@@ -0,0 +1,99 @@
+
+/* +--------------------------------------------------------------------------+
+** |                          _   _       _                                   |
+** |                         | \ | |     (_)                                  |
+** |                         |  \| | ___  _  __ _                             |
+** |                         | . ` |/ _ \| |/ _` |                            |
+** |                         | |\  | (_) | | (_| |                            |
+** |                         |_| \_|\___/| |\__,_|                            |
+** |                                    _/ |                                  |
+** |                                   |__/                                   |
+** +--------------------------------------------------------------------------+
+** | Copyright (c) 2022 Francesco Cozzuto <francesco.cozzuto@gmail.com>       |
+** +--------------------------------------------------------------------------+
+** | This file is part of The Noja Interpreter.                               |
+** |                                                                          |
+** | The Noja Interpreter is free software: you can redistribute it and/or    |
+** | modify it under the terms of the GNU General Public License as published |
+** | by the Free Software Foundation, either version 3 of the License, or (at |
+** | your option) any later version.                                          |
+** |                                                                          |
+** | The Noja Interpreter is distributed in the hope that it will be useful,  |
+** | but WITHOUT ANY WARRANTY; without even the implied warranty of           |
+** | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General |
+** | Public License for more details.                                         |
+** |                                                                          |
+** | You should have received a copy of the GNU General Public License along  |
+** | with The Noja Interpreter. If not, see <http://www.gnu.org/licenses/>.   |
+** +--------------------------------------------------------------------------+ 
+*/
+
+#include "objects.h"
+#include "../utils/defs.h"
+#include "../defs.h"
+
+typedef struct {
+	Object base;
+	Regex *regex;
+} RegexObject;
+
+static _Bool regex_free(Object *obj, Error *error);
+static void  print(Object *obj, FILE *fp);
+
+static TypeObject t_regex = {
+	.base = (Object) { .type = &t_type, .flags = Object_STATIC },
+	.name = TYPENAME_REGEX,
+	.size = sizeof(RegexObject),
+	.free = regex_free,
+	.print = print,
+};
+
+TypeObject *Object_GetRegexType()
+{
+	return &t_regex;
+}
+
+_Bool Object_IsRegex(Object *obj)
+{
+	return Object_GetType(obj) == Object_GetRegexType();
+}
+
+// The object takes a reference to [regex], so the
+// caller still needs to free its own one.
+Object *Object_FromRegex(Regex *regex, Heap *heap, Error *error)
+{
+	RegexObject *rob = (RegexObject*) Heap_Malloc(heap, &t_regex, error);
+
+	if(rob == NULL)
+		return NULL;
+
+	rob->regex = Regex_Copy(regex);
+
+	return (Object*) rob;
+}
+
+Regex *Object_GetRegex(Object *obj)
+{
+	if(!Object_IsRegex(obj)) {
+		Error_Panic("%s expected a " TYPENAME_REGEX
+		            " object, but an %s was provided", 
+		            __func__,  Object_GetName(obj));
+		return NULL;
+	}
+
+	return ((RegexObject*) obj)->regex;
+}
+
+static _Bool regex_free(Object *obj, Error *error)
+{
+	UNUSED(error);
+	RegexObject *rob = (RegexObject*) obj;
+	Regex_Free(rob->regex);
+	return 1;
+}
+
+static void print(Object *obj, FILE *fp)
+{
+	UNUSED(obj);
+	fprintf(fp, "<" TYPENAME_REGEX ">");
+}
@@ -35,11 +35,20 @@
 #include "../utils/utf8.h"
 #include "../defs.h"
 
+// Strings with less than INLINE_CAPACITY bytes (not counting
+// the zero terminator) are stored inside the object itself, 
+// which saves an allocation and the copy of an extension when
+// collecting garbage. Longer strings use an external body.
+#define INLINE_CAPACITY 16
+
 typedef struct {
 	Object  base;
 	int     count;
 	int     bytes;
-	char   *body;
+	union {
+		char *body;
+		char  inline_body[INLINE_CAPACITY];
+	};
 } StringObject;
 
 static int hash(Object *self);
@@ -55,6 +64,7 @@ static TypeObject t_string = {
 	.base = (Object) { .type = &t_type, .flags = Object_STATIC },
 	.name = TYPENAME_STRING,
 	.size = sizeof(StringObject),
+	.immutable = true,
 	.hash = hash,
 	.count = count,
 	.copy = copy,
@@ -65,6 +75,16 @@ static TypeObject t_string = {
 	.walkexts = walkexts,
 };
 
+static inline _Bool is_inline(StringObject *str)
+{
+	return str->bytes < INLINE_CAPACITY;
+}
+
+static inline char *get_body(StringObject *str)
+{
+	return is_inline(str) ? str->inline_body : str->body;
+}
+
 static int char_index_to_offset(StringObject *str, int idx)
 {
 	if(str->count == str->bytes)
@@ -78,7 +98,7 @@ static int char_index_to_offset(StringObject *str, int idx)
 
 	while(idx > 0)
 	{
-		last_code_len = utf8_sequence_to_utf32_codepoint(str->body + scanned_bytes, str->bytes - scanned_bytes, NULL);
+		last_code_len = utf8_sequence_to_utf32_codepoint(get_body(str) + scanned_bytes, str->bytes - scanned_bytes, NULL);
 		scanned_bytes += last_code_len;
 		idx -= 1;
 
@@ -110,9 +130,9 @@ static Object *select_(Object *self, Object *key, Heap *heap, Error *error)
 	}
 
 	int byteoffset = char_index_to_offset(str, idx);
-	int codelength = utf8_sequence_to_utf32_codepoint(str->body + byteoffset, str->bytes - byteoffset, NULL);
+	int codelength = utf8_sequence_to_utf32_codepoint(get_body(str) + byteoffset, str->bytes - byteoffset, NULL);
 
-	return Object_FromString(str->body + byteoffset, codelength, heap, error);
+	return Object_FromString(get_body(str) + byteoffset, codelength, heap, error);
 }
 
 const char *Object_GetString(Object *obj, size_t *size)
@@ -126,7 +146,7 @@ const char *Object_GetString(Object *obj, size_t *size)
 
 	StringObject *s = (StringObject*) obj;
 	if(size) *size = s->bytes;
-	return s->body;
+	return get_body(s);
 }
 
 TypeObject *Object_GetStringType()
@@ -156,16 +176,20 @@ Object *Object_FromString(const char *str, int len, Heap *heap, Error *error)
 	if(strobj == NULL)
 		return NULL;
 
-	strobj->body = Heap_RawMalloc(heap, len+1, error);
 	strobj->bytes = len;
 	strobj->count = count;
 
-	if(strobj->body == NULL)
-		return NULL;
+	if(!is_inline(strobj))
+	{
+		strobj->body = Heap_RawMalloc(heap, len+1, error);
 
-	memcpy(strobj->body, str, len);
+		if(strobj->body == NULL)
+			return NULL;
+	}
 
-	strobj->body[len] = '\0';
+	char *body = get_body(strobj);
+	memcpy(body, str, len);
+	body[len] = '\0';
 
 	return (Object*) strobj;
 }
@@ -187,7 +211,7 @@ static int hash(Object *self)
 
 	StringObject *strobj = (StringObject*) self;
 
-	return hashbytes((unsigned char*) strobj->body, strobj->count);
+	return hashbytes((unsigned char*) get_body(strobj), strobj->count);
 }
 
 static Object *copy(Object *self, Heap *heap, Error *err)
@@ -212,7 +236,7 @@ static _Bool op_eql(Object *self, Object *other)
 	StringObject *s1 = (StringObject*) self;
 	StringObject *s2 = (StringObject*) other;
 
-	_Bool match = s1->bytes == s2->bytes && !strncmp(s1->body, s2->body, s1->bytes);
+	_Bool match = s1->bytes == s2->bytes && !strncmp(get_body(s1), get_body(s2), s1->bytes);
 
 	return match;
 }
@@ -225,14 +249,15 @@ static void print(Object *obj, FILE *fp)
 
 	StringObject *str = (StringObject*) obj;
 
-	fprintf(fp, "%.*s", str->bytes, str->body);
+	fprintf(fp, "%.*s", str->bytes, get_body(str));
 }
 
 static void walkexts(Object *self, void (*callback)(void **referer, unsigned int size, void *userp), void *userp)
 {
 	StringObject *str = (StringObject*) self;
 	
-	callback((void**) &str->body, str->bytes+1, userp);
+	if(!is_inline(str))
+		callback((void**) &str->body, str->bytes+1, userp);
 }
 
 static Object*
@@ -242,5 +267,5 @@ keysof(Object *self,
 {
 	StringObject *str = (StringObject*) self;
 	int count = str->count;
-	return Object_NewListOfConsecutiveIntegers(0, count-1, heap, error);
+	return Object_NewRange(0, count, 1, heap, error);
 }
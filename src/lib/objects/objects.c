@@ -100,6 +100,11 @@ Object_KeysOf(Object *self,
 
 bool Object_IsTypeOf(Object *typ, Object *obj, Heap *heap, Error *error)
 {
+	// Most annotations are plain types,
+	// which don't need the call.
+	if (typ->type == &t_type)
+		return obj->type == (TypeObject*) typ;
+
 	if (typ->type->istypeof == NULL)
 		return false;
 	return typ->type->istypeof(typ, obj, heap, error);
@@ -127,9 +132,21 @@ Object *Object_Copy(Object *obj, Heap *heap, Error *err)
 		return NULL;
 	}
 
+	Heap_WriteBarrier(heap, obj);
 	return type->copy(obj, heap, err);
 }
 
+// Returns true if the object can't be modified, so
+// that containers holding it can share it with their
+// copies instead of copying it. Having no insert or
+// delete method isn't enough, since objects like map
+// views change with the objects they refer to.
+bool Object_IsShareable(Object *obj)
+{
+	const TypeObject *type = Object_GetType(obj);
+	return type->immutable;
+}
+
 int Object_Call(Object *obj, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Heap *heap, Error *err)
 {
 	ASSERT(err != NULL && obj != NULL);
@@ -201,7 +218,8 @@ Object *Object_Delete(Object *coll, Object *key, Heap *heap, Error *err)
 		return NULL;
 	}
 
-	return type->delete(coll, key, heap, err);	
+	Heap_WriteBarrier(heap, coll);
+	return type->delete(coll, key, heap, err);
 }
 
 _Bool Object_Insert(Object *coll, Object *key, Object *val, Heap *heap, Error *err)
@@ -219,6 +237,7 @@ _Bool Object_Insert(Object *coll, Object *key, Object *val, Heap *heap, Error *e
 		return 0;
 	}
 
+	Heap_WriteBarrier(heap, coll);
 	return type->insert(coll, key, val, heap, err);
 }
 
@@ -299,4 +318,11 @@ void Object_WalkExtensions(Object *parent, void (*callback)(void **referer, unsi
 	ASSERT(parent != NULL);
 	if(parent->type->walkexts != NULL)
 		parent->type->walkexts(parent, callback, userp);
+}
+
+void Object_WalkExterns(Object *parent, void (*callback)(void **referer, ExternKind kind, void *userp), void *userp)
+{
+	ASSERT(parent != NULL);
+	if(parent->type->walkexterns != NULL)
+		parent->type->walkexterns(parent, callback, userp);
 }
\ No newline at end of file
@@ -35,6 +35,7 @@
 #include <dirent.h>
 #include <stdbool.h>
 #include "../utils/error.h"
+#include "../utils/regex.h"
 
 #define MAX_RETS 8
 
@@ -42,6 +43,12 @@ typedef struct TypeObject TypeObject;
 typedef struct Object Object;
 typedef struct xHeap Heap;
 
+typedef enum {
+	MAPVIEW_KEYS,
+	MAPVIEW_VALUES,
+	MAPVIEW_ITEMS,
+} MapViewKind;
+
 struct Object {
 	TypeObject *type;
 	unsigned int flags;
@@ -52,6 +59,28 @@ typedef struct {
 	Object *new_location;
 } MovedObject;
 
+// A region of the heap, opened by [Heap_OpenRegion]. It
+// holds the state of the heap when it was opened, which
+// is restored when it's closed, unless the objects it
+// allocated may be referenced by older ones.
+typedef struct HeapRegion HeapRegion;
+struct HeapRegion {
+	HeapRegion *prev;
+	int used, total;
+	int objcount;
+	int pend_used;
+	bool escaped;
+};
+
+// Kinds of pointers to memory that isn't managed by
+// the heap, as reported by the [walkexterns] method.
+typedef enum {
+	EXTERN_STATIC,     // Static memory of the program, like functions or tables.
+	EXTERN_RUNTIME,    // The runtime that owns the object.
+	EXTERN_EXECUTABLE, // An executable the object holds a reference of.
+	EXTERN_EXESTRING,  // A string of the executable reported before it.
+} ExternKind;
+
 struct TypeObject {
 
 	Object base;
@@ -59,6 +88,12 @@ struct TypeObject {
 	const char *name;
 	size_t      size;
 
+	// Objects of immutable types can't change once
+	// they're created, so their copy is the object
+	// itself and containers can share them with
+	// their copies (see [Object_IsShareable]).
+	bool immutable;
+
 	bool  	(*init)(Object *self, Error *err);
 	bool  	(*free)(Object *self, Error *err);
 	int 	(*hash)(Object *self);
@@ -79,6 +114,13 @@ struct TypeObject {
 	bool (*op_eql)(Object *self, Object *other);
 	void (*walk)    (Object *self, void (*callback)(Object **referer,                    void *userp), void *userp);
 	void (*walkexts)(Object *self, void (*callback)(void   **referer, unsigned int size, void *userp), void *userp);
+
+	// Reports the pointers to memory outside of the heap,
+	// so that the object can be stored in a runtime image.
+	// Objects of types with a [free] method can only be 
+	// stored if they implement this, and the only thing 
+	// [free] does is releasing what's reported here.
+	void (*walkexterns)(Object *self, void (*callback)(void **referer, ExternKind kind, void *userp), void *userp);
 };
 
 enum {
@@ -89,6 +131,7 @@ enum {
 
 Heap*		 Heap_New(int size);
 void		 Heap_Free(Heap *heap);
+void 		 Heap_Reset(Heap *heap);
 void*		 Heap_Malloc   (Heap *heap, TypeObject *type, Error *err);
 void*		 Heap_RawMalloc(Heap *heap, int size, Error *err);
 bool  	 	 Heap_StartCollection(Heap *heap, Error *error);
@@ -98,11 +141,19 @@ float 		 Heap_GetUsagePercentage(Heap *heap);
 unsigned int Heap_GetObjectCount(Heap *heap);
 void        *Heap_GetPointer(Heap *heap);
 unsigned int Heap_GetSize(Heap *heap);
+unsigned int Heap_GetUsedSize(Heap *heap);
+bool 		 Heap_LoadImage(Heap *heap, const void *data, unsigned int size, unsigned int objcount, Error *err);
+bool 		 Heap_TrackDestructor(Heap *heap, Object *obj, Error *err);
+void         Heap_OpenRegion(Heap *heap, HeapRegion *region);
+bool         Heap_CloseRegion(Heap *heap, HeapRegion *region, Object **objs, int count);
+bool         Heap_IsInRegion(Heap *heap, HeapRegion *region, void *ptr);
+void         Heap_WriteBarrier(Heap *heap, Object *obj);
 
 const TypeObject* Object_GetType(const Object *obj);
 const char*	      Object_GetName(const Object *obj);
 int 		 Object_Hash (Object *obj);
 Object*		 Object_Copy (Object *obj, Heap *heap, Error *err);
+bool 		 Object_IsShareable(Object *obj);
 int          Object_Call (Object *obj, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Heap *heap, Error *err);
 void 		 Object_Print(Object *obj, FILE *fp);
 Object* 	 Object_KeysOf(Object *self, Heap *heap, Error *error);
@@ -113,16 +164,21 @@ bool 		 Object_Insert(Object *coll, Object *key, Object *val, Heap *heap, Error
 int 		 Object_Count (Object *coll, Error *err);
 void 		 Object_WalkReferences(Object *parent, void (*callback)(Object **referer,                    void *userp), void *userp);
 void 		 Object_WalkExtensions(Object *parent, void (*callback)(void   **referer, unsigned int size, void *userp), void *userp);
+void 		 Object_WalkExterns(Object *parent, void (*callback)(void **referer, ExternKind kind, void *userp), void *userp);
 
 Object*		 Object_NewMap(int num, Heap *heap, Error *error);
 Object*		 Object_NewList(int capacity, Heap *heap, Error *error);
 Object*		 Object_NewList2(int num, Object **items, Heap *heap, Error *error);
-Object*		 Object_NewListOfConsecutiveIntegers(int first, int last, Heap *heap, Error *error);
+Object*		 Object_NewRange(long long int start, long long int end, long long int step, Heap *heap, Error *error);
+Object*		 Object_NewMapView(Object *map, MapViewKind kind, Heap *heap, Error *error);
 Object*		 Object_NewNone(Heap *heap, Error *error);
 Object*      Object_NewBuffer(size_t size, Heap *heap, Error *error);
 Object*		 Object_NewBufferFromString(const char *str, size_t len, Heap *heap, Error *error);
 Object*		 Object_NewClosure(Object *parent, Object *new_map, Heap *heap, Error *error);
 Object*      Object_SliceBuffer(Object *obj, size_t offset, size_t length, Heap *heap, Error *error);
+Object*      Object_NewIntArray(size_t length, Heap *heap, Error *error);
+Object*      Object_NewFloatArray(size_t length, Heap *heap, Error *error);
+Object*      Object_SliceArray(Object *obj, size_t offset, size_t length, Heap *heap, Error *error);
 Object*      Object_NewNullable(Object *item, Heap *heap, Error *error);
 Object*		 Object_NewSum(Object *item0, Object *item1, Heap *heap, Error *error);
 Object*		 Object_NewAny();
@@ -133,6 +189,7 @@ Object*		 Object_FromFloat (double 		 val, Heap *heap, Error *error);
 Object*		 Object_FromString(const char *str, int len, Heap *heap, Error *error);
 Object*		 Object_FromStream(FILE *fp, Heap *heap, Error *error);
 Object* 	 Object_FromDIR(DIR *handle, Heap *heap, Error *error);
+Object*		 Object_FromRegex(Regex *regex, Heap *heap, Error *error);
 
 TypeObject *Object_GetTypeType();
 TypeObject *Object_GetNoneType();
@@ -143,8 +200,13 @@ TypeObject *Object_GetStringType();
 TypeObject *Object_GetListType();
 TypeObject *Object_GetMapType();
 TypeObject *Object_GetBufferType();
+TypeObject *Object_GetIntArrayType();
+TypeObject *Object_GetFloatArrayType();
+TypeObject *Object_GetRangeType();
+TypeObject *Object_GetMapViewType();
 TypeObject *Object_GetFileType();
 TypeObject *Object_GetDirType();
+TypeObject *Object_GetRegexType();
 TypeObject *Object_GetNullableType();
 TypeObject *Object_GetSumType();
 TypeObject *Object_GetAnyType();
@@ -155,8 +217,13 @@ bool  Object_IsBool(Object *obj);
 bool  Object_IsFloat(Object *obj);
 bool  Object_IsString(Object *obj);
 bool  Object_IsBuffer(Object *obj);
+bool  Object_IsIntArray(Object *obj);
+bool  Object_IsFloatArray(Object *obj);
+bool  Object_IsRange(Object *obj);
+bool  Object_IsMapView(Object *obj);
 bool  Object_IsFile(Object *obj);
 bool  Object_IsDir(Object *obj);
+bool  Object_IsRegex(Object *obj);
 bool  Object_IsMap(Object *obj);
 bool  Object_IsList(Object *obj);
 
@@ -165,8 +232,25 @@ bool  		  Object_GetBool (Object *obj);
 double		  Object_GetFloat(Object *obj);
 const char	 *Object_GetString(Object *obj, size_t *size);
 DIR    		 *Object_GetDIR(Object *obj);
+Regex  		 *Object_GetRegex(Object *obj);
 FILE   		 *Object_GetStream(Object *obj);
 void         *Object_GetBuffer(Object *obj, size_t *size);
+long long int *Object_GetIntArray(Object *obj, size_t *length);
+double       *Object_GetFloatArray(Object *obj, size_t *length);
+Object      **Object_GetListItems(Object *obj, int *count);
+Object      **Object_GetMutableListItems(Object *obj, int *count, Heap *heap, Error *error);
+void          Object_GetRange(Object *obj, long long int *start, long long int *step, int *count);
+
+bool          Object_InsertIntoList(Object *list, int idx, Object *item, Heap *heap, Error *error);
+Object       *Object_RemoveFromList(Object *list, int idx, Heap *heap, Error *error);
+bool          Object_ExtendList(Object *list, Object **items, int num, Heap *heap, Error *error);
+bool          Object_NextMapItem(Object *map, int *pos, Object **key, Object **val);
+bool          Object_SeekMapItem(Object *map, int *pos, int *idx, int target);
+unsigned int  Object_GetMapVersion(Object *map);
+Object       *Object_GetViewedMap(Object *view);
+
+Object       *Object_NewIterator(Object *set, Heap *heap, Error *error);
+int           Object_NextFromIterator(Object *iter, Object **key, Object **val, Heap *heap, Error *error);
 
 bool  		  Object_Compare(Object *obj1, Object *obj2, Error *error);
 
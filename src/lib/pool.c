@@ -0,0 +1,87 @@
+#include <stdlib.h>
+#include "pool.h"
+
+// A runtime pool holds runtimes made from the same image
+// that are ready to run scripts. Embedders that run many
+// short scripts can acquire a runtime, run a script on it
+// and release it, instead of paying for a new runtime each
+// time. Runtimes are reset when they're released, so that
+// acquiring one only takes it from the idle list.
+//
+// The image must outlive the pool and the pool isn't safe
+// to use from multiple threads.
+
+struct xRuntimePool {
+	RuntimeImage *image;
+	RuntimeConfig config;
+	int idlec, size;
+	Runtime *idle[];
+};
+
+// Makes a pool holding up to [size] idle runtimes. They
+// are all made upfront.
+RuntimePool *RuntimePool_New(RuntimeImage *image, RuntimeConfig config, int size, Error *error)
+{
+	if (size < 0) {
+		Error_Report(error, ErrorType_INTERNAL, "Invalid pool size %d", size);
+		return NULL;
+	}
+
+	RuntimePool *pool = malloc(sizeof(RuntimePool) + size * sizeof(Runtime*));
+	if (pool == NULL) {
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		return NULL;
+	}
+	pool->image = image;
+	pool->config = config;
+	pool->idlec = 0;
+	pool->size = size;
+
+	while (pool->idlec < size) {
+		Runtime *runtime = Runtime_NewFromImage(image, config, error);
+		if (runtime == NULL) {
+			RuntimePool_Free(pool);
+			return NULL;
+		}
+		pool->idle[pool->idlec++] = runtime;
+	}
+	return pool;
+}
+
+// Returns an idle runtime or, when there are none, makes
+// a new one. The runtime must be given back using
+// [RuntimePool_Release] or freed using [Runtime_Free].
+Runtime *RuntimePool_Acquire(RuntimePool *pool, Error *error)
+{
+	if (pool->idlec > 0)
+		return pool->idle[--pool->idlec];
+	return Runtime_NewFromImage(pool->image, pool->config, error);
+}
+
+// Resets the runtime to the state of the image and puts
+// it back in the idle list. If the list is full or the
+// reset fails, the runtime is freed.
+void RuntimePool_Release(RuntimePool *pool, Runtime *runtime)
+{
+	if (pool->idlec == pool->size) {
+		Runtime_Free(runtime);
+		return;
+	}
+
+	Error error;
+	Error_Init(&error);
+	if (!Runtime_ResetFromImage(runtime, pool->image, &error)) {
+		Error_Free(&error);
+		Runtime_Free(runtime);
+		return;
+	}
+	Error_Free(&error);
+	pool->idle[pool->idlec++] = runtime;
+}
+
+void RuntimePool_Free(RuntimePool *pool)
+{
+	for (int i = 0; i < pool->idlec; i++)
+		Runtime_Free(pool->idle[i]);
+	free(pool);
+}
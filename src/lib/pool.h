@@ -0,0 +1,11 @@
+#ifndef POOL_H
+#define POOL_H
+#include "image.h"
+
+typedef struct xRuntimePool RuntimePool;
+
+RuntimePool *RuntimePool_New(RuntimeImage *image, RuntimeConfig config, int size, Error *error);
+Runtime     *RuntimePool_Acquire(RuntimePool *pool, Error *error);
+void         RuntimePool_Release(RuntimePool *pool, Runtime *runtime);
+void         RuntimePool_Free(RuntimePool *pool);
+#endif
@@ -1,9 +1,12 @@
 #include <time.h>
+#include <sys/stat.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdio.h>
 #include "runtime.h"
 #include "utils/defs.h"
 #include "utils/path.h"
+#include "utils/hash.h"
 #include "compiler/compile.h"
 #include "assembler/assemble.h"
 
@@ -38,6 +41,14 @@ static void func_walk(Object *self, void (*callback)(Object **referer, void *use
 	callback(&func->closure, userp);
 }
 
+static void func_walkexterns(Object *self, void (*callback)(void **referer, ExternKind kind, void *userp), void *userp)
+{
+	FunctionObject *func = (FunctionObject*) self;
+	callback((void**) &func->runtime, EXTERN_RUNTIME, userp);
+	callback((void**) &func->exe, EXTERN_EXECUTABLE, userp);
+	callback((void**) &func->name, EXTERN_EXESTRING, userp);
+}
+
 static int func_call(Object *self, Object **argv, unsigned int argc, Object *rets[static MAX_RETS], Heap *heap, Error *error)
 {
 	ASSERT(self != NULL && heap != NULL && error != NULL);
@@ -123,6 +134,7 @@ static TypeObject t_func = {
 	.size = sizeof (FunctionObject),
 	.call = func_call,
 	.walk = func_walk,
+	.walkexterns = func_walkexterns,
 	.free = func_free,
 };
 
@@ -268,31 +280,48 @@ static int native_func_call(Object *self, Object **argv, unsigned int argc, Obje
 		argc2 = -1;
 	}
 
-	if (!Runtime_PushNativeFrame(func->runtime, error))
+	// The function object itself may be moved by the
+	// collector while the callback runs.
+	Runtime *runtime = func->runtime;
+
+	if (!Runtime_PushNativeFrame(runtime, error, argv2, argc2))
     	return -1;
 
 	ASSERT(func->callback != NULL);
-	int retc = func->callback(func->runtime, argv2, argc2, rets, error);
+	int retc = func->callback(runtime, argv2, argc2, rets, error);
 		
 	// NOTE: Since the callback may have executed some bytecode, a GC
 	//       cycle may have been triggered, therefore we must assume
 	//       every object reference that was locally saved is invalidated 
-	//       from here (the returned object is good tho).
+	//       from here (the returned object is good tho). The arguments
+	//       in [argv2] are kept up to date by the native frame.
 
 	if(argv2 != argv)
 		free(argv2);
 
-	if (retc >= 0 && !Runtime_PopFrame(func->runtime))
+	// On failure the frame stays for the stack trace,
+	// but without the arguments that are gone by now.
+	if (retc < 0)
+		Runtime_ForgetNativeArgs(runtime);
+	else if (!Runtime_PopFrame(runtime))
     	return -1;
 
 	return retc;
 }
 
+static void native_func_walkexterns(Object *self, void (*callback)(void **referer, ExternKind kind, void *userp), void *userp)
+{
+	NativeFunctionObject *func = (NativeFunctionObject*) self;
+	callback((void**) &func->runtime, EXTERN_RUNTIME, userp);
+	callback((void**) &func->callback, EXTERN_STATIC, userp);
+}
+
 static TypeObject t_nfunc = {
 	.base = (Object) { .type = &t_type, .flags = Object_STATIC },
 	.name = "native function",
 	.size = sizeof (NativeFunctionObject),
 	.call = native_func_call,	
+	.walkexterns = native_func_walkexterns,
 };
 
 /* Symbol: Object_FromNativeFunction
@@ -492,6 +521,104 @@ static Object *do_relational_op(Object *lop, Object *rop, Opcode opcode, Heap *h
 	return Object_FromBool(res, heap, error);
 }
 
+static void reportUnallowedType(Error *error, int arg_index, const char *arg_name, Object *typ, Object *arg)
+{
+	char provided[512];
+	char allowed[512];
+	FILE *provided_fp = fmemopen(provided, sizeof(provided), "wb");
+	FILE  *allowed_fp = fmemopen(allowed, sizeof(allowed), "wb");
+	// TODO: Check for errors from [fmemopen]
+	Object_Print(typ, allowed_fp);
+	Object_Print(arg, provided_fp);
+	fclose(allowed_fp);
+	fclose(provided_fp);
+	Error_Report(error, ErrorType_RUNTIME, "Argument %d \"%s\" has an unallowed type. Was expected something with type %s but was provided %s", 
+				 arg_index+1, arg_name, allowed, provided);
+}
+
+// Returns the generic version of an instruction
+// specialized for ints or floats.
+static Opcode generic_opcode(Opcode opcode)
+{
+	switch(opcode)
+	{
+		case OPCODE_ADDINT: case OPCODE_ADDFLT: return OPCODE_ADD;
+		case OPCODE_SUBINT: case OPCODE_SUBFLT: return OPCODE_SUB;
+		case OPCODE_MULINT: case OPCODE_MULFLT: return OPCODE_MUL;
+		case OPCODE_LSSINT: case OPCODE_LSSFLT: return OPCODE_LSS;
+		case OPCODE_GRTINT: case OPCODE_GRTFLT: return OPCODE_GRT;
+		case OPCODE_LEQINT: case OPCODE_LEQFLT: return OPCODE_LEQ;
+		case OPCODE_GEQINT: case OPCODE_GEQFLT: return OPCODE_GEQ;
+		default: UNREACHABLE; break;
+	}
+	return opcode;
+}
+
+// Runs the instructions that the compiler specializes
+// when both operands are known to be ints or floats.
+// Since bytecode may also be written by hand, operands
+// of other types are handled by the generic operation.
+static Object *do_specialized_op(Object *lop, Object *rop, Opcode opcode, Heap *heap, Error *error)
+{
+	switch(opcode)
+	{
+		case OPCODE_ADDINT: case OPCODE_SUBINT: case OPCODE_MULINT:
+		case OPCODE_LSSINT: case OPCODE_GRTINT: case OPCODE_LEQINT: case OPCODE_GEQINT:
+		{
+			TypeObject *type = Object_GetIntType();
+			if(lop->type != type || rop->type != type)
+				break;
+
+			long long int x = Object_GetInt(lop);
+			long long int y = Object_GetInt(rop);
+			switch(opcode)
+			{
+				case OPCODE_ADDINT: return Object_FromInt(x + y, heap, error);
+				case OPCODE_SUBINT: return Object_FromInt(x - y, heap, error);
+				case OPCODE_MULINT: return Object_FromInt(x * y, heap, error);
+				case OPCODE_LSSINT: return Object_FromBool(x <  y, heap, error);
+				case OPCODE_GRTINT: return Object_FromBool(x >  y, heap, error);
+				case OPCODE_LEQINT: return Object_FromBool(x <= y, heap, error);
+				case OPCODE_GEQINT: return Object_FromBool(x >= y, heap, error);
+				default: UNREACHABLE; break;
+			}
+			break;
+		}
+
+		case OPCODE_ADDFLT: case OPCODE_SUBFLT: case OPCODE_MULFLT:
+		case OPCODE_LSSFLT: case OPCODE_GRTFLT: case OPCODE_LEQFLT: case OPCODE_GEQFLT:
+		{
+			TypeObject *type = Object_GetFloatType();
+			if(lop->type != type || rop->type != type)
+				break;
+
+			double x = Object_GetFloat(lop);
+			double y = Object_GetFloat(rop);
+			switch(opcode)
+			{
+				case OPCODE_ADDFLT: return Object_FromFloat(x + y, heap, error);
+				case OPCODE_SUBFLT: return Object_FromFloat(x - y, heap, error);
+				case OPCODE_MULFLT: return Object_FromFloat(x * y, heap, error);
+				case OPCODE_LSSFLT: return Object_FromBool(x <  y, heap, error);
+				case OPCODE_GRTFLT: return Object_FromBool(x >  y, heap, error);
+				case OPCODE_LEQFLT: return Object_FromBool(x <= y, heap, error);
+				case OPCODE_GEQFLT: return Object_FromBool(x >= y, heap, error);
+				default: UNREACHABLE; break;
+			}
+			break;
+		}
+
+		default:
+		UNREACHABLE;
+		break;
+	}
+
+	Opcode generic = generic_opcode(opcode);
+	if(generic == OPCODE_ADD || generic == OPCODE_SUB || generic == OPCODE_MUL)
+		return do_math_op(lop, rop, generic, heap, error);
+	return do_relational_op(lop, rop, generic, heap, error);
+}
+
 static _Bool runInstruction(Runtime *runtime, Error *error)
 {
 	ASSERT(runtime != NULL);
@@ -690,6 +817,24 @@ static _Bool runInstruction(Runtime *runtime, Error *error)
 			return Runtime_Push(runtime, error, res);
 		}
 
+		case OPCODE_ADDINT: case OPCODE_ADDFLT:
+		case OPCODE_SUBINT: case OPCODE_SUBFLT:
+		case OPCODE_MULINT: case OPCODE_MULFLT:
+		case OPCODE_LSSINT: case OPCODE_LSSFLT:
+		case OPCODE_GRTINT: case OPCODE_GRTFLT:
+		case OPCODE_LEQINT: case OPCODE_LEQFLT:
+		case OPCODE_GEQINT: case OPCODE_GEQFLT:
+		{
+			ASSERT(opc == 0);
+			Object *objs[2];
+			if(!Runtime_Pop(runtime, error, objs, 2))
+				return 0;
+			Object *res = do_specialized_op(objs[1], objs[0], opcode, heap, error);
+			if(res == NULL)
+				return 0;
+			return Runtime_Push(runtime, error, res);
+		}
+
 		case OPCODE_ASS:
 		{
 			ASSERT(opc == 1);
@@ -736,17 +881,32 @@ static _Bool runInstruction(Runtime *runtime, Error *error)
 				return 0;
 
 			if (!Object_IsTypeOf(typ, arg, heap, error)) {
-				char provided[512];
-				char allowed[512];
-				FILE *provided_fp = fmemopen(provided, sizeof(provided), "wb");
-				FILE  *allowed_fp = fmemopen(allowed, sizeof(allowed), "wb");
-				// TODO: Check for errors from [fmemopen]
-				Object_Print(typ, allowed_fp);
-				Object_Print(arg, provided_fp);
-				fclose(allowed_fp);
-				fclose(provided_fp);
-				Error_Report(error, ErrorType_RUNTIME, "Argument %d \"%s\" has an unallowed type. Was expected something with type %s but was provided %s", 
-							 arg_index+1, arg_name, allowed, provided);
+				reportUnallowedType(error, arg_index, arg_name, typ, arg);
+				return 0;
+			}
+			return 1;
+		}
+
+		case OPCODE_CHECKINT:
+		case OPCODE_CHECKFLT:
+		{
+			// Same as CHECKTYPE, for the builtin
+			// numeric types, which aren't pushed.
+			ASSERT(opc == 2);
+			ASSERT(ops[0].type == OPTP_INT);
+			ASSERT(ops[1].type == OPTP_STRING);
+
+			Object *arg = Runtime_Top(runtime, 0);
+			if(arg == NULL)
+			{
+				Error_Report(error, ErrorType_INTERNAL, "Frame doesn't own enough objects to execute %s", 
+							 opcode == OPCODE_CHECKINT ? "CHECKINT" : "CHECKFLT");
+				return 0;
+			}
+
+			TypeObject *typ = (opcode == OPCODE_CHECKINT) ? Object_GetIntType() : Object_GetFloatType();
+			if (Object_GetType(arg) != typ) {
+				reportUnallowedType(error, ops[0].as_int, ops[1].as_string, (Object*) typ, arg);
 				return 0;
 			}
 			return 1;
@@ -1036,13 +1196,77 @@ static _Bool runInstruction(Runtime *runtime, Error *error)
 			ASSERT(opc == 1);
 			ASSERT(ops[0].type == OPTP_INT);
 			int retc = ops[0].as_int;
-			UNUSED(retc);
 			ASSERT(retc >= 0);
 			ASSERT(retc <= MAX_RETS);
-			ASSERT((size_t) retc == Runtime_GetFrameStackUsage(runtime));
+			ASSERT((size_t) retc <= Runtime_GetFrameStackUsage(runtime));
+
+			// The values below the returned ones (the
+			// iterators of the for loops the return is
+			// in) are dropped, since the caller takes
+			// everything that's left on the stack.
+			int extra = Runtime_GetFrameStackUsage(runtime) - retc;
+			if (extra > 0) {
+				Object *rets[MAX_RETS];
+				if (!Runtime_Pop(runtime, error, rets, retc))
+					return 0;
+				if (!Runtime_Pop(runtime, error, NULL, extra))
+					return 0;
+				for (int i = retc-1; i >= 0; i--)
+					if (!Runtime_Push(runtime, error, rets[i]))
+						return 0;
+			}
 			return 0;
 		}
 
+		case OPCODE_ITER_INIT:
+		{
+			ASSERT(opc == 0);
+
+			Object *set;
+			if (!Runtime_Pop(runtime, error, &set, 1))
+				return 0;
+
+			Object *iter = Object_NewIterator(set, Runtime_GetHeap(runtime), error);
+			if (iter == NULL)
+				return 0;
+
+			return Runtime_Push(runtime, error, iter);
+		}
+
+		case OPCODE_ITER_NEXT:
+		{
+			// Pushes the key (if the second operand is 2)
+			// and the value of the next item, leaving the
+			// iterator on the stack, or jumps to the first 
+			// operand if there are no more items.
+			ASSERT(opc == 2);
+			ASSERT(ops[0].type == OPTP_IDX);
+			ASSERT(ops[1].type == OPTP_INT);
+			ASSERT(ops[1].as_int == 1 || ops[1].as_int == 2);
+
+			Object *iter = Runtime_Top(runtime, 0);
+			if (iter == NULL) {
+				Error_Report(error, ErrorType_INTERNAL, "Frame has not enough values on the stack to run ITER_NEXT instruction");
+				return 0;
+			}
+
+			bool with_key = (ops[1].as_int == 2);
+
+			Object *key, *val;
+			int res = Object_NextFromIterator(iter, with_key ? &key : NULL, &val, Runtime_GetHeap(runtime), error);
+			if (res < 0)
+				return 0;
+
+			if (res == 0) {
+				Runtime_SetInstructionIndex(runtime, ops[0].as_int);
+				return 1;
+			}
+
+			if (with_key && !Runtime_Push(runtime, error, key))
+				return 0;
+			return Runtime_Push(runtime, error, val);
+		}
+
 		case OPCODE_JUMP:
 		ASSERT(opc == 1);
 		ASSERT(ops[0].type == OPTP_IDX);
@@ -1071,6 +1295,65 @@ static _Bool runInstruction(Runtime *runtime, Error *error)
 			return 1;
 		}
 
+		case OPCODE_CHECKFUN:
+		{
+			// Guard of an inlined call. If the object on top
+			// is the function with the code at the first operand
+			// of this executable, it's popped and the inlined body
+			// that follows runs. Otherwise the execution continues
+			// at the second operand with the object still on the
+			// stack, where the normal call is. The normal call is
+			// also used when profiling, to time the function.
+			ASSERT(opc == 2);
+			ASSERT(ops[0].type == OPTP_IDX);
+			ASSERT(ops[1].type == OPTP_IDX);
+
+			Object *callable = Runtime_Top(runtime, 0);
+			if (callable == NULL) {
+				Error_Report(error, ErrorType_INTERNAL, "Frame has not enough values on the stack to run CHECKFUN instruction");
+				return 0;
+			}
+
+			if (Object_GetType(callable) == &t_func
+				&& ((FunctionObject*) callable)->exe == exe
+				&& ((FunctionObject*) callable)->index == ops[0].as_int
+				&& Runtime_GetTimingTable(runtime) == NULL)
+				return Runtime_Pop(runtime, error, NULL, 1);
+
+			Runtime_SetInstructionIndex(runtime, ops[1].as_int);
+			return 1;
+		}
+
+		case OPCODE_PUSHSTK:
+		{
+			// Pushes the object at the given distance from
+			// the top of the stack (0 duplicates the top).
+			ASSERT(opc == 1);
+			ASSERT(ops[0].type == OPTP_INT);
+
+			Object *obj = Runtime_Top(runtime, -ops[0].as_int);
+			if (obj == NULL) {
+				Error_Report(error, ErrorType_INTERNAL, "Frame has not enough values on the stack to run PUSHSTK instruction");
+				return 0;
+			}
+			return Runtime_Push(runtime, error, obj);
+		}
+
+		case OPCODE_POPUNDER:
+		{
+			// Pops the given number of objects
+			// below the top one.
+			ASSERT(opc == 1);
+			ASSERT(ops[0].type == OPTP_INT);
+
+			Object *top;
+			if (!Runtime_Pop(runtime, error, &top, 1))
+				return 0;
+			if (!Runtime_Pop(runtime, error, NULL, ops[0].as_int))
+				return 0;
+			return Runtime_Push(runtime, error, top);
+		}
+
 		default:
 		UNREACHABLE;
 		return 0;
@@ -1131,10 +1414,82 @@ static int runExecutableAtIndex(Runtime *runtime, Error *error,
 	return retc;
 }
 
+// Builds the path of the file in the cache folder
+// where the executable of a script is stored. It's 
+// named after the hash of the script's absolute path.
+static bool makeCachePath(const char *folder, const char *script, char *buff, size_t buffsize)
+{
+	uint64_t hash = hashbytes64(script, strlen(script));
+
+	size_t folderl = strlen(folder);
+	const char *sep = (folderl > 0 && folder[folderl-1] == '/') ? "" : "/";
+
+	int k = snprintf(buff, buffsize, "%s%s%016llx.nojac", folder, sep, (unsigned long long) hash);
+	return k >= 0 && (size_t) k < buffsize;
+}
+
+// Compiles a source, or loads its executable from the
+// cache folder of the runtime if it was compiled before
+// and didn't change since. Strings and runtimes with no
+// cache folder are always compiled. Failing to use the
+// cache is never an error: the source is compiled as 
+// if there was no cache.
+static Executable *compileUsingFolder(const char *folder, Source *source, uint64_t hash, Error *error, int *error_offset)
+{
+	const char *script = Source_GetAbsolutePath(source);
+	
+	char path[1024];
+	if (folder == NULL || script == NULL || !makeCachePath(folder, script, path, sizeof(path)))
+		return compile(source, error, error_offset);
+
+	Error suberror;
+	Error_Init(&suberror);
+
+	Executable *exe = Executable_Load(path, hash, &suberror);
+	if (exe != NULL && !Executable_SetSource(exe, source)) {
+		Executable_Free(exe);
+		exe = NULL;
+	}
+
+	if (exe == NULL) {
+		Error_Free(&suberror);
+		Error_Init(&suberror);
+
+		exe = compile(source, error, error_offset);
+		if (exe != NULL)
+			Executable_Save(exe, path, hash, &suberror);
+	}
+
+	Error_Free(&suberror);
+	return exe;
+}
+
+// Compiles the source, unless its executable is in the
+// runtime's code cache or cache folder.
+static Executable *compileUsingCache(Runtime *runtime, Source *source, Error *error, int *error_offset)
+{
+	const char *folder = Runtime_GetCacheFolder(runtime);
+	CodeCache  *codecache = Runtime_GetCodeCache(runtime);
+	
+	if (folder == NULL && codecache == NULL)
+		return compile(source, error, error_offset);
+
+	uint64_t hash = hashbytes64(Source_GetBody(source), Source_GetSize(source));
+
+	Executable *exe;
+	if (codecache != NULL && (exe = CodeCache_Lookup(codecache, source, hash)) != NULL)
+		return exe;
+
+	exe = compileUsingFolder(folder, source, hash, error, error_offset);
+	if (exe != NULL && codecache != NULL)
+		CodeCache_Insert(codecache, source, hash, exe);
+	return exe;
+}
+
 int runSource(Runtime *runtime, Source *source, Object *rets[static MAX_RETS], Error *error)
 {
 	int error_offset;
-	Executable *exe = compile(source, error, &error_offset);
+	Executable *exe = compileUsingCache(runtime, source, error, &error_offset);
     if(exe == NULL) {
     	Error suberror;
     	Error_Init(&suberror);
@@ -1149,6 +1504,11 @@ int runSource(Runtime *runtime, Source *source, Object *rets[static MAX_RETS], E
     return retc;
 }
 
+int runExecutable(Runtime *runtime, Executable *exe, Object *rets[static MAX_RETS], Error *error)
+{
+	return runExecutableAtIndex(runtime, error, exe, 0, NULL, rets, NULL, 0);
+}
+
 int runBytecodeSource(Runtime *runtime, Source *source, Object *rets[static MAX_RETS], Error *error)
 {
 	int error_offset;
@@ -1167,14 +1527,66 @@ int runBytecodeSource(Runtime *runtime, Source *source, Object *rets[static MAX_
     return retc;
 }
 
+// Records in the module map of the runtime that the file
+// with the given canonical path is running, by mapping it
+// to none. Imports of a running file are cycles.
+static bool markModuleAsRunning(Runtime *runtime, const char *canonical, Error *error)
+{
+	Heap *heap = Runtime_GetHeap(runtime);
+
+	Object *modules = Runtime_GetModules(runtime, error);
+	if (modules == NULL)
+		return false;
+
+	Object *key = Object_FromString(canonical, -1, heap, error);
+	if (key == NULL)
+		return false;
+
+	Object *marker = Object_NewNone(heap, error);
+	if (marker == NULL)
+		return false;
+
+	return Object_Insert(modules, key, marker, heap, error);
+}
+
+// Removes the file from the module map of the runtime, so
+// that the next import runs it.
+static void forgetModule(Runtime *runtime, const char *canonical)
+{
+	Error error;
+	Error_Init(&error);
+
+	Heap *heap = Runtime_GetHeap(runtime);
+	Object *modules = Runtime_GetModules(runtime, &error);
+	if (modules != NULL) {
+		Object *key = Object_FromString(canonical, -1, heap, &error);
+		if (key != NULL)
+			Object_Delete(modules, key, heap, &error);
+	}
+	Error_Free(&error);
+}
+
 int runFileEx(Runtime *runtime, const char *file, Object *rets[static MAX_RETS], Error *error)
 {
 	Source *source = Source_FromFile(file, error);
 	if (source == NULL)
 		return -1;
 
+	// The script is registered as a running module, so
+	// that the imports leading back to it are reported
+	// as cycles instead of running it again.
+	char canonical[1024];
+	bool registered = Path_MakeCanonical(file, canonical, sizeof(canonical)) != NULL;
+	if (registered && !markModuleAsRunning(runtime, canonical, error)) {
+		Source_Free(source);
+		return -1;
+	}
+
 	int retc = runSource(runtime, source, rets, error);
 
+	if (registered)
+		forgetModule(runtime, canonical);
+
 	Source_Free(source);
 	return retc;
 }
@@ -1283,3 +1695,105 @@ int runFileRelativeToScript(Runtime *runtime, const char *file, Object *rets[sta
 	Source_Free(source);
 	return retc;
 }
+
+static long long int getModificationTime(const char *path)
+{
+	struct stat info;
+	if (stat(path, &info))
+		return -1;
+	return (long long int) info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+}
+
+// Runs the file like [runFileRelativeToScript] the first
+// time it's imported and returns the same values the next
+// times, without running it again. The results are stored
+// in the module map of the runtime, keyed by the canonical
+// path of the file, as a list holding the modification 
+// time of the file followed by them. The file is run again
+// when it's modified or when [reload] is true. While the
+// file is running, its key maps to none, so that cycles
+// of imports can be detected.
+int importFileRelativeToScript(Runtime *runtime, const char *file, bool reload, Object *rets[static MAX_RETS], Error *error)
+{
+	char full[1024];
+	if (!makePathRelativeToScript(runtime, file, full, sizeof(full))) {
+		Error_Report(error, ErrorType_INTERNAL, "Internal buffer is too small");
+		return -1;
+	}
+
+	char canonical[1024];
+	if (Path_MakeCanonical(full, canonical, sizeof(canonical)) == NULL) {
+		Error_Report(error, ErrorType_RUNTIME, "Couldn't import \"%s\"", full);
+		return -1;
+	}
+
+	long long int mtime = getModificationTime(canonical);
+	Heap *heap = Runtime_GetHeap(runtime);
+
+	Object *modules = Runtime_GetModules(runtime, error);
+	if (modules == NULL)
+		return -1;
+
+	Object *key = Object_FromString(canonical, -1, heap, error);
+	if (key == NULL)
+		return -1;
+
+	Object *entry = Object_Select(modules, key, heap, error);
+	if (entry != NULL) {
+
+		if (Object_IsNone(entry)) {
+			Error_Report(error, ErrorType_RUNTIME, "Import cycle detected while importing \"%s\"", canonical);
+			return -1;
+		}
+
+		int count;
+		Object **items = Object_GetListItems(entry, &count);
+		if (!reload && Object_GetInt(items[0]) == mtime) {
+			for (int i = 1; i < count; i++)
+				rets[i-1] = items[i];
+			return count-1;
+		}
+	}
+	if (error->occurred)
+		return -1;
+
+	if (!markModuleAsRunning(runtime, canonical, error))
+		return -1;
+
+	// NOTE: The collector may run while the file
+	//       is executed, so every object reference 
+	//       other than [rets] is invalid from here.
+	int retc = runFileRelativeToScript(runtime, file, rets, error);
+	if (retc < 0) {
+		// Forget about the failed import, so that
+		// it can be tried again.
+		forgetModule(runtime, canonical);
+		return -1;
+	}
+
+	modules = Runtime_GetModules(runtime, error);
+	if (modules == NULL)
+		return -1;
+
+	key = Object_FromString(canonical, -1, heap, error);
+	if (key == NULL)
+		return -1;
+
+	Object *items[MAX_RETS+1];
+	items[0] = Object_FromInt(mtime, heap, error);
+	if (items[0] == NULL)
+		return -1;
+
+	int stored = MIN(retc, MAX_RETS);
+	for (int i = 0; i < stored; i++)
+		items[i+1] = rets[i];
+
+	entry = Object_NewList2(stored+1, items, heap, error);
+	if (entry == NULL)
+		return -1;
+
+	if (!Object_Insert(modules, key, entry, heap, error))
+		return -1;
+
+	return retc;
+}
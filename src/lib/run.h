@@ -1,5 +1,6 @@
 #include "runtime.h"
 int  runSource(Runtime *runtime, Source *source, Object *rets[static MAX_RETS], Error *error);
+int  runExecutable(Runtime *runtime, Executable *exe, Object *rets[static MAX_RETS], Error *error);
 int  runBytecodeSource(Runtime *runtime, Source *source, Object *rets[static MAX_RETS], Error *error);
 bool runFile(Runtime *runtime, const char *file, Error *error);
 bool runString(Runtime *runtime, const char *string, Error *error);
@@ -10,3 +11,4 @@ int  runStringEx(Runtime *runtime, const char *name, const char *string, Object
 int  runBytecodeFileEx(Runtime *runtime, const char *file, Object *rets[static MAX_RETS], Error *error);
 int  runBytecodeStringEx(Runtime *runtime, const char *name, const char *string, Object *rets[static MAX_RETS], Error *error);
 int  runFileRelativeToScript(Runtime *runtime, const char *file, Object *rets[static MAX_RETS], Error *error);
+int  importFileRelativeToScript(Runtime *runtime, const char *file, bool reload, Object *rets[static MAX_RETS], Error *error);
@@ -34,6 +34,7 @@
 #include "run.h"
 #include "runtime.h"
 #include "utils/path.h"
+#include "utils/hash.h"
 #include "utils/defs.h"
 #include "utils/stack.h"
 #include "builtins/basic.h"
@@ -61,8 +62,14 @@ typedef struct {
 	int index, used;
 } NormalFrame;
 
+// The arguments of native functions are referenced
+// by their frame, so that they're kept alive (and 
+// updated when moved) by the garbage collector if
+// the function calls back into noja code.
 typedef struct {
 	Frame base;
+	Object **argv;
+	unsigned int argc;
 } NativeFrame;
 
 typedef struct {
@@ -76,6 +83,7 @@ struct xRuntime {
 	RuntimeCallback callback;
 	_Bool free_heap;
 	Object *builtins;
+	Object *modules;
 	int    depth;
 	Frame *frame;
 	Stack *stack;
@@ -86,6 +94,10 @@ struct xRuntime {
 	FILE *stdout;
 	FILE *stderr;
 
+	const char *cache;
+	CodeCache *codecache;
+	RegexCache *regexcache;
+
 	FailedFrame failed_frame;
 };
 
@@ -119,6 +131,8 @@ RuntimeConfig Runtime_GetDefaultConfigs()
         .stdin  = stdin,
         .stdout = stdout,
         .stderr = stderr,
+        .cache  = NULL,
+        .codecache = NULL,
     };
 }
 
@@ -167,11 +181,18 @@ static int getFrameOffset(Frame *frame)
 	return -1;
 }
 
-static void printFrame(Frame *frame, int depth, FILE *stream)
+// Returns the offset of the call that the current
+// instruction of the frame was inlined into, or -1.
+static int getFrameCaller(Frame *frame)
 {
-	Source *source = getFrameSource(frame);
-	int     offset = getFrameOffset(frame);
+	if (frame->type != FrameType_NORMAL)
+		return -1;
+	NormalFrame *normal_frame = (NormalFrame*) frame;
+	return Executable_GetInstrCaller(normal_frame->exe, normal_frame->index);
+}
 
+static void printLocation(Source *source, int offset, int depth, FILE *stream)
+{
 	int line;
 	const char *name;
 
@@ -220,9 +241,20 @@ void Runtime_PrintStackTrace(Runtime *runtime, FILE *stream)
 	else {
 		size_t depth = 0;
 		do {
-			printFrame(frame, depth, stream);
-			frame = frame->prev;
+			Source *source = getFrameSource(frame);
+			printLocation(source, getFrameOffset(frame), depth, stream);
 			depth++;
+
+			// Code inlined into a call is shown with the
+			// call site below it, like the callee's frame
+			// would have been.
+			int caller = getFrameCaller(frame);
+			if (caller >= 0) {
+				printLocation(source, caller, depth, stream);
+				depth++;
+			}
+
+			frame = frame->prev;
 		} while (frame != NULL);
 	}
 }
@@ -357,6 +389,7 @@ Runtime *Runtime_New(RuntimeConfig config)
 	runtime->timing = timing_table;
 	runtime->callback = config.callback;
 	runtime->builtins = NULL;
+	runtime->modules = NULL;
 	runtime->frame = NULL;
 	runtime->depth = 0;
 	
@@ -364,6 +397,9 @@ Runtime *Runtime_New(RuntimeConfig config)
 	runtime->stderr = config.stderr;
 	runtime->stdout = config.stdout;
 
+	runtime->cache = config.cache;
+	runtime->codecache = config.codecache;
+	runtime->regexcache = NULL;
 	return runtime;
 }
 
@@ -373,11 +409,26 @@ void Runtime_Free(Runtime *runtime)
 		Runtime_PopFrame(runtime);
 	if (runtime->timing != NULL)
 		TimingTable_free(runtime->timing);
+	if (runtime->regexcache != NULL)
+		RegexCache_Free(runtime->regexcache);
 	Stack_Free(runtime->stack);
 	Heap_Free(runtime->heap);
 	free(runtime);
 }
 
+// Drops every frame and object of the runtime, leaving
+// it as [Runtime_New] returns it.
+void Runtime_Reset(Runtime *runtime)
+{
+	while (runtime->frame != NULL)
+		Runtime_PopFrame(runtime);
+	Stack_Pop(runtime->stack, Stack_Size(runtime->stack));
+	Heap_Reset(runtime->heap);
+	runtime->builtins = NULL;
+	runtime->modules = NULL;
+	runtime->interrupt = false;
+}
+
 FILE *Runtime_GetErrorStream(Runtime *runtime)
 {
 	return runtime->stderr;
@@ -630,7 +681,7 @@ bool Runtime_PushFailedFrame(Runtime *runtime, Error *error, Source *source, int
 	return true;
 }
 
-bool Runtime_PushNativeFrame(Runtime *runtime, Error *error)
+bool Runtime_PushNativeFrame(Runtime *runtime, Error *error, Object **argv, unsigned int argc)
 {
 	NativeFrame *native_frame = malloc(sizeof(NativeFrame));
 	if (native_frame == NULL) {
@@ -640,6 +691,8 @@ bool Runtime_PushNativeFrame(Runtime *runtime, Error *error)
 	
 	native_frame->base.type = FrameType_NATIVE;
 	native_frame->base.prev = NULL;
+	native_frame->argv = argv;
+	native_frame->argc = argc;
 
 	if (!appendFrame(runtime, error, (Frame*) native_frame)) {
 		free(native_frame);
@@ -715,6 +768,20 @@ bool Runtime_PopFrame(Runtime *runtime)
 	return true;
 }
 
+// Called when a native function fails. Its frame is
+// left on the stack for the stack trace, but the array
+// of arguments is about to be freed, so the collector
+// must stop walking it.
+void Runtime_ForgetNativeArgs(Runtime *runtime)
+{
+	Frame *frame = runtime->frame;
+	if (frame == NULL || frame->type != FrameType_NATIVE)
+		return;
+	NativeFrame *native_frame = (NativeFrame*) frame;
+	native_frame->argv = NULL;
+	native_frame->argc = 0;
+}
+
 RuntimeCallback Runtime_GetCallback(Runtime *runtime)
 {
 	return runtime->callback;
@@ -725,6 +792,91 @@ bool Runtime_WasInterrupted(Runtime *runtime)
 	return runtime->interrupt;
 }
 
+// Returns the map of the modules imported by the
+// runtime, creating it the first time.
+Object *Runtime_GetModules(Runtime *runtime, Error *error)
+{
+	if (runtime->modules == NULL)
+		runtime->modules = Object_NewMap(-1, runtime->heap, error);
+	return runtime->modules;
+}
+
+Object *Runtime_GetBuiltins(Runtime *runtime)
+{
+	return runtime->builtins;
+}
+
+void Runtime_SetModules(Runtime *runtime, Object *modules)
+{
+	runtime->modules = modules;
+}
+
+int Runtime_GetDepth(Runtime *runtime)
+{
+	return runtime->depth;
+}
+
+const char *Runtime_GetCacheFolder(Runtime *runtime)
+{
+	return runtime->cache;
+}
+
+CodeCache *Runtime_GetCodeCache(Runtime *runtime)
+{
+	return runtime->codecache;
+}
+
+// Returns the cache of the regexes compiled from
+// pattern strings, creating it the first time. It
+// isn't dropped by [Runtime_Reset] since it doesn't
+// refer to any object of the heap.
+RegexCache *Runtime_GetRegexCache(Runtime *runtime, Error *error)
+{
+	if (runtime->regexcache == NULL) {
+		runtime->regexcache = RegexCache_New();
+		if (runtime->regexcache == NULL)
+			Error_Report(error, ErrorType_INTERNAL, "No memory");
+	}
+	return runtime->regexcache;
+}
+
+void Runtime_OpenRegion(Runtime *runtime, HeapRegion *region)
+{
+	Heap_OpenRegion(runtime->heap, region);
+}
+
+// Closes a region of the runtime's heap. Its memory is
+// released unless the roots of the runtime refer to its
+// objects, other than [objs], or one of the cases listed
+// in "heap.c" occurred.
+bool Runtime_CloseRegion(Runtime *runtime, HeapRegion *region, Object **objs, int count)
+{
+	Heap *heap = runtime->heap;
+
+	bool escaped = region->escaped
+	            || Heap_IsInRegion(heap, region, runtime->builtins)
+	            || Heap_IsInRegion(heap, region, runtime->modules);
+
+	for (Frame *frame = runtime->frame; frame != NULL && !escaped; frame = frame->prev) {
+		if (frame->type == FrameType_NORMAL) {
+			NormalFrame *normal_frame = (NormalFrame*) frame;
+			escaped = Heap_IsInRegion(heap, region, normal_frame->locals)
+			       || Heap_IsInRegion(heap, region, normal_frame->closure);
+		} else if (frame->type == FrameType_NATIVE) {
+			NativeFrame *native_frame = (NativeFrame*) frame;
+			for (unsigned int i = 0; i < native_frame->argc && !escaped; i++)
+				escaped = Heap_IsInRegion(heap, region, native_frame->argv[i]);
+		}
+	}
+
+	Stack *stack = runtime->stack;
+	for (unsigned int i = 0; i < Stack_Size(stack) && !escaped; i++)
+		escaped = Heap_IsInRegion(heap, region, *(Object**) Stack_TopRef(stack, -i));
+
+	region->escaped = escaped;
+	return Heap_CloseRegion(heap, region, objs, count);
+}
+
 bool Runtime_CollectGarbage(Runtime *runtime, Error *error)
 {
 	Frame *frame = runtime->frame;
@@ -734,6 +886,7 @@ bool Runtime_CollectGarbage(Runtime *runtime, Error *error)
 		return 0;
 
 	Heap_CollectReference(&runtime->builtins,  runtime->heap);
+	Heap_CollectReference(&runtime->modules,   runtime->heap);
 
 	while(frame)
 	{
@@ -741,6 +894,10 @@ bool Runtime_CollectGarbage(Runtime *runtime, Error *error)
 			NormalFrame *normal_frame = (NormalFrame*) frame;
 			Heap_CollectReference(&normal_frame->locals,  heap);
 			Heap_CollectReference(&normal_frame->closure, heap);
+		} else if (frame->type == FrameType_NATIVE) {
+			NativeFrame *native_frame = (NativeFrame*) frame;
+			for (unsigned int i = 0; i < native_frame->argc; i++)
+				Heap_CollectReference(&native_frame->argv[i], heap);
 		}
 		frame = frame->prev;
 	}
@@ -801,11 +958,52 @@ bool Runtime_plugBuiltinsFromString(Runtime *runtime, const char *string, Error
     return result;
 }
 
-bool Runtime_plugDefaultBuiltins(Runtime *runtime, Error *error)
+// Runs the prelude using the executable that was compiled
+// from it at build time. If that executable can't be used,
+// because it doesn't match the source of the prelude or 
+// the build of the interpreter, the prelude is compiled
+// from source.
+static bool plugPrelude(Runtime *runtime, Error *error)
 {
 	extern char start_noja[];
+	extern const unsigned char start_noja_exe[];
+	extern const unsigned long start_noja_exe_size;
+
+	Source *source = Source_FromString("<prelude>", start_noja, -1, error);
+	if (source == NULL)
+		return false;
+
+	uint64_t hash = hashbytes64(Source_GetBody(source), Source_GetSize(source));
+
+	Error suberror;
+	Error_Init(&suberror);
+	Executable *exe = Executable_FromMemory(start_noja_exe, start_noja_exe_size, hash, &suberror);
+	Error_Free(&suberror);
+
+	if (exe == NULL || !Executable_SetSource(exe, source)) {
+		if (exe != NULL)
+			Executable_Free(exe);
+		bool result = Runtime_plugBuiltinsFromSource(runtime, source, error);
+		Source_Free(source);
+		return result;
+	}
+	Source_Free(source);
+
+	Object *rets[MAX_RETS];
+	int retc = runExecutable(runtime, exe, rets, error);
+	Executable_Free(exe);
+
+	if (retc < 0)
+		return false;
+	if (retc == 0)
+		return true;
+	return Runtime_plugBuiltins(runtime, rets[0], error);
+}
+
+bool Runtime_plugDefaultBuiltins(Runtime *runtime, Error *error)
+{
     return Runtime_plugBuiltinsFromStaticMap(runtime, bins_basic, bins_basic_init, error)
-		&& Runtime_plugBuiltinsFromString(runtime, start_noja, error);
+		&& plugPrelude(runtime, error);
 }
 
 void Runtime_SerializeProfilingResultsToStream(Runtime *runtime, FILE *stream)
@@ -34,7 +34,9 @@
 #include <stdio.h> // meh.. just for the definition of FILE.
 #include "timing.h"
 #include "executable.h"
+#include "codecache.h"
 #include "utils/error.h"
+#include "utils/regex.h"
 #include "objects/objects.h"
 
 typedef struct xRuntime Runtime;
@@ -53,11 +55,14 @@ typedef struct {
     FILE *stdin;
     FILE *stderr;
     FILE *stdout;
+    const char *cache; // Folder where compiled scripts are stored, or NULL
+    CodeCache *codecache; // Executables of the last compiled strings, or NULL
     RuntimeCallback callback;
 } RuntimeConfig;
 
 Runtime*     Runtime_New(RuntimeConfig config);
 void 		 Runtime_Free(Runtime *runtime);
+void 		 Runtime_Reset(Runtime *runtime);
 FILE *Runtime_GetErrorStream(Runtime *runtime);
 FILE *Runtime_GetInputStream(Runtime *runtime);
 FILE *Runtime_GetOutputStream(Runtime *runtime);
@@ -72,9 +77,10 @@ Object *Runtime_Top(Runtime *runtime, int n);
 bool Runtime_Pop (Runtime *runtime, Error *error, Object **p, unsigned int n);
 bool Runtime_Push(Runtime *runtime, Error *error, Object *obj);
 bool Runtime_PushFrame(Runtime *runtime, Error *error, Object *closure, Executable *exe, int index);
-bool Runtime_PushNativeFrame(Runtime *runtime, Error *error);
+bool Runtime_PushNativeFrame(Runtime *runtime, Error *error, Object **argv, unsigned int argc);
 bool Runtime_PushFailedFrame(Runtime *runtime, Error *error, Source *source, int offset);
 bool Runtime_PopFrame(Runtime *runtime);
+void Runtime_ForgetNativeArgs(Runtime *runtime);
 void Runtime_SetInstructionIndex(Runtime *runtime, int index);
 bool Runtime_SetVariable(Runtime *runtime, Error *error, const char *name, Object *value);
 bool Runtime_GetVariable(Runtime *runtime, Error *error, const char *name, Object **value);
@@ -86,6 +92,15 @@ const char *Runtime_GetCurrentScriptAbsolutePath(Runtime *runtime);
 size_t      Runtime_GetCurrentScriptFolder(Runtime *runtime, char *buff, size_t buffsize);
 RuntimeCallback Runtime_GetCallback(Runtime *runtime);
 bool Runtime_CollectGarbage(Runtime *runtime, Error *error);
+void Runtime_OpenRegion(Runtime *runtime, HeapRegion *region);
+bool Runtime_CloseRegion(Runtime *runtime, HeapRegion *region, Object **objs, int count);
+Object *Runtime_GetModules(Runtime *runtime, Error *error);
+void    Runtime_SetModules(Runtime *runtime, Object *modules);
+Object *Runtime_GetBuiltins(Runtime *runtime);
+int     Runtime_GetDepth(Runtime *runtime);
+const char *Runtime_GetCacheFolder(Runtime *runtime);
+CodeCache  *Runtime_GetCodeCache(Runtime *runtime);
+RegexCache *Runtime_GetRegexCache(Runtime *runtime, Error *error);
 void Runtime_PrintStackTrace(Runtime *runtime, FILE *stream);
 void         Runtime_Interrupt(Runtime *runtime);
 Heap*		 Runtime_GetHeap(Runtime *runtime);
@@ -29,6 +29,7 @@
 */
 
 #include <stdint.h>
+#include <stddef.h>
 #include "hash.h"
 
 int hashbytes(unsigned char *str, int len)
@@ -46,4 +47,16 @@ int hashbytes(unsigned char *str, int len)
 		x = -2;
 	
 	return x;
-}
\ No newline at end of file
+}
+// 64 bit FNV-1a. It's used where collisions must be
+// very unlikely, like when checking that a file didn't
+// change.
+uint64_t hashbytes64(const void *data, size_t len)
+{
+	const unsigned char *bytes = data;
+
+	uint64_t x = 14695981039346656037ULL;
+	for(size_t i = 0; i < len; i += 1)
+		x = (x ^ bytes[i]) * 1099511628211ULL;
+	return x;
+}
@@ -30,5 +30,8 @@
 
 #ifndef HASH_H
 #define HASH_H
+#include <stdint.h>
+#include <stddef.h>
 int hashbytes(unsigned char *str, int len);
+uint64_t hashbytes64(const void *data, size_t len);
 #endif
\ No newline at end of file
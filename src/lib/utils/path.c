@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <assert.h>
@@ -33,4 +34,27 @@ const char *Path_MakeAbsolute(const char *path, char *buff, size_t buffsize)
     memcpy(buff + written, path, n);
     buff[written + n] = '\0';
     return buff;
+}
+
+// Writes the absolute path of the file referred to by
+// [path] without symbolic links and "." or ".." parts, 
+// so that all paths to the same file are equal. The file
+// must exist. Returns NULL on failure.
+const char *Path_MakeCanonical(const char *path, char *buff, size_t buffsize)
+{
+    assert(path != NULL);
+
+    char *real = realpath(path, NULL);
+    if(real == NULL)
+        return NULL;
+
+    size_t n = strlen(real);
+    if(n >= buffsize) {
+        free(real);
+        return NULL;
+    }
+
+    memcpy(buff, real, n+1);
+    free(real);
+    return buff;
 }
\ No newline at end of file
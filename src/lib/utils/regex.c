@@ -0,0 +1,1138 @@
+
+/* +--------------------------------------------------------------------------+
+** |                          _   _       _                                   |
+** |                         | \ | |     (_)                                  |
+** |                         |  \| | ___  _  __ _                             |
+** |                         | . ` |/ _ \| |/ _` |                            |
+** |                         | |\  | (_) | | (_| |                            |
+** |                         |_| \_|\___/| |\__,_|                            |
+** |                                    _/ |                                  |
+** |                                   |__/                                   |
+** +--------------------------------------------------------------------------+
+** | Copyright (c) 2022 Francesco Cozzuto <francesco.cozzuto@gmail.com>       |
+** +--------------------------------------------------------------------------+
+** | This file is part of The Noja Interpreter.                               |
+** |                                                                          |
+** | The Noja Interpreter is free software: you can redistribute it and/or    |
+** | modify it under the terms of the GNU General Public License as published |
+** | by the Free Software Foundation, either version 3 of the License, or (at |
+** | your option) any later version.                                          |
+** |                                                                          |
+** | The Noja Interpreter is distributed in the hope that it will be useful,  |
+** | but WITHOUT ANY WARRANTY; without even the implied warranty of           |
+** | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General |
+** | Public License for more details.                                         |
+** |                                                                          |
+** | You should have received a copy of the GNU General Public License along  |
+** | with The Noja Interpreter. If not, see <http://www.gnu.org/licenses/>.   |
+** +--------------------------------------------------------------------------+ 
+*/
+
+/* +--------------------------------------------------------------------------+
+** | This file implements the regular expressions of the [regex] builtin      |
+** | module. Patterns are parsed into a tree, which is then compiled to a     |
+** | program for a Pike VM. The VM simulates the NFA of the pattern in        |
+** | lockstep over the input (like Thompson's algorithm) while tracking the   |
+** | capture offsets of each thread, so the matching time is O(n * m) where n |
+** | is the length of the input and m the size of the program. There's no    |
+** | backtracking, so there's no pattern that can take exponential time.     |
+** |                                                                          |
+** | The supported syntax is:                                                 |
+** |   .           Any byte but '\n'                                          |
+** |   [abc] [^a-z] Byte classes                                              |
+** |   \d \w \s    Digits, word characters and spaces (and their uppercase    |
+** |               negated versions)                                          |
+** |   \b \B       Word boundary and non word boundary                        |
+** |   ^ $         Start and end of the input                                 |
+** |   (x) (?:x)   Capturing and non capturing groups                         |
+** |   x|y         Alternation                                                |
+** |   x* x+ x?    Repetitions, followed by '?' to make them lazy             |
+** |   x{n} x{n,} x{n,m}                                                      |
+** |                                                                          |
+** | Matching works on bytes. UTF-8 sequences in the pattern are matched as   |
+** | sequences of bytes, but classes and '.' refer to single bytes.           |
+** | The leftmost match is returned and alternatives are preferred from left  |
+** | to right, like in backtracking engines.                                  |
+** +--------------------------------------------------------------------------+
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs.h"
+#include "regex.h"
+#include "bpalloc.h"
+
+#define MAX_GROUPS 32
+#define MAX_REPEAT 1000
+#define MAX_INSTRS 20000
+
+typedef enum {
+	NodeKind_CHAR,
+	NodeKind_ANY,
+	NodeKind_CLASS,
+	NodeKind_BOL,
+	NodeKind_EOL,
+	NodeKind_WORDB,
+	NodeKind_NWORDB,
+	NodeKind_EMPTY,
+	NodeKind_CAT,
+	NodeKind_ALT,
+	NodeKind_GROUP,
+	NodeKind_REPEAT,
+} NodeKind;
+
+typedef struct Node Node;
+struct Node {
+	NodeKind kind;
+	int      arg;    // Byte, class index or group index
+	int      min;    // Only for REPEAT
+	int      max;    // Only for REPEAT (-1 means no limit)
+	bool     greedy; // Only for REPEAT
+	Node    *left;
+	Node    *right;
+};
+
+typedef enum {
+	Opcode_CHAR,
+	Opcode_ANY,
+	Opcode_CLASS,
+	Opcode_MATCH,
+	Opcode_JUMP,
+	Opcode_SPLIT,
+	Opcode_SAVE,
+	Opcode_BOL,
+	Opcode_EOL,
+	Opcode_WORDB,
+	Opcode_NWORDB,
+} Opcode;
+
+typedef struct {
+	Opcode opcode;
+	int    x; // Byte, class index, save slot or preferred jump target
+	int    y; // Alternative jump target of SPLIT
+} Instr;
+
+typedef struct {
+	uint32_t bits[8];
+} Class;
+
+// Entry of the stack used to follow the epsilon
+// transitions of the program. When [pc] is -1 the
+// entry restores the capture [slot] to [old].
+typedef struct {
+	int pc;
+	int slot;
+	long long int old;
+} StackEntry;
+
+// Scratch memory used by [Regex_Exec]. It's
+// allocated the first time the regex is used
+// and then reused.
+typedef struct {
+	unsigned int  *marks;
+	StackEntry    *stack;
+	int           *pcs[2];
+	long long int *caps[2];
+	long long int *temp;
+	unsigned int   gen;
+} Scratch;
+
+struct Regex {
+	int      refs;
+	int      groups;
+	int      first; // The byte every match starts with, or -1
+	int      num_instrs;
+	int      num_classes;
+	Instr   *instrs;
+	Class   *classes;
+	Scratch *scratch;
+};
+
+typedef struct {
+	const char *src;
+	size_t      len;
+	size_t      cur;
+	int         groups;
+	int         num_classes;
+	int         cap_classes;
+	Class      *classes;
+	BPAlloc    *alloc;
+	Error      *error;
+} Parser;
+
+static inline void setBit(Class *cls, unsigned char c)
+{
+	cls->bits[c >> 5] |= 1u << (c & 31);
+}
+
+static inline bool getBit(const Class *cls, unsigned char c)
+{
+	return cls->bits[c >> 5] & (1u << (c & 31));
+}
+
+static inline bool isDigit(unsigned char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static inline bool isWord(unsigned char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || isDigit(c) || c == '_';
+}
+
+static inline bool isSpace(unsigned char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static Node *newNode(Parser *p, NodeKind kind, Node *left, Node *right)
+{
+	Node *node = BPAlloc_Malloc(p->alloc, sizeof(Node));
+	if (node == NULL) {
+		Error_Report(p->error, ErrorType_INTERNAL, "No memory");
+		return NULL;
+	}
+	memset(node, 0, sizeof(Node));
+	node->kind  = kind;
+	node->left  = left;
+	node->right = right;
+	return node;
+}
+
+static int newClass(Parser *p)
+{
+	if (p->num_classes == p->cap_classes) {
+		int cap = (p->cap_classes == 0) ? 8 : 2 * p->cap_classes;
+		Class *classes = realloc(p->classes, cap * sizeof(Class));
+		if (classes == NULL) {
+			Error_Report(p->error, ErrorType_INTERNAL, "No memory");
+			return -1;
+		}
+		p->classes = classes;
+		p->cap_classes = cap;
+	}
+	memset(&p->classes[p->num_classes], 0, sizeof(Class));
+	return p->num_classes++;
+}
+
+// Adds to [cls] the bytes of the \d, \w, \s 
+// escapes (or their negations).
+static bool addEscapeClass(Class *cls, char c)
+{
+	bool (*test)(unsigned char);
+	switch (c) {
+		case 'd': case 'D': test = isDigit; break;
+		case 'w': case 'W': test = isWord;  break;
+		case 's': case 'S': test = isSpace; break;
+		default: return false;
+	}
+	bool negated = (c >= 'A' && c <= 'Z');
+	for (int i = 0; i < 256; i++)
+		if (test(i) != negated)
+			setBit(cls, i);
+	return true;
+}
+
+static int parseHexDigit(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+// Parses the escaped byte following a '\', which was
+// already consumed. Returns -1 if it's not valid.
+static int parseEscapedByte(Parser *p)
+{
+	if (p->cur == p->len) {
+		Error_Report(p->error, ErrorType_RUNTIME, "Pattern ends with a '\\'");
+		return -1;
+	}
+	char c = p->src[p->cur++];
+	switch (c) {
+		case 'n': return '\n';
+		case 't': return '\t';
+		case 'r': return '\r';
+		case 'f': return '\f';
+		case 'v': return '\v';
+		case '0': return '\0';
+		case 'x':
+		{
+			int hi = (p->cur < p->len) ? parseHexDigit(p->src[p->cur]) : -1;
+			int lo = (p->cur+1 < p->len) ? parseHexDigit(p->src[p->cur+1]) : -1;
+			if (hi < 0 || lo < 0) {
+				Error_Report(p->error, ErrorType_RUNTIME, "Invalid \\x escape at offset %d of pattern", (int) p->cur);
+				return -1;
+			}
+			p->cur += 2;
+			return (hi << 4) | lo;
+		}
+	}
+	if (isWord(c)) {
+		Error_Report(p->error, ErrorType_RUNTIME, "Unknown escape \\%c at offset %d of pattern", c, (int) p->cur-1);
+		return -1;
+	}
+	return (unsigned char) c;
+}
+
+static Node *parseClass(Parser *p)
+{
+	// The '[' was already consumed.
+
+	int idx = newClass(p);
+	if (idx < 0)
+		return NULL;
+
+	bool negated = false;
+	if (p->cur < p->len && p->src[p->cur] == '^') {
+		negated = true;
+		p->cur++;
+	}
+
+	bool first = true;
+	while (p->cur < p->len && (first || p->src[p->cur] != ']')) {
+		
+		first = false;
+		
+		int lo;
+		char c = p->src[p->cur++];
+		if (c == '\\') {
+			if (p->cur < p->len && addEscapeClass(&p->classes[idx], p->src[p->cur])) {
+				p->cur++;
+				continue;
+			}
+			lo = parseEscapedByte(p);
+			if (lo < 0)
+				return NULL;
+		} else
+			lo = (unsigned char) c;
+		
+		int hi = lo;
+		if (p->cur+1 < p->len && p->src[p->cur] == '-' && p->src[p->cur+1] != ']') {
+			p->cur++;
+			c = p->src[p->cur++];
+			if (c == '\\') {
+				hi = parseEscapedByte(p);
+				if (hi < 0)
+					return NULL;
+			} else
+				hi = (unsigned char) c;
+			
+			if (hi < lo) {
+				Error_Report(p->error, ErrorType_RUNTIME, "Invalid class range at offset %d of pattern", (int) p->cur-1);
+				return NULL;
+			}
+		}
+
+		for (int i = lo; i <= hi; i++)
+			setBit(&p->classes[idx], i);
+	}
+
+	if (p->cur == p->len) {
+		Error_Report(p->error, ErrorType_RUNTIME, "Missing ']' in pattern");
+		return NULL;
+	}
+	p->cur++; // Skip the ']'.
+
+	if (negated)
+		for (int i = 0; i < 8; i++)
+			p->classes[idx].bits[i] = ~p->classes[idx].bits[i];
+
+	Node *node = newNode(p, NodeKind_CLASS, NULL, NULL);
+	if (node != NULL)
+		node->arg = idx;
+	return node;
+}
+
+static Node *parseAlternation(Parser *p);
+
+static Node *parseAtom(Parser *p)
+{
+	char c = p->src[p->cur++];
+	switch (c) {
+		
+		case '(':
+		{
+			int group = -1;
+			if (p->cur+1 < p->len && p->src[p->cur] == '?' && p->src[p->cur+1] == ':')
+				p->cur += 2;
+			else {
+				if (p->groups == MAX_GROUPS) {
+					Error_Report(p->error, ErrorType_RUNTIME, "Pattern has more than %d groups", MAX_GROUPS-1);
+					return NULL;
+				}
+				group = p->groups++;
+			}
+
+			Node *node = parseAlternation(p);
+			if (node == NULL)
+				return NULL;
+			
+			if (p->cur == p->len || p->src[p->cur] != ')') {
+				Error_Report(p->error, ErrorType_RUNTIME, "Missing ')' in pattern");
+				return NULL;
+			}
+			p->cur++;
+
+			if (group < 0)
+				return node;
+			
+			Node *wrap = newNode(p, NodeKind_GROUP, node, NULL);
+			if (wrap != NULL)
+				wrap->arg = group;
+			return wrap;
+		}
+
+		case '[': return parseClass(p);
+		case '.': return newNode(p, NodeKind_ANY, NULL, NULL);
+		case '^': return newNode(p, NodeKind_BOL, NULL, NULL);
+		case '$': return newNode(p, NodeKind_EOL, NULL, NULL);
+
+		case '*':
+		case '+':
+		case '?':
+		Error_Report(p->error, ErrorType_RUNTIME, "Nothing to repeat at offset %d of pattern", (int) p->cur-1);
+		return NULL;
+
+		case '\\':
+		{
+			if (p->cur < p->len) {
+				char e = p->src[p->cur];
+				if (e == 'b' || e == 'B') {
+					p->cur++;
+					return newNode(p, e == 'b' ? NodeKind_WORDB : NodeKind_NWORDB, NULL, NULL);
+				}
+				if (e == 'd' || e == 'D' || e == 'w' || e == 'W' || e == 's' || e == 'S') {
+					p->cur++;
+					int idx = newClass(p);
+					if (idx < 0)
+						return NULL;
+					addEscapeClass(&p->classes[idx], e);
+					Node *node = newNode(p, NodeKind_CLASS, NULL, NULL);
+					if (node != NULL)
+						node->arg = idx;
+					return node;
+				}
+			}
+			int byte = parseEscapedByte(p);
+			if (byte < 0)
+				return NULL;
+			Node *node = newNode(p, NodeKind_CHAR, NULL, NULL);
+			if (node != NULL)
+				node->arg = byte;
+			return node;
+		}
+	}
+
+	Node *node = newNode(p, NodeKind_CHAR, NULL, NULL);
+	if (node != NULL)
+		node->arg = (unsigned char) c;
+	return node;
+}
+
+// Parses a non-negative integer of a {n,m} quantifier.
+// Returns -1 if there's no number at the cursor.
+static int parseCount(Parser *p)
+{
+	if (p->cur == p->len || !isDigit(p->src[p->cur]))
+		return -1;
+	int n = 0;
+	while (p->cur < p->len && isDigit(p->src[p->cur])) {
+		if (n <= MAX_REPEAT)
+			n = n * 10 + p->src[p->cur] - '0';
+		p->cur++;
+	}
+	return n;
+}
+
+// Tries to parse a {n}, {n,} or {n,m} quantifier. If 
+// what follows the '{' isn't a quantifier, the cursor
+// is left where it was and false is returned, so that
+// the '{' is treated as a literal.
+static bool parseBraces(Parser *p, int *min, int *max)
+{
+	size_t save = p->cur;
+	p->cur++; // Skip the '{'.
+
+	int lo = parseCount(p);
+	if (lo < 0)
+		goto literal;
+	
+	int hi = lo;
+	if (p->cur < p->len && p->src[p->cur] == ',') {
+		p->cur++;
+		hi = parseCount(p); // -1 if missing, which is "no limit"
+	}
+
+	if (p->cur == p->len || p->src[p->cur] != '}')
+		goto literal;
+	p->cur++;
+
+	*min = lo;
+	*max = hi;
+	return true;
+
+literal:
+	p->cur = save;
+	return false;
+}
+
+static Node *parseRepetition(Parser *p)
+{
+	Node *node = parseAtom(p);
+	if (node == NULL)
+		return NULL;
+
+	while (p->cur < p->len) {
+
+		int min, max;
+		char c = p->src[p->cur];
+		if (c == '*')      { min = 0; max = -1; p->cur++; }
+		else if (c == '+') { min = 1; max = -1; p->cur++; }
+		else if (c == '?') { min = 0; max =  1; p->cur++; }
+		else if (c == '{') {
+			if (!parseBraces(p, &min, &max))
+				break;
+			if (min > MAX_REPEAT || max > MAX_REPEAT || (max >= 0 && max < min)) {
+				Error_Report(p->error, ErrorType_RUNTIME, "Invalid repetition count at offset %d of pattern", (int) p->cur-1);
+				return NULL;
+			}
+		} else
+			break;
+
+		bool greedy = true;
+		if (p->cur < p->len && p->src[p->cur] == '?') {
+			greedy = false;
+			p->cur++;
+		}
+
+		Node *rep = newNode(p, NodeKind_REPEAT, node, NULL);
+		if (rep == NULL)
+			return NULL;
+		rep->min = min;
+		rep->max = max;
+		rep->greedy = greedy;
+		node = rep;
+	}
+	return node;
+}
+
+static Node *parseConcatenation(Parser *p)
+{
+	Node *node = NULL;
+	while (p->cur < p->len && p->src[p->cur] != '|' && p->src[p->cur] != ')') {
+		
+		Node *next = parseRepetition(p);
+		if (next == NULL)
+			return NULL;
+
+		if (node == NULL)
+			node = next;
+		else {
+			node = newNode(p, NodeKind_CAT, node, next);
+			if (node == NULL)
+				return NULL;
+		}
+	}
+
+	if (node == NULL)
+		node = newNode(p, NodeKind_EMPTY, NULL, NULL);
+	return node;
+}
+
+static Node *parseAlternation(Parser *p)
+{
+	Node *node = parseConcatenation(p);
+	if (node == NULL)
+		return NULL;
+
+	while (p->cur < p->len && p->src[p->cur] == '|') {
+		p->cur++;
+		Node *right = parseConcatenation(p);
+		if (right == NULL)
+			return NULL;
+		node = newNode(p, NodeKind_ALT, node, right);
+		if (node == NULL)
+			return NULL;
+	}
+	return node;
+}
+
+typedef struct {
+	Instr *instrs;
+	int    count;
+	int    capacity;
+	Error *error;
+} Compiler;
+
+static int emit(Compiler *c, Opcode opcode, int x, int y)
+{
+	if (c->count == MAX_INSTRS) {
+		Error_Report(c->error, ErrorType_RUNTIME, "Pattern is too big");
+		return -1;
+	}
+
+	if (c->count == c->capacity) {
+		int cap = (c->capacity == 0) ? 32 : 2 * c->capacity;
+		Instr *instrs = realloc(c->instrs, cap * sizeof(Instr));
+		if (instrs == NULL) {
+			Error_Report(c->error, ErrorType_INTERNAL, "No memory");
+			return -1;
+		}
+		c->instrs = instrs;
+		c->capacity = cap;
+	}
+
+	c->instrs[c->count] = (Instr) { .opcode = opcode, .x = x, .y = y };
+	return c->count++;
+}
+
+// Makes the SPLIT at [split] go either to the following
+// instruction (the body of a repetition) or to the end
+// of the program emitted so far. Greedy repetitions
+// prefer the body, lazy ones prefer skipping it.
+static void setSplitTargets(Compiler *c, int split, bool greedy)
+{
+	int body = split + 1;
+	int skip = c->count;
+	c->instrs[split].x = greedy ? body : skip;
+	c->instrs[split].y = greedy ? skip : body;
+}
+
+static bool compileNode(Compiler *c, Node *node)
+{
+	switch (node->kind) {
+		case NodeKind_CHAR:   return emit(c, Opcode_CHAR,  node->arg, 0) >= 0;
+		case NodeKind_ANY:    return emit(c, Opcode_ANY,   0, 0) >= 0;
+		case NodeKind_CLASS:  return emit(c, Opcode_CLASS, node->arg, 0) >= 0;
+		case NodeKind_BOL:    return emit(c, Opcode_BOL,    0, 0) >= 0;
+		case NodeKind_EOL:    return emit(c, Opcode_EOL,    0, 0) >= 0;
+		case NodeKind_WORDB:  return emit(c, Opcode_WORDB,  0, 0) >= 0;
+		case NodeKind_NWORDB: return emit(c, Opcode_NWORDB, 0, 0) >= 0;
+		case NodeKind_EMPTY:  return true;
+		
+		case NodeKind_CAT:
+		return compileNode(c, node->left) 
+		    && compileNode(c, node->right);
+
+		case NodeKind_ALT:
+		{
+			//   SPLIT L1, L2
+			// L1: <left>
+			//   JUMP L3
+			// L2: <right>
+			// L3:
+			int split = emit(c, Opcode_SPLIT, 0, 0);
+			if (split < 0) return false;
+			c->instrs[split].x = c->count;
+			if (!compileNode(c, node->left)) return false;
+			int jump = emit(c, Opcode_JUMP, 0, 0);
+			if (jump < 0) return false;
+			c->instrs[split].y = c->count;
+			if (!compileNode(c, node->right)) return false;
+			c->instrs[jump].x = c->count;
+			return true;
+		}
+
+		case NodeKind_GROUP:
+		return emit(c, Opcode_SAVE, 2 * node->arg, 0) >= 0
+		    && compileNode(c, node->left)
+		    && emit(c, Opcode_SAVE, 2 * node->arg + 1, 0) >= 0;
+
+		case NodeKind_REPEAT:
+		{
+			// The mandatory repetitions are
+			// just emitted one after the other.
+			for (int i = 0; i < node->min; i++)
+				if (!compileNode(c, node->left))
+					return false;
+
+			if (node->max < 0) {
+				// L1: SPLIT L2, L3
+				// L2: <body>
+				//     JUMP L1
+				// L3:
+				int split = emit(c, Opcode_SPLIT, 0, 0);
+				if (split < 0) return false;
+				if (!compileNode(c, node->left)) return false;
+				if (emit(c, Opcode_JUMP, split, 0) < 0) return false;
+				setSplitTargets(c, split, node->greedy);
+			} else {
+				// Each optional repetition is
+				//     SPLIT L1, L2
+				// L1: <body>
+				// L2:
+				for (int i = node->min; i < node->max; i++) {
+					int split = emit(c, Opcode_SPLIT, 0, 0);
+					if (split < 0) return false;
+					if (!compileNode(c, node->left)) return false;
+					setSplitTargets(c, split, node->greedy);
+				}
+			}
+			return true;
+		}
+	}
+	UNREACHABLE;
+	return false;
+}
+
+// Returns the byte all matches must start with,
+// or -1 if there's no such byte. It's used to skip
+// quickly through the input using [memchr].
+static int findFirstByte(const Instr *instrs, int count)
+{
+	bool *visited = calloc(count, sizeof(bool));
+	int  *stack   = malloc(count * sizeof(int));
+	if (visited == NULL || stack == NULL) {
+		free(visited);
+		free(stack);
+		return -1;
+	}
+
+	int first = -1;
+	int depth = 0;
+	stack[depth++] = 0;
+	visited[0] = true;
+	while (depth > 0) {
+		
+		int pc = stack[--depth];
+		int next[2];
+		int num_next = 0;
+
+		const Instr *instr = &instrs[pc];
+		switch (instr->opcode) {
+			
+			case Opcode_CHAR:
+			if (first >= 0 && first != instr->x)
+				goto fail;
+			first = instr->x;
+			break;
+
+			case Opcode_ANY:
+			case Opcode_CLASS:
+			case Opcode_MATCH:
+			goto fail;
+
+			case Opcode_JUMP:
+			next[num_next++] = instr->x;
+			break;
+
+			case Opcode_SPLIT:
+			next[num_next++] = instr->x;
+			next[num_next++] = instr->y;
+			break;
+
+			case Opcode_SAVE:
+			case Opcode_BOL:
+			case Opcode_EOL:
+			case Opcode_WORDB:
+			case Opcode_NWORDB:
+			next[num_next++] = pc + 1;
+			break;
+		}
+
+		for (int i = 0; i < num_next; i++)
+			if (!visited[next[i]]) {
+				visited[next[i]] = true;
+				stack[depth++] = next[i];
+			}
+	}
+
+	free(visited);
+	free(stack);
+	return first;
+
+fail:
+	free(visited);
+	free(stack);
+	return -1;
+}
+
+Regex *Regex_Compile(const char *pattern, size_t length, Error *error)
+{
+	Parser p = {
+		.src = pattern,
+		.len = length,
+		.cur = 0,
+		.groups = 1, // Group 0 is the whole match
+		.error = error,
+	};
+
+	p.alloc = BPAlloc_Init(-1);
+	if (p.alloc == NULL) {
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		return NULL;
+	}
+
+	Node *root = parseAlternation(&p);
+	if (root != NULL && p.cur < p.len) {
+		// The only way the top-level alternation
+		// stops early is an unmatched ')'.
+		ASSERT(p.src[p.cur] == ')');
+		Error_Report(error, ErrorType_RUNTIME, "Unmatched ')' at offset %d of pattern", (int) p.cur);
+		root = NULL;
+	}
+
+	Compiler c = { .error = error };
+	bool ok = root != NULL 
+	       && emit(&c, Opcode_SAVE, 0, 0) >= 0
+	       && compileNode(&c, root)
+	       && emit(&c, Opcode_SAVE, 1, 0) >= 0
+	       && emit(&c, Opcode_MATCH, 0, 0) >= 0;
+
+	BPAlloc_Free(p.alloc);
+
+	Regex *regex = NULL;
+	if (ok) {
+		regex = malloc(sizeof(Regex));
+		if (regex == NULL)
+			Error_Report(error, ErrorType_INTERNAL, "No memory");
+	}
+
+	if (regex == NULL) {
+		free(c.instrs);
+		free(p.classes);
+		return NULL;
+	}
+
+	regex->refs = 1;
+	regex->groups = p.groups;
+	regex->num_instrs = c.count;
+	regex->num_classes = p.num_classes;
+	regex->instrs = c.instrs;
+	regex->classes = p.classes;
+	regex->scratch = NULL;
+	regex->first = findFirstByte(c.instrs, c.count);
+	return regex;
+}
+
+Regex *Regex_Copy(Regex *regex)
+{
+	regex->refs++;
+	return regex;
+}
+
+void Regex_Free(Regex *regex)
+{
+	regex->refs--;
+	ASSERT(regex->refs >= 0);
+	if (regex->refs == 0) {
+		free(regex->scratch);
+		free(regex->instrs);
+		free(regex->classes);
+		free(regex);
+	}
+}
+
+// A regex cache holds the compiled versions of the
+// last patterns, so that using the same pattern string
+// in a loop doesn't recompile it at each iteration.
+// When the cache is full the least recently used
+// pattern is evicted. Since compiled regexes aren't
+// thread-safe, each runtime owns its own cache.
+
+#define REGEX_CACHE_SIZE 32
+
+typedef struct {
+	char  *pattern;
+	size_t length;
+	Regex *regex;
+	unsigned long long last_use;
+} CachedPattern;
+
+struct RegexCache {
+	unsigned long long time;
+	CachedPattern entries[REGEX_CACHE_SIZE];
+};
+
+RegexCache *RegexCache_New(void)
+{
+	return calloc(1, sizeof(RegexCache));
+}
+
+void RegexCache_Free(RegexCache *cache)
+{
+	for (int i = 0; i < REGEX_CACHE_SIZE; i++) {
+		CachedPattern *entry = &cache->entries[i];
+		if (entry->regex != NULL) {
+			Regex_Free(entry->regex);
+			free(entry->pattern);
+		}
+	}
+	free(cache);
+}
+
+// Returns the compiled version of [pattern]. The
+// returned regex is owned by the cache, so the caller
+// needs to copy it if it's stored anywhere.
+Regex *RegexCache_Compile(RegexCache *cache, const char *pattern, size_t length, Error *error)
+{
+	int victim = 0;
+	for (int i = 0; i < REGEX_CACHE_SIZE; i++) {
+		
+		CachedPattern *entry = &cache->entries[i];
+		
+		if (entry->regex != NULL && entry->length == length && !memcmp(entry->pattern, pattern, length)) {
+			entry->last_use = ++cache->time;
+			return entry->regex;
+		}
+
+		if (entry->last_use < cache->entries[victim].last_use)
+			victim = i;
+	}
+
+	char *copy = malloc(length+1);
+	if (copy == NULL) {
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		return NULL;
+	}
+	memcpy(copy, pattern, length);
+	copy[length] = '\0';
+
+	Regex *regex = Regex_Compile(pattern, length, error);
+	if (regex == NULL) {
+		free(copy);
+		return NULL;
+	}
+
+	CachedPattern *entry = &cache->entries[victim];
+	if (entry->regex != NULL) {
+		Regex_Free(entry->regex);
+		free(entry->pattern);
+	}
+	entry->pattern  = copy;
+	entry->length   = length;
+	entry->regex    = regex;
+	entry->last_use = ++cache->time;
+	return regex;
+}
+
+int Regex_GroupCount(const Regex *regex)
+{
+	return regex->groups;
+}
+
+static Scratch *getScratch(Regex *regex)
+{
+	if (regex->scratch != NULL)
+		return regex->scratch;
+
+	size_t n = regex->num_instrs;
+	size_t slots = 2 * regex->groups;
+
+	// Everything is allocated as a single chunk. The
+	// wider members come first so that they're aligned.
+	size_t size = sizeof(Scratch)
+	            + sizeof(StackEntry) * (2 * n + 1)
+	            + sizeof(long long int) * (2 * n * slots + slots)
+	            + sizeof(unsigned int) * n
+	            + sizeof(int) * 2 * n;
+
+	Scratch *scratch = malloc(size);
+	if (scratch == NULL)
+		return NULL;
+
+	char *ptr = (char*) (scratch + 1);
+	scratch->stack   = (StackEntry*) ptr;    ptr += sizeof(StackEntry) * (2 * n + 1);
+	scratch->caps[0] = (long long int*) ptr; ptr += sizeof(long long int) * n * slots;
+	scratch->caps[1] = (long long int*) ptr; ptr += sizeof(long long int) * n * slots;
+	scratch->temp    = (long long int*) ptr; ptr += sizeof(long long int) * slots;
+	scratch->marks   = (unsigned int*) ptr;  ptr += sizeof(unsigned int) * n;
+	scratch->pcs[0]  = (int*) ptr;           ptr += sizeof(int) * n;
+	scratch->pcs[1]  = (int*) ptr;           ptr += sizeof(int) * n;
+	
+	memset(scratch->marks, 0, sizeof(unsigned int) * n);
+	scratch->gen = 0;
+
+	regex->scratch = scratch;
+	return scratch;
+}
+
+typedef struct {
+	int           *pcs;
+	long long int *caps;
+	int            count;
+} ThreadList;
+
+// Adds to [list] the thread starting at [pc0] and all
+// threads reachable from it through epsilon transitions
+// at input offset [sp]. The capture slots of the thread
+// are [caps], which are modified while following SAVEs
+// and restored before returning.
+static void addThread(Regex *regex, Scratch *scratch, ThreadList *list, int pc0, 
+                      const char *str, size_t len, size_t sp, long long int *caps)
+{
+	int slots = 2 * regex->groups;
+	StackEntry *stack = scratch->stack;
+	int depth = 0;
+
+	stack[depth++] = (StackEntry) { .pc = pc0 };
+	while (depth > 0) {
+
+		StackEntry entry = stack[--depth];
+		if (entry.pc < 0) {
+			caps[entry.slot] = entry.old;
+			continue;
+		}
+
+		int pc = entry.pc;
+		if (scratch->marks[pc] == scratch->gen)
+			continue;
+		scratch->marks[pc] = scratch->gen;
+
+		const Instr *instr = &regex->instrs[pc];
+		switch (instr->opcode) {
+			
+			case Opcode_JUMP:
+			stack[depth++] = (StackEntry) { .pc = instr->x };
+			break;
+
+			case Opcode_SPLIT:
+			// The preferred branch is pushed last,
+			// so that it's followed first.
+			stack[depth++] = (StackEntry) { .pc = instr->y };
+			stack[depth++] = (StackEntry) { .pc = instr->x };
+			break;
+
+			case Opcode_SAVE:
+			stack[depth++] = (StackEntry) { .pc = -1, .slot = instr->x, .old = caps[instr->x] };
+			stack[depth++] = (StackEntry) { .pc = pc + 1 };
+			caps[instr->x] = sp;
+			break;
+
+			case Opcode_BOL:
+			if (sp == 0)
+				stack[depth++] = (StackEntry) { .pc = pc + 1 };
+			break;
+
+			case Opcode_EOL:
+			if (sp == len)
+				stack[depth++] = (StackEntry) { .pc = pc + 1 };
+			break;
+
+			case Opcode_WORDB:
+			case Opcode_NWORDB:
+			{
+				bool before = sp > 0   && isWord(str[sp-1]);
+				bool after  = sp < len && isWord(str[sp]);
+				if ((before != after) == (instr->opcode == Opcode_WORDB))
+					stack[depth++] = (StackEntry) { .pc = pc + 1 };
+				break;
+			}
+
+			case Opcode_CHAR:
+			case Opcode_ANY:
+			case Opcode_CLASS:
+			case Opcode_MATCH:
+			list->pcs[list->count] = pc;
+			memcpy(list->caps + list->count * slots, caps, slots * sizeof(long long int));
+			list->count++;
+			break;
+		}
+	}
+}
+
+static void nextGeneration(Scratch *scratch, int num_instrs)
+{
+	scratch->gen++;
+	if (scratch->gen == 0) {
+		// The counter wrapped around so old marks
+		// could be mistaken for new ones.
+		memset(scratch->marks, 0, sizeof(unsigned int) * num_instrs);
+		scratch->gen = 1;
+	}
+}
+
+// Matches [regex] over [str] starting at offset [start].
+// If a match is found 1 is returned and the offsets of 
+// the captures are written in [caps], which must have 
+// space for 2 * Regex_GroupCount(regex) items. Captures
+// that didn't participate in the match are set to -1.
+// If no match is found, 0 is returned. On failure -1 
+// is returned and [error] is set.
+int Regex_Exec(Regex *regex, const char *str, size_t len, size_t start, RegexMode mode, long long int *caps, Error *error)
+{
+	ASSERT(start <= len);
+
+	Scratch *scratch = getScratch(regex);
+	if (scratch == NULL) {
+		Error_Report(error, ErrorType_INTERNAL, "No memory");
+		return -1;
+	}
+
+	int slots = 2 * regex->groups;
+
+	ThreadList clist = { .pcs = scratch->pcs[0], .caps = scratch->caps[0], .count = 0 };
+	ThreadList nlist = { .pcs = scratch->pcs[1], .caps = scratch->caps[1], .count = 0 };
+
+	bool matched = false;
+	nextGeneration(scratch, regex->num_instrs);
+
+	for (size_t sp = start; sp <= len; sp++) {
+
+		if (!matched && (sp == start || mode == RegexMode_SEARCH)) {
+
+			if (mode == RegexMode_SEARCH && clist.count == 0 && regex->first >= 0) {
+				// No thread is alive, so we can skip
+				// to the next possible match. Anchored
+				// matches can only start at [start].
+				const char *p = memchr(str + sp, regex->first, len - sp);
+				if (p == NULL)
+					break;
+				sp = p - str;
+			}
+
+			// Threads started at later positions have a
+			// lower priority, so they go after the others.
+			for (int i = 0; i < slots; i++)
+				scratch->temp[i] = -1;
+			addThread(regex, scratch, &clist, 0, str, len, sp, scratch->temp);
+		}
+
+		if (clist.count == 0)
+			break;
+
+		nextGeneration(scratch, regex->num_instrs);
+		nlist.count = 0;
+
+		for (int i = 0; i < clist.count; i++) {
+
+			int pc = clist.pcs[i];
+			long long int *tcaps = clist.caps + i * slots;
+			const Instr *instr = &regex->instrs[pc];
+
+			bool step = false;
+			switch (instr->opcode) {
+
+				case Opcode_CHAR:  step = sp < len && (unsigned char) str[sp] == instr->x; break;
+				case Opcode_ANY:   step = sp < len && str[sp] != '\n'; break;
+				case Opcode_CLASS: step = sp < len && getBit(&regex->classes[instr->x], str[sp]); break;
+
+				case Opcode_MATCH:
+				if (mode == RegexMode_FULL && sp != len)
+					break;
+				memcpy(caps, tcaps, slots * sizeof(long long int));
+				matched = true;
+				// Threads with lower priority than this
+				// one are dropped.
+				i = clist.count;
+				break;
+
+				default:
+				UNREACHABLE;
+				break;
+			}
+
+			if (step)
+				addThread(regex, scratch, &nlist, pc + 1, str, len, sp + 1, tcaps);
+		}
+
+		ThreadList temp = clist;
+		clist = nlist;
+		nlist = temp;
+	}
+
+	return matched ? 1 : 0;
+}
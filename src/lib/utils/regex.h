@@ -0,0 +1,55 @@
+
+/* +--------------------------------------------------------------------------+
+** |                          _   _       _                                   |
+** |                         | \ | |     (_)                                  |
+** |                         |  \| | ___  _  __ _                             |
+** |                         | . ` |/ _ \| |/ _` |                            |
+** |                         | |\  | (_) | | (_| |                            |
+** |                         |_| \_|\___/| |\__,_|                            |
+** |                                    _/ |                                  |
+** |                                   |__/                                   |
+** +--------------------------------------------------------------------------+
+** | Copyright (c) 2022 Francesco Cozzuto <francesco.cozzuto@gmail.com>       |
+** +--------------------------------------------------------------------------+
+** | This file is part of The Noja Interpreter.                               |
+** |                                                                          |
+** | The Noja Interpreter is free software: you can redistribute it and/or    |
+** | modify it under the terms of the GNU General Public License as published |
+** | by the Free Software Foundation, either version 3 of the License, or (at |
+** | your option) any later version.                                          |
+** |                                                                          |
+** | The Noja Interpreter is distributed in the hope that it will be useful,  |
+** | but WITHOUT ANY WARRANTY; without even the implied warranty of           |
+** | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General |
+** | Public License for more details.                                         |
+** |                                                                          |
+** | You should have received a copy of the GNU General Public License along  |
+** | with The Noja Interpreter. If not, see <http://www.gnu.org/licenses/>.   |
+** +--------------------------------------------------------------------------+ 
+*/
+
+#ifndef REGEX_H
+#define REGEX_H
+#include <stddef.h>
+#include <stdbool.h>
+#include "error.h"
+
+typedef struct Regex Regex;
+typedef struct RegexCache RegexCache;
+
+typedef enum {
+	RegexMode_SEARCH, // Match anywhere after the starting offset
+	RegexMode_PREFIX, // Match at the starting offset
+	RegexMode_FULL,   // Match from the starting offset to the end
+} RegexMode;
+
+Regex *Regex_Compile(const char *pattern, size_t length, Error *error);
+Regex *Regex_Copy(Regex *regex);
+void   Regex_Free(Regex *regex);
+int    Regex_GroupCount(const Regex *regex);
+int    Regex_Exec(Regex *regex, const char *str, size_t len, size_t start, RegexMode mode, long long int *caps, Error *error);
+
+RegexCache *RegexCache_New(void);
+void        RegexCache_Free(RegexCache *cache);
+Regex      *RegexCache_Compile(RegexCache *cache, const char *pattern, size_t length, Error *error);
+#endif
@@ -215,4 +215,17 @@ Source *Source_FromString(const char *name, const char *body, int size, Error *e
 	
 	strncpy(s->body, body, size);
 	return s;
-}
\ No newline at end of file
+}
+// Creates the source of a file from contents that were
+// already read, like the ones stored in a runtime image.
+Source *Source_FromFileContents(const char *path, const char *body, int size, Error *error)
+{
+	assert(path != NULL);
+
+	Source *s = Source_FromString(path, body, size, error);
+	if(s == NULL)
+		return NULL;
+
+	s->is_file = true;
+	return s;
+}
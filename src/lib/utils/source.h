@@ -39,5 +39,6 @@ const char  *Source_GetBody(const Source *s);
 unsigned int Source_GetSize(const Source *s);
 Source 		*Source_FromFile(const char *file, Error *error);
 Source 		*Source_FromString(const char *name, const char *body, int size, Error *error);
+Source 		*Source_FromFileContents(const char *path, const char *body, int size, Error *error);
 const char  *Source_GetAbsolutePath(Source *src);
 #endif
\ No newline at end of file
@@ -0,0 +1,551 @@
+
+/* +--------------------------------------------------------------------------+
+** |                          _   _       _                                   |
+** |                         | \ | |     (_)                                  |
+** |                         |  \| | ___  _  __ _                             |
+** |                         | . ` |/ _ \| |/ _` |                            |
+** |                         | |\  | (_) | | (_| |                            |
+** |                         |_| \_|\___/| |\__,_|                            |
+** |                                    _/ |                                  |
+** |                                   |__/                                   |
+** +--------------------------------------------------------------------------+
+** | Copyright (c) 2022 Francesco Cozzuto <francesco.cozzuto@gmail.com>       |
+** +--------------------------------------------------------------------------+
+** | This file is part of The Noja Interpreter.                               |
+** |                                                                          |
+** | The Noja Interpreter is free software: you can redistribute it and/or    |
+** | modify it under the terms of the GNU General Public License as published |
+** | by the Free Software Foundation, either version 3 of the License, or (at |
+** | your option) any later version.                                          |
+** |                                                                          |
+** | The Noja Interpreter is distributed in the hope that it will be useful,  |
+** | but WITHOUT ANY WARRANTY; without even the implied warranty of           |
+** | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General |
+** | Public License for more details.                                         |
+** |                                                                          |
+** | You should have received a copy of the GNU General Public License along  |
+** | with The Noja Interpreter. If not, see <http://www.gnu.org/licenses/>.   |
+** +--------------------------------------------------------------------------+ 
+*/
+
+
+#include "vecops.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VECOPS_X86 1
+#include <immintrin.h>
+#else
+#define VECOPS_X86 0
+#endif
+
+/* === Scalar ====================================== */
+
+// Integer operations are done on unsigned values
+// so that overflows wrap around instead of being
+// undefined behaviour.
+typedef unsigned long long int u64;
+
+static double combine8(const double r[8])
+{
+	return ((r[0] + r[1]) + (r[2] + r[3])) 
+		 + ((r[4] + r[5]) + (r[6] + r[7]));
+}
+
+static void combineMinMax8(const double mn[8], const double mx[8], double *min, double *max)
+{
+	double a = mn[0];
+	double b = mx[0];
+	for(int j = 1; j < 8; j += 1)
+	{
+		a = mn[j] < a ? mn[j] : a;
+		b = mx[j] > b ? mx[j] : b;
+	}
+	*min = a;
+	*max = b;
+}
+
+static long long int sum_i64_scalar(const long long int *x, size_t n)
+{
+	u64 s = 0;
+	for(size_t i = 0; i < n; i += 1)
+		s += (u64) x[i];
+	return (long long int) s;
+}
+
+static double sum_f64_scalar(const double *x, size_t n)
+{
+	double r[8] = {0};
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8)
+		for(int j = 0; j < 8; j += 1)
+			r[j] += x[i+j];
+	double s = combine8(r);
+	for(; i < n; i += 1)
+		s += x[i];
+	return s;
+}
+
+static long long int dot_i64_scalar(const long long int *x, const long long int *y, size_t n)
+{
+	u64 s = 0;
+	for(size_t i = 0; i < n; i += 1)
+		s += (u64) x[i] * (u64) y[i];
+	return (long long int) s;
+}
+
+static double dot_f64_scalar(const double *x, const double *y, size_t n)
+{
+	double r[8] = {0};
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8)
+		for(int j = 0; j < 8; j += 1)
+			r[j] += x[i+j] * y[i+j];
+	double s = combine8(r);
+	for(; i < n; i += 1)
+		s += x[i] * y[i];
+	return s;
+}
+
+static void minmax_i64_scalar(const long long int *x, size_t n, long long int *min, long long int *max)
+{
+	long long int a = x[0];
+	long long int b = x[0];
+	for(size_t i = 1; i < n; i += 1)
+	{
+		if(x[i] < a) a = x[i];
+		if(x[i] > b) b = x[i];
+	}
+	*min = a;
+	*max = b;
+}
+
+static void minmax_f64_scalar(const double *x, size_t n, double *min, double *max)
+{
+	double mn[8], mx[8];
+	for(int j = 0; j < 8; j += 1)
+		mn[j] = mx[j] = x[0];
+
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8)
+		for(int j = 0; j < 8; j += 1)
+		{
+			mn[j] = x[i+j] < mn[j] ? x[i+j] : mn[j];
+			mx[j] = x[i+j] > mx[j] ? x[i+j] : mx[j];
+		}
+	combineMinMax8(mn, mx, min, max);
+	for(; i < n; i += 1)
+	{
+		*min = x[i] < *min ? x[i] : *min;
+		*max = x[i] > *max ? x[i] : *max;
+	}
+}
+
+static void add_i64_scalar(const long long int *x, const long long int *y, long long int *z, size_t n)
+{
+	for(size_t i = 0; i < n; i += 1)
+		z[i] = (long long int) ((u64) x[i] + (u64) y[i]);
+}
+
+static void add_f64_scalar(const double *x, const double *y, double *z, size_t n)
+{
+	for(size_t i = 0; i < n; i += 1)
+		z[i] = x[i] + y[i];
+}
+
+static void mul_i64_scalar(const long long int *x, const long long int *y, long long int *z, size_t n)
+{
+	for(size_t i = 0; i < n; i += 1)
+		z[i] = (long long int) ((u64) x[i] * (u64) y[i]);
+}
+
+static void mul_f64_scalar(const double *x, const double *y, double *z, size_t n)
+{
+	for(size_t i = 0; i < n; i += 1)
+		z[i] = x[i] * y[i];
+}
+
+static void axpy_i64_scalar(long long int a, const long long int *x, long long int *y, size_t n)
+{
+	for(size_t i = 0; i < n; i += 1)
+		y[i] = (long long int) ((u64) a * (u64) x[i] + (u64) y[i]);
+}
+
+static void axpy_f64_scalar(double a, const double *x, double *y, size_t n)
+{
+	for(size_t i = 0; i < n; i += 1)
+		y[i] = a * x[i] + y[i];
+}
+
+static const VecOps ops_scalar = {
+	.name = "scalar",
+	.sum_i64 = sum_i64_scalar,
+	.sum_f64 = sum_f64_scalar,
+	.dot_i64 = dot_i64_scalar,
+	.dot_f64 = dot_f64_scalar,
+	.minmax_i64 = minmax_i64_scalar,
+	.minmax_f64 = minmax_f64_scalar,
+	.add_i64 = add_i64_scalar,
+	.add_f64 = add_f64_scalar,
+	.mul_i64 = mul_i64_scalar,
+	.mul_f64 = mul_f64_scalar,
+	.axpy_i64 = axpy_i64_scalar,
+	.axpy_f64 = axpy_f64_scalar,
+};
+
+#if VECOPS_X86
+
+/* === SSE2 ======================================== */
+
+// Operations on 64 bit integers that need a compare
+// or a multiply aren't available before SSE4.2 and
+// AVX-512, so the scalar versions are used for them.
+
+#define SSE2 __attribute__((target("sse2")))
+
+SSE2 static long long int sum_i64_sse2(const long long int *x, size_t n)
+{
+	__m128i a0 = _mm_setzero_si128();
+	__m128i a1 = _mm_setzero_si128();
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4)
+	{
+		a0 = _mm_add_epi64(a0, _mm_loadu_si128((const __m128i*) (x + i)));
+		a1 = _mm_add_epi64(a1, _mm_loadu_si128((const __m128i*) (x + i + 2)));
+	}
+	long long int r[2];
+	_mm_storeu_si128((__m128i*) r, _mm_add_epi64(a0, a1));
+	return (long long int) ((u64) r[0] + (u64) r[1] + (u64) sum_i64_scalar(x + i, n - i));
+}
+
+SSE2 static double sum_f64_sse2(const double *x, size_t n)
+{
+	__m128d a0 = _mm_setzero_pd();
+	__m128d a1 = _mm_setzero_pd();
+	__m128d a2 = _mm_setzero_pd();
+	__m128d a3 = _mm_setzero_pd();
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8)
+	{
+		a0 = _mm_add_pd(a0, _mm_loadu_pd(x + i));
+		a1 = _mm_add_pd(a1, _mm_loadu_pd(x + i + 2));
+		a2 = _mm_add_pd(a2, _mm_loadu_pd(x + i + 4));
+		a3 = _mm_add_pd(a3, _mm_loadu_pd(x + i + 6));
+	}
+	double r[8];
+	_mm_storeu_pd(r + 0, a0);
+	_mm_storeu_pd(r + 2, a1);
+	_mm_storeu_pd(r + 4, a2);
+	_mm_storeu_pd(r + 6, a3);
+	double s = combine8(r);
+	for(; i < n; i += 1)
+		s += x[i];
+	return s;
+}
+
+SSE2 static double dot_f64_sse2(const double *x, const double *y, size_t n)
+{
+	__m128d a0 = _mm_setzero_pd();
+	__m128d a1 = _mm_setzero_pd();
+	__m128d a2 = _mm_setzero_pd();
+	__m128d a3 = _mm_setzero_pd();
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8)
+	{
+		a0 = _mm_add_pd(a0, _mm_mul_pd(_mm_loadu_pd(x + i    ), _mm_loadu_pd(y + i    )));
+		a1 = _mm_add_pd(a1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+		a2 = _mm_add_pd(a2, _mm_mul_pd(_mm_loadu_pd(x + i + 4), _mm_loadu_pd(y + i + 4)));
+		a3 = _mm_add_pd(a3, _mm_mul_pd(_mm_loadu_pd(x + i + 6), _mm_loadu_pd(y + i + 6)));
+	}
+	double r[8];
+	_mm_storeu_pd(r + 0, a0);
+	_mm_storeu_pd(r + 2, a1);
+	_mm_storeu_pd(r + 4, a2);
+	_mm_storeu_pd(r + 6, a3);
+	double s = combine8(r);
+	for(; i < n; i += 1)
+		s += x[i] * y[i];
+	return s;
+}
+
+SSE2 static void minmax_f64_sse2(const double *x, size_t n, double *min, double *max)
+{
+	__m128d mn[4], mx[4];
+	for(int j = 0; j < 4; j += 1)
+		mn[j] = mx[j] = _mm_set1_pd(x[0]);
+
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8)
+		for(int j = 0; j < 4; j += 1)
+		{
+			__m128d v = _mm_loadu_pd(x + i + 2*j);
+			mn[j] = _mm_min_pd(v, mn[j]);
+			mx[j] = _mm_max_pd(v, mx[j]);
+		}
+
+	double rmn[8], rmx[8];
+	for(int j = 0; j < 4; j += 1)
+	{
+		_mm_storeu_pd(rmn + 2*j, mn[j]);
+		_mm_storeu_pd(rmx + 2*j, mx[j]);
+	}
+	combineMinMax8(rmn, rmx, min, max);
+	for(; i < n; i += 1)
+	{
+		*min = x[i] < *min ? x[i] : *min;
+		*max = x[i] > *max ? x[i] : *max;
+	}
+}
+
+SSE2 static void add_i64_sse2(const long long int *x, const long long int *y, long long int *z, size_t n)
+{
+	size_t i = 0;
+	for(; i + 2 <= n; i += 2)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*) (x + i));
+		__m128i b = _mm_loadu_si128((const __m128i*) (y + i));
+		_mm_storeu_si128((__m128i*) (z + i), _mm_add_epi64(a, b));
+	}
+	add_i64_scalar(x + i, y + i, z + i, n - i);
+}
+
+SSE2 static void add_f64_sse2(const double *x, const double *y, double *z, size_t n)
+{
+	size_t i = 0;
+	for(; i + 2 <= n; i += 2)
+		_mm_storeu_pd(z + i, _mm_add_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+	add_f64_scalar(x + i, y + i, z + i, n - i);
+}
+
+SSE2 static void mul_f64_sse2(const double *x, const double *y, double *z, size_t n)
+{
+	size_t i = 0;
+	for(; i + 2 <= n; i += 2)
+		_mm_storeu_pd(z + i, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+	mul_f64_scalar(x + i, y + i, z + i, n - i);
+}
+
+SSE2 static void axpy_f64_sse2(double a, const double *x, double *y, size_t n)
+{
+	__m128d va = _mm_set1_pd(a);
+	size_t i = 0;
+	for(; i + 2 <= n; i += 2)
+		_mm_storeu_pd(y + i, _mm_add_pd(_mm_mul_pd(va, _mm_loadu_pd(x + i)), _mm_loadu_pd(y + i)));
+	axpy_f64_scalar(a, x + i, y + i, n - i);
+}
+
+static const VecOps ops_sse2 = {
+	.name = "sse2",
+	.sum_i64 = sum_i64_sse2,
+	.sum_f64 = sum_f64_sse2,
+	.dot_i64 = dot_i64_scalar,
+	.dot_f64 = dot_f64_sse2,
+	.minmax_i64 = minmax_i64_scalar,
+	.minmax_f64 = minmax_f64_sse2,
+	.add_i64 = add_i64_sse2,
+	.add_f64 = add_f64_sse2,
+	.mul_i64 = mul_i64_scalar,
+	.mul_f64 = mul_f64_sse2,
+	.axpy_i64 = axpy_i64_scalar,
+	.axpy_f64 = axpy_f64_sse2,
+};
+
+/* === AVX2 ======================================== */
+
+// The FMA instructions aren't used even if they're
+// usually available with AVX2 since they round
+// differently than a multiply followed by an add.
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static long long int sum_i64_avx2(const long long int *x, size_t n)
+{
+	__m256i a0 = _mm256_setzero_si256();
+	__m256i a1 = _mm256_setzero_si256();
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8)
+	{
+		a0 = _mm256_add_epi64(a0, _mm256_loadu_si256((const __m256i*) (x + i)));
+		a1 = _mm256_add_epi64(a1, _mm256_loadu_si256((const __m256i*) (x + i + 4)));
+	}
+	long long int r[4];
+	_mm256_storeu_si256((__m256i*) r, _mm256_add_epi64(a0, a1));
+	u64 s = (u64) r[0] + (u64) r[1] + (u64) r[2] + (u64) r[3];
+	return (long long int) (s + (u64) sum_i64_scalar(x + i, n - i));
+}
+
+AVX2 static double sum_f64_avx2(const double *x, size_t n)
+{
+	__m256d a0 = _mm256_setzero_pd();
+	__m256d a1 = _mm256_setzero_pd();
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8)
+	{
+		a0 = _mm256_add_pd(a0, _mm256_loadu_pd(x + i));
+		a1 = _mm256_add_pd(a1, _mm256_loadu_pd(x + i + 4));
+	}
+	double r[8];
+	_mm256_storeu_pd(r + 0, a0);
+	_mm256_storeu_pd(r + 4, a1);
+	double s = combine8(r);
+	for(; i < n; i += 1)
+		s += x[i];
+	return s;
+}
+
+AVX2 static double dot_f64_avx2(const double *x, const double *y, size_t n)
+{
+	__m256d a0 = _mm256_setzero_pd();
+	__m256d a1 = _mm256_setzero_pd();
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8)
+	{
+		a0 = _mm256_add_pd(a0, _mm256_mul_pd(_mm256_loadu_pd(x + i    ), _mm256_loadu_pd(y + i    )));
+		a1 = _mm256_add_pd(a1, _mm256_mul_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)));
+	}
+	double r[8];
+	_mm256_storeu_pd(r + 0, a0);
+	_mm256_storeu_pd(r + 4, a1);
+	double s = combine8(r);
+	for(; i < n; i += 1)
+		s += x[i] * y[i];
+	return s;
+}
+
+AVX2 static void minmax_i64_avx2(const long long int *x, size_t n, long long int *min, long long int *max)
+{
+	__m256i mn = _mm256_set1_epi64x(x[0]);
+	__m256i mx = mn;
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*) (x + i));
+		mn = _mm256_blendv_epi8(mn, v, _mm256_cmpgt_epi64(mn, v));
+		mx = _mm256_blendv_epi8(mx, v, _mm256_cmpgt_epi64(v, mx));
+	}
+	long long int rmn[4], rmx[4];
+	_mm256_storeu_si256((__m256i*) rmn, mn);
+	_mm256_storeu_si256((__m256i*) rmx, mx);
+
+	long long int a = rmn[0];
+	long long int b = rmx[0];
+	for(int j = 1; j < 4; j += 1)
+	{
+		if(rmn[j] < a) a = rmn[j];
+		if(rmx[j] > b) b = rmx[j];
+	}
+	for(; i < n; i += 1)
+	{
+		if(x[i] < a) a = x[i];
+		if(x[i] > b) b = x[i];
+	}
+	*min = a;
+	*max = b;
+}
+
+AVX2 static void minmax_f64_avx2(const double *x, size_t n, double *min, double *max)
+{
+	__m256d mn0 = _mm256_set1_pd(x[0]);
+	__m256d mn1 = mn0;
+	__m256d mx0 = mn0;
+	__m256d mx1 = mn0;
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8)
+	{
+		__m256d v0 = _mm256_loadu_pd(x + i);
+		__m256d v1 = _mm256_loadu_pd(x + i + 4);
+		mn0 = _mm256_min_pd(v0, mn0);
+		mn1 = _mm256_min_pd(v1, mn1);
+		mx0 = _mm256_max_pd(v0, mx0);
+		mx1 = _mm256_max_pd(v1, mx1);
+	}
+	double rmn[8], rmx[8];
+	_mm256_storeu_pd(rmn + 0, mn0);
+	_mm256_storeu_pd(rmn + 4, mn1);
+	_mm256_storeu_pd(rmx + 0, mx0);
+	_mm256_storeu_pd(rmx + 4, mx1);
+	combineMinMax8(rmn, rmx, min, max);
+	for(; i < n; i += 1)
+	{
+		*min = x[i] < *min ? x[i] : *min;
+		*max = x[i] > *max ? x[i] : *max;
+	}
+}
+
+AVX2 static void add_i64_avx2(const long long int *x, const long long int *y, long long int *z, size_t n)
+{
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i*) (x + i));
+		__m256i b = _mm256_loadu_si256((const __m256i*) (y + i));
+		_mm256_storeu_si256((__m256i*) (z + i), _mm256_add_epi64(a, b));
+	}
+	add_i64_scalar(x + i, y + i, z + i, n - i);
+}
+
+AVX2 static void add_f64_avx2(const double *x, const double *y, double *z, size_t n)
+{
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4)
+		_mm256_storeu_pd(z + i, _mm256_add_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+	add_f64_scalar(x + i, y + i, z + i, n - i);
+}
+
+AVX2 static void mul_f64_avx2(const double *x, const double *y, double *z, size_t n)
+{
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4)
+		_mm256_storeu_pd(z + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+	mul_f64_scalar(x + i, y + i, z + i, n - i);
+}
+
+AVX2 static void axpy_f64_avx2(double a, const double *x, double *y, size_t n)
+{
+	__m256d va = _mm256_set1_pd(a);
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4)
+		_mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_mul_pd(va, _mm256_loadu_pd(x + i)), _mm256_loadu_pd(y + i)));
+	axpy_f64_scalar(a, x + i, y + i, n - i);
+}
+
+static const VecOps ops_avx2 = {
+	.name = "avx2",
+	.sum_i64 = sum_i64_avx2,
+	.sum_f64 = sum_f64_avx2,
+	.dot_i64 = dot_i64_scalar,
+	.dot_f64 = dot_f64_avx2,
+	.minmax_i64 = minmax_i64_avx2,
+	.minmax_f64 = minmax_f64_avx2,
+	.add_i64 = add_i64_avx2,
+	.add_f64 = add_f64_avx2,
+	.mul_i64 = mul_i64_scalar,
+	.mul_f64 = mul_f64_avx2,
+	.axpy_i64 = axpy_i64_scalar,
+	.axpy_f64 = axpy_f64_avx2,
+};
+
+#endif /* VECOPS_X86 */
+
+const VecOps *VecOps_GetScalar(void)
+{
+	return &ops_scalar;
+}
+
+const VecOps *VecOps_Get(void)
+{
+	static const VecOps *chosen = NULL;
+
+	if(chosen == NULL)
+	{
+#if VECOPS_X86
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("avx2"))
+			chosen = &ops_avx2;
+		else if(__builtin_cpu_supports("sse2"))
+			chosen = &ops_sse2;
+		else
+#endif
+			chosen = &ops_scalar;
+	}
+	return chosen;
+}
@@ -0,0 +1,65 @@
+
+/* +--------------------------------------------------------------------------+
+** |                          _   _       _                                   |
+** |                         | \ | |     (_)                                  |
+** |                         |  \| | ___  _  __ _                             |
+** |                         | . ` |/ _ \| |/ _` |                            |
+** |                         | |\  | (_) | | (_| |                            |
+** |                         |_| \_|\___/| |\__,_|                            |
+** |                                    _/ |                                  |
+** |                                   |__/                                   |
+** +--------------------------------------------------------------------------+
+** | Copyright (c) 2022 Francesco Cozzuto <francesco.cozzuto@gmail.com>       |
+** +--------------------------------------------------------------------------+
+** | This file is part of The Noja Interpreter.                               |
+** |                                                                          |
+** | The Noja Interpreter is free software: you can redistribute it and/or    |
+** | modify it under the terms of the GNU General Public License as published |
+** | by the Free Software Foundation, either version 3 of the License, or (at |
+** | your option) any later version.                                          |
+** |                                                                          |
+** | The Noja Interpreter is distributed in the hope that it will be useful,  |
+** | but WITHOUT ANY WARRANTY; without even the implied warranty of           |
+** | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General |
+** | Public License for more details.                                         |
+** |                                                                          |
+** | You should have received a copy of the GNU General Public License along  |
+** | with The Noja Interpreter. If not, see <http://www.gnu.org/licenses/>.   |
+** +--------------------------------------------------------------------------+ 
+*/
+
+
+#ifndef VECOPS_H
+#define VECOPS_H
+#include <stddef.h>
+
+/* Kernels over contiguous int64 and float64 items.
+**
+** There's an implementation for each instruction set
+** that is worth it and the best one the processor
+** supports is chosen the first time VecOps_Get is
+** called. Float sums are computed using 8 interleaved
+** partial sums that are added in the same order by
+** every implementation, so the results don't depend
+** on which one was chosen.
+*/
+
+typedef struct {
+	const char *name;
+	long long int (*sum_i64)(const long long int *x, size_t n);
+	double        (*sum_f64)(const double *x, size_t n);
+	long long int (*dot_i64)(const long long int *x, const long long int *y, size_t n);
+	double        (*dot_f64)(const double *x, const double *y, size_t n);
+	void (*minmax_i64)(const long long int *x, size_t n, long long int *min, long long int *max);
+	void (*minmax_f64)(const double *x, size_t n, double *min, double *max);
+	void (*add_i64)(const long long int *x, const long long int *y, long long int *z, size_t n);
+	void (*add_f64)(const double *x, const double *y, double *z, size_t n);
+	void (*mul_i64)(const long long int *x, const long long int *y, long long int *z, size_t n);
+	void (*mul_f64)(const double *x, const double *y, double *z, size_t n);
+	void (*axpy_i64)(long long int a, const long long int *x, long long int *y, size_t n);
+	void (*axpy_f64)(double a, const double *x, double *y, size_t n);
+} VecOps;
+
+const VecOps *VecOps_Get(void);
+const VecOps *VecOps_GetScalar(void);
+#endif
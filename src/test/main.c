@@ -11,10 +11,12 @@
 
 static TestResult runCompilerTest(const char *inputs[static 2], FILE *log_stream);    
 static TestResult  runRuntimeTest(const char *inputs[static 2], FILE *log_stream);
+static TestResult    runErrorTest(const char *inputs[static 2], FILE *log_stream);
 
 static const TestType test_types[] = {
     {.name="compiler", .routine=runCompilerTest, .fields=(const char*[]){"source", "bytecode", NULL}},
     {.name="runtime",  .routine=runRuntimeTest,  .fields=(const char*[]){"bytecode", "output", NULL}},
+    {.name="error",    .routine=runErrorTest,    .fields=(const char*[]){"source", "error", NULL}},
     {.name=NULL, .fields=NULL, .routine=NULL},
 };
 
@@ -134,6 +136,63 @@ static TestResult runRuntimeTest(const char *inputs[static 2], FILE *log_stream)
         fprintf(stderr, "Error: Expected output [%s] but got [%s]\n", inputs[1], buffer);
     }
     
+    Error_Free(&error);
+    Runtime_Free(runtime);
+    return result;
+}
+
+// Runs a source that is expected to fail. The output of
+// the program, followed by the error and the stack trace
+// it caused, must match the expected error text.
+static TestResult runErrorTest(const char *inputs[static 2], FILE *log_stream)
+{
+    char buffer[1024];
+    
+    FILE *output_stream = fmemopen(buffer, sizeof(buffer), "wb");
+    if (output_stream == NULL)
+        return TestResult_ABORTED;
+
+    RuntimeConfig config = Runtime_GetDefaultConfigs();
+    config.stdout = output_stream;
+
+    Runtime *runtime = Runtime_New(config);
+    if (runtime == NULL) {
+        fclose(output_stream);
+        return TestResult_ABORTED;
+    }
+
+    Error error;
+    Error_Init(&error);
+
+    if (!Runtime_plugDefaultBuiltins(runtime, &error)) {
+        Error_Print(&error, ErrorType_UNSPECIFIED, log_stream);
+        Error_Free(&error);
+        Runtime_PrintStackTrace(runtime, log_stream);
+        Runtime_Free(runtime);
+        fclose(output_stream);
+        return TestResult_ABORTED;
+    }
+
+    Object *rets[MAX_RETS];
+    if (runStringEx(runtime, "<test>", inputs[0], rets, &error) >= 0) {
+        fprintf(stderr, "Error: Expected the source to fail\n");
+        Error_Free(&error);
+        Runtime_Free(runtime);
+        fclose(output_stream);
+        return TestResult_FAILED;
+    }
+    Error_Print(&error, ErrorType_RUNTIME, output_stream);
+    Runtime_PrintStackTrace(runtime, output_stream);
+    fclose(output_stream);
+
+    TestResult result;
+    if (!strcmp(buffer, inputs[1])) // No bounds checks
+        result = TestResult_PASSED;
+    else {
+        result = TestResult_FAILED;
+        fprintf(stderr, "Error: Expected error [%s] but got [%s]\n", inputs[1], buffer);
+    }
+    
     Error_Free(&error);
     Runtime_Free(runtime);
     return result;
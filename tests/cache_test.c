@@ -0,0 +1,594 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "../src/lib/run.h"
+#include "../src/lib/runtime.h"
+#include "../src/lib/executable.h"
+#include "../src/lib/pool.h"
+#include "../src/lib/codecache.h"
+#include "../src/lib/utils/hash.h"
+#include "../src/lib/compiler/compile.h"
+
+static int failed = 0;
+
+static void stopTesting_(const char *file, int line)
+{
+    fprintf(stderr, "\n%s:%d :: Failed to set up test environment\n", file, line);
+    abort();
+}
+#define stopTestingIf(exp)                    \
+    do {                                      \
+        if(exp) {                             \
+            stopTesting_(__FILE__, __LINE__); \
+        }                                     \
+    } while(0);
+
+static void testCase(int line, bool exp, const char *msg)
+{
+    if(exp == false) {
+        fprintf(stdout, "Test case failed (line %d) :: %s\n", line, msg);
+        failed++;
+    } else
+        fprintf(stdout, "Test case passed (line %d)\n", line);
+}
+
+// Everything the runtimes of the tests print goes
+// to this stream. [outputIs] checks what was printed
+// since it was last called.
+static FILE  *output;
+static char  *output_buf;
+static size_t output_len;
+static size_t output_seen;
+
+static bool outputIs(const char *expected)
+{
+    fflush(output);
+    size_t len = output_len - output_seen;
+    bool same = (len == strlen(expected) && !memcmp(output_buf + output_seen, expected, len));
+    output_seen = output_len;
+    return same;
+}
+
+static RuntimeConfig makeConfig(void)
+{
+    RuntimeConfig config = Runtime_GetDefaultConfigs();
+    config.stdout = output;
+    return config;
+}
+
+static Runtime *newRuntime(RuntimeConfig config)
+{
+    Error error;
+    Error_Init(&error);
+
+    Runtime *runtime = Runtime_New(config);
+    stopTestingIf(runtime == NULL);
+    stopTestingIf(!Runtime_plugDefaultBuiltins(runtime, &error));
+
+    Error_Free(&error);
+    return runtime;
+}
+
+static bool run(Runtime *runtime, const char *code)
+{
+    Error error;
+    Error_Init(&error);
+    bool ok = runString(runtime, code, &error);
+    if(!ok)
+        fprintf(stderr, "Run error :: %s.\n", error.message);
+    Error_Free(&error);
+    return ok;
+}
+
+static void writeFile(const char *path, const char *data, size_t size)
+{
+    FILE *fp = fopen(path, "wb");
+    stopTestingIf(fp == NULL);
+    stopTestingIf(fwrite(data, 1, size, fp) != size);
+    fclose(fp);
+}
+
+static char *readFile(const char *path, size_t *size)
+{
+    FILE *fp = fopen(path, "rb");
+    stopTestingIf(fp == NULL);
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *data = malloc(*size + 1);
+    stopTestingIf(data == NULL);
+    stopTestingIf(fread(data, 1, *size, fp) != *size);
+    fclose(fp);
+    return data;
+}
+
+// Returns true if loading the executable file fails
+// with an error message that contains [message].
+static bool loadFails(const char *path, uint64_t hash, const char *message)
+{
+    Error error;
+    Error_Init(&error);
+    Executable *exe = Executable_Load(path, hash, &error);
+    bool ok = (exe == NULL && error.occurred && strstr(error.message, message) != NULL);
+    if(exe != NULL)
+        Executable_Free(exe);
+    Error_Free(&error);
+    return ok;
+}
+
+static void testExecutableFiles(const char *folder)
+{
+    Error error;
+    Error_Init(&error);
+
+    const char *code = "x = 1 + 2; print(x, 'ok');";
+    uint64_t hash = hashbytes64(code, strlen(code));
+
+    Source *src = Source_FromString("<test>", code, -1, &error);
+    stopTestingIf(src == NULL);
+
+    int error_offset;
+    Executable *exe = compile(src, &error, &error_offset);
+    stopTestingIf(exe == NULL);
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/exe.nojac", folder);
+
+    // Round-trip: the loaded executable is the same
+    // as the saved one and runs like it.
+    testCase(__LINE__, Executable_Save(exe, path, hash, &error), "Failed to save an executable");
+    {
+        Executable *loaded = Executable_Load(path, hash, &error);
+        testCase(__LINE__, loaded != NULL, "Failed to load a saved executable");
+        if(loaded != NULL) {
+            testCase(__LINE__, Executable_Equiv(exe, loaded, stderr, "Executable diff :: "), "Loaded executable differs from the saved one");
+            stopTestingIf(!Executable_SetSource(loaded, src));
+
+            Runtime *runtime = newRuntime(makeConfig());
+            Object *rets[MAX_RETS];
+            testCase(__LINE__, runExecutable(runtime, loaded, rets, &error) >= 0, "Failed to run a loaded executable");
+            testCase(__LINE__, outputIs("3ok"), "Loaded executable printed the wrong output");
+            Runtime_Free(runtime);
+            Executable_Free(loaded);
+        }
+    }
+
+    // A file written for a different source is stale.
+    testCase(__LINE__, loadFails(path, hash + 1, "out of date"), "Loaded an executable with a different hash");
+
+    size_t size;
+    char *data = readFile(path, &size);
+
+    // Truncated files are rejected.
+    writeFile(path, data, size - 1);
+    testCase(__LINE__, loadFails(path, hash, "corrupted"), "Loaded a truncated executable");
+    writeFile(path, data, 8);
+    testCase(__LINE__, loadFails(path, hash, "isn't an executable"), "Loaded an executable without a header");
+
+    // Files with an unknown opcode or another magic
+    // number are rejected. The instructions follow the
+    // header and start with their opcode.
+    {
+        char *copy = malloc(size);
+        stopTestingIf(copy == NULL);
+
+        memcpy(copy, data, size);
+        memset(copy + 32, 0x7F, sizeof(int));
+        writeFile(path, copy, size);
+        testCase(__LINE__, loadFails(path, hash, "corrupted"), "Loaded an executable with an invalid opcode");
+
+        memcpy(copy, data, size);
+        copy[0] = 'X';
+        writeFile(path, copy, size);
+        testCase(__LINE__, loadFails(path, hash, "Not an executable"), "Loaded an executable with the wrong magic");
+
+        free(copy);
+    }
+    free(data);
+    remove(path);
+
+    Executable_Free(exe);
+    Source_Free(src);
+    Error_Free(&error);
+}
+
+static void testCacheFolder(const char *folder)
+{
+    char script[1024];
+    snprintf(script, sizeof(script), "%s/script.noja", folder);
+
+    const char *code = "print('hello');";
+    writeFile(script, code, strlen(code));
+
+    RuntimeConfig config = makeConfig();
+    config.cache = folder;
+
+    Error error;
+    Error_Init(&error);
+
+    // The first run stores the executable in
+    // the folder and the second one uses it.
+    Runtime *runtime = newRuntime(config);
+    testCase(__LINE__, runFile(runtime, script, &error), "Failed to run a script with a cache folder");
+    testCase(__LINE__, runFile(runtime, script, &error), "Failed to run a cached script");
+    testCase(__LINE__, outputIs("hellohello"), "Cached script printed the wrong output");
+
+    char cached[1024];
+    {
+        char absolute[1024];
+        stopTestingIf(realpath(script, absolute) == NULL);
+        uint64_t hash = hashbytes64(absolute, strlen(absolute));
+        snprintf(cached, sizeof(cached), "%s/%016llx.nojac", folder, (unsigned long long) hash);
+    }
+    testCase(__LINE__, access(cached, F_OK) == 0, "The cache folder has no executable for the script");
+
+    // A corrupted cache file is ignored and
+    // replaced by a valid one.
+    writeFile(cached, "garbage", 7);
+    testCase(__LINE__, runFile(runtime, script, &error), "Failed to run a script with a corrupted cache file");
+    testCase(__LINE__, outputIs("hello"), "Script with a corrupted cache file printed the wrong output");
+    {
+        size_t size;
+        char *data = readFile(cached, &size);
+        testCase(__LINE__, size > 7, "The corrupted cache file wasn't replaced");
+        free(data);
+    }
+
+    // A changed script doesn't use the old file.
+    code = "print('changed');";
+    writeFile(script, code, strlen(code));
+    testCase(__LINE__, runFile(runtime, script, &error), "Failed to run a changed script");
+    testCase(__LINE__, outputIs("changed"), "Changed script used a stale cache file");
+
+    Runtime_Free(runtime);
+    remove(cached);
+    remove(script);
+    Error_Free(&error);
+}
+
+// Makes an image of a runtime with some builtins
+// added to the default ones.
+static RuntimeImage *makeImage(void)
+{
+    Error error;
+    Error_Init(&error);
+
+    Runtime *runtime = newRuntime(makeConfig());
+    stopTestingIf(!Runtime_plugBuiltinsFromString(runtime, "answer = 42; counter = {n: 0};", &error));
+
+    RuntimeImage *image = RuntimeImage_FromRuntime(runtime, &error);
+    stopTestingIf(image == NULL);
+
+    Runtime_Free(runtime);
+    Error_Free(&error);
+    return image;
+}
+
+static void testImages(const char *folder)
+{
+    Error error;
+    Error_Init(&error);
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/runtime.image", folder);
+
+    // Round-trip: a runtime made from a loaded image
+    // has the builtins of the saved runtime.
+    {
+        RuntimeImage *image = makeImage();
+        testCase(__LINE__, RuntimeImage_Save(image, path, &error), "Failed to save an image");
+        RuntimeImage_Free(image);
+
+        RuntimeImage *loaded = RuntimeImage_Load(path, &error);
+        testCase(__LINE__, loaded != NULL, "Failed to load a saved image");
+        if(loaded != NULL) {
+            Runtime *runtime = Runtime_NewFromImage(loaded, makeConfig(), &error);
+            testCase(__LINE__, runtime != NULL, "Failed to make a runtime from a loaded image");
+            RuntimeImage_Free(loaded);
+
+            if(runtime != NULL) {
+                testCase(__LINE__, run(runtime, "print(answer, counter.n, math.floor(1.5));"), "Failed to run a script on a runtime from an image");
+                testCase(__LINE__, outputIs("4201"), "Runtime from an image printed the wrong output");
+                Runtime_Free(runtime);
+            }
+        }
+        remove(path);
+    }
+
+    // Open files can't be stored in an image.
+    {
+        char file[1024];
+        snprintf(file, sizeof(file), "%s/opened.txt", folder);
+
+        char code[2048];
+        snprintf(code, sizeof(code), "stream = files.openFile('%s', files.WRITE);", file);
+
+        Runtime *runtime = newRuntime(makeConfig());
+        stopTestingIf(!Runtime_plugBuiltinsFromString(runtime, code, &error));
+
+        RuntimeImage *image = RuntimeImage_FromRuntime(runtime, &error);
+        testCase(__LINE__, image == NULL, "Stored an open file in an image");
+        testCase(__LINE__, error.occurred && strstr(error.message, "can't be stored in an image") != NULL, "Storing a file in an image didn't report why it failed");
+        if(image != NULL)
+            RuntimeImage_Free(image);
+
+        Runtime_Free(runtime);
+        remove(file);
+    }
+
+    Error_Free(&error);
+}
+
+static void testPools(void)
+{
+    Error error;
+    Error_Init(&error);
+
+    RuntimeImage *image = makeImage();
+    RuntimePool *pool = RuntimePool_New(image, makeConfig(), 1, &error);
+    stopTestingIf(pool == NULL);
+
+    // Changes made by a script don't survive the
+    // release of its runtime.
+    Runtime *runtime = RuntimePool_Acquire(pool, &error);
+    testCase(__LINE__, runtime != NULL, "Failed to acquire a runtime");
+    if(runtime != NULL) {
+        testCase(__LINE__, run(runtime, "counter.n = 5; print(counter.n);"), "Failed to change a builtin");
+        testCase(__LINE__, outputIs("5"), "Changing a builtin printed the wrong output");
+        RuntimePool_Release(pool, runtime);
+    }
+
+    Runtime *reused = RuntimePool_Acquire(pool, &error);
+    testCase(__LINE__, reused != NULL, "Failed to acquire a released runtime");
+    if(reused != NULL) {
+        testCase(__LINE__, reused == runtime, "The pool didn't reuse the released runtime");
+        testCase(__LINE__, run(reused, "print(counter.n, answer);"), "Failed to run a script on a released runtime");
+        testCase(__LINE__, outputIs("042"), "Released runtime kept the changes of the previous script");
+        RuntimePool_Release(pool, reused);
+    }
+
+    RuntimePool_Free(pool);
+    RuntimeImage_Free(image);
+    Error_Free(&error);
+}
+
+// Returns true if [source] is in the cache. The
+// lookup counts as a hit or a miss.
+static bool isCached(CodeCache *cache, Source *source)
+{
+    uint64_t hash = hashbytes64(Source_GetBody(source), Source_GetSize(source));
+    Executable *exe = CodeCache_Lookup(cache, source, hash);
+    if(exe == NULL)
+        return false;
+    Executable_Free(exe);
+    return true;
+}
+
+static bool statsAre(CodeCache *cache, size_t hits, size_t misses, int count)
+{
+    CodeCacheStats stats;
+    CodeCache_GetStats(cache, &stats);
+    return stats.hits == hits && stats.misses == misses && stats.count == count;
+}
+
+static void testCodeCache(void)
+{
+    Error error;
+    Error_Init(&error);
+
+    const char *code = "print(1);";
+    uint64_t hash = hashbytes64(code, strlen(code));
+
+    const char *names[] = {"a", "b", "c"};
+    Source     *srcs[3];
+    Executable *exes[3];
+    for(int i = 0; i < 3; i++) {
+        srcs[i] = Source_FromString(names[i], code, -1, &error);
+        stopTestingIf(srcs[i] == NULL);
+        int error_offset;
+        exes[i] = compile(srcs[i], &error, &error_offset);
+        stopTestingIf(exes[i] == NULL);
+    }
+
+    CodeCache *cache = CodeCache_New(2);
+    stopTestingIf(cache == NULL);
+
+    // Looking up [a] makes [b] the least recently
+    // used entry, so it's the one dropped for [c].
+    for(int i = 0; i < 2; i++)
+        CodeCache_Insert(cache, srcs[i], hash, exes[i]);
+    testCase(__LINE__, isCached(cache, srcs[0]), "Inserted source isn't in the cache");
+    CodeCache_Insert(cache, srcs[2], hash, exes[2]);
+
+    testCase(__LINE__, !isCached(cache, srcs[1]), "The least recently used source wasn't dropped");
+    testCase(__LINE__, isCached(cache, srcs[0]), "A recently used source was dropped");
+    testCase(__LINE__, isCached(cache, srcs[2]), "The last inserted source isn't in the cache");
+    testCase(__LINE__, statsAre(cache, 3, 1, 2), "Wrong cache counters after evicting an entry");
+
+    {
+        CodeCacheStats stats;
+        CodeCache_GetStats(cache, &stats);
+        testCase(__LINE__, stats.capacity == 2, "Wrong cache capacity");
+    }
+    CodeCache_Free(cache);
+
+    for(int i = 0; i < 3; i++) {
+        Executable_Free(exes[i]);
+        Source_Free(srcs[i]);
+    }
+
+    // Runtimes look up the strings they run in their
+    // cache and store the ones that miss.
+    cache = CodeCache_New(4);
+    stopTestingIf(cache == NULL);
+    {
+        RuntimeConfig config = makeConfig();
+        config.codecache = cache;
+
+        Runtime *runtime = newRuntime(config);
+        testCase(__LINE__, run(runtime, "print('x');"), "Failed to run a string with a code cache");
+        testCase(__LINE__, statsAre(cache, 0, 1, 1), "Wrong cache counters after running a new string");
+        testCase(__LINE__, run(runtime, "print('x');"), "Failed to run a cached string");
+        testCase(__LINE__, statsAre(cache, 1, 1, 1), "Wrong cache counters after running a cached string");
+        testCase(__LINE__, outputIs("xx"), "Cached string printed the wrong output");
+        Runtime_Free(runtime);
+    }
+    CodeCache_Free(cache);
+
+    Error_Free(&error);
+}
+
+// A failed native call leaves its frame on the stack
+// for the stack trace, but its arguments are freed, so
+// the collections of the next runs must not walk them.
+static void testFailedNativeCall(void)
+{
+    Error error;
+    Error_Init(&error);
+
+    RuntimeConfig config = makeConfig();
+    config.heap = 65536;
+
+    Runtime *runtime = newRuntime(config);
+    testCase(__LINE__, !runString(runtime, "string.find('a');", &error), "A native call with missing arguments didn't fail");
+    Error_Free(&error);
+
+    testCase(__LINE__, run(runtime, "l = []; i = 0; while i < 10000: { l = [i, 'item', {k: i}]; i = i+1; } print(l[0]);"), "Failed to collect garbage after a failed native call");
+    testCase(__LINE__, outputIs("9999"), "Script after a failed native call printed the wrong output");
+    Runtime_Free(runtime);
+}
+
+static void writeScript(const char *folder, const char *name, const char *code)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", folder, name);
+    writeFile(path, code, strlen(code));
+}
+
+// Runs the script in the folder and returns true if it
+// fails with an error message that contains [message].
+static bool scriptFails(Runtime *runtime, const char *folder, const char *name, const char *message)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", folder, name);
+
+    Error error;
+    Error_Init(&error);
+    bool ok = !runFile(runtime, path, &error) && strstr(error.message, message) != NULL;
+    if(!ok)
+        fprintf(stderr, "Unexpected error :: %s.\n", error.occurred ? error.message : "(none)");
+    Error_Free(&error);
+    return ok;
+}
+
+static bool runScript(Runtime *runtime, const char *folder, const char *name)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", folder, name);
+
+    Error error;
+    Error_Init(&error);
+    bool ok = runFile(runtime, path, &error);
+    if(!ok)
+        fprintf(stderr, "Run error :: %s.\n", error.message);
+    Error_Free(&error);
+    return ok;
+}
+
+static void removeScripts(const char *folder, const char **names)
+{
+    for(int i = 0; names[i] != NULL; i++) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", folder, names[i]);
+        remove(path);
+    }
+}
+
+static void testImports(const char *folder)
+{
+    writeScript(folder, "mod.noja", "print('run'); return 7;");
+    writeScript(folder, "main.noja", "a = import('mod.noja'); b = import('mod.noja'); print(a, b);");
+    writeScript(folder, "reload.noja", "print(reload('mod.noja'));");
+
+    // Modules are run by the first import of each runtime
+    // and the next imports return the same values.
+    {
+        Runtime *runtime = newRuntime(makeConfig());
+        testCase(__LINE__, runScript(runtime, folder, "main.noja"), "Failed to import a module");
+        testCase(__LINE__, outputIs("run77"), "A module was run more than once by the same script");
+        testCase(__LINE__, runScript(runtime, folder, "main.noja"), "Failed to import a module again");
+        testCase(__LINE__, outputIs("77"), "A module was run again by a later script");
+
+        // Reloading runs the module even if it didn't
+        // change.
+        testCase(__LINE__, runScript(runtime, folder, "reload.noja"), "Failed to reload a module");
+        testCase(__LINE__, outputIs("run7"), "Reloading didn't run the module");
+
+        // Changing the file makes the next import run it.
+        // The first version is dated in the past, since
+        // two writes may get the same modification time.
+        {
+            char path[1024];
+            snprintf(path, sizeof(path), "%s/mod.noja", folder);
+            struct timespec times[2] = {{.tv_sec = 1000}, {.tv_sec = 1000}};
+            stopTestingIf(utimensat(AT_FDCWD, path, times, 0));
+        }
+        testCase(__LINE__, runScript(runtime, folder, "main.noja"), "Failed to import a module with a new date");
+        testCase(__LINE__, outputIs("run77"), "A module with a new date wasn't run again");
+
+        writeScript(folder, "mod.noja", "print('new'); return 8;");
+        testCase(__LINE__, runScript(runtime, folder, "main.noja"), "Failed to import a changed module");
+        testCase(__LINE__, outputIs("new88"), "A changed module wasn't run again");
+        Runtime_Free(runtime);
+    }
+
+    // Cycles are errors that name the file imported
+    // while it was running, also when it's the main
+    // script, which isn't run a second time.
+    writeScript(folder, "x.noja", "import('a.noja');");
+    writeScript(folder, "a.noja", "import('b.noja');");
+    writeScript(folder, "b.noja", "import('a.noja');");
+    writeScript(folder, "top.noja", "print('top'); import('c.noja');");
+    writeScript(folder, "c.noja", "import('top.noja');");
+    {
+        Runtime *runtime = newRuntime(makeConfig());
+        testCase(__LINE__, scriptFails(runtime, folder, "x.noja", "/a.noja\""), "A cycle between modules wasn't detected");
+        testCase(__LINE__, scriptFails(runtime, folder, "top.noja", "/top.noja\""), "A cycle back to the main script didn't name it");
+        testCase(__LINE__, outputIs("top"), "The main script was run again by a cycle");
+
+        // A failed script can be run again.
+        writeScript(folder, "c.noja", "return 1;");
+        testCase(__LINE__, runScript(runtime, folder, "top.noja"), "Failed to run a script after a cycle");
+        testCase(__LINE__, outputIs("top"), "Script after a cycle printed the wrong output");
+        Runtime_Free(runtime);
+    }
+
+    const char *names[] = {"mod.noja", "main.noja", "reload.noja", "x.noja", "a.noja", "b.noja", "top.noja", "c.noja", NULL};
+    removeScripts(folder, names);
+}
+
+int main()
+{
+    output = open_memstream(&output_buf, &output_len);
+    stopTestingIf(output == NULL);
+
+    char folder[] = "/tmp/noja_cache_test.XXXXXX";
+    stopTestingIf(mkdtemp(folder) == NULL);
+
+    testExecutableFiles(folder);
+    testCacheFolder(folder);
+    testImages(folder);
+    testPools();
+    testCodeCache();
+    testFailedNativeCall();
+    testImports(folder);
+
+    rmdir(folder);
+    fclose(output);
+    free(output_buf);
+    return failed > 0;
+}
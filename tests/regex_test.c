@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "../src/lib/utils/regex.h"
+
+static int failed = 0;
+
+static void stopTesting_(const char *file, int line)
+{
+    fprintf(stderr, "\n%s:%d :: Failed to set up test environment\n", file, line);
+    abort();
+}
+#define stopTestingIf(exp)                    \
+    do {                                      \
+        if(exp) {                             \
+            stopTesting_(__FILE__, __LINE__); \
+        }                                     \
+    } while(0);
+
+static void testCase(int line, bool exp, const char *msg)
+{
+    if(exp == false) {
+        fprintf(stdout, "Test case failed (line %d) :: %s\n", line, msg);
+        failed++;
+    } else
+        fprintf(stdout, "Test case passed (line %d)\n", line);
+}
+
+// Returns the result of matching [pattern] against
+// [str] from [start], and stores where the match
+// starts in [where] (or -1 if there was no match).
+static int exec(const char *pattern, const char *str, size_t start, RegexMode mode, long long int *where)
+{
+    Error error;
+    Error_Init(&error);
+
+    Regex *regex = Regex_Compile(pattern, strlen(pattern), &error);
+    stopTestingIf(regex == NULL);
+
+    long long int caps[2 * Regex_GroupCount(regex)];
+    int res = Regex_Exec(regex, str, strlen(str), start, mode, caps, &error);
+    stopTestingIf(res < 0);
+
+    if(where != NULL)
+        *where = (res == 1) ? caps[0] : -1;
+
+    Regex_Free(regex);
+    Error_Free(&error);
+    return res;
+}
+
+// Anchored matches must not skip ahead to the first
+// occurrence of the pattern's first byte, like searches
+// do.
+static void testAnchoredMatches(void)
+{
+    long long int where;
+
+    testCase(__LINE__, exec("ab", "xab", 0, RegexMode_FULL,   NULL) == 0, "Full match skipped to a later position");
+    testCase(__LINE__, exec("a",  "ba",  0, RegexMode_FULL,   NULL) == 0, "Full match skipped to a later position");
+    testCase(__LINE__, exec("ab", "xab", 1, RegexMode_FULL,   NULL) == 1, "Full match failed at the starting offset");
+    testCase(__LINE__, exec("ab", "xab", 0, RegexMode_PREFIX, NULL) == 0, "Prefix match skipped to a later position");
+    testCase(__LINE__, exec("a",  "ba",  0, RegexMode_PREFIX, NULL) == 0, "Prefix match skipped to a later position");
+    testCase(__LINE__, exec("ab", "abx", 0, RegexMode_PREFIX, NULL) == 1, "Prefix match failed at the starting offset");
+
+    testCase(__LINE__, exec("ab", "xxab", 1, RegexMode_PREFIX, &where) == 0, "Prefix match skipped past the starting offset");
+    testCase(__LINE__, exec("ab", "xxab", 2, RegexMode_PREFIX, &where) == 1 && where == 2, "Prefix match failed at the starting offset");
+    testCase(__LINE__, exec("ab", "xxab", 0, RegexMode_SEARCH, &where) == 1 && where == 2, "Search didn't find a later match");
+}
+
+int main()
+{
+    testAnchoredMatches();
+    return failed > 0;
+}